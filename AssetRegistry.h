@@ -0,0 +1,123 @@
+/**
+ * @file AssetRegistry.h
+ * @brief Общий для процесса реестр неизменяемых ресурсов: шрифтов и уровней.
+ *
+ * Каждый ресурс загружается один раз при первом запросе; параллельные запросы того же ресурса
+ * дожидаются первой загрузки. Неудачная загрузка не запоминается: следующий запрос загружает заново. Игры получают разделяемые указатели только для чтения,
+ * поэтому создание новой сессии не читает файлов и не копирует уровень.
+ * Навигационные данные уровня входят в ресурс уровня (Manager) и тоже строятся один раз.
+ * Уровень по умолчанию в сборке с PACMAN_EMBED_DEFAULT_LEVEL берется из программы (EmbeddedLevel.h).
+ */
+
+#pragma once
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <SFML/Graphics/Font.hpp>
+
+#include "EmbeddedLevel.h"
+#include "Manager.h"
+
+/**
+ * @class AssetRegistry
+ * @brief Потокобезопасный кэш ресурсов с ленивой загрузкой.
+ */
+class AssetRegistry {
+public:
+    static AssetRegistry &Instance() {
+        static AssetRegistry registry;
+        return registry;
+    }
+
+    /**
+     * @brief Возвращает шрифт, загружая его при первом запросе.
+     *
+     * sf::Font растеризует глифы лениво при первом использовании, поэтому текст одним шрифтом
+     * следует отрисовывать из одного потока одновременно.
+     * @param path Путь к файлу шрифта.
+     */
+    std::shared_ptr<const sf::Font> GetFont(const std::string &path) {
+        return GetOrLoad(m_fonts, path, [](const std::string &fontPath) {
+            auto font = std::make_shared<sf::Font>();
+            if (!font->loadFromFile(fontPath)) {
+                std::cerr << "Couldn't load the font: " << fontPath << std::endl;
+            }
+            return std::shared_ptr<const sf::Font>(std::move(font));
+        });
+    }
+
+    /**
+     * @brief Возвращает уровень вместе с его навигационными данными, загружая его при первом запросе.
+     * @param path Путь к уровню (CSV или .pml); cnp::default_level_path() во встроенной сборке не читается.
+     * @return nullptr, если уровень не загрузился.
+     */
+    std::shared_ptr<const Manager> GetLevel(const std::string &path) {
+        return GetOrLoad(m_levels, path, [](const std::string &levelPath) {
+            auto level = std::make_shared<Manager>();
+#if defined(PACMAN_EMBED_DEFAULT_LEVEL)
+            // Уровень по умолчанию встроен в программу и разобран при компиляции
+            if (levelPath == cnp::default_level_path() && level->LoadEmbeddedLevel(lvl::embedded::k_defaultLevel)) {
+                return std::shared_ptr<const Manager>(std::move(level));
+            }
+#endif
+            if (!level->LoadLevel(levelPath)) {
+                std::cerr << "Error loading level data" << std::endl;
+                return std::shared_ptr<const Manager>();
+            }
+            return std::shared_ptr<const Manager>(std::move(level));
+        });
+    }
+
+    /**
+     * @brief Забывает все ресурсы. Уже выданные указатели остаются действительными.
+     */
+    void Clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fonts.clear();
+        m_levels.clear();
+    }
+
+private:
+    template<typename Asset>
+    using Cache = std::map<std::string, std::shared_future<std::shared_ptr<const Asset>>>;
+
+    std::mutex m_mutex;
+    Cache<sf::Font> m_fonts;
+    Cache<Manager> m_levels;
+
+    AssetRegistry() = default;
+
+    /**
+     * @brief Возвращает ресурс из кэша или загружает его вне блокировки реестра.
+     *
+     * Если загрузчик вернул nullptr, ресурс убирается из кэша; ждавшие его запросы тоже получают nullptr.
+     */
+    template<typename Asset, typename Loader>
+    std::shared_ptr<const Asset> GetOrLoad(Cache<Asset> &cache, const std::string &path, Loader &&loader) {
+        std::promise<std::shared_ptr<const Asset>> promise;
+        std::shared_future<std::shared_ptr<const Asset>> pending;
+        bool loading = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = cache.find(path);
+            if (found == cache.end()) {
+                found = cache.emplace(path, promise.get_future().share()).first;
+                loading = true;
+            }
+            pending = found->second;
+        }
+        if (!loading) return pending.get();
+
+        auto asset = loader(path);
+        if (!asset) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            cache.erase(path);
+        }
+        promise.set_value(asset);
+        return asset;
+    }
+};
@@ -0,0 +1,322 @@
+/**
+ * @file Canvas.h
+ * @brief Определение класса Canvas.
+ *
+ * Класс Canvas представляет собой программный растеризатор в RGBA-буфер в памяти.
+ * Используется для отрисовки кадров без sf::RenderWindow (например, на серверах без дисплея).
+ *
+ * Кадр можно не рисовать сразу, а записать командами (BeginRecording) и растеризовать позже
+ * в другом потоке (Replay): запись - это снимок того, что видно в кадре.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/System/Vector2.hpp>
+
+/**
+ * @class Canvas
+ * @brief Программный растеризатор прямоугольников, кругов и текста HUD.
+ */
+class Canvas {
+public:
+    /**
+     * @brief Конструктор класса Canvas.
+     * @param width Ширина буфера в пикселях.
+     * @param height Высота буфера в пикселях.
+     */
+    Canvas(const unsigned width, const unsigned height) :
+            m_width(width),
+            m_height(height),
+            m_pixels(static_cast<std::size_t>(width) * height * 4, 0) {
+    }
+
+    /**
+     * @brief Заливает весь буфер указанным цветом.
+     * @param colour Цвет заливки.
+     */
+    void Clear(const sf::Color colour = sf::Color::Black) {
+        if (m_recording) {
+            Record(eCommand::e_Clear, {}, {}, colour);
+            return;
+        }
+
+        for (std::size_t i = 0; i < m_pixels.size(); i += 4) {
+            m_pixels[i] = colour.r;
+            m_pixels[i + 1] = colour.g;
+            m_pixels[i + 2] = colour.b;
+            m_pixels[i + 3] = colour.a;
+        }
+    }
+
+    /**
+     * @brief Рисует залитый прямоугольник с учетом альфа-канала.
+     * @param position Левый верхний угол прямоугольника.
+     * @param size Размер прямоугольника.
+     * @param colour Цвет заливки.
+     */
+    void FillRect(const sf::Vector2i position, const sf::Vector2i size, const sf::Color colour) {
+        if (m_recording) {
+            Record(eCommand::e_Rect, sf::Vector2f(position), sf::Vector2f(size), colour);
+            return;
+        }
+
+        const int x0 = position.x < 0 ? 0 : position.x;
+        const int y0 = position.y < 0 ? 0 : position.y;
+        const int x1 = Clamp(position.x + size.x, static_cast<int>(m_width));
+        const int y1 = Clamp(position.y + size.y, static_cast<int>(m_height));
+
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                BlendPixel(x, y, colour);
+            }
+        }
+    }
+
+    /**
+     * @brief Рисует залитый круг с учетом альфа-канала.
+     * @param centre Центр круга.
+     * @param radius Радиус круга.
+     * @param colour Цвет заливки.
+     */
+    void FillCircle(const sf::Vector2f centre, const float radius, const sf::Color colour) {
+        if (m_recording) {
+            Record(eCommand::e_Circle, centre, {radius, radius}, colour);
+            return;
+        }
+
+        const int x0 = Clamp(static_cast<int>(centre.x - radius), static_cast<int>(m_width));
+        const int y0 = Clamp(static_cast<int>(centre.y - radius), static_cast<int>(m_height));
+        const int x1 = Clamp(static_cast<int>(centre.x + radius) + 1, static_cast<int>(m_width));
+        const int y1 = Clamp(static_cast<int>(centre.y + radius) + 1, static_cast<int>(m_height));
+        const float radiusSquared = radius * radius;
+
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                // Проверяем центр пикселя
+                const float dx = static_cast<float>(x) + 0.5f - centre.x;
+                const float dy = static_cast<float>(y) + 0.5f - centre.y;
+                if (dx * dx + dy * dy <= radiusSquared) {
+                    BlendPixel(x, y, colour);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Рисует строку встроенным растровым шрифтом 5x7.
+     *
+     * Строчные буквы выводятся как прописные, неизвестные символы пропускаются.
+     *
+     * @param text Строка для отрисовки.
+     * @param characterSize Высота символа в пикселях (как у sf::Text).
+     * @param position Левый верхний угол строки.
+     * @param colour Цвет текста.
+     */
+    void DrawText(const std::string &text, const unsigned characterSize, const sf::Vector2f position,
+                  const sf::Color colour) {
+        if (m_recording) {
+            Record(eCommand::e_Text, position, {static_cast<float>(characterSize), 0.f}, colour);
+            m_commands.back().m_textOffset = static_cast<std::uint32_t>(m_text.size());
+            m_commands.back().m_textLength = static_cast<std::uint32_t>(text.size());
+            m_text += text;
+            return;
+        }
+
+        const int scale = characterSize / 8 > 0 ? static_cast<int>(characterSize / 8) : 1;
+        int penX = static_cast<int>(position.x);
+        const int penY = static_cast<int>(position.y);
+
+        for (const char character : text) {
+            const std::uint8_t *rows = GetGlyph(character);
+            if (rows) {
+                for (int row = 0; row < k_glyphHeight; ++row) {
+                    for (int column = 0; column < k_glyphWidth; ++column) {
+                        if (rows[row] & (1 << (k_glyphWidth - 1 - column))) {
+                            FillRect({penX + column * scale, penY + row * scale}, {scale, scale}, colour);
+                        }
+                    }
+                }
+            }
+            penX += (k_glyphWidth + 1) * scale;
+        }
+    }
+
+    /**
+     * @brief Включает запись: Clear, FillRect, FillCircle и DrawText запоминают команды вместо отрисовки.
+     *
+     * Запись заменяет команды прошлого кадра; память под них переиспользуется.
+     */
+    void BeginRecording() {
+        m_commands.clear();
+        m_text.clear();
+        m_recording = true;
+    }
+
+    /**
+     * @brief Выключает запись и растеризует записанные команды в буфер.
+     */
+    void Replay() {
+        m_recording = false;
+        for (const Command &command : m_commands) {
+            switch (command.m_type) {
+                case eCommand::e_Clear:
+                    Clear(command.m_colour);
+                    break;
+                case eCommand::e_Rect:
+                    FillRect(sf::Vector2i(command.m_position), sf::Vector2i(command.m_size), command.m_colour);
+                    break;
+                case eCommand::e_Circle:
+                    FillCircle(command.m_position, command.m_size.x, command.m_colour);
+                    break;
+                case eCommand::e_Text:
+                    DrawText(m_text.substr(command.m_textOffset, command.m_textLength),
+                             static_cast<unsigned>(command.m_size.x), command.m_position, command.m_colour);
+                    break;
+            }
+        }
+    }
+
+    /**
+     * @brief Возвращает пиксели буфера в формате RGBA построчно.
+     * @return Ссылка на массив пикселей.
+     */
+    const std::vector<std::uint8_t> &GetPixels() const {
+        return m_pixels;
+    }
+
+    unsigned GetWidth() const {
+        return m_width;
+    }
+
+    unsigned GetHeight() const {
+        return m_height;
+    }
+
+private:
+    static constexpr int k_glyphWidth = 5; ///< Ширина символа растрового шрифта.
+    static constexpr int k_glyphHeight = 7; ///< Высота символа растрового шрифта.
+
+    /**
+     * @enum eCommand
+     * @brief Записанные команды отрисовки.
+     */
+    enum class eCommand : std::uint8_t {
+        e_Clear,
+        e_Rect,
+        e_Circle,
+        e_Text
+    };
+
+    /**
+     * @struct Command
+     * @brief Команда отрисовки с аргументами.
+     */
+    struct Command {
+        eCommand m_type;
+        sf::Color m_colour;
+        sf::Vector2f m_position; /**< Угол прямоугольника, центр круга или начало строки. */
+        sf::Vector2f m_size; /**< Размер прямоугольника; для круга x - радиус, для строки x - высота символа. */
+        std::uint32_t m_textOffset = 0; /**< Начало строки в m_text. */
+        std::uint32_t m_textLength = 0;
+    };
+
+    unsigned m_width; ///< Ширина буфера.
+    unsigned m_height; ///< Высота буфера.
+    std::vector<std::uint8_t> m_pixels; ///< Пиксели в формате RGBA.
+    bool m_recording = false; ///< Команды записываются, а не рисуются.
+    std::vector<Command> m_commands; ///< Команды записанного кадра.
+    std::string m_text; ///< Строки команд DrawText подряд.
+
+    void Record(const eCommand type, const sf::Vector2f position, const sf::Vector2f size, const sf::Color colour) {
+        m_commands.push_back({type, colour, position, size});
+    }
+
+    static int Clamp(const int value, const int max) {
+        if (value < 0) return 0;
+        return value > max ? max : value;
+    }
+
+    void BlendPixel(const int x, const int y, const sf::Color colour) {
+        std::uint8_t *pixel = &m_pixels[(static_cast<std::size_t>(y) * m_width + x) * 4];
+        if (colour.a == 255) {
+            pixel[0] = colour.r;
+            pixel[1] = colour.g;
+            pixel[2] = colour.b;
+            pixel[3] = 255;
+            return;
+        }
+
+        const unsigned alpha = colour.a;
+        pixel[0] = static_cast<std::uint8_t>((colour.r * alpha + pixel[0] * (255 - alpha)) / 255);
+        pixel[1] = static_cast<std::uint8_t>((colour.g * alpha + pixel[1] * (255 - alpha)) / 255);
+        pixel[2] = static_cast<std::uint8_t>((colour.b * alpha + pixel[2] * (255 - alpha)) / 255);
+        pixel[3] = static_cast<std::uint8_t>(alpha + pixel[3] * (255 - alpha) / 255);
+    }
+
+    /**
+     * @brief Возвращает строки растрового символа.
+     * @param character Символ.
+     * @return Указатель на 7 строк по 5 бит или nullptr для неизвестного символа.
+     */
+    static const std::uint8_t *GetGlyph(char character) {
+        struct Glyph {
+            char m_character;
+            std::uint8_t m_rows[k_glyphHeight];
+        };
+
+        static const Glyph k_glyphs[] = {
+                {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+                {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+                {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+                {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+                {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+                {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+                {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+                {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+                {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+                {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+                {'A', {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+                {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+                {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+                {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+                {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+                {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+                {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+                {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+                {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+                {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+                {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+                {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+                {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+                {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+                {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+                {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+                {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+                {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+                {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+                {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+                {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+                {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+                {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+                {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+                {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+                {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+                {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+                {'!', {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}},
+                {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+                {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+                {'/', {0x01, 0x02, 0x02, 0x04, 0x08, 0x08, 0x10}},
+        };
+
+        if (character >= 'a' && character <= 'z') character = static_cast<char>(character - 'a' + 'A');
+
+        for (const auto &glyph : k_glyphs) {
+            if (glyph.m_character == character) return glyph.m_rows;
+        }
+        return nullptr;
+    }
+};
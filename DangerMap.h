@@ -0,0 +1,275 @@
+/**
+ * @file DangerMap.h
+ * @brief Поля опасности и притяжения по клеткам уровня, пересчитываемые каждый тик.
+ *
+ * Источник (призрак, монета) задает значение своей клетки, а по лабиринту оно затухает в decay раз
+ * за шаг: значение клетки - decay^d ближайшего источника на расстоянии d шагов по проходимым клеткам,
+ * дальше радиуса поля - 0.
+ *
+ * Поле хранится уровнями: уровень клетки - радиус + 1 минус расстояние до источника (0 - вне радиуса),
+ * значение - decay^(радиус + 1 - уровень). Уровни строятся итерациями маскированной диффузии
+ *
+ *     v' = mask & max(seed, max(v слева, справа, сверху, снизу) - 1),
+ *
+ * за радиус итераций - то же, что поиск в ширину от всех источников сразу. Итерация - проход по байтам
+ * плоскости без ветвлений. Строки дополнены пустыми клетками до кратного 16 размера и окружены пустыми
+ * строками, поэтому соседи читаются без проверок границ, а проход векторизуется: AVX2 (32 клетки
+ * за команду) в сборке с PACMAN_ENABLE_AVX2, иначе SSE2 (16 клеток), на других архитектурах -
+ * скалярный цикл.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PACMAN_DANGER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PACMAN_DANGER_SSE2
+#endif
+
+#include "Entity.h"
+
+/**
+ * @enum eInfluence
+ * @brief Поля карты.
+ */
+enum class eInfluence : std::uint8_t {
+    e_Danger, ///< Близость преследующих и разбегающихся призраков.
+    e_Prey, ///< Близость испуганных призраков.
+    e_Attraction, ///< Близость монет и усилений.
+    e_Count
+};
+
+/**
+ * @class DangerMap
+ * @brief Поля влияния призраков и подборок на клетки уровня.
+ */
+class DangerMap {
+public:
+    static constexpr int k_ghostRadius = 8; ///< Радиус полей призраков, в шагах; столько же итераций диффузии.
+    static constexpr int k_attractionRadius = 12; ///< Радиус поля притяжения, в шагах.
+    static constexpr float k_ghostDecay = 0.75f; ///< Затухание полей призраков за шаг.
+    static constexpr float k_attractionDecay = 0.85f; ///< Затухание поля притяжения за шаг.
+
+    /**
+     * @brief Набор команд прохода диффузии в этой сборке.
+     */
+#if defined(PACMAN_DANGER_AVX2)
+    static constexpr const char *k_kernel = "AVX2";
+#elif defined(PACMAN_DANGER_SSE2)
+    static constexpr const char *k_kernel = "SSE2";
+#else
+    static constexpr const char *k_kernel = "scalar";
+#endif
+
+    /**
+     * @brief Размечает проходимые клетки уровня; память выделяется только здесь.
+     */
+    void Reset(const GridMetrics &metrics, const std::vector<std::vector<Tile>> &tiles) {
+        m_metrics = metrics;
+        m_columns = metrics.GetColumns();
+        m_rows = metrics.GetRows();
+        // Пустая клетка справа от строки - левый сосед первой клетки следующей строки
+        m_stride = (m_columns + 1 + k_lanes - 1) / k_lanes * k_lanes;
+        const std::size_t size = static_cast<std::size_t>(m_stride) * (m_rows + 2);
+
+        m_mask.assign(size, 0);
+        for (const auto &row: tiles) {
+            for (const Tile &tile: row) {
+                if (tile.m_type == eTileType::e_Wall) continue;
+                m_mask[Index(metrics.ToColumn(tile.m_position.x), metrics.ToRow(tile.m_position.y))] = 0xFF;
+            }
+        }
+        for (std::size_t field = 0; field < k_fields; ++field) {
+            m_seeds[field].assign(size, 0);
+            m_levels[field].assign(size, 0);
+            m_sources[field].clear();
+            m_sources[field].reserve(static_cast<std::size_t>(m_columns) * m_rows);
+            m_stale[field] = false;
+
+            // Значение уровня: decay^(радиус + 1 - уровень), уровень 0 - вне радиуса
+            const int radius = GetRadius(static_cast<eInfluence>(field));
+            const float decay = field == static_cast<std::size_t>(eInfluence::e_Attraction) ? k_attractionDecay
+                                                                                             : k_ghostDecay;
+            m_values[field].fill(0.f);
+            for (int level = 1; level <= radius + 1; ++level) {
+                m_values[field][level] = std::pow(decay, static_cast<float>(radius + 1 - level));
+            }
+        }
+        m_scratch.assign(size, 0);
+    }
+
+    /**
+     * @brief Убирает источники прошлого тика.
+     */
+    void ClearSources() {
+        for (std::size_t field = 0; field < k_fields; ++field) {
+            for (const std::uint32_t index: m_sources[field]) m_seeds[field][index] = 0;
+            m_stale[field] |= !m_sources[field].empty();
+            m_sources[field].clear();
+        }
+    }
+
+    /**
+     * @brief Источник поля в клетке; из нескольких источников клетки действует сильнейший.
+     * @param falloff Ослабление в шагах: источник весит как клетка в falloff шагах от источника полной силы.
+     */
+    void AddSource(const eInfluence field, const int column, const int row, const int falloff = 0) {
+        const std::size_t plane = static_cast<std::size_t>(field);
+        const int level = GetRadius(field) + 1 - falloff;
+        if (level <= 0) return;
+
+        const std::uint32_t index = Index(column, row);
+        if (m_seeds[plane][index] == 0) m_sources[plane].push_back(index);
+        m_seeds[plane][index] = std::max(m_seeds[plane][index], static_cast<std::uint8_t>(level));
+    }
+
+    /**
+     * @brief Источник поля в клетке позиции в пикселях.
+     */
+    void AddSource(const eInfluence field, const sf::Vector2i position, const int falloff = 0) {
+        AddSource(field, m_metrics.ToColumn(position.x), m_metrics.ToRow(position.y), falloff);
+    }
+
+    /**
+     * @brief Строит поля от текущих источников. Поле без источников ни в этом, ни в прошлом тике не трогается.
+     */
+    void Propagate() {
+        for (std::size_t field = 0; field < k_fields; ++field) {
+            Propagate(field, GetRadius(static_cast<eInfluence>(field)));
+        }
+    }
+
+    /**
+     * @brief Значение поля в клетке (0..1; 0 - вне радиуса источников или стена).
+     */
+    float Get(const eInfluence field, const int column, const int row) const {
+        return m_values[static_cast<std::size_t>(field)][GetLevel(field, column, row)];
+    }
+
+    /**
+     * @brief Значение поля в клетке позиции в пикселях.
+     */
+    float Get(const eInfluence field, const sf::Vector2i position) const {
+        return Get(field, m_metrics.ToColumn(position.x), m_metrics.ToRow(position.y));
+    }
+
+    /**
+     * @brief Уровень поля в клетке: радиус поля + 1 минус шагов до ближайшего источника (0 - вне радиуса).
+     */
+    std::uint8_t GetLevel(const eInfluence field, const int column, const int row) const {
+        if (column < 0 || column >= m_columns || row < 0 || row >= m_rows) return 0;
+        return m_levels[static_cast<std::size_t>(field)][Index(column, row)];
+    }
+
+    /**
+     * @brief Уровни строки для векторного чтения: GetColumns() клеток, за ними нули до GetStride().
+     */
+    const std::uint8_t *GetRow(const eInfluence field, const int row) const {
+        return m_levels[static_cast<std::size_t>(field)].data() + Index(0, row);
+    }
+
+    static constexpr int GetRadius(const eInfluence field) {
+        return field == eInfluence::e_Attraction ? k_attractionRadius : k_ghostRadius;
+    }
+
+    int GetColumns() const {
+        return m_columns;
+    }
+
+    int GetRows() const {
+        return m_rows;
+    }
+
+    int GetStride() const {
+        return m_stride;
+    }
+
+private:
+    static constexpr int k_lanes = 16; ///< Клеток в регистре SSE2; AVX2 дорабатывает хвост строки скалярно.
+    static constexpr std::size_t k_fields = static_cast<std::size_t>(eInfluence::e_Count);
+
+    GridMetrics m_metrics;
+    int m_columns = 0;
+    int m_rows = 0;
+    int m_stride = 0; ///< Клеток в строке плоскости вместе с дополнением.
+    std::vector<std::uint8_t> m_mask; ///< 0xFF - проходимая клетка, 0 - стена или дополнение.
+    std::array<std::vector<std::uint8_t>, k_fields> m_seeds; ///< Уровни источников.
+    std::array<std::vector<std::uint8_t>, k_fields> m_levels; ///< Построенные поля.
+    std::array<std::array<float, 256>, k_fields> m_values{}; ///< Значение по уровню.
+    std::array<std::vector<std::uint32_t>, k_fields> m_sources; ///< Клетки с источниками, для ClearSources.
+    std::array<bool, k_fields> m_stale{}; ///< В поле остались уровни убранных источников.
+    std::vector<std::uint8_t> m_scratch;
+
+    // Строка 0 и строка m_rows + 1 плоскости - пустые
+    std::uint32_t Index(const int column, const int row) const {
+        return static_cast<std::uint32_t>((row + 1) * m_stride + column);
+    }
+
+    void Propagate(const std::size_t field, const int steps) {
+        if (m_sources[field].empty()) {
+            if (m_stale[field]) std::memset(m_levels[field].data(), 0, m_levels[field].size());
+            m_stale[field] = false;
+            return;
+        }
+
+        // Итерации чередуют плоскость поля и черновик, чтобы последняя закончилась в плоскости поля;
+        // первая начинается от источников
+        const std::uint8_t *source = m_seeds[field].data();
+        std::uint8_t *target = steps % 2 == 1 ? m_levels[field].data() : m_scratch.data();
+        for (int step = 0; step < steps; ++step) {
+            Diffuse(source, m_seeds[field].data(), target);
+            source = target;
+            target = target == m_scratch.data() ? m_levels[field].data() : m_scratch.data();
+        }
+    }
+
+    /**
+     * @brief Одна итерация по строкам 1..m_rows плоскости.
+     */
+    void Diffuse(const std::uint8_t *source, const std::uint8_t *seeds, std::uint8_t *target) const {
+        const std::uint8_t *mask = m_mask.data();
+        const std::size_t stride = static_cast<std::size_t>(m_stride);
+        const std::size_t end = stride * static_cast<std::size_t>(m_rows + 1);
+        std::size_t i = stride;
+#if defined(PACMAN_DANGER_AVX2)
+        const __m256i one = _mm256_set1_epi8(1);
+        for (; i + 32 <= end; i += 32) {
+            const auto load = [](const std::uint8_t *at) {
+                return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at));
+            };
+            const __m256i across = _mm256_max_epu8(load(source + i - 1), load(source + i + 1));
+            const __m256i along = _mm256_max_epu8(load(source + i - stride), load(source + i + stride));
+            const __m256i spread = _mm256_subs_epu8(_mm256_max_epu8(across, along), one);
+            const __m256i level = _mm256_and_si256(_mm256_max_epu8(load(seeds + i), spread), load(mask + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(target + i), level);
+        }
+#elif defined(PACMAN_DANGER_SSE2)
+        const __m128i one = _mm_set1_epi8(1);
+        for (; i + 16 <= end; i += 16) {
+            const auto load = [](const std::uint8_t *at) {
+                return _mm_loadu_si128(reinterpret_cast<const __m128i *>(at));
+            };
+            const __m128i across = _mm_max_epu8(load(source + i - 1), load(source + i + 1));
+            const __m128i along = _mm_max_epu8(load(source + i - stride), load(source + i + stride));
+            const __m128i spread = _mm_subs_epu8(_mm_max_epu8(across, along), one);
+            const __m128i level = _mm_and_si128(_mm_max_epu8(load(seeds + i), spread), load(mask + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(target + i), level);
+        }
+#endif
+        for (; i < end; ++i) {
+            const std::uint8_t nearest = std::max(std::max(source[i - 1], source[i + 1]),
+                                                  std::max(source[i - stride], source[i + stride]));
+            const std::uint8_t spread = static_cast<std::uint8_t>(nearest - (nearest != 0));
+            target[i] = static_cast<std::uint8_t>(std::max(seeds[i], spread) & mask[i]);
+        }
+    }
+};
@@ -0,0 +1,304 @@
+/**
+ * @file EmbeddedLevel.h
+ * @brief Уровень, встроенный в программу при сборке и разобранный во время компиляции.
+ *
+ * С опцией CMake PACMAN_EMBED_DEFAULT_LEVEL текст data/Level.csv попадает в программу строковым литералом
+ * (DefaultLevel.inc в каталоге сборки), а разбор и все производные данные вычисляются constexpr:
+ * типы клеток, список подборок и образ навигационных данных в формате файла-спутника (.nav) лежат
+ * в памяти программы только для чтения. Ошибки уровня (неизвестный тип клетки, строки разной длины,
+ * стена в углу призраков, в доме или на месте появления Пакмана) становятся ошибками компиляции.
+ *
+ * Уровень по умолчанию (cnp::default_level_path()) тогда загружается без чтения и разбора файла
+ * и без сборки навигационных данных: Manager::LoadEmbeddedLevel только раскладывает клетки.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "LevelLoader.h"
+#include "NavigationData.h"
+#include "np.h"
+
+/**
+ * @struct tNavigationImage
+ * @brief Образ навигационных данных (см. NavFileHeader) в виде структуры, которую можно построить constexpr.
+ *
+ * Поля идут в порядке образа без промежутков, поэтому NavigationData::Attach читает первые k_size байт
+ * структуры как образ (за ними может идти выравнивание структуры).
+ */
+template<std::size_t Cells, std::size_t Walkable>
+struct tNavigationImage {
+    static constexpr std::size_t k_size = NavigationData::GetImageSize(Cells, Walkable); ///< Размер образа.
+
+    NavFileHeader m_header;
+    std::array<std::uint8_t, nav::align4(Cells)> m_exits; /**< Маски проходимых соседей. */
+    std::array<std::uint32_t, Walkable> m_walkable; /**< Индексы проходимых клеток. */
+    std::array<std::uint8_t, nav::k_targetCount * NavigationData::GetPlaneSize(Cells)> m_steps; /**< Таблицы шага. */
+
+    const char *Data() const {
+        return reinterpret_cast<const char *>(this);
+    }
+};
+
+namespace lvl {
+    /**
+     * @enum eEmbeddedLevelError
+     * @brief Ошибка разбора встроенного уровня.
+     */
+    enum class eEmbeddedLevelError : std::uint8_t {
+        e_None,
+        e_UnexpectedCharacter, ///< Символ, кроме цифр, '-', ',', пробелов и переводов строк.
+        e_UnknownTile, ///< Число вне eTileType.
+        e_RaggedRows, ///< Строки с разным количеством столбцов.
+        e_Empty ///< Ни одной клетки.
+    };
+
+    /**
+     * @struct EmbeddedLevelShape
+     * @brief Размеры встроенного уровня: параметры шаблона tEmbeddedLevel.
+     */
+    struct EmbeddedLevelShape {
+        int m_columns = 0;
+        int m_rows = 0;
+        std::size_t m_walkable = 0; /**< Клеток, кроме стен. */
+        std::size_t m_pickups = 0; /**< Монет и усилений. */
+        eEmbeddedLevelError m_error = eEmbeddedLevelError::e_None;
+    };
+
+    /**
+     * @struct EmbeddedPickup
+     * @brief Монета или усиление встроенного уровня.
+     */
+    struct EmbeddedPickup {
+        hnp::GridCell m_cell;
+        eTileType m_type;
+    };
+
+    /**
+     * @brief Разбирает CSV-текст по правилам parse_level_csv и передает клетки построчно в onCell(column, row, type).
+     * @param columns Количество столбцов (по первой строке).
+     * @param rows Количество строк.
+     */
+    template<typename OnCell>
+    constexpr eEmbeddedLevelError scan_level_csv(const char *text, const std::size_t size, int &columns, int &rows,
+                                                 OnCell &&onCell) {
+        columns = 0;
+        rows = 0;
+        int column = 0;
+        auto endRow = [&]() {
+            if (column == 0) return true;
+            if (rows == 0) columns = column;
+            else if (column != columns) return false;
+            ++rows;
+            column = 0;
+            return true;
+        };
+
+        std::size_t cursor = 0;
+        while (cursor < size) {
+            const char character = text[cursor];
+            if (character == '\r' || character == '\n') {
+                if (!endRow()) return eEmbeddedLevelError::e_RaggedRows;
+                ++cursor;
+                continue;
+            }
+            if (character == ',' || character == ' ' || character == '\t') {
+                ++cursor;
+                continue;
+            }
+
+            const bool negative = character == '-';
+            if (negative) ++cursor;
+            if (cursor == size || text[cursor] < '0' || text[cursor] > '9') return eEmbeddedLevelError::e_UnexpectedCharacter;
+
+            int value = 0;
+            while (cursor < size && text[cursor] >= '0' && text[cursor] <= '9') {
+                value = value * 10 + (text[cursor] - '0');
+                ++cursor;
+            }
+            if (negative) value = -value;
+            if (!is_valid_tile_value(value)) return eEmbeddedLevelError::e_UnknownTile;
+
+            onCell(column, rows, static_cast<eTileType>(value));
+            ++column;
+        }
+
+        // Последняя строка без перевода строки
+        if (!endRow()) return eEmbeddedLevelError::e_RaggedRows;
+        return rows == 0 ? eEmbeddedLevelError::e_Empty : eEmbeddedLevelError::e_None;
+    }
+
+    /**
+     * @brief Размеры уровня из CSV-текста: первый проход разбора.
+     */
+    constexpr EmbeddedLevelShape measure_level_csv(const char *text, const std::size_t size) {
+        EmbeddedLevelShape shape;
+        shape.m_error = scan_level_csv(text, size, shape.m_columns, shape.m_rows, [&shape](int, int, const eTileType type) {
+            shape.m_walkable += type != eTileType::e_Wall;
+            shape.m_pickups += type == eTileType::e_Coin || type == eTileType::e_PowerUp;
+        });
+        return shape;
+    }
+
+    /**
+     * @struct tEmbeddedLevel
+     * @brief Уровень, разобранный во время компиляции, с подборками и навигационными данными.
+     */
+    template<int Columns, int Rows, std::size_t Walkable, std::size_t Pickups>
+    struct tEmbeddedLevel {
+        static constexpr int k_columns = Columns;
+        static constexpr int k_rows = Rows;
+        static constexpr std::size_t k_cells = static_cast<std::size_t>(Columns) * Rows;
+
+        std::array<eTileType, k_cells> m_tiles; /**< Типы клеток; на месте подборок - e_Path, как в Manager. */
+        std::array<EmbeddedPickup, Pickups> m_pickups; /**< Подборки построчно, в порядке Manager::LoadLevel. */
+        tNavigationImage<k_cells, Walkable> m_navigation;
+
+        constexpr eTileType GetTile(const int column, const int row) const {
+            return m_tiles[static_cast<std::size_t>(row) * Columns + column];
+        }
+
+        constexpr bool IsWalkable(const hnp::GridCell cell) const {
+            return cell.m_column >= 0 && cell.m_column < Columns && cell.m_row >= 0 && cell.m_row < Rows &&
+                   GetTile(cell.m_column, cell.m_row) != eTileType::e_Wall;
+        }
+
+        /**
+         * @brief Углы разбегания призраков проходимы (см. hnp::corner_cell).
+         */
+        constexpr bool AreCornersWalkable() const {
+            for (int corner = 0; corner < 4; ++corner) {
+                if (!IsWalkable(hnp::corner_cell(corner, Columns, Rows))) return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Домашние клетки призраков и клетка появления Пакмана проходимы.
+         */
+        constexpr bool AreHomesWalkable() const {
+            for (int home = 0; home < 4; ++home) {
+                if (!IsWalkable(hnp::home_cell(home, Columns, Rows))) return false;
+            }
+            return IsWalkable(hnp::pacman_spawn_cell(Columns, Rows));
+        }
+    };
+
+    /**
+     * @brief Навигационные данные уровня так же, как nav::build_navigation: образы совпадают побайтно.
+     */
+    template<std::size_t Cells, std::size_t Walkable>
+    constexpr tNavigationImage<Cells, Walkable> build_navigation_image(const std::array<eTileType, Cells> &tiles,
+                                                                       const int columns, const int rows,
+                                                                       const std::uint64_t levelHash) {
+        tNavigationImage<Cells, Walkable> image{};
+        image.m_header.m_targetCount = nav::k_targetCount;
+        image.m_header.m_levelHash = levelHash;
+        image.m_header.m_columns = static_cast<std::uint32_t>(columns);
+        image.m_header.m_rows = static_cast<std::uint32_t>(rows);
+        image.m_header.m_walkableCount = static_cast<std::uint32_t>(Walkable);
+
+        auto walkable = [&tiles](const std::size_t cell) { return tiles[cell] != eTileType::e_Wall; };
+        std::size_t next = 0;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                const std::size_t cell = static_cast<std::size_t>(r) * columns + c;
+                if (!walkable(cell)) continue;
+
+                image.m_walkable[next++] = static_cast<std::uint32_t>(cell);
+                image.m_exits[cell] = nav::exit_mask(cell, columns, rows, walkable);
+            }
+        }
+
+        std::array<std::uint32_t, Walkable> queue{};
+        for (int target = 0; target < nav::k_targetCount; ++target) {
+            const hnp::GridCell goalCell = target < nav::k_homeTargets
+                                           ? hnp::corner_cell(target - nav::k_cornerTargets, columns, rows)
+                                           : hnp::home_cell(target - nav::k_homeTargets, columns, rows);
+            const std::size_t goal = static_cast<std::size_t>(goalCell.m_row) * columns + goalCell.m_column;
+            if (!walkable(goal)) continue;
+
+            const std::size_t plane = target * NavigationData::GetPlaneSize(Cells);
+            std::array<bool, Cells> visited{};
+            visited[goal] = true;
+            nav::search_from_goal(static_cast<std::uint32_t>(goal), columns, queue.data(),
+                                  [&image](const std::uint32_t cell) { return image.m_exits[cell]; },
+                                  [&](const std::uint32_t neighbour, std::uint32_t, const eDirection towardsCell) {
+                                      if (visited[neighbour]) return false;
+                                      visited[neighbour] = true;
+                                      const auto value = static_cast<std::uint8_t>(towardsCell);
+                                      image.m_steps[plane + neighbour / 2] |=
+                                              neighbour & 1 ? static_cast<std::uint8_t>(value << 4) : value;
+                                      return true;
+                                  },
+                                  [](std::size_t) { return true; });
+        }
+        return image;
+    }
+
+    /**
+     * @brief Второй проход разбора: клетки, подборки и навигационные данные уровня с размерами из measure_level_csv.
+     */
+    template<int Columns, int Rows, std::size_t Walkable, std::size_t Pickups>
+    constexpr tEmbeddedLevel<Columns, Rows, Walkable, Pickups> parse_embedded_level(const char *text,
+                                                                                    const std::size_t size) {
+        using Level = tEmbeddedLevel<Columns, Rows, Walkable, Pickups>;
+        Level level{};
+
+        // Хеш nav::hash_level: размеры (uint32, little-endian), затем клетки CSV
+        std::uint64_t hash = nav::k_hashOffset;
+        for (const std::uint32_t dimension: {static_cast<std::uint32_t>(Columns), static_cast<std::uint32_t>(Rows)}) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                hash = nav::hash_byte(hash, static_cast<unsigned char>(dimension >> shift));
+            }
+        }
+
+        std::size_t pickup = 0;
+        int columns = 0;
+        int rows = 0;
+        scan_level_csv(text, size, columns, rows, [&](const int column, const int row, const eTileType type) {
+            hash = nav::hash_byte(hash, static_cast<unsigned char>(type));
+            const bool isPickup = type == eTileType::e_Coin || type == eTileType::e_PowerUp;
+            if (isPickup) level.m_pickups[pickup++] = {{column, row}, type};
+            level.m_tiles[static_cast<std::size_t>(row) * Columns + column] = isPickup ? eTileType::e_Path : type;
+        });
+
+        level.m_navigation = build_navigation_image<Level::k_cells, Walkable>(level.m_tiles, Columns, Rows, hash);
+        return level;
+    }
+}
+
+#if defined(PACMAN_EMBED_DEFAULT_LEVEL)
+namespace lvl::embedded {
+    /**
+     * @brief Текст data/Level.csv: по строковому литералу на строку уровня (DefaultLevel.inc генерирует CMake).
+     */
+    inline constexpr char k_defaultLevelCsv[] = ""
+#include "DefaultLevel.inc"
+    ;
+
+    inline constexpr EmbeddedLevelShape k_defaultShape =
+            measure_level_csv(k_defaultLevelCsv, sizeof(k_defaultLevelCsv) - 1);
+    static_assert(k_defaultShape.m_error != eEmbeddedLevelError::e_UnexpectedCharacter,
+                  "data/Level.csv: unexpected character (expected tile numbers separated by commas)");
+    static_assert(k_defaultShape.m_error != eEmbeddedLevelError::e_UnknownTile,
+                  "data/Level.csv: unknown tile type (see eTileType)");
+    static_assert(k_defaultShape.m_error != eEmbeddedLevelError::e_RaggedRows,
+                  "data/Level.csv: rows have different numbers of columns");
+    static_assert(k_defaultShape.m_error != eEmbeddedLevelError::e_Empty, "data/Level.csv: the level is empty");
+
+    /**
+     * @brief Уровень по умолчанию, разобранный во время компиляции.
+     */
+    inline constexpr auto k_defaultLevel = parse_embedded_level<k_defaultShape.m_columns, k_defaultShape.m_rows,
+            k_defaultShape.m_walkable, k_defaultShape.m_pickups>(k_defaultLevelCsv, sizeof(k_defaultLevelCsv) - 1);
+    static_assert(k_defaultLevel.AreCornersWalkable(), "data/Level.csv: a ghost scatter corner is a wall");
+    static_assert(k_defaultLevel.AreHomesWalkable(), "data/Level.csv: the ghost home or the Pac-Man spawn is a wall");
+    using DefaultNavigationImage = decltype(k_defaultLevel.m_navigation);
+    static_assert(offsetof(DefaultNavigationImage, m_steps) + sizeof(DefaultNavigationImage::m_steps) ==
+                  DefaultNavigationImage::k_size, "the navigation image must have the layout of a .nav file");
+}
+#endif
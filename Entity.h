@@ -2,45 +2,13 @@
 #include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
 // chekcing
+#include "EntityStore.h"
 #include "Tile.h"
 #include "np.h"
 #include <iostream>
 
 /**
- * @brief Перечисление направлений движения
- */
-enum class eDirection {
-    e_None,  ///< Нет направления
-    e_Up,    ///< Вверх
-    e_Down,  ///< Вниз
-    e_Left,  ///< Влево
-    e_Right  ///< Вправо
-};
-
-/**
- * @brief Функция преобразования значения перечисления в строку
- * @param e Значение перечисления eDirection
- * @return Строковое представление значения перечисления
- */
-inline const char *to_string(eDirection e) {
-    switch (e) {
-        case eDirection::e_None:
-            return "e_None";
-        case eDirection::e_Up:
-            return "e_Up";
-        case eDirection::e_Down:
-            return "e_Down";
-        case eDirection::e_Left:
-            return "e_Left";
-        case eDirection::e_Right:
-            return "e_Right";
-        default:
-            return "unknown";
-    }
-}
-
-/**
- * @brief Класс Entity представляет собой сущность в игре.
+ * @brief Класс Entity представляет собой сущность в игре: представление над ее компонентами в EntityStore.
  */
 class Entity {
 public:
@@ -51,30 +19,30 @@ public:
     void SetDirection(const eDirection direction) {
         switch (direction) {
             case eDirection::e_Up:
-                if (m_currentDirection != eDirection::e_Down) {
-                    m_currentDirection = direction;
+                if (Direction() != eDirection::e_Down) {
+                    m_store->SetDirection(m_id, direction);
                 }
                 break;
             case eDirection::e_Down:
-                if (m_currentDirection != eDirection::e_Up) {
-                    m_currentDirection = direction;
+                if (Direction() != eDirection::e_Up) {
+                    m_store->SetDirection(m_id, direction);
                 }
                 break;
             case eDirection::e_Left:
-                if (m_currentDirection != eDirection::e_Right) {
-                    m_currentDirection = direction;
+                if (Direction() != eDirection::e_Right) {
+                    m_store->SetDirection(m_id, direction);
                 }
                 break;
             case eDirection::e_Right:
-                if (m_currentDirection != eDirection::e_Left) {
-                    m_currentDirection = direction;
+                if (Direction() != eDirection::e_Left) {
+                    m_store->SetDirection(m_id, direction);
                 }
                 break;
             case eDirection::e_None:
-                m_currentDirection = direction;
+                m_store->SetDirection(m_id, direction);
                 break;
             default:
-                std::cout << "Unknown Movement direction" << std::endl;
+                std::cerr << "Unknown Movement direction" << std::endl;
                 break;
         }
     }
@@ -84,7 +52,7 @@ public:
      * @return Текущее направление движения.
      */
     eDirection GetDirection() const {
-        return m_currentDirection;
+        return Direction();
     }
 
     /**
@@ -92,7 +60,7 @@ public:
      * @return Текущая позиция сущности.
      */
     sf::Vector2i GetPosition() const {
-        return m_position;
+        return Position();
     }
 
     /**
@@ -100,43 +68,74 @@ public:
      * @param position Новая позиция сущности.
      */
     void SetPosition(const sf::Vector2i position) {
-        m_position = position;
+        m_store->SetPosition(m_id, position);
+    }
+
+    /**
+     * @brief Возвращает размеры уровня, по которому движется сущность.
+     * @return Метрики сетки.
+     */
+    const GridMetrics &GetGridMetrics() const {
+        return m_gridMetrics;
+    }
+
+    /**
+     * @brief Номер сущности в хранилище.
+     */
+    EntityStore::Id GetId() const {
+        return m_id;
     }
 
 protected:
-    sf::Vector2i m_position; ///< Позиция сущности.
-    int m_speed; ///< Скорость движения сущности.
-    eDirection m_currentDirection; ///< Текущее направление движения сущности.
-    std::vector<eDirection> m_limitedDirections; ///< Ограниченные направления движения сущности.
-    sf::RectangleShape m_shape; ///< Форма сущности.
-    sf::Color m_colour; ///< Цвет сущности.
-    sf::Clock m_clock; ///< Таймер для обновления состояния сущности.
+    EntityStore *m_store; ///< Хранилище компонентов.
+    EntityStore::Id m_id; ///< Номер сущности в хранилище.
+    const GridMetrics &m_gridMetrics; ///< Размеры уровня (общие для хранилища).
 
     /**
- * @brief Конструктор класса Entity.
+ * @brief Конструктор класса Entity. Создает компоненты сущности в хранилище.
+ * @param store Хранилище компонентов.
  * @param position Начальная позиция сущности.
  * @param speed Скорость движения сущности.
  * @param startingDirection Начальное направление движения сущности.
  * @param colour Цвет сущности.
  */
-    Entity(const sf::Vector2i position, const int speed, const eDirection startingDirection, sf::Color colour) :
-            m_position(position),
-            m_speed(speed),
-            m_currentDirection(startingDirection),
-            m_shape({cnp::k_gridCellSize, cnp::k_gridCellSize}),
-            m_colour(colour),
-            m_clock() {
+    Entity(EntityStore &store, const sf::Vector2i position, const int speed, const eDirection startingDirection,
+           sf::Color colour) :
+            m_store(&store),
+            m_id(store.Create(position, speed, startingDirection, colour)),
+            m_gridMetrics(store.GetGridMetrics()) {
+    }
+
+    const sf::Vector2i &Position() const { return m_store->Position(m_id); }
+    eDirection Direction() const { return m_store->Direction(m_id); }
+    int Speed() const { return m_store->Speed(m_id); }
+    float Timer() const { return m_store->Timer(m_id); }
+    void SetTimer(const float seconds) { m_store->SetTimer(m_id, seconds); }
+    const sf::Color &Colour() const { return m_store->Colour(m_id); }
+
+    /**
+     * @brief Закрыто ли направление стеной на этом тике.
+     */
+    bool IsBlocked(const eDirection direction) {
+        return m_store->Blocked(m_id) & DirectionBit(direction);
+    }
+
+    static std::uint8_t DirectionBit(const eDirection direction) {
+        return static_cast<std::uint8_t>(1u << static_cast<unsigned>(direction));
     }
 
     /**
  * @brief Обрабатывает перемещение сущности за границы игрового поля.
  */
     void WrapAround() {
-        if (m_position.x < 0) {
-            m_position.x = cnp::k_screenSize + m_position.x;
-        } else if (m_position.x > cnp::k_screenSize - cnp::k_gridCellSize) {
-            m_position.x = cnp::k_screenSize - m_position.x;
+        const int width = m_gridMetrics.GetWidth();
+        sf::Vector2i position = Position();
+        if (position.x < 0) {
+            position.x = width + position.x;
+        } else if (position.x > width - m_gridMetrics.GetCellSize()) {
+            position.x = width - position.x;
         }
+        SetPosition(position);
     }
 
 /**
@@ -144,17 +143,30 @@ protected:
  * @param tiles Двумерный массив тайлов игрового поля.
  */
     void CheckForBlockades(const std::vector<std::vector<Tile>> &tiles) {
-        if (hnp::is_in_range(m_position.x, 0, cnp::k_screenSize - cnp::k_gridCellSize) &&
-            hnp::is_in_range(m_position.y, 0, cnp::k_screenSize - cnp::k_gridCellSize)) {
-            const int entityX = m_position.x / cnp::k_gridCellSize;
-            const int entityY = m_position.y / cnp::k_gridCellSize;
+        m_gridMetrics.Dispatch([&](const auto &grid) { CheckForBlockades(grid, tiles); });
+    }
+
+private:
+    /**
+     * @brief Проверка препятствий для конкретного типа сетки (DefaultGrid или GridMetrics).
+     * @param grid Размеры сетки.
+     * @param tiles Двумерный массив тайлов игрового поля.
+     */
+    template<typename Grid>
+    void CheckForBlockades(const Grid &grid, const std::vector<std::vector<Tile>> &tiles) {
+        const int cellSize = grid.GetCellSize();
+        sf::Vector2i position = Position();
+        if (hnp::is_in_range(position.x, 0, grid.GetWidth() - cellSize) &&
+            hnp::is_in_range(position.y, 0, grid.GetHeight() - cellSize)) {
+            const int entityX = position.x / cellSize;
+            const int entityY = position.y / cellSize;
 
             {
                 const auto &currentTile = tiles[entityY - 1][entityX];
                 if (currentTile.m_canCollide) {
-                    if (m_position.y <= currentTile.m_position.y + cnp::k_gridCellSize) {
-                        m_position = {m_position.x, currentTile.m_position.y + cnp::k_gridCellSize};
-                        m_limitedDirections.push_back(eDirection::e_Up);
+                    if (position.y <= currentTile.m_position.y + cellSize) {
+                        position = {position.x, currentTile.m_position.y + cellSize};
+                        m_store->Blocked(m_id) |= DirectionBit(eDirection::e_Up);
                     }
                 }
             }
@@ -162,9 +174,9 @@ protected:
             {
                 const auto &currentTile = tiles[entityY + 1][entityX];
                 if (currentTile.m_canCollide) {
-                    if (m_position.y >= currentTile.m_position.y - cnp::k_gridCellSize) {
-                        m_position = {m_position.x, currentTile.m_position.y - cnp::k_gridCellSize};
-                        m_limitedDirections.push_back(eDirection::e_Down);
+                    if (position.y >= currentTile.m_position.y - cellSize) {
+                        position = {position.x, currentTile.m_position.y - cellSize};
+                        m_store->Blocked(m_id) |= DirectionBit(eDirection::e_Down);
                     }
                 }
             }
@@ -172,9 +184,9 @@ protected:
             {
                 const auto &currentTile = tiles[entityY][entityX - 1];
                 if (currentTile.m_canCollide) {
-                    if (m_position.x >= currentTile.m_position.x + cnp::k_gridCellSize) {
-                        m_position = {currentTile.m_position.x + cnp::k_gridCellSize, m_position.y};
-                        m_limitedDirections.push_back(eDirection::e_Left);
+                    if (position.x >= currentTile.m_position.x + cellSize) {
+                        position = {currentTile.m_position.x + cellSize, position.y};
+                        m_store->Blocked(m_id) |= DirectionBit(eDirection::e_Left);
                     }
                 }
             }
@@ -182,12 +194,13 @@ protected:
             {
                 const auto &currentTile = tiles[entityY][entityX + 1];
                 if (currentTile.m_canCollide) {
-                    if (m_position.x <= currentTile.m_position.x - cnp::k_gridCellSize) {
-                        m_position = {currentTile.m_position.x - cnp::k_gridCellSize, m_position.y};
-                        m_limitedDirections.push_back(eDirection::e_Right);
+                    if (position.x <= currentTile.m_position.x - cellSize) {
+                        position = {currentTile.m_position.x - cellSize, position.y};
+                        m_store->Blocked(m_id) |= DirectionBit(eDirection::e_Right);
                     }
                 }
             }
+            SetPosition(position);
         }
     }
 
@@ -0,0 +1,282 @@
+/**
+ * @file EntityStore.h
+ * @brief Хранилище сущностей в виде структуры массивов.
+ *
+ * Данные, которые тик читает и пишет у каждой сущности (позиция, направление, состояние, таймер),
+ * лежат в отдельных плотных массивах и обходятся линейно. Данные только для отрисовки (цвета,
+ * фигура SFML) вынесены в таблицу, которую читает только отрисовка. PacMan и Ghost - представления
+ * над хранилищем: они хранят номер сущности и собственные редко используемые данные.
+ *
+ * Компоненты состояния меняются только через сеттеры, которые обновляют хэш Зобриста игры (StateHash.h).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "StateHash.h"
+#include "np.h"
+
+/**
+ * @brief Перечисление направлений движения
+ */
+enum class eDirection : std::uint8_t {
+    e_None,  ///< Нет направления
+    e_Up,    ///< Вверх
+    e_Down,  ///< Вниз
+    e_Left,  ///< Влево
+    e_Right  ///< Вправо
+};
+
+/**
+ * @brief Функция преобразования значения перечисления в строку
+ * @param e Значение перечисления eDirection
+ * @return Строковое представление значения перечисления
+ */
+inline const char *to_string(eDirection e) {
+    switch (e) {
+        case eDirection::e_None:
+            return "e_None";
+        case eDirection::e_Up:
+            return "e_Up";
+        case eDirection::e_Down:
+            return "e_Down";
+        case eDirection::e_Left:
+            return "e_Left";
+        case eDirection::e_Right:
+            return "e_Right";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @class EntityStore
+ * @brief Компоненты всех сущностей одной игры.
+ */
+class EntityStore {
+public:
+    using Id = std::uint32_t;
+
+    /**
+     * @param gridMetrics Размеры уровня, общие для всех сущностей.
+     */
+    explicit EntityStore(const GridMetrics &gridMetrics) :
+            m_gridMetrics(gridMetrics),
+            m_random(static_cast<std::uint64_t>(std::time(nullptr))) {
+        m_render.m_shape.setSize({static_cast<float>(gridMetrics.GetCellSize()),
+                                  static_cast<float>(gridMetrics.GetCellSize())});
+    }
+
+    EntityStore(const EntityStore &) = delete;
+    EntityStore &operator=(const EntityStore &) = delete;
+
+    /**
+     * @brief Резервирует место под count сущностей, чтобы создание не перевыделяло массивы.
+     */
+    void Reserve(const std::size_t count) {
+        m_positions.reserve(count);
+        m_directions.reserve(count);
+        m_speeds.reserve(count);
+        m_states.reserve(count);
+        m_blocked.reserve(count);
+        m_timers.reserve(count);
+        m_render.m_colours.reserve(count);
+    }
+
+    /**
+     * @brief Создает сущность и возвращает ее номер.
+     */
+    Id Create(const sf::Vector2i position, const int speed, const eDirection direction, const sf::Color colour) {
+        m_positions.push_back(position);
+        m_directions.push_back(direction);
+        m_speeds.push_back(speed);
+        m_states.push_back(0);
+        m_blocked.push_back(0);
+        m_timers.push_back(0.f);
+        m_render.m_colours.push_back(colour);
+
+        const Id id = static_cast<Id>(m_positions.size() - 1);
+        m_hash.Toggle(eHashField::e_Position, id, zobrist::pack(position));
+        m_hash.Toggle(eHashField::e_Direction, id, static_cast<std::uint64_t>(direction));
+        m_hash.Toggle(eHashField::e_State, id, 0);
+        m_hash.Toggle(eHashField::e_Timer, id, zobrist::pack(0.f));
+        return id;
+    }
+
+    std::size_t GetSize() const {
+        return m_positions.size();
+    }
+
+    const GridMetrics &GetGridMetrics() const {
+        return m_gridMetrics;
+    }
+
+    /**
+     * @brief Секунды, прошедшие с предыдущего тика (для таймеров сущностей).
+     */
+    float GetTickSeconds() const {
+        return m_tickSeconds;
+    }
+
+    void SetTickSeconds(const float seconds) {
+        m_tickSeconds = seconds;
+    }
+
+    /**
+     * @brief Генератор случайных чисел игры (появление усилений, блуждание призраков).
+     *
+     * Зерно по умолчанию - текущее время; с заданным зерном и фиксированным шагом тика
+     * партия повторяется тик в тик.
+     */
+    hnp::SplitMix64 &GetRandom() {
+        return m_random;
+    }
+
+    void Seed(const std::uint64_t seed) {
+        m_random = hnp::SplitMix64(seed);
+    }
+
+    /**
+     * @brief Хэш состояния игры; PacMan и PickUp добавляют в него свои признаки сами.
+     */
+    StateHash &GetHash() {
+        return m_hash;
+    }
+
+    const StateHash &GetHash() const {
+        return m_hash;
+    }
+
+    /**
+     * @brief Вклад компонентов хранилища в хэш, посчитанный заново (для проверки инкрементального).
+     */
+    StateHash ComputeHash() const {
+        StateHash hash;
+        for (Id id = 0; id < m_positions.size(); ++id) {
+            hash.Toggle(eHashField::e_Position, id, zobrist::pack(m_positions[id]));
+            hash.Toggle(eHashField::e_Direction, id, static_cast<std::uint64_t>(m_directions[id]));
+            hash.Toggle(eHashField::e_State, id, m_states[id]);
+            hash.Toggle(eHashField::e_Timer, id, zobrist::pack(m_timers[id]));
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Изменяемые компоненты всех сущностей, генератор и хэш: снимок для отката тиков.
+     *
+     * Скорости и цвета не меняются после создания, маска стен живет один тик: в снимок они не входят.
+     */
+    struct Snapshot {
+        hnp::SplitMix64 m_random{0};
+        StateHash m_hash;
+        std::vector<sf::Vector2i> m_positions;
+        std::vector<eDirection> m_directions;
+        std::vector<std::uint8_t> m_states;
+        std::vector<float> m_timers;
+    };
+
+    /**
+     * @brief Копирует состояние в снимок; повторное сохранение в тот же снимок не выделяет память.
+     */
+    void Save(Snapshot &snapshot) const {
+        snapshot.m_random = m_random;
+        snapshot.m_hash = m_hash;
+        snapshot.m_positions = m_positions;
+        snapshot.m_directions = m_directions;
+        snapshot.m_states = m_states;
+        snapshot.m_timers = m_timers;
+    }
+
+    /**
+     * @brief Возвращает состояние из снимка того же хранилища (набор сущностей не меняется).
+     */
+    void Restore(const Snapshot &snapshot) {
+        m_random = snapshot.m_random;
+        m_hash = snapshot.m_hash;
+        m_positions = snapshot.m_positions;
+        m_directions = snapshot.m_directions;
+        m_states = snapshot.m_states;
+        m_timers = snapshot.m_timers;
+    }
+
+    // Компоненты симуляции
+
+    const sf::Vector2i &Position(const Id id) const { return m_positions[id]; }
+
+    void SetPosition(const Id id, const sf::Vector2i position) {
+        m_hash.Change(eHashField::e_Position, id, zobrist::pack(m_positions[id]), zobrist::pack(position));
+        m_positions[id] = position;
+    }
+
+    eDirection Direction(const Id id) const { return m_directions[id]; }
+
+    void SetDirection(const Id id, const eDirection direction) {
+        m_hash.Change(eHashField::e_Direction, id, static_cast<std::uint64_t>(m_directions[id]),
+                      static_cast<std::uint64_t>(direction));
+        m_directions[id] = direction;
+    }
+
+    int Speed(const Id id) const { return m_speeds[id]; }
+
+    /**
+     * @brief Состояние сущности (ePacManState или eGhostState).
+     */
+    std::uint8_t State(const Id id) const { return m_states[id]; }
+
+    void SetState(const Id id, const std::uint8_t state) {
+        m_hash.Change(eHashField::e_State, id, m_states[id], state);
+        m_states[id] = state;
+    }
+
+    /**
+     * @brief Маска направлений, закрытых стенами на этом тике (бит 1 << eDirection).
+     */
+    std::uint8_t &Blocked(const Id id) { return m_blocked[id]; }
+
+    /**
+     * @brief Таймер состояния (усиление Пакмана, ожидание призрака дома), в секундах.
+     */
+    float Timer(const Id id) const { return m_timers[id]; }
+
+    void SetTimer(const Id id, const float seconds) {
+        m_hash.Change(eHashField::e_Timer, id, zobrist::pack(m_timers[id]), zobrist::pack(seconds));
+        m_timers[id] = seconds;
+    }
+
+    // Таблица отрисовки
+
+    const sf::Color &Colour(const Id id) const { return m_render.m_colours[id]; }
+
+    /**
+     * @brief Фигура размером с клетку, общая для отрисовки всех сущностей в окно.
+     */
+    sf::RectangleShape &GetShape() { return m_render.m_shape; }
+
+private:
+    GridMetrics m_gridMetrics;
+    float m_tickSeconds = 0.f;
+    hnp::SplitMix64 m_random;
+    StateHash m_hash;
+
+    std::vector<sf::Vector2i> m_positions;
+    std::vector<eDirection> m_directions;
+    std::vector<int> m_speeds;
+    std::vector<std::uint8_t> m_states;
+    std::vector<std::uint8_t> m_blocked;
+    std::vector<float> m_timers;
+
+    /**
+     * @brief Данные, которые читает только отрисовка.
+     */
+    struct RenderTable {
+        std::vector<sf::Color> m_colours;
+        sf::RectangleShape m_shape;
+    } m_render;
+};
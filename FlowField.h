@@ -0,0 +1,128 @@
+/**
+ * @file FlowField.h
+ * @brief Общие для всех призраков таблицы следующего шага к подвижным целям.
+ *
+ * Навигационные таблицы (NavigationData.h) покрывают только углы и дом. Цели преследования
+ * (клетки у Пакмана) меняются каждый тик, но в толпе призраков многие гонятся за одной клеткой.
+ * Один поиск в ширину от цели дает шаг к ней из любой клетки, поэтому стоимость тика растет
+ * с количеством разных целей, а не с количеством призраков. Таблицы хранятся в кэше LRU.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Entity.h"
+#include "NavigationData.h"
+#include "Profiler.h"
+#include "Tracer.h"
+
+/**
+ * @class FlowFieldCache
+ * @brief Кэш таблиц следующего шага, ключ - клетка цели.
+ */
+class FlowFieldCache {
+public:
+    /**
+     * @param grid Уровень. Должен жить дольше кэша и не изменяться.
+     * @param capacity Наибольшее количество таблиц в кэше.
+     */
+    FlowFieldCache(const std::vector<std::vector<Tile>> &grid, const std::size_t capacity) :
+            m_columns(grid.empty() ? 0 : static_cast<int>(grid[0].size())),
+            m_rows(static_cast<int>(grid.size())),
+            m_capacity(std::max<std::size_t>(1, capacity)) {
+        m_walkable.reserve(static_cast<std::size_t>(m_columns) * m_rows);
+        for (const auto &row: grid) {
+            for (const auto &tile: row) m_walkable.push_back(tile.m_type != eTileType::e_Wall);
+        }
+
+        // Таблицы и очередь поиска выделяются заранее: промах кэша на тике не выделяет память
+        m_fields.resize(m_capacity);
+        for (auto &field: m_fields) field.m_steps.resize(m_walkable.size());
+        m_queue.resize(m_walkable.size());
+        m_visited.assign(m_walkable.size(), false);
+    }
+
+    /**
+     * @brief Направление шага к цели для каждой клетки (e_None - цель или клетка, из которой цель недостижима).
+     * @param goal Индекс клетки цели (строка * столбцы + столбец).
+     */
+    const std::vector<eDirection> &Get(const std::uint32_t goal) {
+        ++m_clock;
+        for (auto &field: m_fields) {
+            if (field.m_lastUse != 0 && field.m_goal == goal) {
+                field.m_lastUse = m_clock;
+                ++m_hits;
+                return field.m_steps;
+            }
+        }
+
+        // Незанятые таблицы (m_lastUse == 0) вытесняются первыми
+        ++m_misses;
+        Field *field = &*std::min_element(m_fields.begin(), m_fields.end(), [](const Field &a, const Field &b) {
+            return a.m_lastUse < b.m_lastUse;
+        });
+        field->m_goal = goal;
+        field->m_lastUse = m_clock;
+        Build(*field);
+        return field->m_steps;
+    }
+
+    int GetColumns() const {
+        return m_columns;
+    }
+
+    std::uint64_t GetHits() const {
+        return m_hits;
+    }
+
+    std::uint64_t GetMisses() const {
+        return m_misses;
+    }
+
+private:
+    struct Field {
+        std::uint32_t m_goal = 0;
+        std::uint64_t m_lastUse = 0; ///< 0 - таблица еще не построена.
+        std::vector<eDirection> m_steps;
+    };
+
+    const int m_columns;
+    const int m_rows;
+    const std::size_t m_capacity;
+    std::vector<char> m_walkable;
+    std::vector<Field> m_fields;
+    std::vector<std::uint32_t> m_queue;
+    std::vector<bool> m_visited;
+    std::uint64_t m_clock = 0;
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+
+    /**
+     * @brief Таблица шагов к цели (nav::search_from_goal).
+     */
+    void Build(Field &field) {
+        PACMAN_PROFILE_SCOPE("FlowFieldCache::Build");
+        PACMAN_TRACE_SCOPE("Flow field");
+
+        field.m_steps.assign(m_walkable.size(), eDirection::e_None);
+        if (field.m_goal >= m_walkable.size() || !m_walkable[field.m_goal]) return;
+
+        // Цель помечается шагом e_None, поэтому посещенность хранится отдельно
+        std::vector<eDirection> &steps = field.m_steps;
+        m_visited.assign(m_walkable.size(), false);
+        m_visited[field.m_goal] = true;
+        auto walkable = [this](const std::size_t cell) { return m_walkable[cell] != 0; };
+        nav::search_from_goal(field.m_goal, m_columns, m_queue.data(),
+                              [&](const std::uint32_t cell) { return nav::exit_mask(cell, m_columns, m_rows, walkable); },
+                              [&](const std::uint32_t neighbour, std::uint32_t, const eDirection towardsCell) {
+                                  if (m_visited[neighbour]) return false;
+                                  m_visited[neighbour] = true;
+                                  steps[neighbour] = towardsCell;
+                                  return true;
+                              },
+                              [](std::size_t) { return true; });
+    }
+};
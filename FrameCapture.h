@@ -0,0 +1,333 @@
+/**
+ * @file FrameCapture.h
+ * @brief Определение класса FrameCapture.
+ *
+ * Класс FrameCapture принимает кадры, записанные командами Canvas, и в фоновом потоке
+ * растеризует их и записывает в сырой видеопоток RGBA или в последовательность PNG-файлов.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Canvas.h"
+#include "Tracer.h"
+
+/**
+ * @enum eCaptureFormat
+ * @brief Форматы записи кадров.
+ */
+enum class eCaptureFormat {
+    e_RawVideo, /**< Сырой поток RGBA (например, для ffmpeg -f rawvideo -pix_fmt rgba). */
+    e_PngSequence /**< Последовательность PNG-файлов <output>_000000.png. */
+};
+
+/**
+ * @class FrameCapture
+ * @brief Ограниченная очередь кадров с фоновой записью.
+ *
+ * Кадры берутся из заранее выделенного пула. Если все кадры пула заняты писателем,
+ * новый кадр отбрасывается и учитывается в счетчике, поэтому тик симуляции никогда не ждет диск.
+ * Пул и очередь готовых кадров являются кольцевыми буферами с одним производителем
+ * (поток симуляции) и одним потребителем (поток записи).
+ */
+class FrameCapture {
+public:
+    /**
+     * @brief Конструктор класса FrameCapture.
+     * @param output Путь к файлу потока или префикс имен PNG-файлов ("-" означает stdout для сырого потока).
+     * @param format Формат записи.
+     * @param width Ширина кадра.
+     * @param height Высота кадра.
+     * @param queueCapacity Количество кадров в пуле (глубина очереди).
+     */
+    FrameCapture(std::string output, const eCaptureFormat format, const unsigned width, const unsigned height,
+                 const std::size_t queueCapacity = 8) :
+            m_output(std::move(output)),
+            m_format(format),
+            m_freeSlots(queueCapacity + 1),
+            m_readySlots(queueCapacity + 1) {
+        for (std::size_t i = 0; i < queueCapacity; ++i) {
+            m_frames.emplace_back(std::make_unique<Canvas>(width, height));
+            m_freeSlots.Push(i);
+        }
+
+        if (m_format == eCaptureFormat::e_RawVideo) {
+            m_stream = m_output == "-" ? stdout : std::fopen(m_output.c_str(), "wb");
+            if (!m_stream) {
+                std::cerr << "Couldn't Open the File: " + m_output + "\nFrame capture disabled" << std::endl;
+            }
+        }
+
+        m_writer = std::thread(&FrameCapture::WriterLoop, this);
+    }
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    /**
+     * @brief Дожидается записи оставшихся кадров и печатает итоговую статистику.
+     */
+    ~FrameCapture() {
+        m_running = false;
+        m_wakeUp.notify_one();
+        m_writer.join();
+
+        if (m_stream && m_stream != stdout) std::fclose(m_stream);
+
+        std::cerr << "Frame capture: " << m_writtenFrames << " frames written, "
+                  << m_droppedFrames << " frames dropped, " << m_failedFrames << " frames failed" << std::endl;
+    }
+
+    /**
+     * @brief Берет свободный кадр из пула без ожидания.
+     * @return Указатель на кадр или nullptr, если свободных кадров нет (кадр считается отброшенным).
+     */
+    Canvas *AcquireFrame() {
+        std::size_t slot = 0;
+        if (!m_freeSlots.Pop(slot)) {
+            ++m_droppedFrames;
+            return nullptr;
+        }
+        m_acquiredSlot = slot;
+        return m_frames[slot].get();
+    }
+
+    /**
+     * @brief Передает кадр, полученный через AcquireFrame, потоку записи.
+     */
+    void SubmitFrame() {
+        m_readySlots.Push(m_acquiredSlot);
+        m_wakeUp.notify_one();
+    }
+
+    /**
+     * @brief Записывает кадр объекта командами в свободный кадр пула и ставит его в очередь записи.
+     *
+     * Растеризует кадр поток записи: на потоке симуляции остается только запись команд.
+     *
+     * @param source Любой объект с методом Render(Canvas&), например Game.
+     * @return false, если кадр был отброшен.
+     */
+    template<typename Source>
+    bool Capture(Source &source) {
+        PACMAN_TRACE_SCOPE("Frame capture");
+        Canvas *frame = AcquireFrame();
+        if (!frame) {
+            PACMAN_TRACE_COUNTER("Dropped frames", static_cast<std::int64_t>(m_droppedFrames.load()));
+            return false;
+        }
+
+        frame->BeginRecording();
+        frame->Clear();
+        source.Render(*frame);
+        SubmitFrame();
+        return true;
+    }
+
+    std::uint64_t GetDroppedFrames() const {
+        return m_droppedFrames;
+    }
+
+    std::uint64_t GetWrittenFrames() const {
+        return m_writtenFrames;
+    }
+
+    /**
+     * @brief Кадры, дошедшие до потока записи, но не записанные (файл не открылся или запись не удалась).
+     */
+    std::uint64_t GetFailedFrames() const {
+        return m_failedFrames;
+    }
+
+private:
+    /**
+     * @brief Кольцевой буфер индексов с одним производителем и одним потребителем.
+     */
+    class SlotRing {
+    public:
+        explicit SlotRing(const std::size_t capacity) : m_slots(capacity) {}
+
+        bool Push(const std::size_t slot) {
+            const std::size_t head = m_head.load(std::memory_order_relaxed);
+            const std::size_t next = (head + 1) % m_slots.size();
+            if (next == m_tail.load(std::memory_order_acquire)) return false;
+            m_slots[head] = slot;
+            m_head.store(next, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(std::size_t &slot) {
+            const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire)) return false;
+            slot = m_slots[tail];
+            m_tail.store((tail + 1) % m_slots.size(), std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::vector<std::size_t> m_slots;
+        std::atomic<std::size_t> m_head{0};
+        std::atomic<std::size_t> m_tail{0};
+    };
+
+    std::string m_output; ///< Путь к потоку или префикс PNG-файлов.
+    eCaptureFormat m_format; ///< Формат записи.
+    std::vector<std::unique_ptr<Canvas>> m_frames; ///< Пул кадров.
+    SlotRing m_freeSlots; ///< Свободные кадры (пишет поток записи, читает симуляция).
+    SlotRing m_readySlots; ///< Готовые кадры (пишет симуляция, читает поток записи).
+    std::size_t m_acquiredSlot = 0; ///< Кадр, выданный последним вызовом AcquireFrame.
+
+    std::FILE *m_stream = nullptr; ///< Файл сырого потока.
+    std::atomic<bool> m_running{true};
+    std::atomic<std::uint64_t> m_droppedFrames{0};
+    std::atomic<std::uint64_t> m_writtenFrames{0};
+    std::atomic<std::uint64_t> m_failedFrames{0};
+
+    std::mutex m_wakeUpMutex;
+    std::condition_variable m_wakeUp;
+    std::thread m_writer;
+
+    void WriterLoop() {
+        std::vector<std::uint8_t> encoded;
+
+        for (;;) {
+            std::size_t slot = 0;
+            if (!m_readySlots.Pop(slot)) {
+                if (!m_running) break;
+
+                // Уведомление может прийти между проверкой и ожиданием, поэтому ждем с таймаутом
+                std::unique_lock<std::mutex> lock(m_wakeUpMutex);
+                m_wakeUp.wait_for(lock, std::chrono::milliseconds(10));
+                continue;
+            }
+
+            Canvas &frame = *m_frames[slot];
+            {
+                PACMAN_TRACE_SCOPE("Frame rasterise");
+                frame.Replay();
+            }
+            if (WriteFrame(frame, encoded)) ++m_writtenFrames;
+            else ++m_failedFrames;
+            m_freeSlots.Push(slot);
+        }
+
+        if (m_stream) std::fflush(m_stream);
+    }
+
+    /**
+     * @brief Записывает кадр целиком.
+     *
+     * Номер PNG-файла - количество уже записанных кадров, поэтому незаписанный кадр не оставляет пропуска в нумерации.
+     * @return false, если кадр не записан.
+     */
+    bool WriteFrame(const Canvas &frame, std::vector<std::uint8_t> &encoded) {
+        if (m_format == eCaptureFormat::e_RawVideo) {
+            const std::vector<std::uint8_t> &pixels = frame.GetPixels();
+            return m_stream && std::fwrite(pixels.data(), 1, pixels.size(), m_stream) == pixels.size();
+        }
+
+        EncodePng(frame, encoded);
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "_%06llu.png", static_cast<unsigned long long>(m_writtenFrames.load()));
+        const std::string path = m_output + suffix;
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+
+        const bool written = std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+        if (std::fclose(file) == 0 && written) return true;
+        std::remove(path.c_str());
+        return false;
+    }
+
+    static std::uint32_t Crc32(const std::uint8_t *data, const std::size_t size, std::uint32_t crc = 0) {
+        static const auto k_table = [] {
+            std::array<std::uint32_t, 256> table{};
+            for (std::uint32_t n = 0; n < 256; ++n) {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+            return table;
+        }();
+
+        crc = ~crc;
+        for (std::size_t i = 0; i < size; ++i) crc = k_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    static void PutUint32(std::vector<std::uint8_t> &out, const std::uint32_t value) {
+        out.push_back(static_cast<std::uint8_t>(value >> 24));
+        out.push_back(static_cast<std::uint8_t>(value >> 16));
+        out.push_back(static_cast<std::uint8_t>(value >> 8));
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    static void PutChunk(std::vector<std::uint8_t> &out, const char *type, const std::vector<std::uint8_t> &data) {
+        PutUint32(out, static_cast<std::uint32_t>(data.size()));
+        const std::size_t typeOffset = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        PutUint32(out, Crc32(&out[typeOffset], data.size() + 4));
+    }
+
+    /**
+     * @brief Кодирует кадр в PNG без сжатия (deflate с несжатыми блоками).
+     *
+     * Сжатие оставлено внешним инструментам: писатель должен успевать за симуляцией.
+     */
+    static void EncodePng(const Canvas &frame, std::vector<std::uint8_t> &out) {
+        static const std::uint8_t k_signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        out.assign(k_signature, k_signature + sizeof(k_signature));
+
+        std::vector<std::uint8_t> header;
+        PutUint32(header, frame.GetWidth());
+        PutUint32(header, frame.GetHeight());
+        header.insert(header.end(), {8, 6, 0, 0, 0}); // 8 бит, RGBA
+        PutChunk(out, "IHDR", header);
+
+        // Строки с фильтром 0 (None)
+        const std::size_t stride = static_cast<std::size_t>(frame.GetWidth()) * 4;
+        std::vector<std::uint8_t> scanlines;
+        scanlines.reserve((stride + 1) * frame.GetHeight());
+        for (unsigned y = 0; y < frame.GetHeight(); ++y) {
+            scanlines.push_back(0);
+            const auto row = frame.GetPixels().begin() + static_cast<std::ptrdiff_t>(y * stride);
+            scanlines.insert(scanlines.end(), row, row + static_cast<std::ptrdiff_t>(stride));
+        }
+
+        std::vector<std::uint8_t> zlib = {0x78, 0x01};
+        std::uint32_t adlerA = 1, adlerB = 0;
+        for (std::size_t offset = 0; offset < scanlines.size() || offset == 0;) {
+            const std::size_t blockSize = scanlines.size() - offset < 65535 ? scanlines.size() - offset : 65535;
+            const bool last = offset + blockSize == scanlines.size();
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back(static_cast<std::uint8_t>(blockSize));
+            zlib.push_back(static_cast<std::uint8_t>(blockSize >> 8));
+            zlib.push_back(static_cast<std::uint8_t>(~blockSize));
+            zlib.push_back(static_cast<std::uint8_t>(~blockSize >> 8));
+            for (std::size_t i = offset; i < offset + blockSize; ++i) {
+                zlib.push_back(scanlines[i]);
+                adlerA = (adlerA + scanlines[i]) % 65521;
+                adlerB = (adlerB + adlerA) % 65521;
+            }
+            offset += blockSize;
+            if (last) break;
+        }
+        PutUint32(zlib, (adlerB << 16) | adlerA);
+        PutChunk(out, "IDAT", zlib);
+
+        PutChunk(out, "IEND", {});
+    }
+};
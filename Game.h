@@ -1,4 +1,11 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
 #include <vector>
 #include <iostream>
 #include <SFML/Graphics/RenderWindow.hpp>
@@ -6,18 +13,64 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Window/Keyboard.hpp>
 #include "Entity.h"
+#include "EntityStore.h"
 #include "Ghost.h"
+#include "GhostPolicy.h"
 #include "Pacman.h"
 #include "PIckup.h"
 #include "Info.h"
+#include "AssetRegistry.h"
+#include "DangerMap.h"
+#include "FlowField.h"
+#include "GameConfig.h"
 #include "Manager.h"
+#include "Metrics.h"
+#include "OccupancyGrid.h"
+#include "PathService.h"
+#include "Profiler.h"
+#include "ReplanScheduler.h"
+#include "StateHash.h"
+#include "Tracer.h"
 #include "np.h"
 
 
 class Game
 {
 public:
-    Game():
+    /**
+     * @brief Создает игру на уровне из файла. Размеры поля берутся из уровня,
+     * количество сущностей - из файла <уровень>.cfg, если он есть.
+     *
+     * Уровень и шрифт берутся из AssetRegistry: файлы читаются только первой игрой процесса.
+     * @param levelPath Путь к уровню (CSV или .pml).
+     */
+    explicit Game(const std::string& levelPath = cnp::default_level_path()):
+            Game(levelPath, lvl::load_level_config(levelPath))
+    {
+    }
+
+    Game(const std::string& levelPath, const GameConfig& config):
+            Game(LoadLevel(levelPath), config)
+    {
+    }
+
+    /**
+     * @brief Создает игру на уровне из памяти, например сгенерированном lvl::generate_maze.
+     */
+    explicit Game(const LevelGrid& level, const GameConfig& config = {}):
+            Game(LoadLevel(level), config)
+    {
+    }
+
+    /**
+     * @brief Создает игру на уже загруженном уровне. Несколько игр могут разделять один уровень.
+     * @param level Уровень.
+     * @param config Количество Пакманов и призраков.
+     */
+    explicit Game(std::shared_ptr<const Manager> level, const GameConfig& config = {}):
+            m_config(config),
+            m_tileManager(std::move(level)),
+            m_entities(m_tileManager->GetGridMetrics()),
             m_score(
                     "Score : ",
                     cnp::k_gridCellSize,
@@ -26,220 +79,719 @@ public:
             m_lives(
                     "Lives: ",
                     cnp::k_gridCellSize,
-                    { cnp::k_screenSize - 5 * cnp::k_gridCellSize, 0.f }
+                    { static_cast<float>(m_tileManager->GetGridMetrics().GetWidth() - 5 * cnp::k_gridCellSize), 0.f }
             ),
             m_end(
                     "Game Over",
                     2 * cnp::k_gridCellSize,
                     {
-                            (static_cast<float>(cnp::k_screenSize) / 2.f) - 6 * cnp::k_gridCellSize,
-                            (static_cast<float>(cnp::k_screenSize) / 2.f) - 2 * cnp::k_gridCellSize
+                            (static_cast<float>(m_tileManager->GetGridMetrics().GetWidth()) / 2.f) - 6 * cnp::k_gridCellSize,
+                            (static_cast<float>(m_tileManager->GetGridMetrics().GetHeight()) / 2.f) - 2 * cnp::k_gridCellSize
                     },
                     false
-            )
+            ),
+            m_font(AssetRegistry::Instance().GetFont(cnp::font_path()))
     {
-        m_font.loadFromFile("../Data/Font.ttf");
+        m_score.SetFont(*m_font);
+        m_lives.SetFont(*m_font);
+        m_end.SetFont(*m_font);
 
-        m_score.SetFont(m_font);
-        m_lives.SetFont(m_font);
-        m_end.SetFont(m_font);
+        const GridMetrics& gridMetrics = m_tileManager->GetGridMetrics();
 
+        for (const auto& pickup : m_tileManager->GetPickUpLocations())
+        {
+            m_pickups.emplace_back();
+            m_pickups.back().TrackState(m_entities.GetHash(), static_cast<std::uint32_t>(m_pickups.size() - 1));
+            m_pickups.back().Initialise(pickup.first, static_cast<ePickUpType>(pickup.second),
+                                        gridMetrics.GetCellSize());
+        }
 
-        if (!m_tileManager.LoadLevel("../Data/Level.csv"))
+        // Призраки хранят указатели на Пакманов, поэтому векторы не должны перевыделяться
+        m_entities.Reserve(static_cast<std::size_t>(std::max(1, m_config.m_pacMen) + std::max(0, m_config.m_ghosts)));
+        m_pacMen.reserve(static_cast<std::size_t>(std::max(1, m_config.m_pacMen)));
+        for (int i = 0; i < std::max(1, m_config.m_pacMen); ++i)
         {
-            std::cout << "Error loading level data" << std::endl;
+            m_pacMen.emplace_back(m_entities);
         }
 
-        for (const auto& pickup : m_tileManager.GetPickUpLocations())
+        // Призраки одного типа хранятся подряд, чтобы тик обходил их группой (см. GhostPolicy.h)
+        const std::vector<const GhostPolicyInfo*> roster = GhostRegistry::Instance().GetRoster(m_config.m_ghostTypes);
+        std::vector<int> order(static_cast<std::size_t>(std::max(0, m_config.m_ghosts)));
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&roster](const int a, const int b) {
+            return roster[a % roster.size()]->m_id < roster[b % roster.size()]->m_id;
+        });
+
+        m_ghosts.reserve(order.size());
+        for (const int i : order)
         {
-            m_pickups.emplace_back();
-            m_pickups.back().Initialise(pickup.first, static_cast<ePickUpType>(pickup.second));
+            const GhostPolicyInfo& policy = *roster[i % roster.size()];
+            if (m_ghostGroups.empty() || m_ghostGroups.back().m_policy != &policy)
+            {
+                m_ghostGroups.push_back({ &policy, m_ghosts.size(), m_ghosts.size() });
+            }
+            m_ghosts.emplace_back(
+                    policy,
+                    i % cnp::k_classicGhostCount,
+                    m_tileManager->GetLevelData(),
+                    m_entities,
+                    m_tileManager->GetNavigation(),
+                    m_pacMen[i % m_pacMen.size()]
+            );
+            m_ghostGroups.back().m_end = m_ghosts.size();
         }
 
-        m_ghosts.emplace_back(
-                eGhostType::e_Blinky,
-                m_tileManager.GetLevelData(),
-                m_pacMan
-        );
+        // В толпе призраки гонятся за немногими клетками у Пакманов: пути к ним общие
+        if (m_config.m_ghosts > cnp::k_classicGhostCount)
+        {
+            m_flowFields = std::make_unique<FlowFieldCache>(m_tileManager->GetLevelData(),
+                                                            k_flowFieldsPerPacMan * m_pacMen.size());
+            for (auto& ghost : m_ghosts)
+            {
+                ghost.SetFlowFields(m_flowFields.get());
+            }
+        }
 
-        m_ghosts.emplace_back(
-                eGhostType::e_Pinky,
-                m_tileManager.GetLevelData(),
-                m_pacMan
-        );
+        if (m_config.m_dangerMap)
+        {
+            m_dangerMap.Reset(gridMetrics, m_tileManager->GetLevelData());
+            for (auto& ghost : m_ghosts)
+            {
+                ghost.SetDangerMap(&m_dangerMap);
+            }
+            UpdateDangerMap();
+        }
+    }
 
-        m_ghosts.emplace_back(
-                eGhostType::e_Inky,
-                m_tileManager.GetLevelData(),
-                m_pacMan
-        );
+    /**
+     * @brief Размеры загруженного уровня (в том числе размер окна в пикселях).
+     */
+    const GridMetrics& GetGridMetrics() const {
+        return m_tileManager->GetGridMetrics();
+    }
 
-        m_ghosts.emplace_back(
-                eGhostType::e_Clyde,
-                m_tileManager.GetLevelData(),
-                m_pacMan
-        );
+    /**
+     * @brief Игра окончена (все монеты собраны или у Пакманов не осталось жизней).
+     */
+    bool IsGameOver() const {
+        return m_gameOver;
     }
 
+    /**
+     * @brief Пакман с номером index (0 - управляется стрелками, 1 - WASD).
+     */
+    PacMan& GetPacMan(const std::size_t index){
+        return m_pacMen[index];
+    }
 
-    void Input(){
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Up))
+    const PacMan& GetPacMan(const std::size_t index) const {
+        return m_pacMen[index];
+    }
+
+    std::size_t GetPacManCount() const {
+        return m_pacMen.size();
+    }
+
+    /**
+     * @brief Уровень игры: клетки, навигационные данные и размеры.
+     */
+    const Manager& GetLevel() const {
+        return *m_tileManager;
+    }
+
+    const std::vector<PickUp>& GetPickUps() const {
+        return m_pickups;
+    }
+
+    const std::vector<Ghost>& GetGhosts() const {
+        return m_ghosts;
+    }
+
+    /**
+     * @brief Поля опасности и притяжения на конец последнего тика или nullptr, если они выключены
+     * (GameConfig::m_dangerMap).
+     */
+    const DangerMap* GetDangerMap() const {
+        return m_config.m_dangerMap ? &m_dangerMap : nullptr;
+    }
+
+    /**
+     * @brief Хэш Зобриста состояния: Пакманы, призраки, видимые подборки, таймеры, счет и жизни.
+     *
+     * Обновляется при каждом изменении состояния, поэтому чтение бесплатно.
+     */
+    std::uint64_t GetStateHash() const {
+        return m_entities.GetHash().GetValue();
+    }
+
+    /**
+     * @brief Хэш состояния, посчитанный заново обходом всей игры; совпадает с GetStateHash.
+     */
+    std::uint64_t ComputeStateHash() const {
+        StateHash hash = m_entities.ComputeHash();
+        for (const auto& pacMan : m_pacMen)
         {
-            m_pacMan.SetDirection(eDirection::e_Up);
+            hash.Toggle(eHashField::e_Points, pacMan.GetId(), zobrist::pack(pacMan.GetPoints()));
+            hash.Toggle(eHashField::e_Lives, pacMan.GetId(), zobrist::pack(pacMan.GetLivesRemaining()));
+            hash.Toggle(eHashField::e_Alive, pacMan.GetId(), pacMan.IsAlive());
         }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Down))
+        for (std::size_t i = 0; i < m_pickups.size(); ++i)
         {
-            m_pacMan.SetDirection(eDirection::e_Down);
+            m_pickups[i].AddToHash(hash, static_cast<std::uint32_t>(i));
         }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Left))
+        return hash.GetValue();
+    }
+
+    /**
+     * @brief Состояние игры между тиками: снимок для отката и повторной симуляции (см. Rollback.h).
+     *
+     * Уровень и навигация не меняются, а сетки занятости строятся заново каждый тик, поэтому в снимок не входят.
+     */
+    struct Snapshot
+    {
+        EntityStore::Snapshot m_entities;
+        std::vector<PacMan::Snapshot> m_pacMen;
+        std::vector<PickUp::Snapshot> m_pickups;
+        std::vector<Ghost::Snapshot> m_ghosts;
+        ReplanScheduler m_replanScheduler;
+        bool m_gameOver = false;
+    };
+
+    /**
+     * @brief Копирует состояние в снимок. Снимок переиспользуется: после первого сохранения память не выделяется.
+     */
+    void Save(Snapshot& snapshot) const {
+        m_entities.Save(snapshot.m_entities);
+        snapshot.m_pacMen.resize(m_pacMen.size());
+        for (std::size_t i = 0; i < m_pacMen.size(); ++i)
         {
-            m_pacMan.SetDirection(eDirection::e_Left);
+            snapshot.m_pacMen[i] = m_pacMen[i].Save();
         }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Right))
+        snapshot.m_pickups.resize(m_pickups.size());
+        for (std::size_t i = 0; i < m_pickups.size(); ++i)
         {
-            m_pacMan.SetDirection(eDirection::e_Right);
+            snapshot.m_pickups[i] = m_pickups[i].Save();
         }
+        snapshot.m_ghosts.resize(m_ghosts.size());
+        for (std::size_t i = 0; i < m_ghosts.size(); ++i)
+        {
+            m_ghosts[i].Save(snapshot.m_ghosts[i]);
+        }
+        snapshot.m_replanScheduler = m_replanScheduler;
+        snapshot.m_gameOver = m_gameOver;
     }
-    void Update(){
-        if (m_gameOver)
+
+    /**
+     * @brief Возвращает игру в состояние из снимка этой же игры или ее копии (Clone); хэш состояния
+     * восстанавливается вместе с ней.
+     */
+    void Restore(const Snapshot& snapshot){
+        m_entities.Restore(snapshot.m_entities);
+        for (std::size_t i = 0; i < m_pacMen.size(); ++i)
+        {
+            m_pacMen[i].Restore(snapshot.m_pacMen[i]);
+        }
+        for (std::size_t i = 0; i < m_pickups.size(); ++i)
         {
-            m_end.SetString(m_pacMan.GetLivesRemaining() <= 0 ? "Game Over" : "You Win!");
+            m_pickups[i].Restore(snapshot.m_pickups[i]);
+        }
+        for (std::size_t i = 0; i < m_ghosts.size(); ++i)
+        {
+            m_ghosts[i].Restore(snapshot.m_ghosts[i]);
+        }
+        m_replanScheduler = snapshot.m_replanScheduler;
+        UpdateDangerMap();
 
-            m_end.SetVisible(true);
+        // A rollback past the end of the game takes the end screen down again
+        if (!snapshot.m_gameOver && m_end.GetVisible())
+        {
+            m_end.SetVisible(false);
+            m_score.SetPosition({ 0.f, 0.f });
+        }
+        m_gameOver = snapshot.m_gameOver;
+    }
 
-            m_score.SetPosition({
-                                        m_end.GetPosition().x,
-                                        m_end.GetPosition().y + 2 * cnp::k_gridCellSize
-                                });
-        } else
+    /**
+     * @brief Копия игры для симуляции: тот же уровень, настройки, шаг тика и состояние.
+     *
+     * Копия разделяет с игрой уровень, поэтому пути призраков в снимках действительны в обеих,
+     * и снимок одной восстанавливается в другой. Поиск путей копии синхронный.
+     */
+    std::unique_ptr<Game> Clone() const {
+        auto copy = std::make_unique<Game>(m_tileManager, m_config);
+        copy->m_fixedTickSeconds = m_fixedTickSeconds;
+        Snapshot snapshot;
+        Save(snapshot);
+        copy->Restore(snapshot);
+        return copy;
+    }
+
+    /**
+     * @brief Строит поля от призраков и видимых подборок, если они включены; тик делает это сам.
+     *
+     * Боты читают поля между тиками, выбор цели призраков - в следующем тике.
+     */
+    void UpdateDangerMap(){
+        if (!m_config.m_dangerMap) return;
+        PACMAN_PROFILE_SCOPE("DangerMap");
+        m_dangerMap.ClearSources();
+        // The default grid converts pixels to cells by a compile-time cell size
+        GetGridMetrics().Dispatch([&](const auto& grid) { AddDangerSources(grid); });
+        m_dangerMap.Propagate();
+    }
+
+    /**
+     * @brief Задает зерно генератора случайных чисел игры (по умолчанию - текущее время).
+     */
+    void SetSeed(const std::uint64_t seed){
+        m_entities.Seed(seed);
+    }
+
+    /**
+     * @brief Фиксированная длительность тика для таймеров усиления и дома призраков.
+     *
+     * С фиксированным шагом и заданным зерном игра детерминирована и не зависит от скорости машины.
+     * @param seconds Секунд на тик; 0 - таймеры идут по реальному времени между тиками.
+     */
+    void SetFixedTickSeconds(const float seconds){
+        m_fixedTickSeconds = seconds;
+    }
+
+    /**
+     * @brief Планировщик обновления путей призраков (бюджет на тик, сдвиг фаз).
+     */
+    ReplanScheduler& GetReplanScheduler(){
+        return m_replanScheduler;
+    }
+
+    /**
+     * @brief Переносит поиск путей призраков в пул рабочих потоков.
+     *
+     * Пути, запрошенные на тике, выдаются призракам в начале следующего тика.
+     * @param threads Количество потоков; 0 - поиск в игровом потоке с бюджетом ReplanScheduler.
+     */
+    void SetPathThreads(const unsigned threads){
+        for (auto& ghost : m_ghosts)
         {
-            if (m_pacMan.IsAlive())
-            {
-                m_pacMan.Update(m_tileManager.GetLevelData());
+            ghost.SetPathService(nullptr);
+        }
+        m_pathService.reset();
+        if (threads == 0) return;
 
-                // If all the coins are collected then pacman has won
-                int activeCoins = 0;
+        m_pathService = std::make_unique<PathService>(m_tileManager->GetLevelData(), threads);
+        // Номера призраков в сервисе совпадают с их индексами
+        for (auto& ghost : m_ghosts)
+        {
+            ghost.SetPathService(m_pathService.get());
+        }
+    }
 
-                for (auto& pickup : m_pickups)
-                {
-                    switch (pickup.GetPickUpType())
-                    {
-                        case ePickUpType::e_Coin:
-                            if (pickup.Visible())
-                            {
-                                activeCoins++;
-                            }
-                        case ePickUpType::e_PowerUp:
-                            if (pickup.Visible())
-                            {
-                                pickup.CheckPacManCollisions(m_pacMan);
-                            }
-                            break;
-                        default:
-                            std::cout << "Unknown pickup" << std::endl;
-                    }
+    /**
+     * @brief Сервис асинхронного поиска путей или nullptr, если поиск синхронный.
+     */
+    const PathService* GetPathService() const {
+        return m_pathService.get();
+    }
 
-                }
+    /**
+     * @brief Дожидается фоновой сборки навигационных данных (до нее призраки используют A*).
+     */
+    void WaitForNavigation(){
+        m_tileManager->GetNavigation().Wait();
+    }
 
-                if (activeCoins == 0)
-                {
-                    m_gameOver = true;
-                }
 
-                for (auto& ghost : m_ghosts)
-                {
-                    if (ghost.GetGhostState() != eGhostState::e_Frightened)
-                    {
-                        switch (m_pacMan.GetPacManState())
-                        {
-                            case ePacManState::e_Normal:
-                                ghost.SetGhostState(eGhostState::e_Chase);
-                                break;
-                            case ePacManState::e_PowerUp:
-                                ghost.SetGhostState(eGhostState::e_Scatter);
-                                break;
-                            default:;
-                        }
-                    }
-                    ghost.Update();
-                }
+    void Input(){
+        // Второй Пакман кооператива управляется клавишами WASD
+        ReadDirection(m_pacMen[0], sf::Keyboard::Key::Up, sf::Keyboard::Key::Down,
+                      sf::Keyboard::Key::Left, sf::Keyboard::Key::Right);
+        if (m_pacMen.size() > 1)
+        {
+            ReadDirection(m_pacMen[1], sf::Keyboard::Key::W, sf::Keyboard::Key::S,
+                          sf::Keyboard::Key::A, sf::Keyboard::Key::D);
+        }
+    }
+    void Update(){
+        PACMAN_PROFILE_SCOPE("Game::Update");
+        PACMAN_TRACE_SCOPE("Game::Update");
+        const auto tickStart = std::chrono::steady_clock::now();
+        metrics::GameMetrics& gameMetrics = metrics::GameMetrics::Instance();
+        if (m_gameOver)
+        {
+            // The end screen is set up once, on the first tick after the game ends
+            if (!m_end.GetVisible())
+            {
+                const bool anyLivesLeft = std::any_of(m_pacMen.begin(), m_pacMen.end(),
+                                                      [](const PacMan& pacMan) { return pacMan.GetLivesRemaining() > 0; });
+                m_end.SetString(anyLivesLeft ? "You Win!" : "Game Over");
 
-                if (hnp::rand_range(0, 1000) <= 5)
-                {
-                    SpawnNewPowerUp();
-                }
+                m_end.SetVisible(true);
 
-            } else
+                m_score.SetPosition({
+                                            m_end.GetPosition().x,
+                                            m_end.GetPosition().y + 2 * cnp::k_gridCellSize
+                                    });
+            }
+        } else
+        {
+            // A caught Pac-Man respawns while it has lives left; one without lives stays out of the game
+            bool caught = false;
+            for (auto& pacMan : m_pacMen)
+            {
+                if (pacMan.IsAlive() || pacMan.GetLivesRemaining() <= 0) continue;
+                pacMan.Reset();
+                caught = true;
+            }
+
+            if (caught)
             {
-                m_pacMan.Reset();
                 for (auto& ghost : m_ghosts)
                 {
                     ghost.Reset();
                 }
-
-                if (m_pacMan.GetLivesRemaining() == 0)
-                {
-                    m_gameOver = true;
-                }
+            } else if (std::none_of(m_pacMen.begin(), m_pacMen.end(), [](const PacMan& pacMan) { return pacMan.IsAlive(); }))
+            {
+                m_gameOver = true;
+                gameMetrics.m_gamesFinished.Add();
+            } else
+            {
+                Play();
             }
         }
-        m_score.SetString("Score: " + std::to_string(m_pacMan.GetPoints()));
-        m_lives.SetString("Lives: " + std::to_string(m_pacMan.GetLivesRemaining()));
+        // Catches reset the ghosts without Play, so the fields follow every tick
+        UpdateDangerMap();
 
+        gameMetrics.m_ticks.Add();
+        gameMetrics.m_tickMicroseconds.Observe(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tickStart).count()));
     }
 
-    void Render(sf::RenderWindow& window){
-        m_tileManager.Render(window);
+    /**
+     * @brief Отрисовывает кадр в окно (sf::RenderWindow) или в программный буфер (Canvas).
+     */
+    template<typename RenderTarget>
+    void Render(RenderTarget& target){
+        {
+            PACMAN_PROFILE_SCOPE("Render maze");
+            m_tileManager->Render(target);
+        }
 
-        for (const auto& pickup : m_pickups)
         {
-            if (pickup.Visible())
+            PACMAN_PROFILE_SCOPE("Render pickups");
+            for (const auto& pickup : m_pickups)
             {
-                pickup.Render(window);
+                if (pickup.Visible())
+                {
+                    pickup.Render(target);
+                }
             }
         }
 
-        m_pacMan.Render(window);
-
-        for (auto& ghost : m_ghosts)
         {
-            ghost.Render(window);
+            PACMAN_PROFILE_SCOPE("Render entities");
+            for (auto& pacMan : m_pacMen)
+            {
+                pacMan.Render(target);
+            }
+
+            for (auto& ghost : m_ghosts)
+            {
+                ghost.Render(target);
+            }
         }
 
-        m_score.Render(window);
-        m_lives.Render(window);
-        m_end.Render(window);
+        {
+            PACMAN_PROFILE_SCOPE("Render HUD");
+            UpdateHud();
+            m_score.Render(target);
+            m_lives.Render(target);
+            m_end.Render(target);
+        }
     }
 
 private:
+    static constexpr std::size_t k_flowFieldsPerPacMan = 8; ///< Таблиц шагов в кэше на одного Пакмана.
+    static constexpr int k_scatterFalloff = 2; ///< Разбегающийся призрак опасен, как преследующий в 2 шагах.
+    static constexpr int k_coinFalloff = 4; ///< Монета притягивает, как усиление в 4 шагах.
+
     bool m_gameOver{};
-    PacMan m_pacMan;
+    GameConfig m_config;
+    // The level is loaded first: every entity is sized from its grid metrics
+    std::shared_ptr<const Manager> m_tileManager;
+    // Components of every Pac-Man and ghost; the entity vectors below are views into it
+    EntityStore m_entities;
+    sf::Clock m_tickClock;
+    float m_fixedTickSeconds = 0.f;
+    std::vector<PacMan> m_pacMen;
     std::vector<PickUp> m_pickups;
     std::vector<Ghost> m_ghosts;
-    Manager m_tileManager;
+
+    /**
+     * @brief Призраки одного типа: m_ghosts[m_begin, m_end).
+     */
+    struct GhostGroup
+    {
+        const GhostPolicyInfo* m_policy;
+        std::size_t m_begin;
+        std::size_t m_end;
+    };
+    std::vector<GhostGroup> m_ghostGroups;
+    OccupancyGrid m_pacManCells;
+    OccupancyGrid m_ghostCells;
+    std::unique_ptr<FlowFieldCache> m_flowFields;
+    DangerMap m_dangerMap;
+    ReplanScheduler m_replanScheduler;
+    std::unique_ptr<PathService> m_pathService;
 
     Info m_score;
+    int m_shownPoints = -1; ///< Score currently shown by the HUD.
+    int m_shownLives = -1; ///< Lives currently shown by the HUD.
     Info m_lives;
     Info m_end;
 
-    sf::Font m_font;
+    std::shared_ptr<const sf::Font> m_font;
+
+    static void ReadDirection(PacMan& pacMan, const sf::Keyboard::Key up, const sf::Keyboard::Key down,
+                              const sf::Keyboard::Key left, const sf::Keyboard::Key right){
+        if (sf::Keyboard::isKeyPressed(up))
+        {
+            pacMan.SetDirection(eDirection::e_Up);
+        }
+        if (sf::Keyboard::isKeyPressed(down))
+        {
+            pacMan.SetDirection(eDirection::e_Down);
+        }
+        if (sf::Keyboard::isKeyPressed(left))
+        {
+            pacMan.SetDirection(eDirection::e_Left);
+        }
+        if (sf::Keyboard::isKeyPressed(right))
+        {
+            pacMan.SetDirection(eDirection::e_Right);
+        }
+    }
+
+    /**
+     * @brief Источники полей опасности для сетки уровня (DefaultGrid или GridMetrics).
+     */
+    template<typename Grid>
+    void AddDangerSources(const Grid& grid){
+        for (const auto& ghost : m_ghosts)
+        {
+            const sf::Vector2i position = ghost.GetPosition();
+            const int column = grid.ToColumn(position.x);
+            const int row = grid.ToRow(position.y);
+            switch (ghost.GetGhostState())
+            {
+                case eGhostState::e_Chase:
+                    m_dangerMap.AddSource(eInfluence::e_Danger, column, row);
+                    break;
+                case eGhostState::e_Scatter:
+                    m_dangerMap.AddSource(eInfluence::e_Danger, column, row, k_scatterFalloff);
+                    break;
+                case eGhostState::e_Frightened:
+                    m_dangerMap.AddSource(eInfluence::e_Prey, column, row);
+                    break;
+                default:;
+            }
+        }
+        for (const auto& pickup : m_pickups)
+        {
+            if (!pickup.Visible()) continue;
+            const sf::Vector2i position = pickup.GetPosition();
+            m_dangerMap.AddSource(eInfluence::e_Attraction, grid.ToColumn(position.x), grid.ToRow(position.y),
+                                  pickup.GetPickUpType() == ePickUpType::e_PowerUp ? 0 : k_coinFalloff);
+        }
+    }
+
+    /**
+     * @brief Один игровой тик: движение, подбор предметов, пути и столкновения призраков.
+     */
+    void Play(){
+        const GridMetrics& gridMetrics = m_tileManager->GetGridMetrics();
+        auto isAlive = [](const PacMan& pacMan) { return pacMan.IsAlive(); };
+        metrics::GameMetrics& gameMetrics = metrics::GameMetrics::Instance();
+        // Power-up and home timers of all entities advance from one clock
+        const float elapsed = m_tickClock.restart().asSeconds();
+        m_entities.SetTickSeconds(m_fixedTickSeconds > 0.f ? m_fixedTickSeconds : elapsed);
+
+        for (auto& pacMan : m_pacMen)
+        {
+            if (pacMan.IsAlive()) pacMan.Update(m_tileManager->GetLevelData());
+        }
+        m_pacManCells.Rebuild(gridMetrics, m_pacMen, isAlive);
+
+        // If all the coins are collected then pacman has won
+        int activeCoins = 0;
+        int consumed = 0;
+
+        {
+            PACMAN_PROFILE_SCOPE("PickUp collisions");
+            PACMAN_TRACE_SCOPE("PickUp collisions");
+            for (auto& pickup : m_pickups)
+            {
+                switch (pickup.GetPickUpType())
+                {
+                    case ePickUpType::e_Coin:
+                        if (pickup.Visible())
+                        {
+                            activeCoins++;
+                        }
+                    case ePickUpType::e_PowerUp:
+                        m_pacManCells.ForEachAt(m_pacManCells.GetCell(pickup.GetPosition()), [&](const int pacMan) {
+                            if (!pickup.Visible()) return;
+                            pickup.CheckPacManCollisions(m_pacMen[pacMan]);
+                            consumed += !pickup.Visible();
+                        });
+                        break;
+                    default:
+                        std::cerr << "Unknown pickup" << std::endl;
+                }
+
+            }
+        }
+
+        PACMAN_TRACE_COUNTER("Active coins", activeCoins);
+        if (consumed > 0) gameMetrics.m_pickupsConsumed.Add(static_cast<std::uint64_t>(consumed));
+
+        if (activeCoins == 0)
+        {
+            m_gameOver = true;
+            gameMetrics.m_gamesFinished.Add();
+        }
+
+        for (auto& ghost : m_ghosts)
+        {
+            PacMan& target = GetNearestPacMan(ghost.GetPosition());
+            ghost.SetChaseTarget(target);
+
+            if (ghost.GetGhostState() != eGhostState::e_Frightened)
+            {
+                switch (target.GetPacManState())
+                {
+                    case ePacManState::e_Normal:
+                        ghost.SetGhostState(eGhostState::e_Chase);
+                        break;
+                    case ePacManState::e_PowerUp:
+                        ghost.SetGhostState(eGhostState::e_Scatter);
+                        break;
+                    default:;
+                }
+            }
+        }
+
+        if (m_pathService)
+        {
+            m_pathService->Deliver([this](const int ghost, const std::vector<std::uint32_t>& cells) {
+                m_ghosts[ghost].AcceptPath(cells);
+            });
+        }
+        m_replanScheduler.Tick(m_ghosts);
+        gameMetrics.m_replanQueueDepth.Set(static_cast<std::int64_t>(m_replanScheduler.GetPendingCount()));
+        if (m_pathService) gameMetrics.m_pathQueueDepth.Set(static_cast<std::int64_t>(m_pathService->GetQueueDepth()));
+
+        if (m_config.m_ghostSeparation)
+        {
+            m_ghostCells.Rebuild(gridMetrics, m_ghosts);
+        }
+        for (const auto& group : m_ghostGroups)
+        {
+            group.m_policy->m_updateGroup(m_ghosts.data() + group.m_begin, m_ghosts.data() + group.m_end,
+                                          m_config.m_ghostSeparation ? &m_ghostCells : nullptr);
+        }
+
+        {
+            PACMAN_TRACE_SCOPE("Ghost collisions");
+            m_ghostCells.Rebuild(gridMetrics, m_ghosts);
+            for (auto& pacMan : m_pacMen)
+            {
+                if (!pacMan.IsAlive()) continue;
+                m_ghostCells.ForEachAt(m_ghostCells.GetCell(pacMan.GetPosition()), [&](const int ghost) {
+                    m_ghosts[ghost].OnPacManContact(pacMan);
+                });
+            }
+        }
+
+        if (m_entities.GetRandom().NextInt(1001) <= 5)
+        {
+            SpawnNewPowerUp();
+        }
+    }
+
+    /**
+     * @brief Обновляет текст HUD при отрисовке кадра, а не в тике: изменение sf::Text выделяет память.
+     */
+    void UpdateHud(){
+        int points = 0;
+        int lives = 0;
+        for (const auto& pacMan : m_pacMen)
+        {
+            points += pacMan.GetPoints();
+            lives += pacMan.GetLivesRemaining();
+        }
+        if (points == m_shownPoints && lives == m_shownLives) return;
+
+        char text[32];
+        std::snprintf(text, sizeof(text), "Score: %d", points);
+        m_score.SetString(text);
+        std::snprintf(text, sizeof(text), "Lives: %d", lives);
+        m_lives.SetString(text);
+        m_shownPoints = points;
+        m_shownLives = lives;
+    }
+
+    /**
+     * @brief Ближайший живой Пакман (по манхэттенскому расстоянию); если живых нет - первый.
+     */
+    PacMan& GetNearestPacMan(const sf::Vector2i position){
+        PacMan* nearest = &m_pacMen[0];
+        int nearestDistance = INT_MAX;
+        for (auto& pacMan : m_pacMen)
+        {
+            if (!pacMan.IsAlive()) continue;
+            const int distance = std::abs(pacMan.GetPosition().x - position.x) +
+                                 std::abs(pacMan.GetPosition().y - position.y);
+            if (distance < nearestDistance)
+            {
+                nearest = &pacMan;
+                nearestDistance = distance;
+            }
+        }
+        return *nearest;
+    }
+
+    /**
+     * @brief Уровень из AssetRegistry; если он не загрузился, игра идет на пустом уровне, как раньше.
+     * Пустой уровень принадлежит только этой игре и не попадает в реестр.
+     */
+    static std::shared_ptr<const Manager> LoadLevel(const std::string& levelPath){
+        if (auto level = AssetRegistry::Instance().GetLevel(levelPath)) return level;
+        return std::make_shared<Manager>();
+    }
+
+    static std::shared_ptr<const Manager> LoadLevel(const LevelGrid& level){
+        auto manager = std::make_shared<Manager>();
+        manager->LoadLevel(level);
+        return manager;
+    }
 
     void SpawnNewPowerUp(){
         // Find an appropriate place to spawn the new power-up
-        auto& map = m_tileManager.GetLevelData();
-        Tile& randomTile = map[1][1];
+        const GridMetrics& gridMetrics = m_tileManager->GetGridMetrics();
+        auto& map = m_tileManager->GetLevelData();
+        const Tile* randomTile = nullptr;
         PickUp* firstAvailablePickup = nullptr;
 
         bool tileTaken = false;
         do
         {
-            const sf::Vector2i random(hnp::rand_range(25, 750), hnp::rand_range(50, 725));
-            randomTile = map[hnp::world_coord_to_array_index(random.y)][hnp::world_coord_to_array_index(random.y)];
+            const sf::Vector2i random = gridMetrics.GetRandomInteriorPosition(m_entities.GetRandom());
+            randomTile = &map[gridMetrics.ToRow(random.y)][gridMetrics.ToColumn(random.x)];
 
             // See if there is already a coin or pickup at this position
             for (auto& pickup : m_pickups)
             {
-                if (pickup.Visible() && pickup.GetPosition() == randomTile.m_position) tileTaken = true;
+                if (pickup.Visible() && pickup.GetPosition() == randomTile->m_position) tileTaken = true;
                 else
                 {
                     if (!pickup.Visible() && !firstAvailablePickup)
@@ -248,11 +800,11 @@ private:
                     }
                 }
             }
-        } while (randomTile.m_type != eTileType::e_Path && !tileTaken);
+        } while (randomTile->m_type != eTileType::e_Path && !tileTaken);
 
         if (firstAvailablePickup)
         {
-            firstAvailablePickup->Initialise(randomTile.m_position, ePickUpType::e_PowerUp);
+            firstAvailablePickup->Initialise(randomTile->m_position, ePickUpType::e_PowerUp, gridMetrics.GetCellSize());
         }
     }
 };
\ No newline at end of file
@@ -0,0 +1,113 @@
+/**
+ * @file GameConfig.h
+ * @brief Настройки сессии: количество Пакманов и призраков, правила и карты для ИИ.
+ *
+ * Настройки читаются из текстового файла вида "ключ = значение" (строки с # - комментарии).
+ * Уровень может нести собственные настройки в файле <уровень>.cfg рядом с ним.
+ *
+ *     pacmen = 2
+ *     ghosts = 64
+ *     ghost_separation = 1
+ *     ghost_types = Blinky, Pinky, Inky, Clyde
+ *     danger_map = 1
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+/**
+ * @struct GameConfig
+ * @brief Количество сущностей и правила их взаимодействия.
+ */
+struct GameConfig {
+    int m_pacMen = 1; /**< Количество Пакманов (1 - обычная игра, больше - кооператив). */
+    int m_ghosts = 4; /**< Количество призраков; типы из m_ghostTypes повторяются по кругу. */
+    bool m_ghostSeparation = false; /**< Призрак не заходит в клетку, занятую другим призраком в начале тика. */
+    std::vector<std::string> m_ghostTypes; /**< Имена типов из GhostRegistry (пусто - Blinky, Pinky, Inky, Clyde). */
+    bool m_dangerMap = false; /**< Игра строит поля опасности и притяжения каждый тик (DangerMap.h). */
+};
+
+namespace lvl {
+    inline std::string config_path(const std::string &levelPath) {
+        return levelPath + ".cfg";
+    }
+
+    /**
+     * @brief Читает настройки из файла. Отсутствующие ключи сохраняют прежние значения.
+     * @param path Путь к файлу настроек.
+     * @param config Настройки для заполнения.
+     * @param error Описание ошибки.
+     * @return false, если файл не открылся или содержит неизвестный ключ.
+     */
+    inline bool load_config(const std::string &path, GameConfig &config, std::string &error) {
+        std::ifstream file(path);
+        if (!file) {
+            error = "cannot open " + path;
+            return false;
+        }
+
+        auto trim = [](std::string text) {
+            const auto first = text.find_first_not_of(" \t\r");
+            const auto last = text.find_last_not_of(" \t\r");
+            return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+        };
+
+        std::string line;
+        for (int number = 1; std::getline(file, line); ++number) {
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty()) continue;
+
+            const auto separator = line.find('=');
+            if (separator == std::string::npos) {
+                error = path + ":" + std::to_string(number) + ": expected key = value";
+                return false;
+            }
+            const std::string key = trim(line.substr(0, separator));
+            const std::string text = trim(line.substr(separator + 1));
+            const int value = std::atoi(text.c_str());
+
+            if (key == "pacmen") config.m_pacMen = std::max(1, value);
+            else if (key == "ghosts") config.m_ghosts = std::max(0, value);
+            else if (key == "ghost_separation") config.m_ghostSeparation = value != 0;
+            else if (key == "danger_map") config.m_dangerMap = value != 0;
+            else if (key == "ghost_types") {
+                config.m_ghostTypes.clear();
+                for (std::size_t begin = 0; begin <= text.size();) {
+                    const std::size_t comma = std::min(text.find(',', begin), text.size());
+                    const std::string name = trim(text.substr(begin, comma - begin));
+                    if (!name.empty()) config.m_ghostTypes.push_back(name);
+                    begin = comma + 1;
+                }
+            }
+            else {
+                error = path + ":" + std::to_string(number) + ": unknown key " + key;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Настройки уровня из <уровень>.cfg или настройки по умолчанию, если файла нет.
+     */
+    inline GameConfig load_level_config(const std::string &levelPath) {
+        GameConfig config;
+        const std::string path = config_path(levelPath);
+        struct stat status{};
+        if (stat(path.c_str(), &status) != 0) return config;
+
+        std::string error;
+        if (!load_config(path, config, error)) {
+            std::cerr << "Ignoring level config: " << error << std::endl;
+            return GameConfig();
+        }
+        return config;
+    }
+}
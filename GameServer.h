@@ -0,0 +1,955 @@
+/**
+ * @file GameServer.h
+ * @brief Безоконный сервер, на котором идут тысячи игр одновременно.
+ *
+ * Сессия - одна игра (Game) и подключенные к ней соединения: игроки управляют Пакманами, зрители
+ * только получают состояние. Сессии распределены по рабочим потокам, по одному на ядро: каждый поток
+ * ведет свой цикл epoll, сам принимает ввод своих соединений, продвигает свои игры раз в тик и рассылает
+ * состояние. Игра и ее соединения принадлежат одному потоку, поэтому тик обходится без блокировок.
+ * Состояние рассылается дельтами: дельта тика кодируется один раз и копируется всем подписчикам сессии,
+ * ключевой кадр кодируется только для вошедших и пропустивших кадры (см. NetProtocol.h).
+ *
+ * Поток, вызвавший GameServer::Run, принимает соединения TCP и Unix-сокета, дожидается первого
+ * кадра e_Join, выбирает рабочий поток (новая игра - наименее загруженный, существующая - ее поток)
+ * и передает ему соединение. Он же печатает отчет о загрузке и оценку емкости сессий на ядро.
+ *
+ * Сервер работает только в Linux.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#define PACMAN_SERVER_EPOLL
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "Game.h"
+#include "GameConfig.h"
+#include "Manager.h"
+#include "NetProtocol.h"
+
+namespace server
+{
+    /**
+     * @brief Снимает с игры состояние, передаваемое клиентам.
+     *
+     * Векторы state переиспользуются: снимок каждого тика не выделяет память.
+     */
+    inline void capture_state(Game& game, const std::uint32_t tick, net::StreamState& state)
+    {
+        const GridMetrics& gridMetrics = game.GetGridMetrics();
+        auto toEntity = [&gridMetrics](const Entity& entity, const std::uint8_t entityState) {
+            net::EntityState result;
+            result.m_column = static_cast<std::uint16_t>(gridMetrics.ToColumn(entity.GetPosition().x));
+            result.m_row = static_cast<std::uint16_t>(gridMetrics.ToRow(entity.GetPosition().y));
+            result.m_direction = static_cast<std::uint8_t>(entity.GetDirection());
+            result.m_state = entityState;
+            return result;
+        };
+
+        state.m_tick = tick;
+        state.m_flags = game.IsGameOver() ? net::k_stateGameOver : 0;
+        state.m_pacMen = static_cast<std::uint8_t>(game.GetPacManCount());
+        state.m_entities.resize(game.GetPacManCount() + game.GetGhosts().size());
+        state.m_stats.resize(game.GetPacManCount());
+        for (std::size_t i = 0; i < game.GetPacManCount(); ++i)
+        {
+            const PacMan& pacMan = game.GetPacMan(i);
+            state.m_entities[i] = toEntity(pacMan, static_cast<std::uint8_t>(pacMan.GetPacManState()));
+            state.m_stats[i].m_points = pacMan.GetPoints();
+            state.m_stats[i].m_lives = static_cast<std::uint8_t>(std::clamp(pacMan.GetLivesRemaining(), 0, 255));
+            state.m_stats[i].m_alive = pacMan.IsAlive();
+        }
+        for (std::size_t i = 0; i < game.GetGhosts().size(); ++i)
+        {
+            const Ghost& ghost = game.GetGhosts()[i];
+            state.m_entities[game.GetPacManCount() + i] = toEntity(ghost, static_cast<std::uint8_t>(ghost.GetGhostState()));
+        }
+
+        const std::vector<PickUp>& pickups = game.GetPickUps();
+        state.m_pickups.resize(pickups.size());
+        for (std::size_t i = 0; i < pickups.size(); ++i)
+        {
+            net::PickUpState& pickup = state.m_pickups[i];
+            pickup = net::PickUpState();
+            if (!pickups[i].Visible()) continue;
+            pickup.m_cell = static_cast<std::uint32_t>(gridMetrics.ToRow(pickups[i].GetPosition().y) * gridMetrics.GetColumns() +
+                                                       gridMetrics.ToColumn(pickups[i].GetPosition().x));
+            pickup.m_type = static_cast<std::uint8_t>(pickups[i].GetPickUpType());
+            pickup.m_visible = 1;
+        }
+    }
+
+#ifdef PACMAN_SERVER_EPOLL
+    /**
+     * @brief Какой рабочий поток ведет сессию; читается при входе в существующую игру.
+     */
+    class SessionDirectory
+    {
+    public:
+        void Add(const std::uint32_t session, const unsigned worker)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_workers[session] = worker;
+        }
+
+        bool Find(const std::uint32_t session, unsigned& worker) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto found = m_workers.find(session);
+            if (found == m_workers.end()) return false;
+            worker = found->second;
+            return true;
+        }
+
+        void Remove(const std::uint32_t session)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_workers.erase(session);
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::uint32_t, unsigned> m_workers;
+    };
+
+    /**
+     * @brief Соединение, передаваемое рабочему потоку после e_Join.
+     */
+    struct Handoff
+    {
+        int m_fd = -1;
+        net::JoinRequest m_join;
+        std::uint32_t m_session = 0; ///< Номер сессии (для новой игры уже выбран).
+        bool m_create = false;
+        std::vector<std::uint8_t> m_received; ///< Байты, пришедшие вслед за e_Join.
+    };
+
+    /**
+     * @brief Счетчики рабочего потока для отчета о загрузке (пишет поток, читает Run).
+     */
+    struct WorkerStats
+    {
+        std::atomic<int> m_sessions{ 0 }; ///< Включая назначенные, но еще не созданные сессии.
+        std::atomic<int> m_connections{ 0 };
+        std::atomic<std::uint64_t> m_busyNanoseconds{ 0 };
+        std::atomic<std::uint64_t> m_sessionTicks{ 0 };
+        std::atomic<std::uint64_t> m_bytesSent{ 0 };
+        std::atomic<std::uint64_t> m_droppedFrames{ 0 };
+        std::atomic<std::uint64_t> m_lateTicks{ 0 };
+    };
+
+    /**
+     * @brief Рабочий поток: цикл epoll, игры и соединения одного ядра.
+     */
+    class Worker
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        Worker(const unsigned index, std::shared_ptr<const Manager> level, const GameConfig& config,
+               const std::chrono::milliseconds tick, SessionDirectory& directory):
+                m_index(index),
+                m_level(std::move(level)),
+                m_config(config),
+                m_tick(tick),
+                m_directory(directory)
+        {
+        }
+
+        ~Worker()
+        {
+            Stop();
+        }
+
+        Worker(const Worker&) = delete;
+        Worker& operator=(const Worker&) = delete;
+
+        bool Start()
+        {
+            m_epoll = epoll_create1(EPOLL_CLOEXEC);
+            m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (m_epoll < 0 || m_wake < 0) return false;
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.ptr = nullptr;
+            epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &event);
+
+            m_running = true;
+            m_thread = std::thread([this] { Run(); });
+
+            // Один цикл на ядро; в урезанном наборе ядер (контейнер) закрепление просто не удается
+            const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(m_index % cores, &cpus);
+            pthread_setaffinity_np(m_thread.native_handle(), sizeof(cpus), &cpus);
+            return true;
+        }
+
+        void Stop()
+        {
+            if (m_thread.joinable())
+            {
+                m_running = false;
+                Wake();
+                m_thread.join();
+            }
+            if (m_wake >= 0) close(m_wake);
+            if (m_epoll >= 0) close(m_epoll);
+            m_wake = -1;
+            m_epoll = -1;
+        }
+
+        /**
+         * @brief Передает соединение потоку; вызывается из потока приема.
+         */
+        void Post(Handoff handoff)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_inboxMutex);
+                m_inbox.push_back(std::move(handoff));
+            }
+            Wake();
+        }
+
+        WorkerStats& GetStats()
+        {
+            return m_stats;
+        }
+
+    private:
+        static constexpr int k_maxEvents = 256;
+        static constexpr std::size_t k_readChunk = 4096;
+        static constexpr std::size_t k_maxBacklog = 256 * 1024; ///< Медленному клиенту новые состояния не дописываются.
+
+        struct Session;
+
+        struct Connection
+        {
+            int m_fd = -1;
+            Session* m_session = nullptr;
+            std::uint8_t m_slot = net::k_spectatorSlot;
+            std::vector<std::uint8_t> m_input;
+            std::vector<std::uint8_t> m_output;
+            std::size_t m_outputOffset = 0;
+            bool m_writeArmed = false;
+            bool m_closing = false;
+            bool m_needsKeyframe = true; ///< Новый подписчик или пропустил дельту.
+        };
+
+        struct Session
+        {
+            Session(const std::uint32_t id, const std::shared_ptr<const Manager>& level, const GameConfig& config):
+                    m_id(id),
+                    m_game(level, config)
+            {
+                m_players.assign(m_game.GetPacManCount(), nullptr);
+            }
+
+            std::uint32_t m_id;
+            Game m_game;
+            std::uint32_t m_tick = 0;
+            net::StreamState m_sent; ///< Состояние прошлого тика, от которого считается дельта.
+            net::StreamState m_current;
+            std::vector<Connection*> m_subscribers;
+            std::vector<Connection*> m_players; ///< Соединение, управляющее Пакманом с этим номером.
+        };
+
+        unsigned m_index;
+        std::shared_ptr<const Manager> m_level;
+        GameConfig m_config;
+        std::chrono::milliseconds m_tick;
+        SessionDirectory& m_directory;
+
+        int m_epoll = -1;
+        int m_wake = -1;
+        std::thread m_thread;
+        std::atomic<bool> m_running{ false };
+        WorkerStats m_stats;
+
+        std::mutex m_inboxMutex;
+        std::vector<Handoff> m_inbox;
+        std::vector<Handoff> m_accepting; ///< Переставляется с m_inbox, чтобы не держать блокировку.
+
+        std::unordered_map<std::uint32_t, std::unique_ptr<Session>> m_sessions;
+        std::unordered_map<int, std::unique_ptr<Connection>> m_connections;
+        std::vector<Connection*> m_closed;
+        std::vector<std::uint8_t> m_frame; ///< Дельта сессии, кодируется один раз на тик.
+        std::vector<std::uint8_t> m_keyframe; ///< Ключевой кадр, кодируется только если он кому-то нужен.
+
+        void Wake()
+        {
+            const std::uint64_t one = 1;
+            if (write(m_wake, &one, sizeof(one)) < 0) {}
+        }
+
+        void Run()
+        {
+            std::array<epoll_event, k_maxEvents> events{};
+            auto next = Clock::now() + m_tick;
+            while (m_running.load(std::memory_order_relaxed))
+            {
+                const auto now = Clock::now();
+                const int timeout = now >= next ? 0 : static_cast<int>(
+                        std::chrono::ceil<std::chrono::milliseconds>(next - now).count());
+                const int count = epoll_wait(m_epoll, events.data(), k_maxEvents, timeout);
+
+                const auto busyStart = Clock::now();
+                for (int i = 0; i < count; ++i)
+                {
+                    auto* connection = static_cast<Connection*>(events[i].data.ptr);
+                    if (!connection)
+                    {
+                        std::uint64_t ignored = 0;
+                        if (read(m_wake, &ignored, sizeof(ignored)) < 0) {}
+                        AcceptHandoffs();
+                        continue;
+                    }
+                    if (connection->m_closing) continue;
+                    if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                    {
+                        Close(*connection);
+                        continue;
+                    }
+                    if (events[i].events & EPOLLIN) Receive(*connection);
+                    if ((events[i].events & EPOLLOUT) && !connection->m_closing) Flush(*connection);
+                }
+
+                if (busyStart >= next)
+                {
+                    TickSessions();
+                    next += m_tick;
+                    // Тики не догоняются: перегруженный поток отстает, а не копит очередь тиков
+                    if (Clock::now() >= next)
+                    {
+                        m_stats.m_lateTicks.fetch_add(1, std::memory_order_relaxed);
+                        next = Clock::now() + m_tick;
+                    }
+                }
+                ReapClosed();
+
+                m_stats.m_busyNanoseconds.fetch_add(static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - busyStart).count()),
+                                                    std::memory_order_relaxed);
+            }
+
+            for (auto& connection : m_connections)
+            {
+                close(connection.second->m_fd);
+            }
+            m_connections.clear();
+            for (const auto& session : m_sessions)
+            {
+                m_directory.Remove(session.first);
+            }
+            m_sessions.clear();
+        }
+
+        void AcceptHandoffs()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_inboxMutex);
+                m_accepting.swap(m_inbox);
+            }
+            for (Handoff& handoff : m_accepting)
+            {
+                Attach(handoff);
+            }
+            m_accepting.clear();
+        }
+
+        void Attach(Handoff& handoff)
+        {
+            if (handoff.m_create)
+            {
+                auto session = std::make_unique<Session>(handoff.m_session, m_level, m_config);
+                session->m_game.SetSeed(handoff.m_session);
+                session->m_game.SetFixedTickSeconds(std::chrono::duration<float>(m_tick).count());
+                m_sessions.emplace(handoff.m_session, std::move(session));
+            }
+
+            const auto found = m_sessions.find(handoff.m_session);
+            if (found == m_sessions.end())
+            {
+                // Игра закончилась, пока соединение передавалось
+                std::vector<std::uint8_t> error;
+                net::encode_error(error, "No session " + std::to_string(handoff.m_session));
+                if (send(handoff.m_fd, error.data(), error.size(), MSG_NOSIGNAL) < 0) {}
+                close(handoff.m_fd);
+                return;
+            }
+            Session& session = *found->second;
+
+            auto owned = std::make_unique<Connection>();
+            Connection& connection = *owned;
+            connection.m_fd = handoff.m_fd;
+            connection.m_session = &session;
+            connection.m_input = std::move(handoff.m_received);
+            m_connections.emplace(handoff.m_fd, std::move(owned));
+            m_stats.m_connections.fetch_add(1, std::memory_order_relaxed);
+
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.ptr = &connection;
+            epoll_ctl(m_epoll, EPOLL_CTL_ADD, connection.m_fd, &event);
+
+            if (handoff.m_join.m_role == net::eRole::e_Player)
+            {
+                const auto freeSlot = std::find(session.m_players.begin(), session.m_players.end(), nullptr);
+                if (freeSlot != session.m_players.end())
+                {
+                    *freeSlot = &connection;
+                    connection.m_slot = static_cast<std::uint8_t>(freeSlot - session.m_players.begin());
+                }
+            }
+            session.m_subscribers.push_back(&connection);
+
+            const GridMetrics& gridMetrics = session.m_game.GetGridMetrics();
+            net::Welcome welcome;
+            welcome.m_session = session.m_id;
+            welcome.m_slot = connection.m_slot;
+            welcome.m_columns = static_cast<std::uint16_t>(gridMetrics.GetColumns());
+            welcome.m_rows = static_cast<std::uint16_t>(gridMetrics.GetRows());
+            welcome.m_cellSize = static_cast<std::uint16_t>(gridMetrics.GetCellSize());
+            welcome.m_tickMilliseconds = static_cast<std::uint32_t>(m_tick.count());
+            m_frame.clear();
+            net::encode_welcome(m_frame, welcome);
+            Send(connection, m_frame);
+
+            HandleFrames(connection);
+        }
+
+        void Receive(Connection& connection)
+        {
+            const std::size_t size = connection.m_input.size();
+            connection.m_input.resize(size + k_readChunk);
+            const ssize_t received = recv(connection.m_fd, connection.m_input.data() + size, k_readChunk, 0);
+            if (received <= 0)
+            {
+                connection.m_input.resize(size);
+                if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) Close(connection);
+                return;
+            }
+            connection.m_input.resize(size + static_cast<std::size_t>(received));
+            HandleFrames(connection);
+        }
+
+        void HandleFrames(Connection& connection)
+        {
+            std::size_t offset = 0;
+            net::Frame frame;
+            std::size_t next = 0;
+            bool malformed = false;
+            while (net::next_frame(connection.m_input, offset, frame, next, malformed))
+            {
+                offset = next;
+                if (frame.m_type != net::eMessageType::e_Input || frame.m_size < 1) continue;
+
+                const auto direction = static_cast<eDirection>(frame.m_payload[0]);
+                if (connection.m_slot != net::k_spectatorSlot && direction <= eDirection::e_Right)
+                {
+                    connection.m_session->m_game.GetPacMan(connection.m_slot).SetDirection(direction);
+                }
+            }
+            if (malformed)
+            {
+                Close(connection);
+                return;
+            }
+            connection.m_input.erase(connection.m_input.begin(), connection.m_input.begin() + static_cast<std::ptrdiff_t>(offset));
+        }
+
+        void TickSessions()
+        {
+            for (auto& entry : m_sessions)
+            {
+                Session& session = *entry.second;
+                session.m_game.Update();
+                ++session.m_tick;
+
+                capture_state(session.m_game, session.m_tick, session.m_current);
+                m_frame.clear();
+                if (session.m_tick > 1) net::encode_delta(m_frame, session.m_sent, session.m_current);
+                m_keyframe.clear();
+
+                // Все подписчики получают одни и те же байты; ключевой кадр нужен только вошедшим и отставшим
+                for (Connection* subscriber : session.m_subscribers)
+                {
+                    if (!subscriber->m_needsKeyframe)
+                    {
+                        subscriber->m_needsKeyframe = !Send(*subscriber, m_frame);
+                        continue;
+                    }
+                    if (m_keyframe.empty()) net::encode_keyframe(m_keyframe, session.m_current);
+                    subscriber->m_needsKeyframe = !Send(*subscriber, m_keyframe);
+                }
+                std::swap(session.m_sent, session.m_current);
+            }
+            m_stats.m_sessionTicks.fetch_add(m_sessions.size(), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Ставит кадр в очередь соединения и сразу пытается отправить.
+         * @return false, если кадр пропущен: очередь медленного клиента переполнена.
+         */
+        bool Send(Connection& connection, const std::vector<std::uint8_t>& frame)
+        {
+            if (connection.m_closing) return true;
+            if (connection.m_output.size() - connection.m_outputOffset > k_maxBacklog)
+            {
+                m_stats.m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            connection.m_output.insert(connection.m_output.end(), frame.begin(), frame.end());
+            Flush(connection);
+            return true;
+        }
+
+        void Flush(Connection& connection)
+        {
+            while (connection.m_outputOffset < connection.m_output.size())
+            {
+                const ssize_t sent = send(connection.m_fd, connection.m_output.data() + connection.m_outputOffset,
+                                          connection.m_output.size() - connection.m_outputOffset, MSG_NOSIGNAL);
+                if (sent < 0)
+                {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    Close(connection);
+                    return;
+                }
+                connection.m_outputOffset += static_cast<std::size_t>(sent);
+                m_stats.m_bytesSent.fetch_add(static_cast<std::uint64_t>(sent), std::memory_order_relaxed);
+            }
+
+            const bool pending = connection.m_outputOffset < connection.m_output.size();
+            if (!pending)
+            {
+                connection.m_output.clear();
+                connection.m_outputOffset = 0;
+            }
+            if (pending != connection.m_writeArmed)
+            {
+                epoll_event event{};
+                event.events = EPOLLIN | EPOLLRDHUP | (pending ? EPOLLOUT : 0u);
+                event.data.ptr = &connection;
+                epoll_ctl(m_epoll, EPOLL_CTL_MOD, connection.m_fd, &event);
+                connection.m_writeArmed = pending;
+            }
+        }
+
+        /**
+         * @brief Соединение удаляется после обработки событий и рассылки тика (см. ReapClosed).
+         */
+        void Close(Connection& connection)
+        {
+            if (connection.m_closing) return;
+            connection.m_closing = true;
+            m_closed.push_back(&connection);
+        }
+
+        void ReapClosed()
+        {
+            for (Connection* connection : m_closed)
+            {
+                Session& session = *connection->m_session;
+                session.m_subscribers.erase(std::find(session.m_subscribers.begin(), session.m_subscribers.end(), connection));
+                if (connection->m_slot != net::k_spectatorSlot) session.m_players[connection->m_slot] = nullptr;
+
+                // Игра без соединений завершается
+                if (session.m_subscribers.empty())
+                {
+                    m_directory.Remove(session.m_id);
+                    m_sessions.erase(session.m_id);
+                    m_stats.m_sessions.fetch_sub(1, std::memory_order_relaxed);
+                }
+
+                epoll_ctl(m_epoll, EPOLL_CTL_DEL, connection->m_fd, nullptr);
+                close(connection->m_fd);
+                m_stats.m_connections.fetch_sub(1, std::memory_order_relaxed);
+                m_connections.erase(connection->m_fd);
+            }
+            m_closed.clear();
+        }
+    };
+
+    /**
+     * @class GameServer
+     * @brief Прием соединений, распределение сессий по рабочим потокам и отчет о загрузке.
+     */
+    class GameServer
+    {
+    public:
+        /**
+         * @param level Уровень, общий для всех игр сервера.
+         * @param config Количество Пакманов (мест игроков в сессии) и призраков.
+         * @param tick Длительность тика.
+         * @param workers Количество рабочих потоков; 0 - по одному на ядро.
+         */
+        GameServer(std::shared_ptr<const Manager> level, const GameConfig& config,
+                   const std::chrono::milliseconds tick, unsigned workers):
+                m_tick(tick)
+        {
+            if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned i = 0; i < workers; ++i)
+            {
+                m_workers.push_back(std::make_unique<Worker>(i, level, config, tick, m_directory));
+            }
+        }
+
+        ~GameServer()
+        {
+            for (auto& worker : m_workers)
+            {
+                worker->Stop();
+            }
+            for (const Listener& listener : m_listeners)
+            {
+                close(listener.m_fd);
+            }
+            for (auto& pending : m_pending)
+            {
+                close(pending.first);
+            }
+            if (!m_unixPath.empty()) unlink(m_unixPath.c_str());
+            if (m_epoll >= 0) close(m_epoll);
+        }
+
+        GameServer(const GameServer&) = delete;
+        GameServer& operator=(const GameServer&) = delete;
+
+        /**
+         * @brief Принимает соединения TCP на адресе address (например, 127.0.0.1 или 0.0.0.0).
+         */
+        bool ListenTcp(const std::string& address, const int port)
+        {
+            const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) return false;
+            const int reuse = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            sockaddr_in socketAddress{};
+            socketAddress.sin_family = AF_INET;
+            socketAddress.sin_port = htons(static_cast<std::uint16_t>(port));
+            if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1 ||
+                bind(fd, reinterpret_cast<const sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0 ||
+                listen(fd, SOMAXCONN) != 0)
+            {
+                std::cerr << "Cannot listen on " << address << ":" << port << std::endl;
+                close(fd);
+                return false;
+            }
+            m_listeners.push_back({ fd, true });
+            return true;
+        }
+
+        /**
+         * @brief Принимает соединения Unix-сокета path; существующий файл сокета заменяется.
+         */
+        bool ListenUnix(const std::string& path)
+        {
+            sockaddr_un socketAddress{};
+            if (path.size() >= sizeof(socketAddress.sun_path))
+            {
+                std::cerr << "The socket path " << path << " is too long" << std::endl;
+                return false;
+            }
+            const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) return false;
+
+            socketAddress.sun_family = AF_UNIX;
+            std::copy(path.begin(), path.end(), socketAddress.sun_path);
+            unlink(path.c_str());
+            if (bind(fd, reinterpret_cast<const sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0 ||
+                listen(fd, SOMAXCONN) != 0)
+            {
+                std::cerr << "Cannot listen on " << path << std::endl;
+                close(fd);
+                return false;
+            }
+            m_listeners.push_back({ fd, false });
+            m_unixPath = path;
+            return true;
+        }
+
+        /**
+         * @brief Обслуживает соединения до RequestStop.
+         * @param report Поток отчета о загрузке.
+         * @param reportInterval Период отчета.
+         * @param duration Время работы; 0 - до RequestStop.
+         */
+        bool Run(std::ostream& report, const std::chrono::seconds reportInterval,
+                 const std::chrono::seconds duration = std::chrono::seconds(0))
+        {
+            m_epoll = epoll_create1(EPOLL_CLOEXEC);
+            if (m_epoll < 0 || m_listeners.empty()) return false;
+            for (const Listener& listener : m_listeners)
+            {
+                Watch(listener.m_fd);
+            }
+            for (auto& worker : m_workers)
+            {
+                if (!worker->Start()) return false;
+            }
+
+            Snapshot last = TakeSnapshot();
+            const auto start = last.m_time;
+            auto nextReport = start + reportInterval;
+            std::array<epoll_event, 64> events{};
+            while (!m_stopping.load(std::memory_order_relaxed))
+            {
+                if (duration.count() > 0 && Worker::Clock::now() - start >= duration) break;
+
+                const int count = epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), k_pollMilliseconds);
+                for (int i = 0; i < count; ++i)
+                {
+                    const int fd = events[i].data.fd;
+                    const auto listener = std::find_if(m_listeners.begin(), m_listeners.end(),
+                                                       [fd](const Listener& l) { return l.m_fd == fd; });
+                    if (listener != m_listeners.end()) AcceptAll(*listener);
+                    else ReadJoin(fd);
+                }
+
+                if (Worker::Clock::now() >= nextReport)
+                {
+                    const Snapshot current = TakeSnapshot();
+                    Report(report, last, current);
+                    last = current;
+                    nextReport += reportInterval;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Останавливает Run; можно вызывать из обработчика сигнала.
+         */
+        void RequestStop()
+        {
+            m_stopping.store(true, std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr int k_pollMilliseconds = 100;
+        static constexpr std::size_t k_maxJoinBytes = 4096; ///< Больше без e_Join - не клиент.
+
+        struct Listener
+        {
+            int m_fd;
+            bool m_tcp;
+        };
+
+        /**
+         * @brief Суммарные счетчики рабочих потоков в момент времени.
+         */
+        struct Snapshot
+        {
+            Worker::Clock::time_point m_time;
+            std::vector<std::uint64_t> m_busyNanoseconds;
+            std::uint64_t m_sessionTicks = 0;
+            std::uint64_t m_bytesSent = 0;
+            std::uint64_t m_droppedFrames = 0;
+            std::uint64_t m_lateTicks = 0;
+        };
+
+        std::chrono::milliseconds m_tick;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        SessionDirectory m_directory;
+        std::vector<Listener> m_listeners;
+        std::string m_unixPath;
+        int m_epoll = -1;
+        std::atomic<bool> m_stopping{ false };
+        std::uint32_t m_nextSession = 1;
+        std::unordered_map<int, std::vector<std::uint8_t>> m_pending; ///< Соединения до e_Join.
+
+        void Watch(const int fd)
+        {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event);
+        }
+
+        void AcceptAll(const Listener& listener)
+        {
+            while (true)
+            {
+                const int fd = accept4(listener.m_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+                if (listener.m_tcp)
+                {
+                    // Состояние тика - маленький кадр, его нельзя задерживать алгоритмом Нейгла
+                    const int noDelay = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                }
+                m_pending[fd];
+                Watch(fd);
+            }
+        }
+
+        void Drop(const int fd, const std::string& reason)
+        {
+            if (!reason.empty())
+            {
+                std::vector<std::uint8_t> error;
+                net::encode_error(error, reason);
+                if (send(fd, error.data(), error.size(), MSG_NOSIGNAL) < 0) {}
+            }
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            m_pending.erase(fd);
+        }
+
+        void ReadJoin(const int fd)
+        {
+            auto found = m_pending.find(fd);
+            if (found == m_pending.end()) return;
+            std::vector<std::uint8_t>& received = found->second;
+
+            std::array<std::uint8_t, 512> chunk{};
+            const ssize_t size = recv(fd, chunk.data(), chunk.size(), 0);
+            if (size <= 0)
+            {
+                if (size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) Drop(fd, "");
+                return;
+            }
+            received.insert(received.end(), chunk.begin(), chunk.begin() + size);
+
+            net::Frame frame;
+            std::size_t next = 0;
+            bool malformed = false;
+            if (!net::next_frame(received, 0, frame, next, malformed))
+            {
+                if (malformed || received.size() > k_maxJoinBytes) Drop(fd, "Expected a join request");
+                return;
+            }
+
+            Handoff handoff;
+            if (!net::decode_join(frame, handoff.m_join))
+            {
+                Drop(fd, "Expected a join request");
+                return;
+            }
+
+            unsigned worker = 0;
+            if (handoff.m_join.m_session == net::k_newSession)
+            {
+                // Новая игра - в поток с наименьшим числом сессий
+                for (unsigned i = 1; i < m_workers.size(); ++i)
+                {
+                    if (m_workers[i]->GetStats().m_sessions.load(std::memory_order_relaxed) <
+                        m_workers[worker]->GetStats().m_sessions.load(std::memory_order_relaxed))
+                    {
+                        worker = i;
+                    }
+                }
+                handoff.m_session = m_nextSession++;
+                handoff.m_create = true;
+                m_directory.Add(handoff.m_session, worker);
+                m_workers[worker]->GetStats().m_sessions.fetch_add(1, std::memory_order_relaxed);
+            } else if (m_directory.Find(handoff.m_join.m_session, worker))
+            {
+                handoff.m_session = handoff.m_join.m_session;
+            } else
+            {
+                Drop(fd, "No session " + std::to_string(handoff.m_join.m_session));
+                return;
+            }
+
+            handoff.m_fd = fd;
+            handoff.m_received.assign(received.begin() + static_cast<std::ptrdiff_t>(next), received.end());
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+            m_pending.erase(found);
+            m_workers[worker]->Post(std::move(handoff));
+        }
+
+        Snapshot TakeSnapshot()
+        {
+            Snapshot snapshot;
+            snapshot.m_time = Worker::Clock::now();
+            for (auto& worker : m_workers)
+            {
+                const WorkerStats& stats = worker->GetStats();
+                snapshot.m_busyNanoseconds.push_back(stats.m_busyNanoseconds.load(std::memory_order_relaxed));
+                snapshot.m_sessionTicks += stats.m_sessionTicks.load(std::memory_order_relaxed);
+                snapshot.m_bytesSent += stats.m_bytesSent.load(std::memory_order_relaxed);
+                snapshot.m_droppedFrames += stats.m_droppedFrames.load(std::memory_order_relaxed);
+                snapshot.m_lateTicks += stats.m_lateTicks.load(std::memory_order_relaxed);
+            }
+            return snapshot;
+        }
+
+        /**
+         * @brief Печатает загрузку потоков за интервал и оценку емкости.
+         *
+         * Емкость ядра - сессий, которые поток вел бы при полной загрузке при той же стоимости сессии:
+         * sessions / busy. Оценка верна, пока стоимость тика растет линейно с числом сессий.
+         */
+        void Report(std::ostream& report, const Snapshot& from, const Snapshot& to)
+        {
+            const double wall = std::chrono::duration<double, std::nano>(to.m_time - from.m_time).count();
+            if (wall <= 0.0) return;
+
+            int sessions = 0;
+            int connections = 0;
+            double busy = 0.0;
+            std::ostringstream perWorker;
+            perWorker << std::fixed << std::setprecision(0);
+            for (std::size_t i = 0; i < m_workers.size(); ++i)
+            {
+                const WorkerStats& stats = m_workers[i]->GetStats();
+                sessions += stats.m_sessions.load(std::memory_order_relaxed);
+                connections += stats.m_connections.load(std::memory_order_relaxed);
+                const double load = static_cast<double>(to.m_busyNanoseconds[i] - from.m_busyNanoseconds[i]) / wall;
+                busy += load;
+                perWorker << ' ' << 100.0 * load << '%';
+            }
+
+            const double seconds = wall * 1e-9;
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(0)
+                 << sessions << " sessions, " << connections << " connections on " << m_workers.size()
+                 << " workers; load" << perWorker.str() << "; "
+                 << static_cast<double>(to.m_sessionTicks - from.m_sessionTicks) / seconds << " session ticks/s, "
+                 << std::setprecision(2)
+                 << static_cast<double>(to.m_bytesSent - from.m_bytesSent) / seconds / (1024.0 * 1024.0) << " MB/s sent, "
+                 << to.m_droppedFrames - from.m_droppedFrames << " frames dropped, "
+                 << to.m_lateTicks - from.m_lateTicks << " late ticks";
+            if (sessions > 0 && busy > 0.0)
+            {
+                line << std::setprecision(0) << "; capacity ~" << static_cast<double>(sessions) / busy
+                     << " sessions/core at " << m_tick.count() << " ms ticks";
+            }
+            report << line.str();
+            report << std::endl;
+        }
+    };
+#endif
+}
@@ -1,30 +1,48 @@
 #pragma once
 
+#include <array>
 #include <stack>
+#include <string>
 #include <iostream>
+#include "Canvas.h"
+#include "DangerMap.h"
 #include "Entity.h"
+#include "FlowField.h"
+#include "Metrics.h"
+#include "NavigationData.h"
+#include "OccupancyGrid.h"
+#include "PathService.h"
 #include "Pacman.h"
+#include "Profiler.h"
+#include "Tracer.h"
 #include "np.h"
 
-/**
- * @brief Перечисление типов призраков.
- */
-enum class eGhostType {
-    e_Blinky, ///< Блинки.
-    e_Pinky, ///< Пинки.
-    e_Inky, ///< Инки.
-    e_Clyde ///< Клайд.
-};
-
 /**
  * @brief Перечисление состояний призраков.
  */
-enum class eGhostState {
+enum class eGhostState : std::uint8_t {
     e_Chase, ///< Преследование.
     e_Scatter, ///< Разбегание.
     e_Frightened ///< Испуг.
 };
 
+class Ghost;
+
+/**
+ * @brief Тип призрака, построенный реестром из типа политики (см. GhostPolicy.h).
+ *
+ * Функции - экземпляры шаблонов для конкретной политики, поэтому внутри них поведение
+ * призрака известно во время компиляции.
+ */
+struct GhostPolicyInfo {
+    int m_id = 0; ///< Номер типа в реестре.
+    std::string m_name; ///< Имя типа (для файлов настроек).
+    sf::Color m_colour; ///< Цвет призрака.
+    int m_scatterCorner = 0; ///< Угол разбегания (0..3, см. GridMetrics::GetCornerPosition).
+    void (*m_chase)(Ghost &) = nullptr; ///< Выбор цели в режиме преследования.
+    void (*m_updateGroup)(Ghost *first, Ghost *last, const OccupancyGrid *ghosts) = nullptr; ///< Тик группы призраков типа.
+};
+
 
 /**
  * @brief Класс Ghost представляет собой призрака в игре Pac-Man.
@@ -33,58 +51,184 @@ class Ghost final : public Entity {
 public:
     /**
      * @brief Конструктор класса Ghost.
-     * @param type Тип призрака.
+     * @param policy Тип призрака из GhostRegistry.
+     * @param homeSlot Домашняя клетка (0..3, см. GridMetrics::GetHomePosition).
      * @param grid Двумерный массив тайлов игрового поля.
-     * @param pacMan Ссылка на объект класса PacMan.
+     * @param store Хранилище сущностей игры.
+     * @param navigation Навигационные данные уровня.
+     * @param pacMan Пакман, которого призрак преследует (см. SetChaseTarget).
      */
-    explicit Ghost(eGhostType type, std::vector<std::vector<Tile>> &grid, PacMan &pacMan) :
-            Entity(sf::Vector2i(),
-                   cnp::k_gridCellSize,
+    explicit Ghost(const GhostPolicyInfo &policy, const int homeSlot, const std::vector<std::vector<Tile>> &grid,
+                   EntityStore &store, const NavigationStore &navigation, PacMan &pacMan) :
+            Entity(store,
+                   store.GetGridMetrics().GetCornerPosition(policy.m_scatterCorner),
+                   store.GetGridMetrics().GetCellSize(),
                    eDirection::e_None,
-                   sf::Color::White),
-            m_pacMan(pacMan),
-            m_type(type),
-            m_state(eGhostState::e_Chase),
-            m_homeTimer(0.f),
-            m_updateTicks(0),
+                   policy.m_colour),
+            m_pacMan(&pacMan),
+            m_policy(&policy),
+            m_homeSlot(homeSlot & 3),
             m_grid(grid),
+            m_navigation(navigation),
             m_currentCorner(0) {
-        // Определение углов карты для патрулирования и разбегания
-        switch (m_type) {
-            case eGhostType::e_Blinky:
-                m_colour = sf::Color::Red;
-                break;
-            case eGhostType::e_Pinky:
-                m_colour = sf::Color::Magenta;
-                break;
-            case eGhostType::e_Inky:
-                m_colour = sf::Color::Cyan;
-                break;
-            case eGhostType::e_Clyde:
-                m_colour = sf::Color(255, 165, 0);
-                break;
-            default:;
+        // Данные поиска пути принадлежат призраку: уровень общий и не изменяется
+        const std::size_t cells = static_cast<std::size_t>(m_gridMetrics.GetColumns()) * m_gridMetrics.GetRows();
+        m_nodes.reserve(cells);
+        for (const auto &row: m_grid) {
+            for (const auto &tile: row) {
+                m_nodes.emplace_back();
+                m_nodes.back().m_tile = &tile;
+            }
         }
 
-        m_position = cnp::k_cornerPositions[static_cast<int>(m_type)];
+        // Путь и списки поиска не длиннее числа клеток: тик не выделяет память
+        std::vector<const Tile *> pathStorage;
+        pathStorage.reserve(cells);
+        m_path = TilePath(std::move(pathStorage));
+        m_openList.reserve(cells);
+        m_closedList.reserve(cells);
+        m_navigationSteps.reserve(cells);
     }
 
     /**
      * @brief Обновляет состояние призрака.
+     *
+     * Столкновения с Пакманом проверяет игра по сетке занятости после хода всех призраков (OnPacManContact).
+     * @param ghosts Занятость клеток призраками в начале тика: призрак не заходит в занятую клетку
+     *               (nullptr - призраки проходят друг через друга).
      */
-    void Update() {
-        if (m_state == eGhostState::e_Frightened && m_position == cnp::k_homePositions[static_cast<int>(m_type)]) {
-            m_homeTimer += m_clock.getElapsedTime().asSeconds();
-            if (m_homeTimer >= cnp::k_ghostHomeTime) {
-                m_state = eGhostState::e_Chase;
-                m_homeTimer = 0.f;
+    void Update(const OccupancyGrid *ghosts = nullptr) {
+        if (IsWaitingAtHome()) {
+            SetTimer(Timer() + m_store->GetTickSeconds());
+            if (Timer() >= cnp::k_ghostHomeTime) {
+                SetGhostState(eGhostState::e_Chase);
+                SetTimer(0.f);
             }
         } else {
-            Move();
-            CheckPacManCollisions();
+            Move(ghosts);
+        }
+    }
+
+    /**
+     * @brief Обрабатывает встречу с Пакманом в одной клетке.
+     * @param pacMan Пакман в клетке призрака.
+     */
+    void OnPacManContact(PacMan &pacMan) {
+        if (GetGhostState() != eGhostState::e_Frightened) {
+            if (pacMan.GetPacManState() == ePacManState::e_PowerUp) {
+                SetGhostState(eGhostState::e_Frightened);
+                pacMan.AddPoints(1000);
+                metrics::GameMetrics::Instance().m_ghostsEaten.Add();
+            } else {
+                pacMan.Catch(m_policy->m_id);
+                metrics::GameMetrics::Instance().m_deaths.Add();
+            }
+        }
+    }
+
+    /**
+     * @brief Задает Пакмана, которого преследует призрак (например, ближайшего в кооперативе).
+     */
+    void SetChaseTarget(PacMan &pacMan) {
+        m_pacMan = &pacMan;
+    }
+
+    /**
+     * @brief Пути к клеткам у Пакмана берутся из общих таблиц шагов вместо поиска A* (nullptr - A*).
+     */
+    void SetFlowFields(FlowFieldCache *flowFields) {
+        m_flowFields = flowFields;
+    }
+
+    /**
+     * @brief Поля опасности и притяжения игры для выбора цели (nullptr - игра их не строит).
+     */
+    void SetDangerMap(const DangerMap *dangerMap) {
+        m_dangerMap = dangerMap;
+    }
+
+    const DangerMap *GetDangerMap() const {
+        return m_dangerMap;
+    }
+
+    /**
+     * @brief Обновляет путь призрака: выбирает цель и начинает поиск или продолжает незавершенный поиск.
+     *
+     * Пока поиск не завершен, призрак продолжает идти по предыдущему пути.
+     * @param nodeBudget Сколько узлов A* можно раскрыть за этот вызов.
+     * @return Количество раскрытых узлов.
+     */
+    int Replan(const int nodeBudget) {
+        trace::Span span("Ghost replan");
+        span.SetArg("ghost", m_policy->m_id);
+
+        // Пути по навигационным таблицам строятся сразу, поиск A* только начинается (или уходит в PathService)
+        metrics::GameMetrics &gameMetrics = metrics::GameMetrics::Instance();
+        if (!m_searching && !m_awaitingPath) {
+            UpdatePathFinding();
+            gameMetrics.m_replans.Add();
+        }
+
+        int expanded = 0;
+        if (m_searching) {
+            m_gridMetrics.Dispatch([&](const auto &grid) { expanded = ContinueSearch(grid, nodeBudget); });
+            if (!m_searching) SkipTraversedSteps();
         }
+        if (expanded > 0) gameMetrics.m_nodesExpanded.Add(static_cast<std::uint64_t>(expanded));
+
+        span.SetArg("nodes expanded", expanded);
+        return expanded;
+    }
+
+    /**
+     * @brief Поиск пути начат и будет продолжен при следующем вызове Replan.
+     */
+    bool IsReplanning() const {
+        return m_searching;
+    }
+
+    /**
+     * @brief Путь закончился, а новый поиск не идет.
+     */
+    bool NeedsPath() const {
+        return m_path.empty() && !m_searching && !m_awaitingPath && !IsWaitingAtHome();
+    }
 
-        m_clock.restart();
+    /**
+     * @brief Передает поиск A* в асинхронный сервис. nullptr возвращает синхронный поиск в Replan.
+     */
+    void SetPathService(PathService *pathService) {
+        if (m_pathService && m_awaitingPath) m_pathService->Cancel(m_pathRequester);
+        m_pathService = pathService;
+        m_pathRequester = pathService ? pathService->Register() : -1;
+        m_awaitingPath = false;
+    }
+
+    /**
+     * @brief Принимает путь, найденный PathService.
+     * @param cells Индексы клеток от начала до цели; пусто, если цель недостижима (призрак остается на старом пути).
+     */
+    void AcceptPath(const std::vector<std::uint32_t> &cells) {
+        m_awaitingPath = false;
+        if (cells.empty()) return;
+
+        while (!m_path.empty()) {
+            m_path.pop();
+        }
+        const std::size_t columns = static_cast<std::size_t>(m_pathService->GetColumns());
+        for (auto cell = cells.rbegin(); cell != cells.rend(); ++cell) {
+            m_path.push(&m_grid[*cell / columns][*cell % columns]);
+        }
+        metrics::GameMetrics::Instance().m_pathLength.Observe(m_path.size());
+        SkipTraversedSteps();
+    }
+
+    /**
+     * @brief Испуганный призрак вернулся домой и ждет окончания таймера.
+     */
+    bool IsWaitingAtHome() const {
+        return GetGhostState() == eGhostState::e_Frightened &&
+               Position() == m_gridMetrics.GetHomePosition(m_homeSlot);
     }
 
     /**
@@ -93,55 +237,102 @@ public:
      */
 
     void Render(sf::RenderWindow &window) {
-        std::stack<Tile *> temp = m_path;
+        TilePath temp = m_path;
+        sf::RectangleShape &shape = m_store->GetShape();
+        const sf::Color &colour = Colour();
 
         while (!temp.empty()) {
             auto *node = temp.top();
             temp.pop();
 
-            m_shape.setFillColor({m_colour.r, m_colour.g, m_colour.b, 80});
-            m_shape.setPosition(static_cast<sf::Vector2f>(node->m_position));
-            window.draw(m_shape);
+            shape.setFillColor({colour.r, colour.g, colour.b, 80});
+            shape.setPosition(static_cast<sf::Vector2f>(node->m_position));
+            window.draw(shape);
         }
 
-        if (m_state != eGhostState::e_Frightened) m_shape.setFillColor(m_colour);
-        else {
-            const sf::Color frightenedColour = {0, 19, 142};
-            if (m_position == cnp::k_homePositions[static_cast<int>(m_type)]) {
-                // Blend from blue to the normal ghost colour
-                const float normalisedTimer = m_homeTimer / static_cast<float>(cnp::k_ghostHomeTime);
+        shape.setFillColor(GetRenderColour());
+        shape.setPosition(static_cast<sf::Vector2f>(Position()));
 
-                const sf::Uint32 lerpedColour = hnp::interpolate(frightenedColour.toInteger(), m_colour.toInteger(),
-                                                                 normalisedTimer);
+        window.draw(shape);
+    }
 
-                m_shape.setFillColor(sf::Color(lerpedColour));
-            } else m_shape.setFillColor(frightenedColour);
-        }
+    /**
+     * @brief Отрисовывает призрака и его путь в программный буфер кадра.
+     * @param canvas Буфер кадра.
+     */
+    void Render(Canvas &canvas) const {
+        TilePath temp = m_path;
+        const sf::Color &colour = Colour();
 
-        m_shape.setPosition(static_cast<sf::Vector2f>(m_position));
+        while (!temp.empty()) {
+            canvas.FillRect(temp.top()->m_position, {m_gridMetrics.GetCellSize(), m_gridMetrics.GetCellSize()},
+                            {colour.r, colour.g, colour.b, 80});
+            temp.pop();
+        }
 
-        window.draw(m_shape);
+        canvas.FillRect(Position(), {m_gridMetrics.GetCellSize(), m_gridMetrics.GetCellSize()}, GetRenderColour());
     }
 
     /**
    * @brief Сбрасывает состояние призрака.
    */
     void Reset() {
-        m_state = eGhostState::e_Chase;
-        m_position = cnp::k_cornerPositions[static_cast<int>(m_type)];
+        SetGhostState(eGhostState::e_Chase);
+        SetPosition(m_gridMetrics.GetCornerPosition(m_policy->m_scatterCorner));
 
         // Очищает путь, если он существует
         while (!m_path.empty()) {
             m_path.pop();
         }
+        m_searching = false;
+        m_yielded = false;
+        if (m_awaitingPath) m_pathService->Cancel(m_pathRequester);
+        m_awaitingPath = false;
+    }
+
+    /**
+     * @brief Путь и патрулирование призрака для снимка игры; позиция, состояние и таймер лежат в EntityStore.
+     *
+     * Незавершенный поиск A* в снимок не входит: откат тиков требует поиска без бюджета (см. RollbackGame).
+     */
+    struct Snapshot {
+        std::stack<const Tile *, std::vector<const Tile *>> m_path;
+        int m_currentCorner = 0;
+        bool m_yielded = false;
+        bool m_reserved = false; ///< Память под путь длиной в весь уровень выделена.
+    };
+
+    /**
+     * @brief Копирует состояние в снимок; путь копируется в уже выделенную память снимка.
+     */
+    void Save(Snapshot &snapshot) const {
+        if (!snapshot.m_reserved) {
+            // Как и у самого призрака, память под путь выделяется один раз на самый длинный путь
+            std::vector<const Tile *> pathStorage;
+            pathStorage.reserve(m_nodes.size());
+            snapshot.m_path = TilePath(std::move(pathStorage));
+            snapshot.m_reserved = true;
+        }
+        snapshot.m_path = m_path;
+        snapshot.m_currentCorner = m_currentCorner;
+        snapshot.m_yielded = m_yielded;
+    }
+
+    void Restore(const Snapshot &snapshot) {
+        m_path = snapshot.m_path;
+        m_currentCorner = snapshot.m_currentCorner;
+        m_yielded = snapshot.m_yielded;
+        m_searching = false;
+        if (m_awaitingPath) m_pathService->Cancel(m_pathRequester);
+        m_awaitingPath = false;
     }
 
     /**
   * @brief Возвращает текущее состояние призрака.
   * @return Текущее состояние призрака.
   */
-    const eGhostState &GetGhostState() const {
-        return m_state;
+    eGhostState GetGhostState() const {
+        return static_cast<eGhostState>(m_store->State(m_id));
     }
 
 /**
@@ -149,32 +340,227 @@ public:
  * @param state Новое состояние призрака.
  */
     void SetGhostState(eGhostState state) {
-        m_state = state;
+        m_store->SetState(m_id, static_cast<std::uint8_t>(state));
+    }
+
+    /**
+     * @brief Тип призрака.
+     */
+    const GhostPolicyInfo &GetPolicy() const {
+        return *m_policy;
+    }
+
+    // Действия, из которых политики (GhostPolicy.h) составляют преследование
+
+    /**
+     * @brief Преследуемый Пакман.
+     */
+    const PacMan &GetChaseTarget() const {
+        return *m_pacMan;
+    }
+
+    bool HasPath() const {
+        return !m_path.empty();
+    }
+
+    /**
+     * @brief Идет к клетке рядом с Пакманом по его направлению движения.
+     *
+     * Вплотную к Пакману (ближе двух клеток на той же линии) или у края поля призрак идет к самому Пакману,
+     * а если Пакман в туннеле у края - в свой угол.
+     * @param lead 1 - клетка перед Пакманом, -1 - клетка за ним.
+     */
+    void ChasePacMan(const int lead) {
+        const sf::Vector2i pacManPosition = m_pacMan->GetPosition();
+        const int column = m_gridMetrics.ToColumn(pacManPosition.x);
+        const int row = m_gridMetrics.ToRow(pacManPosition.y);
+
+        if (!hnp::is_in_range(column, 0, m_gridMetrics.GetColumns() - 1) ||
+            !hnp::is_in_range(row, 0, m_gridMetrics.GetRows() - 1)) {
+            ScatterToCorner();
+            return;
+        }
+
+        const sf::Vector2i direction = ToOffset(m_pacMan->GetDirection());
+        if (direction == sf::Vector2i()) {
+            PathFindToChaseTarget(pacManPosition);
+            return;
+        }
+
+        const sf::Vector2i offset(direction.x * lead, direction.y * lead);
+        const sf::Vector2i toPacMan = pacManPosition - Position();
+        const bool aligned = offset.x == 0 ? toPacMan.x == 0 : toPacMan.y == 0;
+        if (aligned && toPacMan.x * offset.x + toPacMan.y * offset.y < 2 * m_gridMetrics.GetCellSize()) {
+            PathFindToChaseTarget(pacManPosition);
+            return;
+        }
+
+        const int targetColumn = column + offset.x;
+        const int targetRow = row + offset.y;
+        if (hnp::is_in_range(targetColumn, 0, m_gridMetrics.GetColumns() - 1) &&
+            hnp::is_in_range(targetRow, 0, m_gridMetrics.GetRows() - 1)) {
+            const Tile &target = m_grid[targetRow][targetColumn];
+            if (target.m_type == eTileType::e_Path) PathFindToChaseTarget(target.m_position);
+        } else {
+            PathFindToChaseTarget(pacManPosition);
+        }
+    }
+
+    /**
+     * @brief Поджидает Пакмана у монет: идет к клетке рядом с ним, сильнее всего притягивающей Пакмана.
+     *
+     * Без карты притяжения (DangerMap) или без монет рядом преследует клетку перед Пакманом.
+     * @param radius Насколько клеток от Пакмана искать клетку, по каждой оси.
+     */
+    void AmbushPacMan(const int radius) {
+        const sf::Vector2i pacManPosition = m_pacMan->GetPosition();
+        const int column = m_gridMetrics.ToColumn(pacManPosition.x);
+        const int row = m_gridMetrics.ToRow(pacManPosition.y);
+
+        const Tile *best = nullptr;
+        std::uint8_t bestAttraction = 0;
+        if (m_dangerMap) {
+            const int lastRow = std::min(m_gridMetrics.GetRows() - 1, row + radius);
+            const int lastColumn = std::min(m_gridMetrics.GetColumns() - 1, column + radius);
+            for (int r = std::max(0, row - radius); r <= lastRow; ++r) {
+                for (int c = std::max(0, column - radius); c <= lastColumn; ++c) {
+                    const std::uint8_t attraction = m_dangerMap->GetLevel(eInfluence::e_Attraction, c, r);
+                    if (attraction > bestAttraction && m_grid[r][c].m_type == eTileType::e_Path) {
+                        best = &m_grid[r][c];
+                        bestAttraction = attraction;
+                    }
+                }
+            }
+        }
+        if (best) PathFindToChaseTarget(best->m_position);
+        else ChasePacMan(1);
+    }
+
+    /**
+     * @brief Обходит углы уровня по часовой стрелке, выбирая следующий угол, когда путь закончился.
+     */
+    void PatrolCorners() {
+        if (!m_path.empty()) return;
+
+        m_currentCorner = (m_currentCorner + 1) & 3;
+        PathFindToTarget(nav::k_cornerTargets + m_currentCorner, m_gridMetrics.GetCornerPosition(m_currentCorner));
+    }
+
+    /**
+     * @brief Идет в случайную проходимую клетку, выбирая новую, когда путь закончился.
+     */
+    void WanderRandomly() {
+        if (!m_path.empty()) return;
+
+        const Tile *randomTile = nullptr;
+        do {
+            const sf::Vector2i random = m_gridMetrics.GetRandomInteriorPosition(m_store->GetRandom());
+            randomTile = &m_grid[m_gridMetrics.ToRow(random.y)][m_gridMetrics.ToColumn(random.x)];
+        } while (randomTile->m_type != eTileType::e_Path);
+        AStarPathFinding(Position(), randomTile->m_position);
+    }
+
+    /**
+     * @brief Идет в угол разбегания своего типа.
+     */
+    void ScatterToCorner() {
+        PathFindToTarget(nav::k_cornerTargets + m_policy->m_scatterCorner,
+                         m_gridMetrics.GetCornerPosition(m_policy->m_scatterCorner));
+    }
+
+    /**
+ * @brief Строит путь к клетке у Пакмана: по общей таблице шагов, если она включена, иначе поиском A*.
+ *
+ * Призраки толпы гонятся за немногими клетками у Пакманов, поэтому таблица к каждой из них
+ * строится один раз и используется всеми призраками.
+ * @param endPosition Позиция цели.
+ */
+    void PathFindToChaseTarget(const sf::Vector2i endPosition) {
+        if (!m_flowFields) {
+            AStarPathFinding(Position(), endPosition);
+            return;
+        }
+
+        const std::size_t columns = static_cast<std::size_t>(m_flowFields->GetColumns());
+        const std::size_t goal = m_gridMetrics.ToRow(endPosition.y) * columns + m_gridMetrics.ToColumn(endPosition.x);
+        const std::vector<eDirection> &steps = m_flowFields->Get(static_cast<std::uint32_t>(goal));
+        FollowSteps([&](const int column, const int row) { return steps[row * columns + column]; }, endPosition);
     }
 
 private:
-    PacMan &m_pacMan; ///< Ссылка на объект PacMan.
-    eGhostType m_type; ///< Тип призрака.
-    eGhostState m_state; ///< Состояние призрака.
-    float m_homeTimer; ///< Таймер для отслеживания времени нахождения призрака дома.
-
-    // Поиск пути будет обновляться каждые 10 игровых тиков (раз в секунду)
-    int m_updateTicks;
-    std::vector<std::vector<Tile>> &m_grid; ///< Ссылка на двумерный массив тайлов игрового поля.
+    friend struct PathfindingBenchmark; ///< Микробенчмарки (bench.cpp) вызывают шаги поиска напрямую.
+
+    PacMan *m_pacMan; ///< Преследуемый Пакман.
+    const GhostPolicyInfo *m_policy; ///< Тип призрака.
+    int m_homeSlot; ///< Домашняя клетка призрака.
+
+    const std::vector<std::vector<Tile>> &m_grid; ///< Ссылка на двумерный массив тайлов игрового поля.
+    const NavigationStore &m_navigation; ///< Таблицы путей к углам и дому.
     int m_currentCorner; ///< Текущий угол карты для патрулирования.
 
-    std::stack<Tile *> m_path; ///< Стек тайлов, представляющий путь призрака.
-    std::vector<Tile *> m_openList; ///< Список открытых тайлов для поиска пути.
-    std::vector<Tile *> m_closedList; ///< Список закрытых тайлов для поиска пути.
+    /**
+     * @brief Данные поиска A* для одной клетки уровня.
+     */
+    struct PathNode {
+        const Tile *m_tile = nullptr; ///< Клетка уровня.
+        PathNode *m_cameFromNode = nullptr; ///< Предыдущий узел в пути.
+        int m_fCost = 0; ///< Значение F-стоимости.
+        int m_gCost = 0; ///< Значение G-стоимости.
+        int m_hCost = 0; ///< Значение H-стоимости.
+
+        void CalculateFCost() {
+            m_fCost = m_gCost + m_hCost;
+        }
+    };
+
+    /**
+     * @brief Стек тайлов пути на векторе: снятие шага не освобождает память, а емкость резервируется заранее.
+     */
+    using TilePath = std::stack<const Tile *, std::vector<const Tile *>>;
+
+    TilePath m_path; ///< Стек тайлов, представляющий путь призрака.
+    std::vector<PathNode> m_nodes; ///< Узлы поиска пути, индекс row * columns + column.
+    std::vector<PathNode *> m_openList; ///< Список открытых узлов для поиска пути.
+    std::vector<PathNode *> m_closedList; ///< Список закрытых узлов для поиска пути.
+    PathNode *m_searchEnd = nullptr; ///< Цель незавершенного поиска A*.
+    sf::Vector2i m_searchStart; ///< Позиция, из которой начат поиск A*.
+    bool m_searching = false; ///< Поиск A* начат и еще не завершен.
+    PathService *m_pathService = nullptr; ///< Асинхронный поиск путей (nullptr - поиск в Replan).
+    int m_pathRequester = -1; ///< Номер призрака в PathService.
+    bool m_awaitingPath = false; ///< Запрос отправлен в PathService, результат еще не выдан.
+    FlowFieldCache *m_flowFields = nullptr; ///< Общие таблицы шагов к подвижным целям.
+    const DangerMap *m_dangerMap = nullptr; ///< Поля опасности и притяжения игры.
+    bool m_yielded = false; ///< На прошлом тике призрак уступил клетку другому призраку.
+    std::vector<const Tile *> m_navigationSteps; ///< Путь по навигационной таблице (от начала к цели).
+
+    /**
+     * @brief Возвращает цвет призрака с учетом его состояния.
+     * @return Цвет для отрисовки.
+     */
+    sf::Color GetRenderColour() const {
+        if (GetGhostState() != eGhostState::e_Frightened) return Colour();
+
+        const sf::Color frightenedColour = {0, 19, 142};
+        if (Position() == m_gridMetrics.GetHomePosition(m_homeSlot)) {
+            // Blend from blue to the normal ghost colour
+            const float normalisedTimer = Timer() / static_cast<float>(cnp::k_ghostHomeTime);
+
+            const sf::Uint32 lerpedColour = hnp::interpolate(frightenedColour.toInteger(), Colour().toInteger(),
+                                                             normalisedTimer);
+
+            return sf::Color(lerpedColour);
+        }
+        return frightenedColour;
+    }
 
     /**
      * @brief Возвращает узел с наименьшей стоимостью F из списка узлов.
      * @param list Список узлов для поиска.
      * @return Узел с наименьшей стоимостью F или nullptr, если список пуст.
      */
-    static Tile *GetLowestFCostNode(std::vector<Tile *> &list) {
+    static PathNode *GetLowestFCostNode(std::vector<PathNode *> &list) {
         if (!list.empty()) {
-            Tile *lowestFCostNode = list[0];
+            PathNode *lowestFCostNode = list[0];
 
             for (auto &node: list) {
                 // перезаписываем наименьший узел, если стоимость F меньше
@@ -194,9 +580,9 @@ private:
  * @param b Второй тайл.
  * @return Расстояние между тайлами.
  */
-    static int CalculateDistanceCost(Tile *a, Tile *b) {
-        const int deltaX = abs(a->m_position.x - b->m_position.x);
-        const int deltaY = abs(a->m_position.y - b->m_position.y);
+    static int CalculateDistanceCost(const PathNode *a, const PathNode *b) {
+        const int deltaX = abs(a->m_tile->m_position.x - b->m_tile->m_position.x);
+        const int deltaY = abs(a->m_tile->m_position.y - b->m_tile->m_position.y);
 
         const int remaining = abs(deltaX - deltaY);
 
@@ -207,99 +593,131 @@ private:
  * @brief Вычисляет путь от начального узла до конечного узла.
  * @param endNode Конечный узел пути.
  */
-    void CalculatePath(Tile *endNode) {
+    void CalculatePath(PathNode *endNode) {
         // Очищаем стек
         while (!m_path.empty()) {
             m_path.pop();
         }
 
-        m_path.push(endNode);
+        m_path.push(endNode->m_tile);
 
-        Tile *currentNode = endNode;
+        PathNode *currentNode = endNode;
 
         // Проходим через родительские узлы, пока не найдем узел без родителя
         // Этот узел является начальным узлом
         while (currentNode->m_cameFromNode != nullptr) {
-            m_path.push(currentNode->m_cameFromNode);
+            m_path.push(currentNode->m_cameFromNode->m_tile);
             currentNode = currentNode->m_cameFromNode;
         }
+        metrics::GameMetrics::Instance().m_pathLength.Observe(m_path.size());
 
         if (m_path.empty()) {
-            std::cout << "No path to X: " << endNode->m_position.x
-                      << " Y : " << endNode->m_position.y << " found" << std::endl;
+            std::cerr << "No path to X: " << endNode->m_tile->m_position.x
+                      << " Y : " << endNode->m_tile->m_position.y << " found" << std::endl;
         }
     }
 
 
+    template<typename Grid>
+    PathNode *GetNode(const Grid &grid, const int column, const int row) {
+        return &m_nodes[static_cast<std::size_t>(row) * grid.GetColumns() + column];
+    }
+
+    /**
+     * @brief Соседние узлы (не больше четырех) без выделения памяти.
+     */
+    struct NeighbourNodes {
+        std::array<PathNode *, 4> m_nodes{};
+        std::size_t m_count = 0;
+
+        void push_back(PathNode *node) { m_nodes[m_count++] = node; }
+        PathNode *const *begin() const { return m_nodes.data(); }
+        PathNode *const *end() const { return m_nodes.data() + m_count; }
+    };
+
     /**
   * @brief Возвращает список соседних узлов для текущего узла.
+  * @param grid Размеры сетки (DefaultGrid или GridMetrics).
   * @param currentNode Текущий узел.
   * @return Список соседних узлов.
   */
-    std::vector<Tile *> GetNeighbourNodes(Tile *currentNode) const {
-        std::vector<Tile *> neighbours;
+    template<typename Grid>
+    NeighbourNodes GetNeighbourNodes(const Grid &grid, const PathNode *currentNode) {
+        NeighbourNodes neighbours;
 
-        const int xIndex = hnp::world_coord_to_array_index(currentNode->m_position.x);
-        const int yIndex = hnp::world_coord_to_array_index(currentNode->m_position.y);
+        const int xIndex = grid.ToColumn(currentNode->m_tile->m_position.x);
+        const int yIndex = grid.ToRow(currentNode->m_tile->m_position.y);
 
         // Находим 4 соседние позиции, если они допустимы
         if (xIndex - 1 >= 0) {
             // Слева
-            neighbours.push_back(&m_grid[yIndex][xIndex - 1]);
+            neighbours.push_back(GetNode(grid, xIndex - 1, yIndex));
         }
 
-        if (xIndex + 1 < static_cast<int>(m_grid[0].size())) {
+        if (xIndex + 1 < grid.GetColumns()) {
             // Справа
-            neighbours.push_back(&m_grid[yIndex][xIndex + 1]);
+            neighbours.push_back(GetNode(grid, xIndex + 1, yIndex));
         }
 
         // Сверху
         if (yIndex - 1 >= 0) {
-            neighbours.push_back(&m_grid[yIndex - 1][xIndex]);
+            neighbours.push_back(GetNode(grid, xIndex, yIndex - 1));
         }
 
         // Снизу
-        if (yIndex + 1 < static_cast<int>(m_grid.size())) {
-            neighbours.push_back(&m_grid[yIndex + 1][xIndex]);
+        if (yIndex + 1 < grid.GetRows()) {
+            neighbours.push_back(GetNode(grid, xIndex, yIndex + 1));
         }
 
         return neighbours;
     }
 
     /**
- * @brief Выполняет поиск пути между начальной и конечной позициями с помощью алгоритма A*.
+ * @brief Начинает поиск пути между начальной и конечной позициями с помощью алгоритма A*.
+ *
+ * Узлы раскрываются в Replan в пределах бюджета, а с PathService поиск идет в рабочем потоке;
+ * пока поиск не закончен, призрак идет по старому пути.
  * @param startPosition Начальная позиция.
  * @param endPosition Конечная позиция.
  */
     void AStarPathFinding(sf::Vector2i startPosition, sf::Vector2i endPosition) {
-        // Вычисляем индексы массива для начальной и конечной позиций
-        const sf::Vector2i startNodeIndices(
-                startPosition.x / cnp::k_gridCellSize,
-                startPosition.y / cnp::k_gridCellSize
-        );
+        if (m_pathService) {
+            m_searchStart = startPosition;
+            m_awaitingPath = true;
+            m_pathService->Submit(m_pathRequester,
+                                  {m_gridMetrics.ToColumn(startPosition.x), m_gridMetrics.ToRow(startPosition.y)},
+                                  {m_gridMetrics.ToColumn(endPosition.x), m_gridMetrics.ToRow(endPosition.y)});
+            return;
+        }
+        m_gridMetrics.Dispatch([&](const auto &grid) { BeginSearch(grid, startPosition, endPosition); });
+    }
 
-        const sf::Vector2i endNodeIndices(
-                endPosition.x / cnp::k_gridCellSize,
-                endPosition.y / cnp::k_gridCellSize
-        );
+    /**
+ * @brief Подготавливает поиск A* для конкретного типа сетки (DefaultGrid или GridMetrics).
+ * @param grid Размеры сетки.
+ * @param startPosition Начальная позиция.
+ * @param endPosition Конечная позиция.
+ */
+    template<typename Grid>
+    void BeginSearch(const Grid &grid, sf::Vector2i startPosition, sf::Vector2i endPosition) {
+        // Вычисляем индексы массива для начальной и конечной позиций
+        const sf::Vector2i startNodeIndices(grid.ToColumn(startPosition.x), grid.ToRow(startPosition.y));
+        const sf::Vector2i endNodeIndices(grid.ToColumn(endPosition.x), grid.ToRow(endPosition.y));
 
-        Tile *startNode = &m_grid[startNodeIndices.y][startNodeIndices.x];
-        Tile *endNode = &m_grid[endNodeIndices.y][endNodeIndices.x];
+        PathNode *startNode = GetNode(grid, startNodeIndices.x, startNodeIndices.y);
+        PathNode *endNode = GetNode(grid, endNodeIndices.x, endNodeIndices.y);
 
         m_openList.clear();
         m_closedList.clear();
 
         // Проходим через сетку, устанавливаем стоимость g в бесконечность и вычисляем стоимость f
-        for (auto &tile: m_grid) {
-            for (auto &pathNode: tile) {
-                // получаем ссылку на объект
-                // устанавливаем стоимость g в бесконечность
-                pathNode.m_gCost = INT_MAX;
-
-                // вычисляем стоимость f
-                pathNode.CalculateFCost();
-                pathNode.m_cameFromNode = nullptr;
-            }
+        for (auto &pathNode: m_nodes) {
+            // устанавливаем стоимость g в бесконечность
+            pathNode.m_gCost = INT_MAX;
+
+            // вычисляем стоимость f
+            pathNode.CalculateFCost();
+            pathNode.m_cameFromNode = nullptr;
         }
 
         // Вычисляем стоимости для начального узла
@@ -307,29 +725,47 @@ private:
         startNode->m_hCost = CalculateDistanceCost(startNode, endNode);
         startNode->CalculateFCost();
         m_openList.push_back(startNode);
-        int loops = 0;
+
+        m_searchStart = startPosition;
+        m_searchEnd = endNode;
+        m_searching = true;
+    }
+
+    /**
+ * @brief Продолжает начатый поиск A*.
+ * @param grid Размеры сетки.
+ * @param nodeBudget Сколько узлов можно раскрыть.
+ * @return Количество раскрытых узлов.
+ */
+    template<typename Grid>
+    int ContinueSearch(const Grid &grid, const int nodeBudget) {
+        PACMAN_PROFILE_SCOPE("Ghost::AStarPathFinding");
+        int expanded = 0;
+
         // Проходим через все узлы и находим путь
-        while (!m_openList.empty()) {
-            ++loops;
+        while (!m_openList.empty() && expanded < nodeBudget) {
+            ++expanded;
             // Текущий узел является узлом в открытом списке с наименьшей стоимостью F
-            Tile *currentNode = GetLowestFCostNode(m_openList);
+            PathNode *currentNode = GetLowestFCostNode(m_openList);
 
             m_openList.erase(std::remove(m_openList.begin(), m_openList.end(), currentNode), m_openList.end());
             m_closedList.push_back(currentNode);
 
-            // Если текущий узел является конечным
-            if (currentNode == endNode) {
-                CalculatePath(endNode);
+            // Если текущий узел является конечным, путь найден
+            if (currentNode == m_searchEnd) {
+                CalculatePath(m_searchEnd);
+                m_searching = false;
+                return expanded;
             }
 
-            for (auto &neighbour: GetNeighbourNodes(currentNode)) {
+            for (PathNode *neighbour: GetNeighbourNodes(grid, currentNode)) {
                 // Убедитесь, что текущий соседний узел не находится в закрытом списке
                 if (hnp::is_in_vector(m_closedList, neighbour)) {
                     continue;
                 }
 
                 // Если сосед блокирует путь
-                if (neighbour->m_type == eTileType::e_Wall) {
+                if (neighbour->m_tile->m_type == eTileType::e_Wall) {
                     // добавляем в закрытый список
                     m_closedList.push_back(neighbour);
                     // продолжаем с начала цикла For
@@ -341,7 +777,7 @@ private:
                 neighbour->m_gCost = currentNode->m_gCost + CalculateDistanceCost(currentNode, neighbour);
 
                 // Вычисляем новую стоимость H для узла
-                neighbour->m_hCost = CalculateDistanceCost(neighbour, endNode);
+                neighbour->m_hCost = CalculateDistanceCost(neighbour, m_searchEnd);
                 // neighbour.CalculateFCost();
                 neighbour->m_fCost = neighbour->m_gCost + neighbour->m_hCost;
 
@@ -356,245 +792,131 @@ private:
                 m_openList.push_back(neighbour);
             }
         }
+
+        // Открытый список пуст: цель недостижима, призрак остается на старом пути
+        if (m_openList.empty()) m_searching = false;
+        return expanded;
     }
 
     /**
- * @brief Обновляет поиск пути в зависимости от текущего состояния призрака.
+ * @brief Отбрасывает начало пути, пройденное по старому пути, пока шел поиск.
+ *
+ * Если призрак сошел с нового пути, путь очищается и будет построен заново.
  */
-    void UpdatePathFinding() {
-        switch (m_state) {
-            case eGhostState::e_Chase:
-                ChaseModePathFinding();
-                break;
-            case eGhostState::e_Scatter:
-                AStarPathFinding(m_position, cnp::k_cornerPositions[static_cast<int>(m_type)]);
-                break;
-            case eGhostState::e_Frightened:
-                AStarPathFinding(m_position, cnp::k_homePositions[static_cast<int>(m_type)]);
-                break;
-            default:;
+    void SkipTraversedSteps() {
+        if (Position() == m_searchStart) return;
+
+        while (!m_path.empty() && m_path.top()->m_position != Position()) {
+            m_path.pop();
         }
     }
 
     /**
- * @brief Выполняет поиск пути в режиме преследования.
+ * @brief Строит путь к фиксированной цели по навигационной таблице, а пока таблицы не готовы - поиском A*.
+ * @param target Индекс цели (nav::k_cornerTargets или nav::k_homeTargets плюс номер).
+ * @param endPosition Позиция цели.
  */
-    void ChaseModePathFinding() {
-        const int pacManIndexX = hnp::world_coord_to_array_index(m_pacMan.GetPosition().x);
-        const int pacManIndexY = hnp::world_coord_to_array_index(m_pacMan.GetPosition().y);
-
-        switch (m_type) {
-            case eGhostType::e_Blinky:
-                // Если индексы X и Y допустимы в массиве
-                if (hnp::is_in_range(pacManIndexX, 0, static_cast<int>(m_grid[0].size() - 1)) &&
-                    hnp::is_in_range(pacManIndexY, 0, static_cast<int>(m_grid.size() - 1))) {
-                    // Преследуем Pacman и пытаемся оказаться за ним
-                    switch (m_pacMan.GetDirection()) {
-                        case eDirection::e_None:
-                            AStarPathFinding(m_position, m_pacMan.GetPosition());
-                            break;
-                        case eDirection::e_Up:
-                            MoveTowardsBlockBelow(pacManIndexX, pacManIndexY);
-                            break;
-                        case eDirection::e_Down:
-                            MoveTowardsBlockAbove(pacManIndexX, pacManIndexY);
-                            break;
-                        case eDirection::e_Left:
-                            MoveTowardsBlockRight(pacManIndexX, pacManIndexY);
-                            break;
-                        case eDirection::e_Right:
-                            MoveTowardsBlockLeft(pacManIndexX, pacManIndexY);
-                            break;
-                    }
-                } else {
-                    // если не допустимы, перемещаемся в свой угол
-                    AStarPathFinding(
-                            m_position,
-                            cnp::k_cornerPositions[static_cast<int>(m_type)]
-                    );
-                }
-                break;
-            case eGhostType::e_Pinky:
-                if (hnp::is_in_range(pacManIndexX, 0, static_cast<int>(m_grid[0].size() - 1)) &&
-                    hnp::is_in_range(pacManIndexY, 0, static_cast<int>(m_grid.size() - 1))) {
-                    // Преследуем Pacman и пытаемся оказаться перед ним
-                    switch (m_pacMan.GetDirection()) {
-                        case eDirection::e_None:
-                            AStarPathFinding(m_position, m_pacMan.GetPosition());
-                            break;
-                        case eDirection::e_Up:
-                            MoveTowardsBlockAbove(pacManIndexX, pacManIndexY);
-                            break;
-                        case eDirection::e_Down:
-                            MoveTowardsBlockBelow(pacManIndexX, pacManIndexY);
-                            break;
-                        case eDirection::e_Left:
-                            MoveTowardsBlockLeft(pacManIndexX, pacManIndexY);
-                            break;
-                        case eDirection::e_Right:
-                            MoveTowardsBlockRight(pacManIndexX, pacManIndexY);
-                            break;
-                    }
-                } else {
-                    // если не допустимы, перемещаемся в свой угол
-                    AStarPathFinding(
-                            m_position,
-                            cnp::k_cornerPositions[static_cast<int>(m_type)]
-                    );
-                }
-                break;
-
-            case eGhostType::e_Inky:
-                // Патрулируем область
-                if (m_path.empty()) {
-                    m_currentCorner++;
-
-                    if (m_currentCorner > 3) m_currentCorner = 0;
-
-                    AStarPathFinding(m_position, cnp::k_cornerPositions[m_currentCorner]);
-                }
-
-                break;
-            case eGhostType::e_Clyde:
-                // Перемещаемся в случайную позицию
-                if (m_path.empty()) {
-                    Tile &randomTile = m_grid[1][1];
-                    do {
-                        const sf::Vector2i random(hnp::rand_range(25, 750), hnp::rand_range(50, 725));
-                        randomTile = m_grid[hnp::world_coord_to_array_index(random.y)][hnp::world_coord_to_array_index(
-                                random.y)];
-                    } while (randomTile.m_type != eTileType::e_Path);
-                    AStarPathFinding(m_position, randomTile.m_position);
-                }
-
-                break;
-            default:;
+    void PathFindToTarget(const int target, const sf::Vector2i endPosition) {
+        const NavigationData *navigation = m_navigation.Get();
+        if (!navigation || !FollowNavigation(*navigation, target, endPosition)) {
+            AStarPathFinding(Position(), endPosition);
         }
     }
 
-
-    /**
-  * @brief Выполняет поиск пути к блоку над PacMan.
-  * @param pacManIndexX Индекс X позиции PacMan в массиве.
-  * @param pacManIndexY Индекс Y позиции PacMan в массиве.
-  */
-    void MoveTowardsBlockAbove(int pacManIndexX, int pacManIndexY) {
-        if (m_position.y - m_pacMan.GetPosition().y < 2 * cnp::k_gridCellSize &&
-            m_position.x == m_pacMan.GetPosition().x) {
-            AStarPathFinding(m_position, m_pacMan.GetPosition());
-        } else {
-            // Проверяем, является ли блок над PacMan допустимым
-            if (hnp::is_in_range(pacManIndexY - 1, 0, static_cast<int>(m_grid.size() - 1))) {
-                if (m_grid[pacManIndexY - 1][pacManIndexX].m_type == eTileType::e_Path) {
-                    AStarPathFinding(m_position, m_grid[pacManIndexY - 1][pacManIndexX].m_position);
-                }
-            } else {
-                AStarPathFinding(m_position, m_pacMan.GetPosition());
-            }
+    static sf::Vector2i ToOffset(const eDirection direction) {
+        switch (direction) {
+            case eDirection::e_Up:
+                return {0, -1};
+            case eDirection::e_Down:
+                return {0, 1};
+            case eDirection::e_Left:
+                return {-1, 0};
+            case eDirection::e_Right:
+                return {1, 0};
+            default:
+                return {};
         }
     }
 
     /**
-   * @brief Выполняет поиск пути к блоку под PacMan.
-   * @param pacManIndexX Индекс X позиции PacMan в массиве.
-   * @param pacManIndexY Индекс Y позиции PacMan в массиве.
-   */
-    void MoveTowardsBlockBelow(int pacManIndexX, int pacManIndexY) {
-        // Если расстояние короткое, двигаемся к нему
-        if (m_pacMan.GetPosition().y - m_position.y < 2 * cnp::k_gridCellSize &&
-            m_position.x == m_pacMan.GetPosition().x) {
-            AStarPathFinding(m_position, m_pacMan.GetPosition());
-        } else {
-            // Проверяем, является ли блок под PacMan допустимым
-            if (hnp::is_in_range(pacManIndexY + 1, 0, static_cast<int>(m_grid.size() - 1))) {
-                if (m_grid[pacManIndexY + 1][pacManIndexX].m_type == eTileType::e_Path) {
-                    AStarPathFinding(m_position, m_grid[pacManIndexY + 1][pacManIndexX].m_position);
-                }
-            } else {
-                AStarPathFinding(m_position, m_pacMan.GetPosition());
-            }
-        }
+ * @brief Проходит по таблице следующего шага от позиции призрака до цели.
+ * @return false, если цель недостижима из текущей клетки.
+ */
+    bool FollowNavigation(const NavigationData &navigation, const int target, const sf::Vector2i endPosition) {
+        return FollowSteps([&](const int column, const int row) { return navigation.GetNextStep(target, column, row); },
+                           endPosition);
     }
 
-/**
- * @brief Выполняет поиск пути к блоку слева от PacMan.
- * @param pacManIndexX Индекс X позиции PacMan в массиве.
- * @param pacManIndexY Индекс Y позиции PacMan в массиве.
+    /**
+ * @brief Строит путь от позиции призрака до цели по таблице следующего шага.
+ * @param nextStep Функция nextStep(column, row), возвращающая направление шага (e_None - конец пути).
+ * @return false, если цель недостижима из текущей клетки.
  */
-    void MoveTowardsBlockLeft(int pacManIndexX, int pacManIndexY) {
-        // Если расстояние короткое, двигаемся к нему
-        if (m_position.x - m_pacMan.GetPosition().x < 2 * cnp::k_gridCellSize &&
-            m_position.y == m_pacMan.GetPosition().y) {
-            AStarPathFinding(m_position, m_pacMan.GetPosition());
-        } else {
-            // Проверяем, является ли блок слева от PacMan допустимым
-            if (hnp::is_in_range(pacManIndexX - 1, 0, static_cast<int>(m_grid.size() - 1))) {
-                if (m_grid[pacManIndexY][pacManIndexX - 1].m_type == eTileType::e_Path) {
-                    AStarPathFinding(m_position, m_grid[pacManIndexY][pacManIndexX - 1].m_position);
-                }
-            } else {
-                AStarPathFinding(m_position, m_pacMan.GetPosition());
-            }
+    template<typename NextStep>
+    bool FollowSteps(NextStep &&nextStep, const sf::Vector2i endPosition) {
+        int column = m_gridMetrics.ToColumn(Position().x);
+        int row = m_gridMetrics.ToRow(Position().y);
+        const int endColumn = m_gridMetrics.ToColumn(endPosition.x);
+        const int endRow = m_gridMetrics.ToRow(endPosition.y);
+
+        m_navigationSteps.clear();
+        m_navigationSteps.push_back(&m_grid[row][column]);
+        for (;;) {
+            const eDirection step = nextStep(column, row);
+            if (step == eDirection::e_None) break;
+
+            column += step == eDirection::e_Left ? -1 : step == eDirection::e_Right ? 1 : 0;
+            row += step == eDirection::e_Up ? -1 : step == eDirection::e_Down ? 1 : 0;
+            m_navigationSteps.push_back(&m_grid[row][column]);
         }
-    }
+        if (column != endColumn || row != endRow) return false;
 
+        // Вершина стека - клетка призрака, как и у пути из CalculatePath
+        while (!m_path.empty()) {
+            m_path.pop();
+        }
+        for (auto step = m_navigationSteps.rbegin(); step != m_navigationSteps.rend(); ++step) {
+            m_path.push(*step);
+        }
+        metrics::GameMetrics::Instance().m_pathLength.Observe(m_path.size());
+        return true;
+    }
 
     /**
- * @brief Выполняет поиск пути к блоку справа от PacMan.
- * @param pacManIndexX Индекс X позиции PacMan в массиве.
- * @param pacManIndexY Индекс Y позиции PacMan в массиве.
+ * @brief Обновляет поиск пути в зависимости от текущего состояния призрака.
  */
-    void MoveTowardsBlockRight(int pacManIndexX, int pacManIndexY) {
-        // Если расстояние короткое, двигаемся к нему
-        if (m_pacMan.GetPosition().x - m_position.x < 2 * cnp::k_gridCellSize &&
-            m_position.y == m_pacMan.GetPosition().y) {
-            AStarPathFinding(m_position, m_pacMan.GetPosition());
-        } else {
-            // Проверяем, является ли блок справа от PacMan допустимым
-            if (hnp::is_in_range(pacManIndexX + 1, 0, static_cast<int>(m_grid.size() - 1))) {
-                if (m_grid[pacManIndexY][pacManIndexX + 1].m_type == eTileType::e_Path) {
-                    AStarPathFinding(m_position, m_grid[pacManIndexY][pacManIndexX + 1].m_position);
-                }
-            } else {
-                AStarPathFinding(m_position, m_pacMan.GetPosition());
-            }
+    void UpdatePathFinding() {
+        switch (GetGhostState()) {
+            case eGhostState::e_Chase:
+                m_policy->m_chase(*this);
+                break;
+            case eGhostState::e_Scatter:
+                ScatterToCorner();
+                break;
+            case eGhostState::e_Frightened:
+                PathFindToTarget(nav::k_homeTargets + m_homeSlot, m_gridMetrics.GetHomePosition(m_homeSlot));
+                break;
+            default:;
         }
     }
 
-
     /**
  * @brief Выполняет перемещение призрака.
  */
-    void Move() {
-        m_updateTicks++;
-        if (m_updateTicks == 10 || m_path.empty()) {
-            UpdatePathFinding();
-            m_updateTicks = 0;
-        }
-
+    void Move(const OccupancyGrid *ghosts) {
         // Извлекаем первый элемент пути
         if (!m_path.empty()) {
-            Tile *destination = m_path.top();
+            const Tile *destination = m_path.top();
+            if (ghosts && !m_yielded && destination->m_position != Position() &&
+                ghosts->IsOccupied(ghosts->GetCell(destination->m_position))) {
+                // Уступаем клетку, но не дольше тика, иначе встречные призраки запрут коридор
+                m_yielded = true;
+                return;
+            }
+            m_yielded = false;
             m_path.pop();
 
-            m_position = destination->m_position;
-        }
-    }
-
-/**
- * @brief Проверяет столкновения с PacMan.
- */
-    void CheckPacManCollisions() {
-        if (m_state != eGhostState::e_Frightened) {
-            if (m_position == m_pacMan.GetPosition()) {
-                if (m_pacMan.GetPacManState() == ePacManState::e_PowerUp) {
-                    m_state = eGhostState::e_Frightened;
-                    m_pacMan.AddPoints(1000);
-                } else {
-                    m_pacMan.SetIsAlive(false);
-                }
-                std::cout << "I hit PacMan!" << std::endl;
-            }
+            SetPosition(destination->m_position);
         }
     }
 
@@ -0,0 +1,201 @@
+/**
+ * @file GhostPolicy.h
+ * @brief Типы призраков как политики времени компиляции и реестр типов.
+ *
+ * Политика - это структура со статическими членами:
+ *
+ *     struct SuePolicy {
+ *         static constexpr const char *k_name = "Sue";                     // имя в файле настроек
+ *         static constexpr const char *k_profileName = "Ghost::Update[Sue]"; // область профилировщика
+ *         static constexpr sf::Uint32 k_colour = 0x8000FFFF;                // RGBA
+ *         static constexpr int k_scatterCorner = 2;                         // 0..3
+ *         static void Chase(Ghost &ghost) { ghost.ChasePacMan(2); }         // цель в режиме преследования
+ *     };
+ *     PACMAN_REGISTER_GHOST_POLICY(SuePolicy);
+ *
+ * Реестр строит для политики GhostPolicyInfo с экземплярами шаблонов chase_with и update_group,
+ * поэтому поведение внутри них разрешается при компиляции. Игра хранит призраков одного типа подряд
+ * и обновляет каждую группу одним вызовом без выбора поведения для каждого призрака.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Ghost.h"
+#include "OccupancyGrid.h"
+#include "Profiler.h"
+
+/// Преследует клетку за Пакманом.
+struct BlinkyPolicy {
+    static constexpr const char *k_name = "Blinky";
+    static constexpr const char *k_profileName = "Ghost::Update[Blinky]";
+    static constexpr sf::Uint32 k_colour = 0xFF0000FF;
+    static constexpr int k_scatterCorner = 0;
+
+    static void Chase(Ghost &ghost) {
+        ghost.ChasePacMan(-1);
+    }
+};
+
+/// Преследует клетку перед Пакманом.
+struct PinkyPolicy {
+    static constexpr const char *k_name = "Pinky";
+    static constexpr const char *k_profileName = "Ghost::Update[Pinky]";
+    static constexpr sf::Uint32 k_colour = 0xFF00FFFF;
+    static constexpr int k_scatterCorner = 1;
+
+    static void Chase(Ghost &ghost) {
+        ghost.ChasePacMan(1);
+    }
+};
+
+/// Патрулирует углы уровня.
+struct InkyPolicy {
+    static constexpr const char *k_name = "Inky";
+    static constexpr const char *k_profileName = "Ghost::Update[Inky]";
+    static constexpr sf::Uint32 k_colour = 0x00FFFFFF;
+    static constexpr int k_scatterCorner = 2;
+
+    static void Chase(Ghost &ghost) {
+        ghost.PatrolCorners();
+    }
+};
+
+/// Бродит по случайным клеткам.
+struct ClydePolicy {
+    static constexpr const char *k_name = "Clyde";
+    static constexpr const char *k_profileName = "Ghost::Update[Clyde]";
+    static constexpr sf::Uint32 k_colour = 0xFFA500FF;
+    static constexpr int k_scatterCorner = 3;
+
+    static void Chase(Ghost &ghost) {
+        ghost.WanderRandomly();
+    }
+};
+
+/// Поджидает Пакмана у монет рядом с ним (нужна карта притяжения: danger_map = 1 в GameConfig).
+struct FunkyPolicy {
+    static constexpr const char *k_name = "Funky";
+    static constexpr const char *k_profileName = "Ghost::Update[Funky]";
+    static constexpr sf::Uint32 k_colour = 0x00FF00FF;
+    static constexpr int k_scatterCorner = 1;
+
+    static void Chase(Ghost &ghost) {
+        ghost.AmbushPacMan(4);
+    }
+};
+
+namespace ghost {
+    template<typename Policy>
+    void chase_with(Ghost &ghost) {
+        Policy::Chase(ghost);
+    }
+
+    /**
+     * @brief Тик группы призраков одного типа.
+     */
+    template<typename Policy>
+    void update_group(Ghost *first, Ghost *last, const OccupancyGrid *ghosts) {
+        PACMAN_PROFILE_SCOPE(Policy::k_profileName);
+        for (; first != last; ++first) first->Update(ghosts);
+    }
+}
+
+/**
+ * @class GhostRegistry
+ * @brief Реестр типов призраков. Классические четыре типа и Funky зарегистрированы заранее.
+ */
+class GhostRegistry {
+public:
+    static GhostRegistry &Instance() {
+        static GhostRegistry registry;
+        return registry;
+    }
+
+    /**
+     * @brief Регистрирует политику; повторная регистрация имени возвращает уже зарегистрированный тип.
+     */
+    template<typename Policy>
+    const GhostPolicyInfo &Register() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (const GhostPolicyInfo *existing = FindLocked(Policy::k_name)) return *existing;
+
+        auto info = std::make_unique<GhostPolicyInfo>();
+        info->m_id = static_cast<int>(m_policies.size());
+        info->m_name = Policy::k_name;
+        info->m_colour = sf::Color(Policy::k_colour);
+        info->m_scatterCorner = Policy::k_scatterCorner & 3;
+        info->m_chase = &ghost::chase_with<Policy>;
+        info->m_updateGroup = &ghost::update_group<Policy>;
+        m_policies.push_back(std::move(info));
+        return *m_policies.back();
+    }
+
+    /**
+     * @brief Тип по имени или nullptr.
+     */
+    const GhostPolicyInfo *Find(const std::string &name) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return FindLocked(name);
+    }
+
+    /**
+     * @brief Тип по номеру (GhostPolicyInfo::m_id) или nullptr.
+     */
+    const GhostPolicyInfo *Get(const int id) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return id >= 0 && static_cast<std::size_t>(id) < m_policies.size() ? m_policies[id].get() : nullptr;
+    }
+
+    /**
+     * @brief Типы призраков по именам. Пустой список - классические четыре типа по порядку.
+     *
+     * Неизвестные имена пропускаются с сообщением.
+     */
+    std::vector<const GhostPolicyInfo *> GetRoster(const std::vector<std::string> &names) const {
+        std::vector<const GhostPolicyInfo *> roster;
+        for (const auto &name: names) {
+            if (const GhostPolicyInfo *policy = Find(name)) roster.push_back(policy);
+            else std::cerr << "Unknown ghost type: " << name << std::endl;
+        }
+        if (roster.empty()) {
+            for (const char *name: {BlinkyPolicy::k_name, PinkyPolicy::k_name, InkyPolicy::k_name, ClydePolicy::k_name}) {
+                roster.push_back(Find(name));
+            }
+        }
+        return roster;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<GhostPolicyInfo>> m_policies;
+
+    GhostRegistry() {
+        Register<BlinkyPolicy>();
+        Register<PinkyPolicy>();
+        Register<InkyPolicy>();
+        Register<ClydePolicy>();
+        Register<FunkyPolicy>();
+    }
+
+    const GhostPolicyInfo *FindLocked(const std::string &name) const {
+        for (const auto &policy: m_policies) {
+            if (policy->m_name == name) return policy.get();
+        }
+        return nullptr;
+    }
+};
+
+#define PACMAN_GHOST_POLICY_CONCAT_IMPL(a, b) a##b
+#define PACMAN_GHOST_POLICY_CONCAT(a, b) PACMAN_GHOST_POLICY_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Регистрирует политику при статической инициализации (в .cpp или заголовке пользователя).
+ */
+#define PACMAN_REGISTER_GHOST_POLICY(Policy) \
+    static const GhostPolicyInfo &PACMAN_GHOST_POLICY_CONCAT(ghostPolicy_, __LINE__) = \
+            GhostRegistry::Instance().Register<Policy>()
@@ -4,6 +4,7 @@
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Graphics/Text.hpp>
 #include <SFML/System/Vector2.hpp>
+#include "Canvas.h"
 
 class Info
 {
@@ -25,6 +26,14 @@ public:
         }
     }
 
+    void Render(Canvas& canvas) const{
+        if (m_visible)
+        {
+            canvas.DrawText(m_text.getString().toAnsiString(), m_text.getCharacterSize(), m_text.getPosition(),
+                            m_text.getFillColor());
+        }
+    }
+
     void SetString(const std::string& string){
         if (m_text.getString() != string) m_text.setString(string);
     }
@@ -0,0 +1,356 @@
+/**
+ * @file LevelLoader.h
+ * @brief Загрузка уровней из CSV и из скомпилированного бинарного формата.
+ *
+ * CSV-файл отображается в память и разбирается вручную без промежуточных строк,
+ * размеры уровня определяются по содержимому файла.
+ * Бинарный формат (.pml) состоит из заголовка LevelFileHeader и упакованных типов клеток
+ * (по одному байту на клетку, построчно) и читается одним системным вызовом.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "Tile.h"
+
+/**
+ * @struct LevelGrid
+ * @brief Типы клеток уровня в плоском массиве (построчно) и его размеры.
+ */
+struct LevelGrid {
+    int m_columns = 0; /**< Количество столбцов. */
+    int m_rows = 0; /**< Количество строк. */
+    std::vector<eTileType> m_cells; /**< Типы клеток, индекс row * m_columns + column. */
+
+    eTileType At(const int column, const int row) const {
+        return m_cells[static_cast<std::size_t>(row) * m_columns + column];
+    }
+};
+
+/**
+ * @struct LevelFileHeader
+ * @brief Заголовок бинарного файла уровня (little-endian).
+ */
+struct LevelFileHeader {
+    static constexpr std::uint16_t k_version = 1;
+
+    char m_magic[4] = {'P', 'M', 'L', 'V'}; /**< Сигнатура файла. */
+    std::uint16_t m_version = k_version; /**< Версия формата. */
+    std::uint16_t m_cellBytes = sizeof(eTileType); /**< Размер клетки в байтах. */
+    std::uint32_t m_columns = 0; /**< Количество столбцов. */
+    std::uint32_t m_rows = 0; /**< Количество строк. */
+};
+static_assert(sizeof(LevelFileHeader) == 16, "LevelFileHeader must stay packed");
+
+/**
+ * @class MappedFile
+ * @brief Файл, отображенный в память только для чтения.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+#if defined(_WIN32)
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return;
+        m_fallback.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_data = m_fallback.data();
+        m_size = m_fallback.size();
+        m_open = true;
+#else
+        const int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) return;
+
+        struct stat status{};
+        if (fstat(descriptor, &status) == 0) {
+            m_size = static_cast<std::size_t>(status.st_size);
+            m_open = true;
+            if (m_size > 0) {
+                void *mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapping == MAP_FAILED) {
+                    m_open = false;
+                    m_size = 0;
+                } else {
+                    m_data = static_cast<const char *>(mapping);
+                }
+            }
+        }
+        close(descriptor);
+#endif
+    }
+
+    ~MappedFile() {
+#if !defined(_WIN32)
+        if (m_data) munmap(const_cast<char *>(m_data), m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool IsOpen() const {
+        return m_open;
+    }
+
+    const char *Data() const {
+        return m_data;
+    }
+
+    std::size_t Size() const {
+        return m_size;
+    }
+
+private:
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_open = false;
+#if defined(_WIN32)
+    std::vector<char> m_fallback;
+#endif
+};
+
+namespace lvl {
+    /**
+     * @brief Проверяет, что значение является допустимым типом клетки.
+     */
+    constexpr bool is_valid_tile_value(const int value) {
+        return value >= static_cast<int>(eTileType::e_Path) && value <= static_cast<int>(eTileType::e_WrapAroundPath);
+    }
+
+    /**
+     * @brief Разбирает CSV-уровень из памяти. Количество столбцов определяется по первой строке.
+     * @param begin Начало текста.
+     * @param end Конец текста.
+     * @param grid Результат.
+     * @param error Описание ошибки, если разбор не удался.
+     * @return true при успехе.
+     */
+    inline bool parse_level_csv(const char *begin, const char *end, LevelGrid &grid, std::string &error) {
+        grid.m_columns = 0;
+        grid.m_rows = 0;
+        grid.m_cells.clear();
+        // В файле на каждую клетку приходится минимум два символа ("0,")
+        grid.m_cells.reserve(static_cast<std::size_t>(end - begin) / 2);
+
+        int column = 0;
+        const char *cursor = begin;
+        while (cursor < end) {
+            const char character = *cursor;
+
+            if (character == '\r' || character == '\n') {
+                if (column > 0) {
+                    if (grid.m_rows == 0) grid.m_columns = column;
+                    else if (column != grid.m_columns) {
+                        error = "row " + std::to_string(grid.m_rows + 1) + " has " + std::to_string(column) +
+                                " columns, expected " + std::to_string(grid.m_columns);
+                        return false;
+                    }
+                    ++grid.m_rows;
+                    column = 0;
+                }
+                ++cursor;
+                continue;
+            }
+
+            if (character == ',' || character == ' ' || character == '\t') {
+                ++cursor;
+                continue;
+            }
+
+            const bool negative = character == '-';
+            if (negative) ++cursor;
+            if (cursor == end || *cursor < '0' || *cursor > '9') {
+                error = "unexpected character in row " + std::to_string(grid.m_rows + 1);
+                return false;
+            }
+
+            int value = 0;
+            while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+                value = value * 10 + (*cursor - '0');
+                ++cursor;
+            }
+            if (negative) value = -value;
+
+            if (!is_valid_tile_value(value)) {
+                error = "unknown tile type " + std::to_string(value) + " in row " + std::to_string(grid.m_rows + 1);
+                return false;
+            }
+
+            grid.m_cells.push_back(static_cast<eTileType>(value));
+            ++column;
+        }
+
+        // Последняя строка без перевода строки
+        if (column > 0) {
+            if (grid.m_rows == 0) grid.m_columns = column;
+            else if (column != grid.m_columns) {
+                error = "last row has " + std::to_string(column) + " columns, expected " +
+                        std::to_string(grid.m_columns);
+                return false;
+            }
+            ++grid.m_rows;
+        }
+
+        if (grid.m_rows == 0) {
+            error = "level is empty";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Загружает CSV-уровень, отображая файл в память.
+     */
+    inline bool load_level_csv(const std::string &filename, LevelGrid &grid, std::string &error) {
+        const MappedFile file(filename);
+        if (!file.IsOpen()) {
+            error = "couldn't open " + filename;
+            return false;
+        }
+        return parse_level_csv(file.Data(), file.Data() + file.Size(), grid, error);
+    }
+
+    /**
+     * @brief Загружает бинарный уровень: заголовок и клетки читаются одним вызовом readv.
+     */
+    inline bool load_level_binary(const std::string &filename, LevelGrid &grid, std::string &error) {
+        LevelFileHeader header;
+        std::size_t cellCount = 0;
+
+#if defined(_WIN32)
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            error = "couldn't open " + filename;
+            return false;
+        }
+        const auto size = static_cast<std::size_t>(file.tellg());
+        if (size < sizeof(header)) {
+            error = filename + " is too small";
+            return false;
+        }
+        cellCount = size - sizeof(header);
+        grid.m_cells.resize(cellCount);
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        file.read(reinterpret_cast<char *>(grid.m_cells.data()), static_cast<std::streamsize>(cellCount));
+        if (!file) {
+            error = "couldn't read " + filename;
+            return false;
+        }
+#else
+        const int descriptor = open(filename.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            error = "couldn't open " + filename;
+            return false;
+        }
+
+        struct stat status{};
+        if (fstat(descriptor, &status) != 0 || static_cast<std::size_t>(status.st_size) < sizeof(header)) {
+            close(descriptor);
+            error = filename + " is too small";
+            return false;
+        }
+        cellCount = static_cast<std::size_t>(status.st_size) - sizeof(header);
+        grid.m_cells.resize(cellCount);
+
+        iovec parts[2] = {
+                {&header, sizeof(header)},
+                {grid.m_cells.data(), cellCount}
+        };
+        const ssize_t bytesRead = readv(descriptor, parts, 2);
+        close(descriptor);
+        if (bytesRead != status.st_size) {
+            error = "couldn't read " + filename;
+            return false;
+        }
+#endif
+
+        if (std::memcmp(header.m_magic, LevelFileHeader().m_magic, sizeof(header.m_magic)) != 0 ||
+            header.m_version != LevelFileHeader::k_version || header.m_cellBytes != sizeof(eTileType)) {
+            error = filename + " is not a compiled level of version " + std::to_string(LevelFileHeader::k_version);
+            return false;
+        }
+        if (static_cast<std::size_t>(header.m_columns) * header.m_rows != cellCount || cellCount == 0) {
+            error = filename + " has a size that doesn't match its header";
+            return false;
+        }
+
+        for (const auto cell : grid.m_cells) {
+            if (!is_valid_tile_value(static_cast<int>(cell))) {
+                error = filename + " contains an unknown tile type";
+                return false;
+            }
+        }
+
+        grid.m_columns = static_cast<int>(header.m_columns);
+        grid.m_rows = static_cast<int>(header.m_rows);
+        return true;
+    }
+
+    /**
+     * @brief Сохраняет уровень в бинарном формате.
+     */
+    inline bool save_level_binary(const std::string &filename, const LevelGrid &grid) {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        LevelFileHeader header;
+        header.m_columns = static_cast<std::uint32_t>(grid.m_columns);
+        header.m_rows = static_cast<std::uint32_t>(grid.m_rows);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(grid.m_cells.data()),
+                   static_cast<std::streamsize>(grid.m_cells.size()));
+        return static_cast<bool>(file);
+    }
+
+    /**
+     * @brief Сохраняет уровень в CSV-формате.
+     */
+    inline bool save_level_csv(const std::string &filename, const LevelGrid &grid) {
+        std::ofstream file(filename, std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        std::string line;
+        for (int r = 0; r < grid.m_rows; ++r) {
+            line.clear();
+            for (int c = 0; c < grid.m_columns; ++c) {
+                if (c > 0) line += ',';
+                line += std::to_string(static_cast<int>(grid.At(c, r)));
+            }
+            line += '\n';
+            file << line;
+        }
+        return static_cast<bool>(file);
+    }
+
+    /**
+     * @brief Признак скомпилированного уровня по расширению файла.
+     */
+    inline bool is_binary_level(const std::string &filename) {
+        static const std::string k_extension = ".pml";
+        return filename.size() >= k_extension.size() &&
+               filename.compare(filename.size() - k_extension.size(), k_extension.size(), k_extension) == 0;
+    }
+
+    /**
+     * @brief Загружает уровень в любом из поддерживаемых форматов.
+     */
+    inline bool load_level(const std::string &filename, LevelGrid &grid, std::string &error) {
+        return is_binary_level(filename) ? load_level_binary(filename, grid, error)
+                                         : load_level_csv(filename, grid, error);
+    }
+}
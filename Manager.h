@@ -1,13 +1,15 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
 
+#include "Canvas.h"
 #include "Entity.h"
+#include "LevelLoader.h"
+#include "NavigationData.h"
 #include "Tile.h"
 #include "np.h"
 
@@ -16,78 +18,75 @@ class Manager
 public:
     Manager() = default;
 
+    /**
+     * @brief Загружает уровень из CSV или скомпилированного (.pml) файла.
+     *
+     * Размеры уровня определяются по содержимому файла. Навигационные данные берутся
+     * из файла-спутника <filename>.nav, а если его нет или он устарел, строятся в фоне и сохраняются.
+     */
     bool LoadLevel(const std::string& filename){
-        // Clear the level data if it exists
-        m_levelData.clear();
-        m_pickupLocations.clear();
-
-        std::ifstream file(filename);
-        if (!file.is_open())
+        LevelGrid grid;
+        std::string error;
+        if (!lvl::load_level(filename, grid, error))
         {
-            std::cout << "Couldn't Open the File: " + filename + "\nCheck the location and try again" << std::endl;
+            std::cerr << "Couldn't load the level: " + filename + " (" + error + ")\nCheck the location and try again"
+                      << std::endl;
             return false;
         }
 
-        while (!file.eof())
-        {
-            for (int r = 0; r < cnp::k_gridSize; ++r)
-            {
-                std::vector<Tile> row;
+        BuildLevel(grid);
+        m_navigation->Open(grid, nav::sidecar_path(filename));
+        return true;
+    }
 
-                std::string line;
-                std::getline(file, line);
-                if (!file.good())
-                {
-                    break;
-                }
+    /**
+     * @brief Загружает уровень, уже находящийся в памяти (например, из lvl::generate_maze).
+     *
+     * Навигационные данные строятся в фоне и не сохраняются.
+     */
+    bool LoadLevel(const LevelGrid& grid){
+        BuildLevel(grid);
+        m_navigation->Open(grid, "");
+        return true;
+    }
 
-                std::stringstream iss(line);
-                for (int c = 0; c < cnp::k_gridSize; ++c)
-                {
-                    std::string val;
-                    std::getline(iss, val, ',');
-                    if (!iss.good())
-                    {
-                        break;
-                    }
-
-                    const auto tileIntFromCSV = atoi(val.c_str());
-
-                    const sf::Vector2i tilePosition{
-                            c * cnp::k_gridCellSize,
-                            r * cnp::k_gridCellSize
-                    };
-
-                    const auto tileType = static_cast<eTileType>(tileIntFromCSV);
-
-                    switch (tileType)
-                    {
-                        case eTileType::e_Wall:
-                            row.emplace_back(tileType, tilePosition, true);
-                            break;
-                        case eTileType::e_Coin:
-                        case eTileType::e_PowerUp:
-                            m_pickupLocations.emplace_back(tilePosition, tileType);
-                            row.emplace_back(eTileType::e_Path, tilePosition, false);
-                            break;
-                        case eTileType::e_WrapAroundPath:
-                        case eTileType::e_Path:
-                            row.emplace_back(tileType, tilePosition, false);
-                            break;
-                    }
-                }
-                m_levelData.emplace_back(row);
+    /**
+     * @brief Загружает уровень, разобранный во время компиляции (lvl::tEmbeddedLevel из EmbeddedLevel.h).
+     *
+     * Файлы не читаются, текст не разбирается, навигационные данные берутся из образа в памяти программы.
+     */
+    template<typename EmbeddedLevel>
+    bool LoadEmbeddedLevel(const EmbeddedLevel& level){
+        m_levelData.clear();
+        m_pickupLocations.clear();
+
+        m_gridMetrics = GridMetrics(EmbeddedLevel::k_columns, EmbeddedLevel::k_rows);
+        m_levelData.reserve(EmbeddedLevel::k_rows);
+        for (int r = 0; r < EmbeddedLevel::k_rows; ++r)
+        {
+            std::vector<Tile> row;
+            row.reserve(EmbeddedLevel::k_columns);
+            for (int c = 0; c < EmbeddedLevel::k_columns; ++c)
+            {
+                const eTileType tileType = level.GetTile(c, r);
+                row.emplace_back(tileType, m_gridMetrics.CellToWorld(c, r), tileType == eTileType::e_Wall);
             }
+            m_levelData.emplace_back(std::move(row));
         }
-        file.close();
 
-        return true;
+        m_pickupLocations.reserve(level.m_pickups.size());
+        for (const auto& pickup : level.m_pickups)
+        {
+            m_pickupLocations.emplace_back(m_gridMetrics.CellToWorld(pickup.m_cell), pickup.m_type);
+        }
+        return m_navigation->Attach(level.m_navigation.Data(), level.m_navigation.k_size,
+                                    level.m_navigation.m_header.m_levelHash);
     }
 
-    void Render(sf::RenderWindow& window){
+    void Render(sf::RenderWindow& window) const {
         sf::RectangleShape rec({
-                                       static_cast<float>(cnp::k_gridCellSize),
-                                       static_cast<float>(cnp::k_gridCellSize)
+                                       static_cast<float>(m_gridMetrics.GetCellSize()),
+                                       static_cast<float>(m_gridMetrics.GetCellSize())
                                }
         );
 
@@ -95,35 +94,103 @@ public:
         {
             for (const auto& currentTile : row)
             {
-                switch (currentTile.m_type)
-                {
-                    case eTileType::e_Path:
-                    case eTileType::e_WrapAroundPath:
-                        rec.setFillColor({ 128, 128, 128 });
-                        break;
-                    case eTileType::e_Wall:
-                        rec.setFillColor({ 0, 0, 64 });
-                        break;
-                    default:
-                        std::cout << "Unknown tile type" << std::endl;
-                        break;
-                }
-
+                rec.setFillColor(GetTileColour(currentTile));
                 rec.setPosition(static_cast<sf::Vector2f>(currentTile.m_position));
                 window.draw(rec);
             }
         }
     }
 
+    void Render(Canvas& canvas) const {
+        for (const auto& row : m_levelData)
+        {
+            for (const auto& currentTile : row)
+            {
+                canvas.FillRect(currentTile.m_position, { m_gridMetrics.GetCellSize(), m_gridMetrics.GetCellSize() },
+                                GetTileColour(currentTile));
+            }
+        }
+    }
+
 
     [[nodiscard]] const  std::vector<std::pair<sf::Vector2i, eTileType>>& GetPickUpLocations() const {
         return m_pickupLocations;
     }
-    std::vector<std::vector<Tile>>& GetLevelData() {
+    const std::vector<std::vector<Tile>>& GetLevelData() const {
         return m_levelData;
     }
 
+    /**
+     * @brief Размеры загруженного уровня.
+     */
+    const GridMetrics& GetGridMetrics() const {
+        return m_gridMetrics;
+    }
+
+    /**
+     * @brief Навигационные данные уровня (могут быть еще не готовы, см. NavigationStore::Get).
+     */
+    const NavigationStore& GetNavigation() const {
+        return *m_navigation;
+    }
+
 private:
+    GridMetrics m_gridMetrics;
     std::vector<std::vector<Tile>> m_levelData;
     std::vector<std::pair<sf::Vector2i, eTileType>> m_pickupLocations;
+    // Shared so that entities keep a stable reference when the manager is moved
+    std::shared_ptr<NavigationStore> m_navigation = std::make_shared<NavigationStore>();
+
+    void BuildLevel(const LevelGrid& grid){
+        // Clear the level data if it exists
+        m_levelData.clear();
+        m_pickupLocations.clear();
+
+        m_gridMetrics = GridMetrics(grid.m_columns, grid.m_rows);
+        m_levelData.reserve(grid.m_rows);
+
+        for (int r = 0; r < grid.m_rows; ++r)
+        {
+            std::vector<Tile> row;
+            row.reserve(grid.m_columns);
+
+            for (int c = 0; c < grid.m_columns; ++c)
+            {
+                const sf::Vector2i tilePosition = m_gridMetrics.CellToWorld(c, r);
+
+                const auto tileType = grid.At(c, r);
+
+                switch (tileType)
+                {
+                    case eTileType::e_Wall:
+                        row.emplace_back(tileType, tilePosition, true);
+                        break;
+                    case eTileType::e_Coin:
+                    case eTileType::e_PowerUp:
+                        m_pickupLocations.emplace_back(tilePosition, tileType);
+                        row.emplace_back(eTileType::e_Path, tilePosition, false);
+                        break;
+                    case eTileType::e_WrapAroundPath:
+                    case eTileType::e_Path:
+                        row.emplace_back(tileType, tilePosition, false);
+                        break;
+                }
+            }
+            m_levelData.emplace_back(std::move(row));
+        }
+    }
+
+    static sf::Color GetTileColour(const Tile& tile){
+        switch (tile.m_type)
+        {
+            case eTileType::e_Path:
+            case eTileType::e_WrapAroundPath:
+                return { 128, 128, 128 };
+            case eTileType::e_Wall:
+                return { 0, 0, 64 };
+            default:
+                std::cerr << "Unknown tile type" << std::endl;
+                return sf::Color::Black;
+        }
+    }
 };
\ No newline at end of file
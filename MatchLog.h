@@ -0,0 +1,613 @@
+/**
+ * @file MatchLog.h
+ * @brief Журнал результатов партий: бинарный, только на дозапись, с фоновой записью блоками.
+ *
+ * Потоки симуляции кладут результаты в ограниченную очередь без блокировок (MatchLogWriter::Push) и не ждут
+ * диска. Фоновый поток собирает результаты в блоки, пишет каждый блок одной последовательной записью и
+ * сбрасывает файл на диск (fsync) не после каждого блока, а по объему или по времени.
+ *
+ * Формат (little-endian): MatchLogHeader, затем блоки. Блок - MatchBlockHeader и m_count записей MatchResult.
+ * Заголовок блока хранит сводку записей (победы, боты, сумму и границы счета), поэтому статистика всего
+ * журнала читается по одним заголовкам, а поиск по боту пропускает блоки без его партий. Недописанный
+ * после сбоя хвост отрезается при следующем открытии журнала на запись.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PACMAN_MATCHLOG_POSIX
+#include <unistd.h>
+#endif
+
+#include "Metrics.h"
+
+/**
+ * @enum eMatchOutcome
+ * @brief Исход партии для команды Пакманов.
+ */
+enum class eMatchOutcome : std::uint8_t
+{
+    e_Win, ///< Все монеты собраны.
+    e_Loss, ///< У Пакманов не осталось жизней.
+    e_Unfinished ///< Партия остановлена по лимиту тиков.
+};
+
+inline const char* to_string(const eMatchOutcome outcome)
+{
+    switch (outcome)
+    {
+        case eMatchOutcome::e_Win:
+            return "win";
+        case eMatchOutcome::e_Loss:
+            return "loss";
+        case eMatchOutcome::e_Unfinished:
+            return "unfinished";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @struct MatchResult
+ * @brief Результат одного Пакмана в одной партии.
+ */
+struct MatchResult
+{
+    std::uint64_t m_seed = 0; /**< Зерно партии. */
+    std::int32_t m_score = 0; /**< Счет (PacMan::GetPoints). */
+    std::uint32_t m_ticks = 0; /**< Длина партии в тиках. */
+    std::int16_t m_lives = 0; /**< Оставшиеся жизни. */
+    std::uint8_t m_bot = 0; /**< Стратегия бота (eBotType). */
+    eMatchOutcome m_outcome = eMatchOutcome::e_Unfinished;
+    std::int8_t m_caughtBy = -1; /**< Тип призрака, поймавшего Пакмана последним (GhostPolicyInfo::m_id), -1 - не пойман. */
+    std::uint8_t m_pacMan = 0; /**< Номер Пакмана в кооперативе. */
+    std::uint8_t m_reserved[2] = {};
+};
+static_assert(sizeof(MatchResult) == 24, "MatchResult must stay packed");
+
+/**
+ * @struct MatchLogHeader
+ * @brief Заголовок файла журнала.
+ */
+struct MatchLogHeader
+{
+    static constexpr std::uint16_t k_version = 1;
+
+    char m_magic[4] = { 'P', 'M', 'R', 'L' }; /**< Сигнатура файла. */
+    std::uint16_t m_version = k_version; /**< Версия формата. */
+    std::uint16_t m_recordBytes = sizeof(MatchResult); /**< Размер записи. */
+    std::uint32_t m_reserved[2] = {};
+};
+static_assert(sizeof(MatchLogHeader) == 16, "MatchLogHeader must stay packed");
+
+/**
+ * @struct MatchBlockHeader
+ * @brief Заголовок блока: количество записей, их сводка и контрольная сумма.
+ */
+struct MatchBlockHeader
+{
+    char m_magic[4] = { 'P', 'M', 'R', 'B' }; /**< Сигнатура блока. */
+    std::uint32_t m_count = 0; /**< Записей в блоке. */
+    std::uint32_t m_wins = 0; /**< Записей с исходом e_Win. */
+    std::uint32_t m_losses = 0; /**< Записей с исходом e_Loss. */
+    std::uint32_t m_botMask = 0; /**< Бит 1 << m_bot для каждого бота в блоке. */
+    std::uint32_t m_reserved = 0;
+    std::int64_t m_scoreSum = 0; /**< Сумма счета. */
+    std::int32_t m_scoreMin = 0; /**< Наименьший счет. */
+    std::int32_t m_scoreMax = 0; /**< Наибольший счет. */
+    std::uint64_t m_tickSum = 0; /**< Сумма длин партий. */
+    std::uint64_t m_firstRecord = 0; /**< Номер первой записи блока в журнале. */
+    std::uint64_t m_checksum = 0; /**< FNV-1a записей блока. */
+};
+static_assert(sizeof(MatchBlockHeader) == 64, "MatchBlockHeader must stay packed");
+
+namespace matchlog
+{
+    constexpr std::uint32_t k_maxBlockRecords = 1u << 20; ///< Больше записей в блоке не бывает (проверка при чтении).
+
+    /**
+     * @brief Хеш FNV-1a записей блока.
+     */
+    inline std::uint64_t checksum(const MatchResult* records, const std::size_t count)
+    {
+        std::uint64_t hash = 0xCBF29CE484222325ull;
+        const auto* bytes = reinterpret_cast<const unsigned char*>(records);
+        for (std::size_t i = 0; i < count * sizeof(MatchResult); ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Заголовок блока со сводкой записей.
+     */
+    inline MatchBlockHeader make_block_header(const MatchResult* records, const std::size_t count,
+                                              const std::uint64_t firstRecord)
+    {
+        MatchBlockHeader header;
+        header.m_count = static_cast<std::uint32_t>(count);
+        header.m_firstRecord = firstRecord;
+        header.m_scoreMin = std::numeric_limits<std::int32_t>::max();
+        header.m_scoreMax = std::numeric_limits<std::int32_t>::min();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const MatchResult& record = records[i];
+            header.m_wins += record.m_outcome == eMatchOutcome::e_Win;
+            header.m_losses += record.m_outcome == eMatchOutcome::e_Loss;
+            header.m_botMask |= 1u << (record.m_bot & 31);
+            header.m_scoreSum += record.m_score;
+            header.m_scoreMin = std::min(header.m_scoreMin, record.m_score);
+            header.m_scoreMax = std::max(header.m_scoreMax, record.m_score);
+            header.m_tickSum += record.m_ticks;
+        }
+        header.m_checksum = checksum(records, count);
+        return header;
+    }
+
+    /**
+     * @class BoundedQueue
+     * @brief Ограниченная очередь для многих писателей и читателей без блокировок (кольцо с номерами ячеек).
+     *
+     * Ячейка хранит номер позиции, для которой она свободна или заполнена: писатель и читатель занимают
+     * позицию одним compare-exchange и не ждут друг друга, пока очередь не пуста и не полна.
+     */
+    template<typename T>
+    class BoundedQueue
+    {
+    public:
+        /**
+         * @param capacity Емкость; округляется вверх до степени двойки.
+         */
+        explicit BoundedQueue(const std::size_t capacity)
+        {
+            std::size_t size = 2;
+            while (size < capacity) size *= 2;
+            m_mask = size - 1;
+            m_cells = std::make_unique<Cell[]>(size);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        /**
+         * @return false, если очередь полна.
+         */
+        bool TryPush(const T& value)
+        {
+            std::size_t position = m_tail.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = m_cells[position & m_mask];
+                const std::size_t sequence = cell.m_sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+                if (difference == 0)
+                {
+                    if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.m_value = value;
+                        cell.m_sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0)
+                {
+                    return false;
+                } else
+                {
+                    position = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @return false, если очередь пуста.
+         */
+        bool TryPop(T& value)
+        {
+            std::size_t position = m_head.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = m_cells[position & m_mask];
+                const std::size_t sequence = cell.m_sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+                if (difference == 0)
+                {
+                    if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        value = cell.m_value;
+                        cell.m_sequence.store(position + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0)
+                {
+                    return false;
+                } else
+                {
+                    position = m_head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::size_t GetCapacity() const
+        {
+            return m_mask + 1;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<std::size_t> m_sequence{ 0 };
+            T m_value{};
+        };
+
+        std::unique_ptr<Cell[]> m_cells;
+        std::size_t m_mask = 0;
+        // Позиции писателей и читателя на разных строках кэша
+        alignas(64) std::atomic<std::size_t> m_tail{ 0 };
+        alignas(64) std::atomic<std::size_t> m_head{ 0 };
+    };
+
+    /**
+     * @brief Настройки фоновой записи.
+     */
+    struct WriterOptions
+    {
+        std::size_t m_queueCapacity = 1u << 16; /**< Результатов в очереди; полная очередь задерживает Push. */
+        std::uint32_t m_blockRecords = 4096; /**< Записей в полном блоке. */
+        std::chrono::milliseconds m_flushInterval{ 250 }; /**< Неполный блок пишется не позже этого. */
+        std::size_t m_syncBytes = 8u << 20; /**< fsync после стольких записанных байт... */
+        std::chrono::milliseconds m_syncInterval{ 1000 }; /**< ...или не позже этого после записи. */
+    };
+
+    /**
+     * @brief Счетчики записи журнала.
+     */
+    struct WriterStats
+    {
+        std::uint64_t m_results = 0; /**< Записано результатов. */
+        std::uint64_t m_blocks = 0; /**< Записано блоков. */
+        std::uint64_t m_bytes = 0; /**< Записано байт. */
+        std::uint64_t m_syncs = 0; /**< Вызовов fsync. */
+        std::uint64_t m_stalls = 0; /**< Push, ждавших места в полной очереди. */
+    };
+
+    /**
+     * @class MatchLogWriter
+     * @brief Дописывает результаты в журнал из фонового потока.
+     */
+    class MatchLogWriter
+    {
+    public:
+        explicit MatchLogWriter(const WriterOptions& options = {}):
+                m_options(options),
+                m_queue(options.m_queueCapacity)
+        {
+            m_options.m_blockRecords = std::clamp<std::uint32_t>(m_options.m_blockRecords, 1, k_maxBlockRecords);
+        }
+
+        ~MatchLogWriter()
+        {
+            Close();
+        }
+
+        MatchLogWriter(const MatchLogWriter&) = delete;
+        MatchLogWriter& operator=(const MatchLogWriter&) = delete;
+
+        /**
+         * @brief Открывает журнал на дозапись (создает новый) и запускает фоновую запись.
+         *
+         * Недописанный последний блок (запись прервана сбоем) отрезается.
+         * @return false, если файл не журнал или не открывается; error описывает причину.
+         */
+        bool Open(const std::string& path, std::string& error)
+        {
+            Close();
+            std::uint64_t end = 0;
+            if (!Recover(path, end, m_nextRecord, error)) return false;
+
+            m_file = std::fopen(path.c_str(), end == 0 ? "wb" : "ab");
+            if (!m_file)
+            {
+                error = "cannot open " + path + " for writing";
+                return false;
+            }
+            // Блок уходит в файл одним системным вызовом, без копии в буфер stdio
+            std::setvbuf(m_file, nullptr, _IONBF, 0);
+            if (end == 0)
+            {
+                const MatchLogHeader header;
+                if (std::fwrite(&header, sizeof(header), 1, m_file) != 1)
+                {
+                    error = "cannot write " + path;
+                    std::fclose(m_file);
+                    m_file = nullptr;
+                    return false;
+                }
+            }
+
+            m_path = path;
+            m_failed = false;
+            m_stopping.store(false, std::memory_order_relaxed);
+            m_thread = std::thread([this] { Run(); });
+            return true;
+        }
+
+        bool IsOpen() const
+        {
+            return m_file != nullptr;
+        }
+
+        /**
+         * @brief Ставит результат в очередь записи; ждет, только если очередь полна. Потокобезопасно.
+         */
+        void Push(const MatchResult& result)
+        {
+            if (m_queue.TryPush(result)) return;
+            m_stalls.fetch_add(1, std::memory_order_relaxed);
+            while (!m_queue.TryPush(result))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        /**
+         * @brief Дописывает все результаты из очереди, сбрасывает файл на диск и останавливает запись.
+         *
+         * Вызывается после того, как все писатели закончили Push.
+         * @return false, если запись в файл не удалась.
+         */
+        bool Close()
+        {
+            if (!m_file) return true;
+            m_stopping.store(true, std::memory_order_release);
+            m_thread.join();
+            std::fclose(m_file);
+            m_file = nullptr;
+            return !m_failed;
+        }
+
+        WriterStats GetStats() const
+        {
+            WriterStats stats;
+            stats.m_results = m_results.load(std::memory_order_relaxed);
+            stats.m_blocks = m_blocks.load(std::memory_order_relaxed);
+            stats.m_bytes = m_bytes.load(std::memory_order_relaxed);
+            stats.m_syncs = m_syncs.load(std::memory_order_relaxed);
+            stats.m_stalls = m_stalls.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+    private:
+        static constexpr std::chrono::milliseconds k_idleSleep{ 2 }; ///< Пауза фонового потока при пустой очереди.
+
+        WriterOptions m_options;
+        BoundedQueue<MatchResult> m_queue;
+        std::string m_path;
+        std::FILE* m_file = nullptr;
+        std::uint64_t m_nextRecord = 0;
+        bool m_failed = false;
+        std::thread m_thread;
+        std::atomic<bool> m_stopping{ false };
+        std::atomic<std::uint64_t> m_results{ 0 };
+        std::atomic<std::uint64_t> m_blocks{ 0 };
+        std::atomic<std::uint64_t> m_bytes{ 0 };
+        std::atomic<std::uint64_t> m_syncs{ 0 };
+        std::atomic<std::uint64_t> m_stalls{ 0 };
+
+        /**
+         * @brief Находит конец последнего целого блока и отрезает то, что за ним.
+         * @param end Конец журнала; 0 - файла нет или он пуст.
+         * @param records Записей в целых блоках.
+         */
+        static bool Recover(const std::string& path, std::uint64_t& end, std::uint64_t& records, std::string& error)
+        {
+            end = 0;
+            records = 0;
+            std::error_code code;
+            const std::uintmax_t size = std::filesystem::file_size(path, code);
+            if (code || size == 0) return true;
+
+            std::ifstream file(path, std::ios::binary);
+            MatchLogHeader header;
+            if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+                std::memcmp(header.m_magic, MatchLogHeader().m_magic, sizeof(header.m_magic)) != 0 ||
+                header.m_version != MatchLogHeader::k_version || header.m_recordBytes != sizeof(MatchResult))
+            {
+                error = path + " is not a match log of version " + std::to_string(MatchLogHeader::k_version);
+                return false;
+            }
+
+            end = sizeof(header);
+            std::vector<MatchResult> payload;
+            MatchBlockHeader block;
+            while (file.read(reinterpret_cast<char*>(&block), sizeof(block)))
+            {
+                const std::uint64_t blockEnd = end + sizeof(block) + std::uint64_t{ block.m_count } * sizeof(MatchResult);
+                if (std::memcmp(block.m_magic, MatchBlockHeader().m_magic, sizeof(block.m_magic)) != 0 ||
+                    block.m_count == 0 || block.m_count > k_maxBlockRecords || blockEnd > size) break;
+
+                // Сбой оставляет поврежденным только последний блок: содержимое проверяется у него
+                if (blockEnd + sizeof(MatchBlockHeader) > size)
+                {
+                    payload.resize(block.m_count);
+                    if (!file.read(reinterpret_cast<char*>(payload.data()),
+                                   static_cast<std::streamsize>(payload.size() * sizeof(MatchResult))) ||
+                        checksum(payload.data(), payload.size()) != block.m_checksum) break;
+                } else
+                {
+                    file.seekg(static_cast<std::streamoff>(blockEnd));
+                }
+                end = blockEnd;
+                records += block.m_count;
+            }
+            file.close();
+
+            if (end < size)
+            {
+                std::filesystem::resize_file(path, end, code);
+                if (code)
+                {
+                    error = "cannot cut the torn tail of " + path;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void Run()
+        {
+            std::vector<MatchResult> batch;
+            batch.reserve(m_options.m_blockRecords);
+            std::vector<char> buffer(sizeof(MatchBlockHeader) + m_options.m_blockRecords * sizeof(MatchResult));
+
+            auto lastFlush = std::chrono::steady_clock::now();
+            auto lastSync = lastFlush;
+            std::size_t unsynced = 0;
+            for (;;)
+            {
+                // Остановка читается до опустошения очереди: все Push до Close попадут в журнал
+                const bool stopping = m_stopping.load(std::memory_order_acquire);
+                bool drained = false;
+                MatchResult result;
+                while (batch.size() < m_options.m_blockRecords)
+                {
+                    if (!m_queue.TryPop(result))
+                    {
+                        drained = true;
+                        break;
+                    }
+                    batch.push_back(result);
+                }
+
+                const auto now = std::chrono::steady_clock::now();
+                if (batch.size() == m_options.m_blockRecords ||
+                    (!batch.empty() && (stopping || now - lastFlush >= m_options.m_flushInterval)))
+                {
+                    unsynced += WriteBlock(batch, buffer);
+                    batch.clear();
+                    lastFlush = now;
+                }
+                if (unsynced > 0 && (stopping || unsynced >= m_options.m_syncBytes ||
+                                     now - lastSync >= m_options.m_syncInterval))
+                {
+                    Sync();
+                    unsynced = 0;
+                    lastSync = now;
+                }
+
+                if (drained && stopping) break;
+                if (drained) std::this_thread::sleep_for(k_idleSleep);
+            }
+        }
+
+        /**
+         * @return Записано байт.
+         */
+        std::size_t WriteBlock(const std::vector<MatchResult>& batch, std::vector<char>& buffer)
+        {
+            const MatchBlockHeader header = make_block_header(batch.data(), batch.size(), m_nextRecord);
+            const std::size_t bytes = sizeof(header) + batch.size() * sizeof(MatchResult);
+            std::memcpy(buffer.data(), &header, sizeof(header));
+            std::memcpy(buffer.data() + sizeof(header), batch.data(), batch.size() * sizeof(MatchResult));
+            if (std::fwrite(buffer.data(), 1, bytes, m_file) != bytes)
+            {
+                if (!m_failed) std::cerr << "Cannot write the match log " << m_path << std::endl;
+                m_failed = true;
+                return 0;
+            }
+
+            m_nextRecord += batch.size();
+            m_results.fetch_add(batch.size(), std::memory_order_relaxed);
+            m_blocks.fetch_add(1, std::memory_order_relaxed);
+            m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+            metrics::GameMetrics::Instance().m_matchResultsWritten.Add(batch.size());
+            return bytes;
+        }
+
+        void Sync()
+        {
+            std::fflush(m_file);
+#ifdef PACMAN_MATCHLOG_POSIX
+            fsync(fileno(m_file));
+#endif
+            m_syncs.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * @class MatchLogReader
+     * @brief Последовательное чтение журнала: заголовки блоков без записей или блоки целиком.
+     */
+    class MatchLogReader
+    {
+    public:
+        bool Open(const std::string& path, std::string& error)
+        {
+            m_file.open(path, std::ios::binary);
+            MatchLogHeader header;
+            if (!m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+                std::memcmp(header.m_magic, MatchLogHeader().m_magic, sizeof(header.m_magic)) != 0 ||
+                header.m_version != MatchLogHeader::k_version || header.m_recordBytes != sizeof(MatchResult))
+            {
+                error = path + " is not a match log of version " + std::to_string(MatchLogHeader::k_version);
+                return false;
+            }
+            m_offset = sizeof(header);
+            return true;
+        }
+
+        /**
+         * @brief Читает заголовок следующего блока. Записи блока читает ReadRecords, иначе они пропускаются.
+         * @return false в конце журнала (или на недописанном хвосте).
+         */
+        bool NextBlock(MatchBlockHeader& block)
+        {
+            m_file.clear();
+            m_file.seekg(static_cast<std::streamoff>(m_offset));
+            if (!m_file.read(reinterpret_cast<char*>(&block), sizeof(block)) ||
+                std::memcmp(block.m_magic, MatchBlockHeader().m_magic, sizeof(block.m_magic)) != 0 ||
+                block.m_count == 0 || block.m_count > k_maxBlockRecords) return false;
+
+            m_block = block;
+            m_offset += sizeof(block) + std::uint64_t{ block.m_count } * sizeof(MatchResult);
+            return true;
+        }
+
+        /**
+         * @brief Записи блока, прочитанного последним NextBlock.
+         * @return false, если записи не дочитаны или не сходятся с контрольной суммой.
+         */
+        bool ReadRecords(std::vector<MatchResult>& records)
+        {
+            records.resize(m_block.m_count);
+            return static_cast<bool>(m_file.read(reinterpret_cast<char*>(records.data()),
+                                                 static_cast<std::streamsize>(records.size() * sizeof(MatchResult)))) &&
+                   checksum(records.data(), records.size()) == m_block.m_checksum;
+        }
+
+    private:
+        std::ifstream m_file;
+        std::uint64_t m_offset = 0;
+        MatchBlockHeader m_block;
+    };
+}
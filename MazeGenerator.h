@@ -0,0 +1,203 @@
+/**
+ * @file MazeGenerator.h
+ * @brief Процедурный генератор лабиринтов в стиле Pac-Man.
+ *
+ * Лабиринт строится на решетке перекрестков с шагом 3 клетки, обнесенной кольцевым коридором.
+ * Остовное дерево решетки строится алгоритмом Sidewinder, который решает судьбу каждой строки
+ * перекрестков независимо, поэтому большие уровни генерируются полосами строк в нескольких потоках.
+ * Каждая строка использует собственный генератор случайных чисел, производный от зерна,
+ * так что результат не зависит от количества потоков. Левая половина зеркально отражается в правую.
+ *
+ * Разметка совпадает со стандартным уровнем: строка 0 и последняя строка отведены под HUD,
+ * за ними идут внешние стены, углы призраков и их дом находятся там же, где их ищет GridMetrics.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "LevelLoader.h"
+
+/**
+ * @struct MazeParameters
+ * @brief Параметры генерации лабиринта.
+ */
+struct MazeParameters {
+    int m_columns = cnp::k_gridSize; /**< Количество столбцов (не меньше 12). */
+    int m_rows = cnp::k_gridSize; /**< Количество строк (не меньше 12). */
+    std::uint64_t m_seed = 1; /**< Зерно генерации. */
+    float m_loopDensity = 0.3f; /**< Вероятность сохранить коридор, не входящий в остовное дерево. */
+    int m_tunnels = 1; /**< Количество строк с туннелями (e_WrapAroundPath) по краям. */
+    float m_coinDensity = 0.9f; /**< Доля проходимых клеток с монетами. */
+    float m_powerUpDensity = 0.01f; /**< Доля проходимых клеток с усилениями. */
+    unsigned m_threads = 0; /**< Количество потоков (0 - по числу ядер). */
+};
+
+namespace lvl {
+    using hnp::SplitMix64;
+
+    /**
+     * @brief Выполняет fn(begin, end) над диапазоном [0, count), разбитым на полосы по потокам.
+     */
+    template<typename Function>
+    void parallel_for_rows(const int count, const unsigned threads, Function &&fn) {
+        const int bands = static_cast<int>(std::min<unsigned>(threads, static_cast<unsigned>(count)));
+        if (bands <= 1) {
+            fn(0, count);
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        workers.reserve(bands);
+        for (int band = 0; band < bands; ++band) {
+            workers.emplace_back([&fn, band, bands, count] {
+                fn(count * band / bands, count * (band + 1) / bands);
+            });
+        }
+        for (auto &worker : workers) worker.join();
+    }
+
+    /**
+     * @brief Генерирует лабиринт.
+     * @param parameters Параметры генерации.
+     * @return Уровень в формате, который читает Manager::LoadLevel.
+     */
+    inline LevelGrid generate_maze(const MazeParameters &parameters) {
+        constexpr int k_pitch = 3;
+
+        LevelGrid grid;
+        grid.m_columns = std::max(parameters.m_columns, 12);
+        grid.m_rows = std::max(parameters.m_rows, 12);
+        grid.m_cells.assign(static_cast<std::size_t>(grid.m_columns) * grid.m_rows, eTileType::e_Wall);
+
+        const int columns = grid.m_columns;
+        const int rows = grid.m_rows;
+        const unsigned threads = parameters.m_threads ? parameters.m_threads
+                                                      : std::max(1u, std::thread::hardware_concurrency());
+
+        // Последний столбец левой половины (включительно) и зеркальный столбец
+        const int halfLast = (columns - 1) / 2;
+        auto mirror = [columns](const int x) { return columns - 1 - x; };
+        auto set = [&grid, columns, &mirror](const int x, const int y, const eTileType type) {
+            grid.m_cells[static_cast<std::size_t>(y) * columns + x] = type;
+            grid.m_cells[static_cast<std::size_t>(y) * columns + mirror(x)] = type;
+        };
+        auto at = [&grid, columns](const int x, const int y) -> eTileType & {
+            return grid.m_cells[static_cast<std::size_t>(y) * columns + x];
+        };
+        auto rowSeed = [&parameters](const int row, const std::uint64_t salt) {
+            return parameters.m_seed * 0x9E3779B97F4A7C15ull ^ (static_cast<std::uint64_t>(row) << 20) ^ salt;
+        };
+
+        // Перекрестки: x = 1 + 3i в левой половине, y = 2 + 3j до нижнего кольца
+        const int nodeColumns = (halfLast - 1) / k_pitch + 1;
+        const int nodeRows = (rows - 5) / k_pitch + 1;
+        auto nodeX = [](const int i) { return 1 + k_pitch * i; };
+        auto nodeY = [](const int j) { return 2 + k_pitch * j; };
+        const int ringBottom = rows - 3;
+
+        // Полосы HUD и кольцевой коридор
+        parallel_for_rows(rows, threads, [&](const int begin, const int end) {
+            for (int y = begin; y < end; ++y) {
+                if (y == 0 || y == rows - 1) {
+                    for (int x = 0; x <= halfLast; ++x) set(x, y, eTileType::e_Path);
+                } else if (y == 2 || y == ringBottom) {
+                    for (int x = 1; x <= halfLast; ++x) set(x, y, eTileType::e_Path);
+                } else if (y > 2 && y < ringBottom) {
+                    set(1, y, eTileType::e_Path);
+                }
+            }
+        });
+
+        // Остовное дерево (Sidewinder) и дополнительные петли, по строкам перекрестков
+        parallel_for_rows(nodeRows, threads, [&](const int begin, const int end) {
+            for (int j = begin; j < end; ++j) {
+                SplitMix64 random(rowSeed(j, 0x5157));
+                const int y = nodeY(j);
+                int runStart = 0;
+
+                for (int i = 0; i < nodeColumns; ++i) {
+                    set(nodeX(i), y, eTileType::e_Path);
+
+                    const bool lastNode = i == nodeColumns - 1;
+                    // Верхняя строка перекрестков лежит на кольце: все горизонтальные коридоры открыты
+                    const bool closeRun = j > 0 && (lastNode || random.NextFloat() < 0.5f);
+                    const bool keepHorizontal = !closeRun || random.NextFloat() < parameters.m_loopDensity;
+
+                    if (keepHorizontal) {
+                        const int toX = lastNode ? halfLast : nodeX(i + 1) - 1;
+                        // Коридор от последнего перекрестка к центру соединяет половины лабиринта
+                        if (!lastNode || j == 0 || random.NextFloat() < parameters.m_loopDensity) {
+                            for (int x = nodeX(i) + 1; x <= toX; ++x) set(x, y, eTileType::e_Path);
+                        }
+                    }
+
+                    if (j == 0) continue;
+
+                    if (!closeRun) continue;
+
+                    // Закрываем серию: один вертикальный коридор вверх входит в дерево, остальные - петли
+                    const int treeColumn = runStart + random.NextInt(i - runStart + 1);
+                    for (int k = runStart; k <= i; ++k) {
+                        const bool keepVertical = k == treeColumn || random.NextFloat() < parameters.m_loopDensity;
+                        if (!keepVertical) continue;
+                        for (int gapY = nodeY(j - 1) + 1; gapY < y; ++gapY) set(nodeX(k), gapY, eTileType::e_Path);
+                    }
+                    runStart = i + 1;
+                }
+
+                // Соединяем последнюю строку перекрестков с нижним кольцом
+                if (j == nodeRows - 1 && y < ringBottom) {
+                    for (int i = 1; i < nodeColumns; ++i) {
+                        if (random.NextFloat() >= parameters.m_loopDensity) continue;
+                        for (int gapY = y + 1; gapY < ringBottom; ++gapY) set(nodeX(i), gapY, eTileType::e_Path);
+                    }
+                }
+            }
+        });
+
+        // Дом призраков вокруг точки появления Пакмана и проход от него к верхнему кольцу
+        const int centreX = columns / 2 - 1;
+        const int centreY = rows / 2 - 1;
+        for (int y = centreY - 1; y <= centreY + 1; ++y) {
+            for (int x = centreX - 2; x <= centreX + 3; ++x) set(std::min(x, mirror(x)), y, eTileType::e_Path);
+        }
+        for (int y = 2; y < centreY - 1; ++y) {
+            set(std::min(centreX, mirror(centreX)), y, eTileType::e_Path);
+            set(std::min(centreX + 1, mirror(centreX + 1)), y, eTileType::e_Path);
+        }
+
+        // Туннели: равномерно по строкам перекрестков, кроме верхней и нижней
+        for (int t = 0; t < parameters.m_tunnels && nodeRows > 2; ++t) {
+            const int j = 1 + (t + 1) * (nodeRows - 2) / (parameters.m_tunnels + 1);
+            set(0, nodeY(std::min(j, nodeRows - 2)), eTileType::e_WrapAroundPath);
+        }
+
+        // Монеты и усиления на проходимых клетках, кроме дома призраков
+        parallel_for_rows(rows, threads, [&](const int begin, const int end) {
+            for (int y = std::max(begin, 2); y < std::min(end, ringBottom + 1); ++y) {
+                SplitMix64 random(rowSeed(y, 0xC011));
+                for (int x = 1; x <= halfLast; ++x) {
+                    if (at(x, y) != eTileType::e_Path) continue;
+                    if (y >= centreY - 1 && y <= centreY + 1 && x >= std::min(centreX - 2, mirror(centreX + 3))) {
+                        continue;
+                    }
+
+                    const float roll = random.NextFloat();
+                    if (roll < parameters.m_powerUpDensity) set(x, y, eTileType::e_PowerUp);
+                    else if (roll < parameters.m_powerUpDensity + parameters.m_coinDensity) set(x, y, eTileType::e_Coin);
+                }
+            }
+        });
+
+        // Уровень без монет заканчивается сразу, поэтому хотя бы одна монета должна быть
+        if (std::find(grid.m_cells.begin(), grid.m_cells.end(), eTileType::e_Coin) == grid.m_cells.end()) {
+            set(1, ringBottom, eTileType::e_Coin);
+        }
+
+        return grid;
+    }
+}
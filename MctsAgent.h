@@ -0,0 +1,470 @@
+/**
+ * @file MctsAgent.h
+ * @brief Пакман, управляемый поиском по дереву Монте-Карло (UCT) на копиях игры.
+ *
+ * Моделью среды служит сама игра: каждый рабочий поток держит копию (Game::Clone), восстанавливает
+ * в нее снимок текущего тика и симулирует ходы настоящим Game::Update с ИИ призраков из Ghost.h.
+ * Ход дерева - направление Пакмана на один тик (Пакман проходит клетку за тик). За деревом следует
+ * розыгрыш: все Пакманы ведутся ботом (PacManBot) до m_rolloutTicks тиков или до потери жизни.
+ *
+ * Параллельность по корню: каждый поток строит свое дерево, а статистику ходов корня складывает
+ * в общие атомарные счетчики без блокировок. Выбирается ход с наибольшим числом посещений.
+ *
+ * Поиск ограничен временем на ход.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Game.h"
+#include "Metrics.h"
+#include "PacManBot.h"
+#include "np.h"
+
+/**
+ * @brief Параметры поиска.
+ */
+struct MctsOptions
+{
+    std::chrono::microseconds m_budget{ 2000 }; ///< Время поиска на ход.
+    unsigned m_threads = 0; ///< Потоков поиска; 0 - по числу ядер.
+    int m_rolloutTicks = 30; ///< Длина розыгрыша после листа дерева, в тиках.
+    eBotType m_rolloutBot = eBotType::e_GhostAvoiding; ///< Политика розыгрыша.
+    double m_exploration = 1.4; ///< Константа исследования UCB1.
+    std::size_t m_maxNodes = 1 << 15; ///< Узлов в дереве одного потока; дальше дерево не растет.
+};
+
+/**
+ * @brief Счетчики агента за все ходы.
+ */
+struct MctsStats
+{
+    std::uint64_t m_moves = 0; ///< Выбранных ходов.
+    std::uint64_t m_rollouts = 0; ///< Итераций поиска всеми потоками.
+    std::uint64_t m_simulatedTicks = 0; ///< Тиков, симулированных в деревьях и розыгрышах.
+    double m_searchSeconds = 0.0; ///< Время поиска (по часам, не по потокам).
+    std::uint32_t m_maxDepth = 0; ///< Самый глубокий путь по дереву.
+};
+
+/**
+ * @class MctsAgent
+ * @brief Выбирает направление одного Пакмана игры поиском по дереву на всех ядрах.
+ */
+class MctsAgent
+{
+public:
+    static constexpr int k_lifeCost = 5000; ///< Цена потерянной жизни в очках.
+    static constexpr int k_winBonus = 5000; ///< Награда за собранные монеты.
+
+    /**
+     * @param game Игра, которой будет управлять агент; копии для потоков делаются сразу.
+     * @param pacManIndex Номер управляемого Пакмана.
+     * @param options Параметры поиска.
+     * @param seed Зерно случайных решений розыгрышей.
+     */
+    MctsAgent(const Game& game, const std::size_t pacManIndex, const MctsOptions& options, const std::uint64_t seed):
+            m_pacManIndex(pacManIndex),
+            m_options(options)
+    {
+        const Manager& level = game.GetLevel();
+        const GridMetrics& metrics = level.GetGridMetrics();
+        m_columns = metrics.GetColumns();
+        m_rows = metrics.GetRows();
+        m_open.assign(static_cast<std::size_t>(m_columns) * m_rows, 0);
+        for (const auto& row : level.GetLevelData())
+        {
+            for (const Tile& tile : row)
+            {
+                m_open[ToCell(metrics, tile.m_position)] = tile.m_type != eTileType::e_Wall;
+            }
+        }
+
+        const unsigned threads = m_options.m_threads > 0 ? m_options.m_threads
+                                                          : std::max(1u, std::thread::hardware_concurrency());
+        m_workers.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            m_workers.push_back(std::make_unique<Worker>(game, m_options, seed * 31 + i));
+        }
+        // Первый поток поиска - вызывающий
+        m_threads.reserve(threads - 1);
+        for (unsigned i = 1; i < threads; ++i)
+        {
+            m_threads.emplace_back(&MctsAgent::WorkerLoop, this, i);
+        }
+    }
+
+    MctsAgent(const MctsAgent&) = delete;
+    MctsAgent& operator=(const MctsAgent&) = delete;
+
+    ~MctsAgent()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads) thread.join();
+    }
+
+    const MctsStats& GetStats() const {
+        return m_stats;
+    }
+
+    /**
+     * @brief Ищет ход в течение бюджета времени и задает его Пакману.
+     */
+    void Steer(Game& game){
+        PacMan& pacMan = game.GetPacMan(m_pacManIndex);
+        if (!pacMan.IsAlive()) return;
+        PacManBot::Apply(pacMan, Choose(game));
+    }
+
+    /**
+     * @brief Ищет ход в течение бюджета времени, не изменяя игру.
+     * @return e_None, если Пакман выбыл или ходов нет.
+     */
+    eDirection Choose(const Game& game){
+        const PacMan& pacMan = game.GetPacMan(m_pacManIndex);
+        if (!pacMan.IsAlive() || game.IsGameOver()) return eDirection::e_None;
+        const std::uint8_t moves = GetMoves(game.GetGridMetrics(), pacMan);
+        if (moves == 0) return eDirection::e_None;
+        // Из тупика есть только один ход
+        if ((moves & (moves - 1)) == 0) return k_directions[Bit(moves)];
+
+        game.Save(m_root);
+        m_rootPoints = pacMan.GetPoints();
+        m_rootLives = pacMan.GetLivesRemaining();
+        m_rootMoves = moves;
+        for (auto& statistics : m_rootStatistics)
+        {
+            statistics.m_visits.store(0, std::memory_order_relaxed);
+            statistics.m_reward.store(0, std::memory_order_relaxed);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        m_deadline = start + m_options.m_budget;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = static_cast<unsigned>(m_threads.size());
+            ++m_generation;
+        }
+        m_wake.notify_all();
+        Search(*m_workers[0]);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_running == 0; });
+        }
+
+        // Больше всего посещений - у самого надежного хода; при равенстве решает средняя награда
+        int best = -1;
+        std::uint64_t bestVisits = 0;
+        double bestMean = 0.0;
+        std::uint64_t rollouts = 0;
+        for (int action = 0; action < 4; ++action)
+        {
+            const std::uint64_t visits = m_rootStatistics[action].m_visits.load(std::memory_order_relaxed);
+            rollouts += visits;
+            if (visits == 0) continue;
+            const double mean = static_cast<double>(m_rootStatistics[action].m_reward.load(std::memory_order_relaxed)) /
+                                static_cast<double>(visits);
+            if (best < 0 || visits > bestVisits || (visits == bestVisits && mean > bestMean))
+            {
+                best = action;
+                bestVisits = visits;
+                bestMean = mean;
+            }
+        }
+
+        ++m_stats.m_moves;
+        m_stats.m_rollouts += rollouts;
+        m_stats.m_searchSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (auto& worker : m_workers)
+        {
+            m_stats.m_simulatedTicks += worker->m_ticks;
+            m_stats.m_maxDepth = std::max(m_stats.m_maxDepth, worker->m_maxDepth);
+            worker->m_ticks = 0;
+        }
+        metrics::GameMetrics::Instance().m_mctsRollouts.Add(rollouts);
+        return best >= 0 ? k_directions[best] : eDirection::e_None;
+    }
+
+private:
+    static constexpr std::int32_t k_none = -1;
+
+    /**
+     * @brief Ходы по номеру: e_Up, e_Down, e_Left, e_Right.
+     */
+    static constexpr std::array<eDirection, 4> k_directions = {
+            eDirection::e_Up, eDirection::e_Down, eDirection::e_Left, eDirection::e_Right
+    };
+
+    /**
+     * @brief Узел дерева одного потока: состояние после хода от родителя.
+     */
+    struct Node
+    {
+        std::int32_t m_parent = k_none;
+        std::array<std::int32_t, 4> m_children{ k_none, k_none, k_none, k_none };
+        std::uint32_t m_visits = 0;
+        double m_reward = 0.0; ///< Сумма наград розыгрышей через узел.
+        std::uint8_t m_untried = 0; ///< Маска ходов, еще не раскрытых в детей.
+        bool m_terminal = false; ///< Пакман потерял жизнь или игра окончена.
+    };
+
+    /**
+     * @brief Статистика хода корня, общая для всех потоков.
+     */
+    struct RootStatistics
+    {
+        std::atomic<std::uint64_t> m_visits{ 0 };
+        std::atomic<std::int64_t> m_reward{ 0 }; ///< Сумма наград, в очках.
+    };
+
+    /**
+     * @brief Копия игры и дерево одного потока поиска.
+     */
+    struct Worker
+    {
+        Worker(const Game& game, const MctsOptions& options, const std::uint64_t seed):
+                m_game(game.Clone()),
+                m_rolloutBot(options.m_rolloutBot, seed),
+                m_random(seed)
+        {
+            m_nodes.reserve(options.m_maxNodes);
+        }
+
+        std::unique_ptr<Game> m_game;
+        PacManBot m_rolloutBot;
+        hnp::SplitMix64 m_random;
+        std::vector<Node> m_nodes;
+        double m_minReward = 0.0;
+        double m_maxReward = 0.0;
+        std::uint64_t m_ticks = 0;
+        std::uint32_t m_maxDepth = 0;
+    };
+
+    std::size_t m_pacManIndex;
+    MctsOptions m_options;
+    MctsStats m_stats;
+    int m_columns = 0;
+    int m_rows = 0;
+    std::vector<std::uint8_t> m_open; ///< Проходимость клеток уровня.
+
+    // Корень поиска текущего хода: потоки только читают его
+    Game::Snapshot m_root;
+    int m_rootPoints = 0;
+    int m_rootLives = 0;
+    std::uint8_t m_rootMoves = 0;
+    std::chrono::steady_clock::time_point m_deadline;
+    std::array<RootStatistics, 4> m_rootStatistics;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::uint64_t m_generation = 0;
+    unsigned m_running = 0;
+    bool m_stopping = false;
+
+    static int ToCell(const GridMetrics& metrics, const sf::Vector2i position){
+        return metrics.ToRow(position.y) * metrics.GetColumns() + metrics.ToColumn(position.x);
+    }
+
+    static int Bit(const std::uint8_t mask){
+        int bit = 0;
+        while (!(mask & (1u << bit))) ++bit;
+        return bit;
+    }
+
+    /**
+     * @brief Маска ходов из клетки Пакмана в соседние проходимые клетки.
+     */
+    std::uint8_t GetMoves(const GridMetrics& metrics, const PacMan& pacMan) const {
+        const int cell = ToCell(metrics, pacMan.GetPosition());
+        const int column = cell % m_columns;
+        const int row = cell / m_columns;
+        std::uint8_t moves = 0;
+        if (row > 0 && m_open[cell - m_columns]) moves |= 1;
+        if (row + 1 < m_rows && m_open[cell + m_columns]) moves |= 2;
+        if (column > 0 && m_open[cell - 1]) moves |= 4;
+        if (column + 1 < m_columns && m_open[cell + 1]) moves |= 8;
+        return moves;
+    }
+
+    void WorkerLoop(const unsigned index){
+        std::uint64_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stopping || m_generation != seen; });
+                if (m_stopping) return;
+                seen = m_generation;
+            }
+            Search(*m_workers[index]);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_running > 0) continue;
+            }
+            m_done.notify_one();
+        }
+    }
+
+    /**
+     * @brief Итерации поиска до конца бюджета (хотя бы одна); статистика корня добавляется в общую.
+     */
+    void Search(Worker& worker){
+        worker.m_nodes.clear();
+        worker.m_nodes.emplace_back();
+        worker.m_minReward = 0.0;
+        worker.m_maxReward = 0.0;
+        worker.m_nodes[0].m_untried = m_rootMoves;
+
+        do
+        {
+            Iterate(worker);
+        } while (std::chrono::steady_clock::now() < m_deadline);
+
+        const Node& root = worker.m_nodes[0];
+        for (int action = 0; action < 4; ++action)
+        {
+            if (root.m_children[action] == k_none) continue;
+            const Node& child = worker.m_nodes[root.m_children[action]];
+            m_rootStatistics[action].m_visits.fetch_add(child.m_visits, std::memory_order_relaxed);
+            m_rootStatistics[action].m_reward.fetch_add(std::llround(child.m_reward), std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Выбор по UCB1, раскрытие одного хода, розыгрыш и обратное распространение награды.
+     */
+    void Iterate(Worker& worker){
+        Game& game = *worker.m_game;
+        game.Restore(m_root);
+
+        std::int32_t node = 0;
+        std::uint32_t depth = 0;
+        while (!worker.m_nodes[node].m_terminal && worker.m_nodes[node].m_untried == 0)
+        {
+            const int action = SelectAction(worker, node);
+            if (action < 0) break;
+            Step(worker, action);
+            node = worker.m_nodes[node].m_children[action];
+            ++depth;
+        }
+
+        Node* leaf = &worker.m_nodes[node];
+        if (!leaf->m_terminal && leaf->m_untried != 0 && worker.m_nodes.size() < m_options.m_maxNodes)
+        {
+            // Случайный нераскрытый ход
+            int choices[4];
+            int count = 0;
+            for (int action = 0; action < 4; ++action)
+            {
+                if (leaf->m_untried & (1u << action)) choices[count++] = action;
+            }
+            const int action = choices[worker.m_random.NextInt(count)];
+            leaf->m_untried &= static_cast<std::uint8_t>(~(1u << action));
+            Step(worker, action);
+
+            const auto child = static_cast<std::int32_t>(worker.m_nodes.size());
+            worker.m_nodes[node].m_children[action] = child;
+            worker.m_nodes.emplace_back();
+            Node& created = worker.m_nodes.back();
+            created.m_parent = node;
+            created.m_terminal = IsTerminal(game);
+            if (!created.m_terminal) created.m_untried = GetMoves(game.GetGridMetrics(), game.GetPacMan(m_pacManIndex));
+            node = child;
+            ++depth;
+        }
+        worker.m_maxDepth = std::max(worker.m_maxDepth, depth);
+
+        for (int tick = 0; tick < m_options.m_rolloutTicks && !IsTerminal(game); ++tick)
+        {
+            for (std::size_t i = 0; i < game.GetPacManCount(); ++i)
+            {
+                worker.m_rolloutBot.Steer(game, i);
+            }
+            game.Update();
+            ++worker.m_ticks;
+        }
+
+        const double reward = Evaluate(game);
+        worker.m_minReward = std::min(worker.m_minReward, reward);
+        worker.m_maxReward = std::max(worker.m_maxReward, reward);
+        for (std::int32_t current = node; current != k_none; current = worker.m_nodes[current].m_parent)
+        {
+            ++worker.m_nodes[current].m_visits;
+            worker.m_nodes[current].m_reward += reward;
+        }
+    }
+
+    /**
+     * @brief Ход к ребенку с наибольшей оценкой UCB1 или -1; награды нормируются разбросом наград этого дерева.
+     */
+    int SelectAction(const Worker& worker, const std::int32_t node) const {
+        const Node& parent = worker.m_nodes[node];
+        const double range = worker.m_maxReward - worker.m_minReward;
+        const double logVisits = std::log(static_cast<double>(std::max<std::uint32_t>(1, parent.m_visits)));
+        int best = -1;
+        double bestScore = 0.0;
+        for (int action = 0; action < 4; ++action)
+        {
+            if (parent.m_children[action] == k_none) continue;
+            const Node& candidate = worker.m_nodes[parent.m_children[action]];
+            const double mean = candidate.m_reward / candidate.m_visits;
+            const double value = range > 0.0 ? (mean - worker.m_minReward) / range : 0.5;
+            const double score = value + m_options.m_exploration * std::sqrt(logVisits / candidate.m_visits);
+            if (best < 0 || score > bestScore)
+            {
+                best = action;
+                bestScore = score;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief Ход управляемого Пакмана и один тик; остальные Пакманы ведутся ботом розыгрыша.
+     */
+    void Step(Worker& worker, const int action){
+        Game& game = *worker.m_game;
+        for (std::size_t i = 0; i < game.GetPacManCount(); ++i)
+        {
+            if (i == m_pacManIndex) PacManBot::Apply(game.GetPacMan(i), k_directions[action]);
+            else worker.m_rolloutBot.Steer(game, i);
+        }
+        game.Update();
+        ++worker.m_ticks;
+    }
+
+    bool IsTerminal(Game& game) const {
+        const PacMan& pacMan = game.GetPacMan(m_pacManIndex);
+        return game.IsGameOver() || !pacMan.IsAlive();
+    }
+
+    /**
+     * @brief Очки, набранные от корня, за вычетом потерянных жизней; победа добавляет k_winBonus.
+     */
+    double Evaluate(Game& game) const {
+        const PacMan& pacMan = game.GetPacMan(m_pacManIndex);
+        // Поимка уже вычла жизнь и штраф в очках
+        double reward = pacMan.GetPoints() - m_rootPoints -
+                        k_lifeCost * std::max(0, m_rootLives - pacMan.GetLivesRemaining());
+        if (game.IsGameOver() && pacMan.GetLivesRemaining() > 0) reward += k_winBonus;
+        return reward;
+    }
+};
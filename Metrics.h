@@ -0,0 +1,694 @@
+/**
+ * @file Metrics.h
+ * @brief Реестр счетчиков и гистограмм работающей игры и их экспорт.
+ *
+ * Каждый поток увеличивает значения в собственном наборе ячеек: единственный писатель ячейки
+ * обходится без блокировок и атомарных read-modify-write операций. Чтение складывает ячейки всех
+ * потоков. Показатели игры перечислены в GameMetrics, обновление стоит одного чтения и одной записи.
+ *
+ * Снимок реестра публикуется в сегмент разделяемой памяти POSIX (для локального сборщика,
+ * читается через read_shared_memory) и отдается в текстовом формате Prometheus на локальном
+ * порту TCP. Экспорт доступен только в POSIX-системах.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PACMAN_METRICS_POSIX
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace metrics
+{
+    constexpr int k_maxMetrics = 32; ///< Максимальное количество показателей.
+    constexpr int k_maxSlots = 256; ///< Ячеек на поток: счетчик занимает одну, гистограмма - корзины, сумму и количество.
+    constexpr int k_histogramBuckets = 16; ///< Корзины: значение <= base * 2^k, последняя - без границы.
+
+    enum class eMetricType : std::uint32_t
+    {
+        e_Counter, ///< Только растет; суммируется по потокам.
+        e_Gauge, ///< Последнее записанное значение (например, длина очереди).
+        e_Histogram ///< Распределение значений в логарифмических корзинах.
+    };
+
+    /**
+     * @brief Агрегированное значение показателя.
+     */
+    struct MetricValue
+    {
+        std::string m_name;
+        std::string m_help;
+        eMetricType m_type = eMetricType::e_Counter;
+        std::uint64_t m_bucketBase = 1; ///< Граница первой корзины гистограммы.
+        std::int64_t m_value = 0; ///< Счетчик или датчик.
+        std::uint64_t m_sum = 0; ///< Сумма наблюдений гистограммы.
+        std::uint64_t m_count = 0; ///< Количество наблюдений гистограммы.
+        std::array<std::uint64_t, k_histogramBuckets> m_buckets{}; ///< Наблюдения по корзинам (не накопленные).
+    };
+
+    /**
+     * @brief Показатели в текстовом формате Prometheus.
+     */
+    inline std::string format_text(const std::vector<MetricValue>& values)
+    {
+        static const char* const k_typeNames[] = { "counter", "gauge", "histogram" };
+        std::string text;
+        char line[192];
+        for (const auto& value : values)
+        {
+            text += "# HELP " + value.m_name + " " + value.m_help + "\n";
+            text += "# TYPE " + value.m_name + " " + k_typeNames[static_cast<int>(value.m_type)] + "\n";
+            if (value.m_type != eMetricType::e_Histogram)
+            {
+                std::snprintf(line, sizeof(line), "%s %lld\n", value.m_name.c_str(),
+                              static_cast<long long>(value.m_value));
+                text += line;
+                continue;
+            }
+
+            std::uint64_t cumulative = 0;
+            for (int bucket = 0; bucket < k_histogramBuckets; ++bucket)
+            {
+                cumulative += value.m_buckets[bucket];
+                if (bucket + 1 < k_histogramBuckets)
+                {
+                    std::snprintf(line, sizeof(line), "%s_bucket{le=\"%llu\"} %llu\n", value.m_name.c_str(),
+                                  static_cast<unsigned long long>(value.m_bucketBase << bucket),
+                                  static_cast<unsigned long long>(cumulative));
+                } else
+                {
+                    std::snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n", value.m_name.c_str(),
+                                  static_cast<unsigned long long>(cumulative));
+                }
+                text += line;
+            }
+            std::snprintf(line, sizeof(line), "%s_sum %llu\n%s_count %llu\n",
+                          value.m_name.c_str(), static_cast<unsigned long long>(value.m_sum),
+                          value.m_name.c_str(), static_cast<unsigned long long>(value.m_count));
+            text += line;
+        }
+        return text;
+    }
+
+    /**
+     * @brief Реестр показателей и ячеек всех потоков.
+     */
+    class Registry
+    {
+    public:
+        static Registry& Instance()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        /**
+         * @brief Регистрирует показатель; повторная регистрация имени возвращает тот же идентификатор.
+         * @param name Имя в формате Prometheus (строка со статическим временем жизни).
+         * @param help Описание (строка со статическим временем жизни).
+         * @param bucketBase Граница первой корзины гистограммы.
+         * @return Идентификатор или -1, если реестр переполнен.
+         */
+        int Register(const char* name, const char* help, const eMetricType type, const std::uint64_t bucketBase = 1)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const int count = m_count.load(std::memory_order_relaxed);
+            for (int i = 0; i < count; ++i)
+            {
+                if (std::strcmp(m_infos[i].m_name, name) == 0) return i;
+            }
+
+            const int slots = type == eMetricType::e_Histogram ? k_histogramBuckets + 2 :
+                              type == eMetricType::e_Counter ? 1 : 0;
+            if (count == k_maxMetrics || m_usedSlots + slots > k_maxSlots) return -1;
+
+            m_infos[count] = { name, help, type, m_usedSlots, bucketBase };
+            m_usedSlots += slots;
+            m_count.store(count + 1, std::memory_order_release);
+            return count;
+        }
+
+        void Add(const int id, const std::uint64_t amount)
+        {
+            if (id < 0) return;
+            Bump(LocalShard().m_slots[m_infos[id].m_slot], amount);
+        }
+
+        void Set(const int id, const std::int64_t value)
+        {
+            if (id < 0) return;
+            m_gauges[id].store(value, std::memory_order_relaxed);
+        }
+
+        void Observe(const int id, const std::uint64_t value)
+        {
+            if (id < 0) return;
+            const Info& info = m_infos[id];
+            int bucket = 0;
+            for (std::uint64_t bound = info.m_bucketBase; value > bound && bucket < k_histogramBuckets - 1; bound <<= 1)
+            {
+                ++bucket;
+            }
+
+            auto& slots = LocalShard().m_slots;
+            Bump(slots[info.m_slot + bucket], 1);
+            Bump(slots[info.m_slot + k_histogramBuckets], value);
+            Bump(slots[info.m_slot + k_histogramBuckets + 1], 1);
+        }
+
+        /**
+         * @brief Складывает ячейки всех потоков.
+         * @param values Заполняется значениями всех показателей (буфер переиспользуется между вызовами).
+         */
+        void Read(std::vector<MetricValue>& values)
+        {
+            const int count = m_count.load(std::memory_order_acquire);
+            values.resize(static_cast<std::size_t>(count));
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (int id = 0; id < count; ++id)
+            {
+                const Info& info = m_infos[id];
+                MetricValue& value = values[id];
+                value = MetricValue();
+                value.m_name = info.m_name;
+                value.m_help = info.m_help;
+                value.m_type = info.m_type;
+                value.m_bucketBase = info.m_bucketBase;
+
+                if (info.m_type == eMetricType::e_Gauge)
+                {
+                    value.m_value = m_gauges[id].load(std::memory_order_relaxed);
+                    continue;
+                }
+                for (const auto& shard : m_shards)
+                {
+                    const auto& slots = shard->m_slots;
+                    if (info.m_type == eMetricType::e_Counter)
+                    {
+                        value.m_value += static_cast<std::int64_t>(slots[info.m_slot].load(std::memory_order_relaxed));
+                        continue;
+                    }
+                    for (int bucket = 0; bucket < k_histogramBuckets; ++bucket)
+                    {
+                        value.m_buckets[bucket] += slots[info.m_slot + bucket].load(std::memory_order_relaxed);
+                    }
+                    value.m_sum += slots[info.m_slot + k_histogramBuckets].load(std::memory_order_relaxed);
+                    value.m_count += slots[info.m_slot + k_histogramBuckets + 1].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::string ReadText()
+        {
+            std::vector<MetricValue> values;
+            Read(values);
+            return format_text(values);
+        }
+
+    private:
+        struct Info
+        {
+            const char* m_name = nullptr;
+            const char* m_help = nullptr;
+            eMetricType m_type = eMetricType::e_Counter;
+            int m_slot = 0;
+            std::uint64_t m_bucketBase = 1;
+        };
+
+        struct Shard
+        {
+            std::array<std::atomic<std::uint64_t>, k_maxSlots> m_slots{};
+        };
+
+        std::array<Info, k_maxMetrics> m_infos{};
+        std::atomic<int> m_count{ 0 };
+        int m_usedSlots = 0;
+        std::array<std::atomic<std::int64_t>, k_maxMetrics> m_gauges{};
+
+        std::mutex m_mutex;
+        // Ячейки живут до конца процесса, чтобы значения завершившихся потоков не пропадали из суммы
+        std::vector<std::unique_ptr<Shard>> m_shards;
+
+        Registry() = default;
+
+        // Ячейку пишет только ее поток, поэтому достаточно обычных чтения и записи
+        static void Bump(std::atomic<std::uint64_t>& slot, const std::uint64_t amount)
+        {
+            slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        Shard& LocalShard()
+        {
+            thread_local Shard* shard = RegisterThread();
+            return *shard;
+        }
+
+        Shard* RegisterThread()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shards.emplace_back(std::make_unique<Shard>());
+            return m_shards.back().get();
+        }
+    };
+
+    /**
+     * @brief Счетчик: количество событий или сумма величин.
+     */
+    class Counter
+    {
+    public:
+        Counter(const char* name, const char* help) :
+                m_id(Registry::Instance().Register(name, help, eMetricType::e_Counter))
+        {
+        }
+
+        void Add(const std::uint64_t amount = 1) const
+        {
+            Registry::Instance().Add(m_id, amount);
+        }
+
+    private:
+        int m_id;
+    };
+
+    /**
+     * @brief Датчик: текущее значение, например длина очереди.
+     */
+    class Gauge
+    {
+    public:
+        Gauge(const char* name, const char* help) :
+                m_id(Registry::Instance().Register(name, help, eMetricType::e_Gauge))
+        {
+        }
+
+        void Set(const std::int64_t value) const
+        {
+            Registry::Instance().Set(m_id, value);
+        }
+
+    private:
+        int m_id;
+    };
+
+    /**
+     * @brief Гистограмма с корзинами base, 2 * base, 4 * base, ...
+     */
+    class Histogram
+    {
+    public:
+        Histogram(const char* name, const char* help, const std::uint64_t bucketBase) :
+                m_id(Registry::Instance().Register(name, help, eMetricType::e_Histogram, bucketBase))
+        {
+        }
+
+        void Observe(const std::uint64_t value) const
+        {
+            Registry::Instance().Observe(m_id, value);
+        }
+
+    private:
+        int m_id;
+    };
+
+    /**
+     * @brief Показатели игры. Регистрируются все сразу, поэтому экспорт показывает и нулевые.
+     */
+    struct GameMetrics
+    {
+        static GameMetrics& Instance()
+        {
+            static GameMetrics gameMetrics;
+            return gameMetrics;
+        }
+
+        Counter m_ticks{ "pacman_ticks_total", "Game ticks simulated." };
+        Histogram m_tickMicroseconds{ "pacman_tick_duration_us", "Game::Update duration in microseconds.", 1 };
+        Counter m_replans{ "pacman_replans_total", "Ghost path updates started." };
+        Counter m_nodesExpanded{ "pacman_astar_nodes_expanded_total", "A* nodes expanded on the game thread." };
+        Histogram m_pathLength{ "pacman_path_length_cells", "Length of every path a ghost received, in cells.", 1 };
+        Counter m_pickupsConsumed{ "pacman_pickups_consumed_total", "Coins and power-ups eaten." };
+        Counter m_deaths{ "pacman_deaths_total", "Pac-Men caught by ghosts." };
+        Counter m_ghostsEaten{ "pacman_ghosts_eaten_total", "Ghosts eaten by powered-up Pac-Men." };
+        Counter m_gamesFinished{ "pacman_games_finished_total", "Games won or lost." };
+        Gauge m_pathQueueDepth{ "pacman_path_queue_depth", "Path requests waiting for a PathService worker." };
+        Gauge m_replanQueueDepth{ "pacman_replan_queue_depth", "Ghosts waiting for a replan budget." };
+        Counter m_rollbacks{ "pacman_rollbacks_total", "Rollbacks to an earlier tick after a mispredicted input." };
+        Histogram m_rollbackTicks{ "pacman_rollback_ticks", "Ticks re-simulated by one rollback.", 1 };
+        Counter m_mctsRollouts{ "pacman_mcts_rollouts_total", "Search iterations of MctsAgent on all threads." };
+        Counter m_matchResultsWritten{ "pacman_match_results_written_total", "Match results written to the match log." };
+        Histogram m_frameMicroseconds{ "pacman_frame_time_us", "Window frame time in microseconds.", 64 };
+
+    private:
+        GameMetrics() = default;
+    };
+
+    /**
+     * @brief Показатель в сегменте разделяемой памяти.
+     */
+    struct SharedMetric
+    {
+        char m_name[64];
+        char m_help[128];
+        eMetricType m_type;
+        std::uint32_t m_reserved;
+        std::uint64_t m_bucketBase;
+        std::int64_t m_value;
+        std::uint64_t m_sum;
+        std::uint64_t m_count;
+        std::uint64_t m_buckets[k_histogramBuckets];
+    };
+
+    /**
+     * @brief Сегмент разделяемой памяти. m_sequence нечетный, пока снимок записывается (seqlock).
+     */
+    struct SharedSegment
+    {
+        static constexpr std::uint64_t k_magic = 0x53434952544D504Dull; // "MPMTRICS"
+        static constexpr std::uint32_t k_version = 1;
+
+        std::uint64_t m_magic;
+        std::uint32_t m_version;
+        std::uint32_t m_count;
+        std::atomic<std::uint64_t> m_sequence;
+        std::int64_t m_publishedMilliseconds; ///< Время публикации (system_clock, мс от эпохи).
+        SharedMetric m_metrics[k_maxMetrics];
+    };
+
+    /**
+     * @brief Периодически публикует снимок реестра в сегмент разделяемой памяти.
+     */
+    class SharedMemoryExporter
+    {
+    public:
+        SharedMemoryExporter() = default;
+
+        ~SharedMemoryExporter()
+        {
+            Stop();
+        }
+
+        SharedMemoryExporter(const SharedMemoryExporter&) = delete;
+        SharedMemoryExporter& operator=(const SharedMemoryExporter&) = delete;
+
+        /**
+         * @param name Имя сегмента POSIX, например "/pacman-metrics".
+         * @param interval Период публикации.
+         */
+        bool Start(const std::string& name, const std::chrono::milliseconds interval)
+        {
+#ifdef PACMAN_METRICS_POSIX
+            const int descriptor = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (descriptor < 0)
+            {
+                std::cerr << "Cannot create the metrics segment " << name << std::endl;
+                return false;
+            }
+            if (ftruncate(descriptor, sizeof(SharedSegment)) != 0)
+            {
+                close(descriptor);
+                shm_unlink(name.c_str());
+                std::cerr << "Cannot size the metrics segment " << name << std::endl;
+                return false;
+            }
+            void* memory = mmap(nullptr, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            close(descriptor);
+            if (memory == MAP_FAILED)
+            {
+                shm_unlink(name.c_str());
+                std::cerr << "Cannot map the metrics segment " << name << std::endl;
+                return false;
+            }
+
+            m_name = name;
+            m_segment = static_cast<SharedSegment*>(memory);
+            m_segment->m_magic = SharedSegment::k_magic;
+            m_segment->m_version = SharedSegment::k_version;
+            Publish();
+
+            m_running = true;
+            m_thread = std::thread([this, interval] {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                while (!m_wake.wait_for(lock, interval, [this] { return !m_running; }))
+                {
+                    Publish();
+                }
+            });
+            return true;
+#else
+            (void)name;
+            (void)interval;
+            std::cerr << "Shared-memory metrics are not supported on this system" << std::endl;
+            return false;
+#endif
+        }
+
+        /**
+         * @brief Публикует последний снимок и удаляет сегмент.
+         */
+        void Stop()
+        {
+#ifdef PACMAN_METRICS_POSIX
+            if (!m_segment) return;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running = false;
+            }
+            m_wake.notify_all();
+            m_thread.join();
+
+            munmap(m_segment, sizeof(SharedSegment));
+            shm_unlink(m_name.c_str());
+            m_segment = nullptr;
+#endif
+        }
+
+    private:
+        std::string m_name;
+        SharedSegment* m_segment = nullptr;
+        std::vector<MetricValue> m_values;
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_running = false;
+
+        void Publish()
+        {
+            Registry::Instance().Read(m_values);
+
+            const std::uint64_t sequence = m_segment->m_sequence.load(std::memory_order_relaxed);
+            m_segment->m_sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            m_segment->m_count = static_cast<std::uint32_t>(m_values.size());
+            m_segment->m_publishedMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+            for (std::size_t i = 0; i < m_values.size(); ++i)
+            {
+                const MetricValue& value = m_values[i];
+                SharedMetric& shared = m_segment->m_metrics[i];
+                std::snprintf(shared.m_name, sizeof(shared.m_name), "%s", value.m_name.c_str());
+                std::snprintf(shared.m_help, sizeof(shared.m_help), "%s", value.m_help.c_str());
+                shared.m_type = value.m_type;
+                shared.m_bucketBase = value.m_bucketBase;
+                shared.m_value = value.m_value;
+                shared.m_sum = value.m_sum;
+                shared.m_count = value.m_count;
+                std::memcpy(shared.m_buckets, value.m_buckets.data(), sizeof(shared.m_buckets));
+            }
+
+            m_segment->m_sequence.store(sequence + 2, std::memory_order_release);
+        }
+    };
+
+    /**
+     * @brief Читает снимок из сегмента, опубликованного SharedMemoryExporter другого процесса.
+     * @param values Показатели снимка.
+     * @param error Причина ошибки.
+     */
+    inline bool read_shared_memory(const std::string& name, std::vector<MetricValue>& values, std::string& error)
+    {
+#ifdef PACMAN_METRICS_POSIX
+        const int descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+        if (descriptor < 0)
+        {
+            error = "No metrics segment " + name;
+            return false;
+        }
+        void* memory = mmap(nullptr, sizeof(SharedSegment), PROT_READ, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+        if (memory == MAP_FAILED)
+        {
+            error = "Cannot map the metrics segment " + name;
+            return false;
+        }
+
+        const auto* segment = static_cast<const SharedSegment*>(memory);
+        bool valid = segment->m_magic == SharedSegment::k_magic && segment->m_version == SharedSegment::k_version;
+        if (!valid) error = name + " is not a metrics segment of this version";
+
+        // Снимок копируется заново, пока публикация не закончится между двумя чтениями m_sequence
+        auto copy = std::make_unique<SharedSegment>();
+        bool copied = false;
+        for (int attempt = 0; valid && !copied && attempt < 100000; ++attempt)
+        {
+            const std::uint64_t before = segment->m_sequence.load(std::memory_order_acquire);
+            if (before & 1u) continue;
+            std::memcpy(static_cast<void*>(copy.get()), segment, sizeof(SharedSegment));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            copied = segment->m_sequence.load(std::memory_order_relaxed) == before;
+        }
+        munmap(memory, sizeof(SharedSegment));
+        if (valid && !copied) error = "The metrics segment " + name + " is being rewritten continuously";
+        if (!copied) return false;
+
+        values.clear();
+        for (std::uint32_t i = 0; i < copy->m_count && i < static_cast<std::uint32_t>(k_maxMetrics); ++i)
+        {
+            const SharedMetric& shared = copy->m_metrics[i];
+            MetricValue value;
+            value.m_name.assign(shared.m_name, strnlen(shared.m_name, sizeof(shared.m_name)));
+            value.m_help.assign(shared.m_help, strnlen(shared.m_help, sizeof(shared.m_help)));
+            value.m_type = shared.m_type;
+            value.m_bucketBase = shared.m_bucketBase;
+            value.m_value = shared.m_value;
+            value.m_sum = shared.m_sum;
+            value.m_count = shared.m_count;
+            std::memcpy(value.m_buckets.data(), shared.m_buckets, sizeof(shared.m_buckets));
+            values.push_back(std::move(value));
+        }
+        return true;
+#else
+        (void)name;
+        (void)values;
+        error = "Shared-memory metrics are not supported on this system";
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Отдает показатели в текстовом формате Prometheus на 127.0.0.1:port любому подключившемуся.
+     */
+    class TextEndpoint
+    {
+    public:
+        TextEndpoint() = default;
+
+        ~TextEndpoint()
+        {
+            Stop();
+        }
+
+        TextEndpoint(const TextEndpoint&) = delete;
+        TextEndpoint& operator=(const TextEndpoint&) = delete;
+
+        bool Start(const int port)
+        {
+#ifdef PACMAN_METRICS_POSIX
+            m_socket = socket(AF_INET, SOCK_STREAM, 0);
+            if (m_socket < 0)
+            {
+                std::cerr << "Cannot open the metrics socket" << std::endl;
+                return false;
+            }
+            const int reuse = 1;
+            setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(static_cast<std::uint16_t>(port));
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(m_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+                listen(m_socket, 8) != 0)
+            {
+                std::cerr << "Cannot listen for metrics on port " << port << std::endl;
+                close(m_socket);
+                m_socket = -1;
+                return false;
+            }
+
+            m_running = true;
+            m_thread = std::thread([this] { Serve(); });
+            return true;
+#else
+            (void)port;
+            std::cerr << "The metrics endpoint is not supported on this system" << std::endl;
+            return false;
+#endif
+        }
+
+        void Stop()
+        {
+#ifdef PACMAN_METRICS_POSIX
+            if (m_socket < 0) return;
+            m_running = false;
+            m_thread.join();
+            close(m_socket);
+            m_socket = -1;
+#endif
+        }
+
+    private:
+        int m_socket = -1;
+        std::atomic<bool> m_running{ false };
+        std::thread m_thread;
+
+#ifdef PACMAN_METRICS_POSIX
+#ifdef MSG_NOSIGNAL
+        static constexpr int k_sendFlags = MSG_NOSIGNAL; // Закрытый клиентом сокет не должен завершать игру по SIGPIPE
+#else
+        static constexpr int k_sendFlags = 0;
+#endif
+
+        // Проверяет остановку раз в 200 мс; каждый запрос получает полный текст и закрытое соединение
+        void Serve()
+        {
+            while (m_running)
+            {
+                pollfd listening{ m_socket, POLLIN, 0 };
+                if (poll(&listening, 1, 200) <= 0) continue;
+
+                const int client = accept(m_socket, nullptr, nullptr);
+                if (client < 0) continue;
+
+                // Запрос не разбирается: любой путь возвращает показатели
+                pollfd request{ client, POLLIN, 0 };
+                char discard[1024];
+                if (poll(&request, 1, 100) > 0) recv(client, discard, sizeof(discard), 0);
+
+                const std::string body = Registry::Instance().ReadText();
+                const std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                             "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+                for (std::size_t sent = 0; sent < response.size();)
+                {
+                    const ssize_t written = send(client, response.data() + sent, response.size() - sent, k_sendFlags);
+                    if (written <= 0) break;
+                    sent += static_cast<std::size_t>(written);
+                }
+                close(client);
+            }
+        }
+#endif
+    };
+}
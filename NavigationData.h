@@ -0,0 +1,523 @@
+/**
+ * @file NavigationData.h
+ * @brief Предрасчитанные навигационные данные уровня и их файл-спутник (.nav).
+ *
+ * Для каждой клетки хранится маска проходимых соседей, для уровня - список проходимых клеток,
+ * а для каждой фиксированной цели призраков (углы и места в доме) - таблица следующего шага
+ * по кратчайшему пути (по 4 бита на клетку). Таблицы строятся поиском в ширину от цели.
+ *
+ * Файл-спутник лежит рядом с уровнем (<level>.nav), содержит версию формата и хеш содержимого уровня
+ * и отображается в память только для чтения: данные используются напрямую, без разбора и копирования.
+ * Если файла нет или он устарел, таблицы строятся в фоновом потоке, а до их готовности
+ * призраки пользуются поиском A*.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Entity.h"
+#include "LevelLoader.h"
+#include "MazeGenerator.h"
+
+/**
+ * @struct NavFileHeader
+ * @brief Заголовок файла навигационных данных (little-endian).
+ *
+ * За заголовком следуют: маски выходов (байт на клетку, с выравниванием до 4 байт),
+ * индексы проходимых клеток (uint32) и таблицы следующего шага (по полбайта на клетку для каждой цели).
+ */
+struct NavFileHeader {
+    static constexpr std::uint16_t k_version = 1;
+
+    char m_magic[4] = {'P', 'M', 'N', 'V'}; /**< Сигнатура файла. */
+    std::uint16_t m_version = k_version; /**< Версия формата. */
+    std::uint16_t m_targetCount = 0; /**< Количество таблиц следующего шага. */
+    std::uint64_t m_levelHash = 0; /**< Хеш уровня, для которого построены данные. */
+    std::uint32_t m_columns = 0; /**< Количество столбцов. */
+    std::uint32_t m_rows = 0; /**< Количество строк. */
+    std::uint32_t m_walkableCount = 0; /**< Количество проходимых клеток. */
+    std::uint32_t m_reserved = 0;
+};
+static_assert(sizeof(NavFileHeader) == 32, "NavFileHeader must stay packed");
+
+namespace nav {
+    // Биты маски выходов
+    constexpr std::uint8_t k_exitLeft = 1;
+    constexpr std::uint8_t k_exitRight = 2;
+    constexpr std::uint8_t k_exitUp = 4;
+    constexpr std::uint8_t k_exitDown = 8;
+
+    // Цели: углы призраков (GridMetrics::GetCornerPosition), затем места в доме (GetHomePosition)
+    constexpr int k_cornerTargets = 0;
+    constexpr int k_homeTargets = 4;
+    constexpr int k_targetCount = 8;
+
+    constexpr std::size_t align4(const std::size_t size) {
+        return (size + 3) & ~static_cast<std::size_t>(3);
+    }
+
+    constexpr std::uint64_t k_hashOffset = 0xCBF29CE484222325ull; ///< Начальное значение FNV-1a.
+
+    /**
+     * @brief Шаг FNV-1a: добавляет к хешу один байт.
+     */
+    constexpr std::uint64_t hash_byte(const std::uint64_t hash, const unsigned char byte) {
+        return (hash ^ byte) * 0x100000001B3ull;
+    }
+
+    /**
+     * @brief Хеш FNV-1a размеров и содержимого уровня.
+     */
+    inline std::uint64_t hash_level(const LevelGrid &grid) {
+        std::uint64_t hash = k_hashOffset;
+        auto mix = [&hash](const unsigned char *data, const std::size_t size) {
+            for (std::size_t i = 0; i < size; ++i) hash = hash_byte(hash, data[i]);
+        };
+        const std::uint32_t dimensions[2] = {static_cast<std::uint32_t>(grid.m_columns),
+                                             static_cast<std::uint32_t>(grid.m_rows)};
+        mix(reinterpret_cast<const unsigned char *>(dimensions), sizeof(dimensions));
+        mix(reinterpret_cast<const unsigned char *>(grid.m_cells.data()), grid.m_cells.size());
+        return hash;
+    }
+
+    /**
+     * @brief Путь к файлу-спутнику уровня.
+     */
+    inline std::string sidecar_path(const std::string &levelPath) {
+        return levelPath + ".nav";
+    }
+
+    /**
+     * @brief Маска проходимых соседей клетки (биты k_exit*); за краем уровня соседей нет.
+     * @param walkable walkable(cell): клетка не является стеной.
+     */
+    template<typename Walkable>
+    constexpr std::uint8_t exit_mask(const std::size_t cell, const int columns, const int rows, Walkable &&walkable) {
+        const auto column = static_cast<int>(cell % columns);
+        const auto row = static_cast<int>(cell / columns);
+        std::uint8_t mask = 0;
+        if (column > 0 && walkable(cell - 1)) mask |= k_exitLeft;
+        if (column + 1 < columns && walkable(cell + 1)) mask |= k_exitRight;
+        if (row > 0 && walkable(cell - columns)) mask |= k_exitUp;
+        if (row + 1 < rows && walkable(cell + columns)) mask |= k_exitDown;
+        return mask;
+    }
+
+    /**
+     * @brief Поиск в ширину от цели: шаг соседа указывает на клетку, из которой он был открыт.
+     *
+     * Один на навигационные таблицы, встроенный уровень, FlowFieldCache и PathService: соседи
+     * открываются влево, вправо, вверх, вниз, как у A* призрака, поэтому при путях равной длины
+     * все выбирают один шаг. Память поиска принадлежит вызывающему.
+     *
+     * @param goal Клетка цели, уже отмеченная вызывающим как посещенная.
+     * @param queue Очередь не короче количества проходимых клеток.
+     * @param exits exits(cell): маска проходимых соседей (exit_mask).
+     * @param open open(neighbour, cell, towardsCell): отмечает непосещенного соседа и возвращает true.
+     * @param proceed proceed(expanded): продолжать ли поиск перед раскрытием очередной клетки.
+     * @return Количество раскрытых клеток.
+     */
+    template<typename Exits, typename Open, typename Proceed>
+    constexpr std::size_t search_from_goal(const std::uint32_t goal, const int columns, std::uint32_t *queue,
+                                           Exits &&exits, Open &&open, Proceed &&proceed) {
+        std::size_t head = 0, tail = 0;
+        queue[tail++] = goal;
+        while (head < tail && proceed(head)) {
+            const std::uint32_t cell = queue[head++];
+            const std::uint8_t mask = exits(cell);
+            auto expand = [&](const std::uint32_t neighbour, const eDirection towardsCell) {
+                if (open(neighbour, cell, towardsCell)) queue[tail++] = neighbour;
+            };
+            if (mask & k_exitLeft) expand(cell - 1, eDirection::e_Right);
+            if (mask & k_exitRight) expand(cell + 1, eDirection::e_Left);
+            if (mask & k_exitUp) expand(cell - columns, eDirection::e_Down);
+            if (mask & k_exitDown) expand(cell + columns, eDirection::e_Up);
+        }
+        return head;
+    }
+}
+
+/**
+ * @class NavigationData
+ * @brief Представление навигационных данных поверх памяти (отображенного файла или буфера сборки).
+ */
+class NavigationData {
+public:
+    /**
+     * @brief Проверяет образ и привязывается к нему без копирования.
+     * @param data Начало образа (выравнивание не меньше 4 байт).
+     * @param size Размер образа.
+     * @param levelHash Ожидаемый хеш уровня.
+     * @param error Причина, по которой образ не подходит.
+     * @return true, если образ подходит к уровню.
+     */
+    bool Attach(const char *data, const std::size_t size, const std::uint64_t levelHash, std::string &error) {
+        if (size < sizeof(NavFileHeader)) {
+            error = "file is too small";
+            return false;
+        }
+
+        const auto *header = reinterpret_cast<const NavFileHeader *>(data);
+        if (std::memcmp(header->m_magic, NavFileHeader().m_magic, sizeof(header->m_magic)) != 0) {
+            error = "not a navigation file";
+            return false;
+        }
+        if (header->m_version != NavFileHeader::k_version || header->m_targetCount != nav::k_targetCount) {
+            error = "version " + std::to_string(header->m_version) + ", expected " +
+                    std::to_string(NavFileHeader::k_version);
+            return false;
+        }
+        if (header->m_levelHash != levelHash) {
+            error = "built for a different level";
+            return false;
+        }
+
+        const std::size_t cells = static_cast<std::size_t>(header->m_columns) * header->m_rows;
+        if (size != GetImageSize(cells, header->m_walkableCount)) {
+            error = "size doesn't match its header";
+            return false;
+        }
+
+        m_header = header;
+        m_exits = reinterpret_cast<const std::uint8_t *>(data + sizeof(NavFileHeader));
+        m_walkable = reinterpret_cast<const std::uint32_t *>(data + sizeof(NavFileHeader) + nav::align4(cells));
+        m_steps = reinterpret_cast<const std::uint8_t *>(m_walkable + header->m_walkableCount);
+        return true;
+    }
+
+    /**
+     * @brief Размер образа для уровня с заданным количеством клеток.
+     */
+    static constexpr std::size_t GetImageSize(const std::size_t cells, const std::size_t walkableCount) {
+        return sizeof(NavFileHeader) + nav::align4(cells) + walkableCount * sizeof(std::uint32_t) +
+               nav::k_targetCount * GetPlaneSize(cells);
+    }
+
+    static constexpr std::size_t GetPlaneSize(const std::size_t cells) {
+        return (cells + 1) / 2;
+    }
+
+    int GetColumns() const {
+        return static_cast<int>(m_header->m_columns);
+    }
+
+    int GetRows() const {
+        return static_cast<int>(m_header->m_rows);
+    }
+
+    /**
+     * @brief Маска проходимых соседей клетки (биты nav::k_exit*).
+     */
+    std::uint8_t GetExits(const int column, const int row) const {
+        return m_exits[static_cast<std::size_t>(row) * m_header->m_columns + column];
+    }
+
+    std::size_t GetWalkableCount() const {
+        return m_header->m_walkableCount;
+    }
+
+    /**
+     * @brief Индекс (row * columns + column) i-й проходимой клетки.
+     */
+    std::uint32_t GetWalkableCell(const std::size_t i) const {
+        return m_walkable[i];
+    }
+
+    /**
+     * @brief Следующий шаг по кратчайшему пути из клетки к цели.
+     * @return e_None, если клетка является целью или цель недостижима.
+     */
+    eDirection GetNextStep(const int target, const int column, const int row) const {
+        const std::size_t cells = static_cast<std::size_t>(m_header->m_columns) * m_header->m_rows;
+        const std::size_t cell = static_cast<std::size_t>(row) * m_header->m_columns + column;
+        const std::uint8_t packed = m_steps[target * GetPlaneSize(cells) + cell / 2];
+        return static_cast<eDirection>((cell & 1 ? packed >> 4 : packed) & 0x0F);
+    }
+
+private:
+    const NavFileHeader *m_header = nullptr;
+    const std::uint8_t *m_exits = nullptr;
+    const std::uint32_t *m_walkable = nullptr;
+    const std::uint8_t *m_steps = nullptr;
+};
+
+namespace nav {
+    /**
+     * @brief Строит образ навигационных данных. Таблицы целей строятся параллельно.
+     * @param grid Уровень.
+     * @param cancel Флаг отмены, проверяется между строками поиска.
+     * @return Образ файла или пустой вектор, если сборка отменена.
+     */
+    inline std::vector<char> build_navigation(const LevelGrid &grid, const std::atomic<bool> &cancel) {
+        static_assert(static_cast<int>(eDirection::e_None) < 16 && static_cast<int>(eDirection::e_Right) < 16,
+                      "directions must fit in a nibble");
+
+        const int columns = grid.m_columns;
+        const int rows = grid.m_rows;
+        const std::size_t cells = grid.m_cells.size();
+        auto walkable = [&grid](const std::size_t cell) { return grid.m_cells[cell] != eTileType::e_Wall; };
+
+        std::size_t walkableCount = 0;
+        for (std::size_t cell = 0; cell < cells; ++cell) walkableCount += walkable(cell);
+
+        std::vector<char> image(NavigationData::GetImageSize(cells, walkableCount));
+        auto *header = new(image.data()) NavFileHeader();
+        header->m_targetCount = k_targetCount;
+        header->m_levelHash = hash_level(grid);
+        header->m_columns = static_cast<std::uint32_t>(columns);
+        header->m_rows = static_cast<std::uint32_t>(rows);
+        header->m_walkableCount = static_cast<std::uint32_t>(walkableCount);
+
+        auto *exits = reinterpret_cast<std::uint8_t *>(image.data() + sizeof(NavFileHeader));
+        auto *walkableCells = reinterpret_cast<std::uint32_t *>(image.data() + sizeof(NavFileHeader) + align4(cells));
+        auto *steps = reinterpret_cast<std::uint8_t *>(walkableCells + walkableCount);
+
+        std::size_t next = 0;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                const std::size_t cell = static_cast<std::size_t>(r) * columns + c;
+                if (!walkable(cell)) continue;
+
+                walkableCells[next++] = static_cast<std::uint32_t>(cell);
+                exits[cell] = exit_mask(cell, columns, rows, walkable);
+            }
+        }
+
+        const GridMetrics metrics(columns, rows);
+        std::atomic<bool> cancelled{false};
+        lvl::parallel_for_rows(k_targetCount, std::max(1u, std::thread::hardware_concurrency()),
+                               [&](const int begin, const int end) {
+            std::vector<std::uint32_t> queue(walkableCount);
+            std::vector<bool> visited;
+
+            for (int target = begin; target < end && !cancelled; ++target) {
+                const sf::Vector2i position = target < k_homeTargets
+                                              ? metrics.GetCornerPosition(target - k_cornerTargets)
+                                              : metrics.GetHomePosition(target - k_homeTargets);
+                const std::size_t goal = static_cast<std::size_t>(metrics.ToRow(position.y)) * columns +
+                                         metrics.ToColumn(position.x);
+                if (!walkable(goal)) continue;
+
+                std::uint8_t *plane = steps + target * NavigationData::GetPlaneSize(cells);
+                visited.assign(cells, false);
+                visited[goal] = true;
+                search_from_goal(static_cast<std::uint32_t>(goal), columns, queue.data(),
+                                 [exits](const std::uint32_t cell) { return exits[cell]; },
+                                 [&](const std::uint32_t neighbour, std::uint32_t, const eDirection towardsCell) {
+                                     if (visited[neighbour]) return false;
+                                     visited[neighbour] = true;
+                                     const auto value = static_cast<std::uint8_t>(towardsCell);
+                                     plane[neighbour / 2] |= neighbour & 1 ? static_cast<std::uint8_t>(value << 4)
+                                                                           : value;
+                                     return true;
+                                 },
+                                 [&](const std::size_t expanded) {
+                                     if ((expanded & 0xFFFF) == 0 && cancel.load(std::memory_order_relaxed)) {
+                                         cancelled = true;
+                                     }
+                                     return !cancelled;
+                                 });
+            }
+        });
+
+        if (cancelled) return {};
+        return image;
+    }
+
+    /**
+     * @brief Имя временного файла рядом с path, свое у каждого писателя: процесс, поток и номер записи.
+     */
+    inline std::string temporary_path(const std::string &path) {
+        static std::atomic<std::uint32_t> counter{0};
+#if defined(_WIN32)
+        const long process = _getpid();
+#else
+        const long process = getpid();
+#endif
+        const std::size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return path + "." + std::to_string(process) + "." + std::to_string(thread) + "." +
+               std::to_string(counter.fetch_add(1)) + ".tmp";
+    }
+
+    /**
+     * @brief Записывает образ во временный файл и переименовывает его,
+     * чтобы процессы, отобразившие старый файл, продолжали видеть целые данные.
+     *
+     * Временный файл у каждого писателя свой, поэтому одновременные сборки одного уровня
+     * не пишут в один файл: на место файла-спутника встает целый образ одной из них.
+     */
+    inline bool save_navigation(const std::string &path, const std::vector<char> &image) {
+        const std::string temporaryPath = temporary_path(path);
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) return false;
+            file.write(image.data(), static_cast<std::streamsize>(image.size()));
+            file.close();
+            if (!file) {
+                std::remove(temporaryPath.c_str());
+                return false;
+            }
+        }
+#if defined(_WIN32)
+        std::remove(path.c_str());
+#endif
+        if (std::rename(temporaryPath.c_str(), path.c_str()) == 0) return true;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+}
+
+/**
+ * @class NavigationStore
+ * @brief Владелец навигационных данных уровня: отображенный файл-спутник или результат фоновой сборки.
+ *
+ * Get() возвращает nullptr, пока данные не готовы; после публикации данные не меняются до следующего Open.
+ * Open, Attach и Close вызывает только владелец; Get, Wait и IsMapped можно вызывать из любых потоков.
+ */
+class NavigationStore {
+public:
+    NavigationStore() = default;
+
+    ~NavigationStore() {
+        Close();
+    }
+
+    NavigationStore(const NavigationStore &) = delete;
+    NavigationStore &operator=(const NavigationStore &) = delete;
+
+    /**
+     * @brief Открывает файл-спутник уровня или запускает фоновую сборку, если файла нет или он устарел.
+     * @param grid Уровень.
+     * @param sidecarPath Путь к файлу-спутнику (пустая строка - только сборка в памяти).
+     */
+    void Open(const LevelGrid &grid, std::string sidecarPath) {
+        Close();
+
+        const std::uint64_t levelHash = nav::hash_level(grid);
+        if (!sidecarPath.empty()) {
+            auto file = std::make_unique<MappedFile>(sidecarPath);
+            std::string error;
+            if (file->IsOpen() && m_data.Attach(file->Data(), file->Size(), levelHash, error)) {
+                m_file = std::move(file);
+                m_ready.store(true, std::memory_order_release);
+                return;
+            }
+            if (file->IsOpen()) {
+                std::cerr << "Navigation data " << sidecarPath << " is stale (" << error
+                          << "), rebuilding in the background" << std::endl;
+            }
+        }
+
+        m_cancel = false;
+        {
+            std::lock_guard<std::mutex> lock(m_buildMutex);
+            m_building = true;
+        }
+        m_builder = std::thread([this, grid, levelHash, path = std::move(sidecarPath)] {
+            Build(grid, levelHash, path);
+            {
+                std::lock_guard<std::mutex> lock(m_buildMutex);
+                m_building = false;
+            }
+            m_built.notify_all();
+        });
+    }
+
+    /**
+     * @brief Привязывается к готовому образу в памяти программы (встроенный уровень, EmbeddedLevel.h)
+     * без копирования и сборки. Образ должен жить дольше хранилища.
+     * @return false, если образ не подходит к уровню.
+     */
+    bool Attach(const char *image, const std::size_t size, const std::uint64_t levelHash) {
+        Close();
+
+        std::string error;
+        if (!m_data.Attach(image, size, levelHash, error)) {
+            std::cerr << "Embedded navigation data rejected: " << error << std::endl;
+            return false;
+        }
+        m_ready.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Отменяет фоновую сборку и освобождает данные.
+     */
+    void Close() {
+        m_cancel = true;
+        if (m_builder.joinable()) m_builder.join();
+        m_ready.store(false, std::memory_order_release);
+        m_file.reset();
+        m_image.clear();
+    }
+
+    /**
+     * @brief Дожидается окончания фоновой сборки (для инструментов и тестов производительности).
+     *
+     * Поток сборки не присоединяется: ждать могут несколько сессий одного уровня сразу.
+     */
+    void Wait() const {
+        std::unique_lock<std::mutex> lock(m_buildMutex);
+        m_built.wait(lock, [this] { return !m_building; });
+    }
+
+    /**
+     * @brief Готовые навигационные данные или nullptr, если они еще строятся.
+     */
+    const NavigationData *Get() const {
+        return m_ready.load(std::memory_order_acquire) ? &m_data : nullptr;
+    }
+
+    /**
+     * @brief Данные взяты из файла-спутника без пересборки.
+     */
+    bool IsMapped() const {
+        return m_file != nullptr;
+    }
+
+private:
+    std::unique_ptr<MappedFile> m_file; ///< Отображенный файл-спутник.
+    std::vector<char> m_image; ///< Образ, собранный в фоне.
+    NavigationData m_data; ///< Представление над m_file или m_image.
+    std::atomic<bool> m_ready{false};
+    std::atomic<bool> m_cancel{false};
+    std::thread m_builder;
+
+    mutable std::mutex m_buildMutex;
+    mutable std::condition_variable m_built; ///< Сигнал окончания фоновой сборки.
+    bool m_building = false; ///< Фоновая сборка идет (под m_buildMutex).
+
+    void Build(const LevelGrid &grid, const std::uint64_t levelHash, const std::string &path) {
+        std::vector<char> image = nav::build_navigation(grid, m_cancel);
+        if (image.empty()) return;
+
+        if (!path.empty() && !nav::save_navigation(path, image)) {
+            std::cerr << "Couldn't write the navigation data: " << path << std::endl;
+        }
+
+        m_image = std::move(image);
+        std::string error;
+        if (m_data.Attach(m_image.data(), m_image.size(), levelHash, error)) {
+            m_ready.store(true, std::memory_order_release);
+        }
+    }
+};
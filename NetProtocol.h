@@ -0,0 +1,604 @@
+/**
+ * @file NetProtocol.h
+ * @brief Сетевой протокол игрового сервера.
+ *
+ * Поток TCP или Unix-сокета состоит из кадров: длина (uint32, без заголовка), тип (uint8) и данные.
+ * Все числа передаются в порядке little-endian.
+ *
+ * Клиент:
+ * - e_Join (первый кадр соединения): номер сессии (k_newSession - новая игра), роль eRole;
+ * - e_Input: направление Пакмана (значение eDirection).
+ *
+ * Сервер:
+ * - e_Welcome: номер сессии, номер Пакмана игрока (k_spectatorSlot у зрителя), столбцы, строки,
+ *   размер клетки в пикселях и длительность тика в миллисекундах;
+ * - e_Keyframe: полное состояние игры (encode_keyframe) - первым после входа и после пропущенных кадров;
+ * - e_Delta после каждого следующего тика: только изменения относительно прошлого тика (encode_delta);
+ * - e_Error: текст причины, после которого сервер закрывает соединение.
+ *
+ * Оба кадра состояния начинаются с тика (uint32) и флагов (k_stateGameOver). Клиент восстанавливает
+ * состояние функцией apply_state. Дельта тика кодируется один раз и одинакова для всех подписчиков сессии.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace net
+{
+    constexpr std::uint32_t k_newSession = 0xFFFFFFFFu; ///< Номер сессии в e_Join: начать новую игру.
+    constexpr std::uint8_t k_spectatorSlot = 0xFF; ///< Номер Пакмана в e_Welcome: соединение только смотрит.
+    constexpr std::uint8_t k_stateGameOver = 1; ///< Флаг кадров состояния: игра окончена.
+    constexpr std::size_t k_headerSize = 5;
+    constexpr std::uint32_t k_maxFrameSize = 1u << 24; ///< Кадры длиннее считаются ошибкой протокола.
+    constexpr std::size_t k_entitySize = 6; ///< Байт на сущность в кадрах состояния.
+
+    enum class eMessageType : std::uint8_t
+    {
+        e_Join = 1,
+        e_Input,
+        e_Welcome,
+        e_Keyframe,
+        e_Error,
+        e_Delta
+    };
+
+    enum class eRole : std::uint8_t
+    {
+        e_Player, ///< Управляет свободным Пакманом сессии (если свободных нет - смотрит).
+        e_Spectator ///< Только получает состояние.
+    };
+
+    /**
+     * @brief Дописывает кадры в буфер отправки.
+     */
+    class FrameWriter
+    {
+    public:
+        explicit FrameWriter(std::vector<std::uint8_t>& buffer):
+                m_buffer(buffer)
+        {
+        }
+
+        void Begin(const eMessageType type)
+        {
+            m_start = m_buffer.size();
+            m_buffer.resize(m_start + k_headerSize);
+            m_buffer[m_start + 4] = static_cast<std::uint8_t>(type);
+        }
+
+        /**
+         * @brief Записывает длину кадра, начатого Begin.
+         */
+        void End()
+        {
+            const auto size = static_cast<std::uint32_t>(m_buffer.size() - m_start - k_headerSize);
+            for (int i = 0; i < 4; ++i)
+            {
+                m_buffer[m_start + i] = static_cast<std::uint8_t>(size >> (8 * i));
+            }
+        }
+
+        void U8(const std::uint8_t value)
+        {
+            m_buffer.push_back(value);
+        }
+
+        void U16(const std::uint16_t value)
+        {
+            U8(static_cast<std::uint8_t>(value));
+            U8(static_cast<std::uint8_t>(value >> 8));
+        }
+
+        void U32(const std::uint32_t value)
+        {
+            U16(static_cast<std::uint16_t>(value));
+            U16(static_cast<std::uint16_t>(value >> 16));
+        }
+
+        void I32(const std::int32_t value)
+        {
+            U32(static_cast<std::uint32_t>(value));
+        }
+
+        void Bytes(const void* data, const std::size_t size)
+        {
+            const auto* bytes = static_cast<const std::uint8_t*>(data);
+            m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+        }
+
+        /**
+         * @brief Смещение следующего байта; вместе с Patch32 записывает количество, известное после элементов.
+         */
+        std::size_t GetOffset() const
+        {
+            return m_buffer.size();
+        }
+
+        void Patch32(const std::size_t offset, const std::uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                m_buffer[offset + i] = static_cast<std::uint8_t>(value >> (8 * i));
+            }
+        }
+
+    private:
+        std::vector<std::uint8_t>& m_buffer;
+        std::size_t m_start = 0;
+    };
+
+    /**
+     * @brief Читает данные одного кадра; чтение за концом кадра выставляет Failed.
+     */
+    class FrameReader
+    {
+    public:
+        FrameReader(const std::uint8_t* data, const std::size_t size):
+                m_data(data),
+                m_size(size)
+        {
+        }
+
+        std::uint8_t U8()
+        {
+            if (m_offset + 1 > m_size)
+            {
+                m_failed = true;
+                return 0;
+            }
+            return m_data[m_offset++];
+        }
+
+        std::uint16_t U16()
+        {
+            const std::uint16_t low = U8();
+            return static_cast<std::uint16_t>(low | U8() << 8);
+        }
+
+        std::uint32_t U32()
+        {
+            const std::uint32_t low = U16();
+            return low | static_cast<std::uint32_t>(U16()) << 16;
+        }
+
+        std::int32_t I32()
+        {
+            return static_cast<std::int32_t>(U32());
+        }
+
+        bool Failed() const
+        {
+            return m_failed;
+        }
+
+        std::size_t GetRemaining() const
+        {
+            return m_size - m_offset;
+        }
+
+        const std::uint8_t* GetCursor() const
+        {
+            return m_data + m_offset;
+        }
+
+        void Skip(const std::size_t size)
+        {
+            if (m_offset + size > m_size) m_failed = true;
+            else m_offset += size;
+        }
+
+    private:
+        const std::uint8_t* m_data;
+        std::size_t m_size;
+        std::size_t m_offset = 0;
+        bool m_failed = false;
+    };
+
+    /**
+     * @brief Кадр в буфере приема.
+     */
+    struct Frame
+    {
+        eMessageType m_type = eMessageType::e_Error;
+        const std::uint8_t* m_payload = nullptr;
+        std::uint32_t m_size = 0;
+    };
+
+    /**
+     * @brief Находит кадр, начинающийся в buffer[offset].
+     * @param next Смещение следующего кадра.
+     * @param malformed Длина кадра больше k_maxFrameSize.
+     * @return false, если кадр еще не получен целиком.
+     */
+    inline bool next_frame(const std::vector<std::uint8_t>& buffer, const std::size_t offset, Frame& frame,
+                           std::size_t& next, bool& malformed)
+    {
+        malformed = false;
+        if (buffer.size() - offset < k_headerSize) return false;
+
+        FrameReader header(buffer.data() + offset, k_headerSize);
+        const std::uint32_t size = header.U32();
+        if (size > k_maxFrameSize)
+        {
+            malformed = true;
+            return false;
+        }
+        if (buffer.size() - offset - k_headerSize < size) return false;
+
+        frame.m_type = static_cast<eMessageType>(header.U8());
+        frame.m_payload = buffer.data() + offset + k_headerSize;
+        frame.m_size = size;
+        next = offset + k_headerSize + size;
+        return true;
+    }
+
+    struct JoinRequest
+    {
+        std::uint32_t m_session = k_newSession;
+        eRole m_role = eRole::e_Player;
+    };
+
+    struct Welcome
+    {
+        std::uint32_t m_session = 0;
+        std::uint8_t m_slot = k_spectatorSlot;
+        std::uint16_t m_columns = 0;
+        std::uint16_t m_rows = 0;
+        std::uint16_t m_cellSize = 0;
+        std::uint32_t m_tickMilliseconds = 0;
+    };
+
+    inline void encode_join(std::vector<std::uint8_t>& buffer, const JoinRequest& join)
+    {
+        FrameWriter writer(buffer);
+        writer.Begin(eMessageType::e_Join);
+        writer.U32(join.m_session);
+        writer.U8(static_cast<std::uint8_t>(join.m_role));
+        writer.End();
+    }
+
+    inline bool decode_join(const Frame& frame, JoinRequest& join)
+    {
+        FrameReader reader(frame.m_payload, frame.m_size);
+        join.m_session = reader.U32();
+        join.m_role = static_cast<eRole>(reader.U8());
+        return frame.m_type == eMessageType::e_Join && !reader.Failed() && join.m_role <= eRole::e_Spectator;
+    }
+
+    inline void encode_input(std::vector<std::uint8_t>& buffer, const std::uint8_t direction)
+    {
+        FrameWriter writer(buffer);
+        writer.Begin(eMessageType::e_Input);
+        writer.U8(direction);
+        writer.End();
+    }
+
+    inline void encode_welcome(std::vector<std::uint8_t>& buffer, const Welcome& welcome)
+    {
+        FrameWriter writer(buffer);
+        writer.Begin(eMessageType::e_Welcome);
+        writer.U32(welcome.m_session);
+        writer.U8(welcome.m_slot);
+        writer.U16(welcome.m_columns);
+        writer.U16(welcome.m_rows);
+        writer.U16(welcome.m_cellSize);
+        writer.U32(welcome.m_tickMilliseconds);
+        writer.End();
+    }
+
+    inline bool decode_welcome(const Frame& frame, Welcome& welcome)
+    {
+        FrameReader reader(frame.m_payload, frame.m_size);
+        welcome.m_session = reader.U32();
+        welcome.m_slot = reader.U8();
+        welcome.m_columns = reader.U16();
+        welcome.m_rows = reader.U16();
+        welcome.m_cellSize = reader.U16();
+        welcome.m_tickMilliseconds = reader.U32();
+        return frame.m_type == eMessageType::e_Welcome && !reader.Failed();
+    }
+
+    /**
+     * @brief Клетка, направление и состояние Пакмана или призрака.
+     */
+    struct EntityState
+    {
+        std::uint16_t m_column = 0;
+        std::uint16_t m_row = 0;
+        std::uint8_t m_direction = 0;
+        std::uint8_t m_state = 0;
+
+        bool operator==(const EntityState& other) const
+        {
+            return m_column == other.m_column && m_row == other.m_row && m_direction == other.m_direction &&
+                   m_state == other.m_state;
+        }
+    };
+
+    struct PacManStats
+    {
+        std::int32_t m_points = 0;
+        std::uint8_t m_lives = 0;
+        std::uint8_t m_alive = 0;
+
+        bool operator==(const PacManStats& other) const
+        {
+            return m_points == other.m_points && m_lives == other.m_lives && m_alive == other.m_alive;
+        }
+    };
+
+    /**
+     * @brief Предмет по номеру в игре; у невидимого клетка и тип нулевые.
+     */
+    struct PickUpState
+    {
+        std::uint32_t m_cell = 0;
+        std::uint8_t m_type = 0;
+        std::uint8_t m_visible = 0;
+
+        bool operator==(const PickUpState& other) const
+        {
+            return m_cell == other.m_cell && m_type == other.m_type && m_visible == other.m_visible;
+        }
+    };
+
+    /**
+     * @brief Состояние игры, которое передается клиентам.
+     */
+    struct StreamState
+    {
+        std::uint32_t m_tick = 0;
+        std::uint8_t m_flags = 0;
+        std::uint8_t m_pacMen = 0; ///< Первые m_pacMen элементов m_entities - Пакманы, остальные - призраки.
+        std::vector<EntityState> m_entities;
+        std::vector<PacManStats> m_stats;
+        std::vector<PickUpState> m_pickups;
+
+        bool operator==(const StreamState& other) const
+        {
+            return m_tick == other.m_tick && m_flags == other.m_flags && m_pacMen == other.m_pacMen &&
+                   m_entities == other.m_entities && m_stats == other.m_stats && m_pickups == other.m_pickups;
+        }
+    };
+
+    inline void write_entity(FrameWriter& writer, const EntityState& entity)
+    {
+        writer.U16(entity.m_column);
+        writer.U16(entity.m_row);
+        writer.U8(entity.m_direction);
+        writer.U8(entity.m_state);
+    }
+
+    inline void write_stats(FrameWriter& writer, const PacManStats& stats)
+    {
+        writer.I32(stats.m_points);
+        writer.U8(stats.m_lives);
+        writer.U8(stats.m_alive);
+    }
+
+    inline EntityState read_entity(FrameReader& reader)
+    {
+        EntityState entity;
+        entity.m_column = reader.U16();
+        entity.m_row = reader.U16();
+        entity.m_direction = reader.U8();
+        entity.m_state = reader.U8();
+        return entity;
+    }
+
+    inline PacManStats read_stats(FrameReader& reader)
+    {
+        PacManStats stats;
+        stats.m_points = reader.I32();
+        stats.m_lives = reader.U8();
+        stats.m_alive = reader.U8();
+        return stats;
+    }
+
+    /**
+     * @brief Кодирует кадр e_Keyframe.
+     *
+     * После тика и флагов: количество Пакманов (uint8) и призраков (uint32), все сущности (столбец,
+     * строка - uint16, направление, состояние - uint8), очки (int32), жизни и участие в игре (uint8)
+     * каждого Пакмана, количество предметов (uint32) и для каждого предмета видимость (uint8),
+     * а у видимого еще номер клетки (uint32) и тип (uint8).
+     */
+    inline void encode_keyframe(std::vector<std::uint8_t>& buffer, const StreamState& state)
+    {
+        FrameWriter writer(buffer);
+        writer.Begin(eMessageType::e_Keyframe);
+        writer.U32(state.m_tick);
+        writer.U8(state.m_flags);
+        writer.U8(state.m_pacMen);
+        writer.U32(static_cast<std::uint32_t>(state.m_entities.size() - state.m_pacMen));
+        for (const EntityState& entity : state.m_entities)
+        {
+            write_entity(writer, entity);
+        }
+        for (const PacManStats& stats : state.m_stats)
+        {
+            write_stats(writer, stats);
+        }
+
+        // Каждый предмет занимает хотя бы байт, поэтому клиент проверяет их количество по длине кадра
+        writer.U32(static_cast<std::uint32_t>(state.m_pickups.size()));
+        for (const PickUpState& pickup : state.m_pickups)
+        {
+            writer.U8(pickup.m_visible);
+            if (!pickup.m_visible) continue;
+            writer.U32(pickup.m_cell);
+            writer.U8(pickup.m_type);
+        }
+        writer.End();
+    }
+
+    /**
+     * @brief Кодирует кадр e_Delta: переход от состояния from к состоянию to той же игры.
+     *
+     * После тика и флагов: изменившиеся сущности (uint32 количество; номер uint32, затем как в
+     * кадре e_Keyframe), изменившиеся очки и жизни (uint8 количество; номер Пакмана uint8, очки,
+     * жизни, участие), исчезнувшие предметы (uint32 количество; номера uint32) и появившиеся или
+     * перемещенные предметы (uint32 количество; номер, клетка, тип).
+     */
+    inline void encode_delta(std::vector<std::uint8_t>& buffer, const StreamState& from, const StreamState& to)
+    {
+        FrameWriter writer(buffer);
+        writer.Begin(eMessageType::e_Delta);
+        writer.U32(to.m_tick);
+        writer.U8(to.m_flags);
+
+        std::size_t countOffset = writer.GetOffset();
+        writer.U32(0);
+        std::uint32_t count = 0;
+        for (std::uint32_t i = 0; i < to.m_entities.size(); ++i)
+        {
+            if (to.m_entities[i] == from.m_entities[i]) continue;
+            writer.U32(i);
+            write_entity(writer, to.m_entities[i]);
+            ++count;
+        }
+        writer.Patch32(countOffset, count);
+
+        countOffset = writer.GetOffset();
+        writer.U8(0);
+        count = 0;
+        for (std::uint8_t i = 0; i < to.m_stats.size(); ++i)
+        {
+            if (to.m_stats[i] == from.m_stats[i]) continue;
+            writer.U8(i);
+            write_stats(writer, to.m_stats[i]);
+            ++count;
+        }
+        buffer[countOffset] = static_cast<std::uint8_t>(count);
+
+        // Сначала исчезнувшие, потом появившиеся: освободившийся номер может сразу занять новое усиление
+        countOffset = writer.GetOffset();
+        writer.U32(0);
+        count = 0;
+        for (std::uint32_t slot = 0; slot < to.m_pickups.size(); ++slot)
+        {
+            if (!from.m_pickups[slot].m_visible || to.m_pickups[slot].m_visible) continue;
+            writer.U32(slot);
+            ++count;
+        }
+        writer.Patch32(countOffset, count);
+
+        countOffset = writer.GetOffset();
+        writer.U32(0);
+        count = 0;
+        for (std::uint32_t slot = 0; slot < to.m_pickups.size(); ++slot)
+        {
+            const PickUpState& pickup = to.m_pickups[slot];
+            if (!pickup.m_visible || pickup == from.m_pickups[slot]) continue;
+            writer.U32(slot);
+            writer.U32(pickup.m_cell);
+            writer.U8(pickup.m_type);
+            ++count;
+        }
+        writer.Patch32(countOffset, count);
+        writer.End();
+    }
+
+    /**
+     * @brief Применяет кадр e_Keyframe или e_Delta к состоянию клиента.
+     * @return false, если кадр поврежден или дельта пришла не к тому состоянию (нужен новый ключевой кадр).
+     */
+    inline bool apply_state(const Frame& frame, StreamState& state)
+    {
+        FrameReader reader(frame.m_payload, frame.m_size);
+        const std::uint32_t tick = reader.U32();
+        const std::uint8_t flags = reader.U8();
+
+        if (frame.m_type == eMessageType::e_Keyframe)
+        {
+            state.m_pacMen = reader.U8();
+            const std::uint32_t ghosts = reader.U32();
+            const std::size_t entities = static_cast<std::size_t>(state.m_pacMen) + ghosts;
+            if (reader.Failed() || entities > reader.GetRemaining() / k_entitySize) return false;
+            state.m_entities.resize(entities);
+            for (EntityState& entity : state.m_entities)
+            {
+                entity = read_entity(reader);
+            }
+            state.m_stats.resize(state.m_pacMen);
+            for (PacManStats& stats : state.m_stats)
+            {
+                stats = read_stats(reader);
+            }
+
+            const std::uint32_t pickups = reader.U32();
+            if (reader.Failed() || pickups > reader.GetRemaining()) return false;
+            state.m_pickups.assign(pickups, PickUpState());
+            for (PickUpState& pickup : state.m_pickups)
+            {
+                pickup.m_visible = reader.U8();
+                if (pickup.m_visible > 1) return false;
+                if (!pickup.m_visible) continue;
+                pickup.m_cell = reader.U32();
+                pickup.m_type = reader.U8();
+            }
+        } else if (frame.m_type == eMessageType::e_Delta)
+        {
+            if (state.m_entities.empty() || tick != state.m_tick + 1) return false;
+
+            const std::uint32_t entities = reader.U32();
+            for (std::uint32_t i = 0; i < entities && !reader.Failed(); ++i)
+            {
+                const std::uint32_t index = reader.U32();
+                const EntityState entity = read_entity(reader);
+                if (index >= state.m_entities.size()) return false;
+                state.m_entities[index] = entity;
+            }
+            const std::uint8_t stats = reader.U8();
+            for (std::uint8_t i = 0; i < stats && !reader.Failed(); ++i)
+            {
+                const std::uint8_t index = reader.U8();
+                const PacManStats value = read_stats(reader);
+                if (index >= state.m_stats.size()) return false;
+                state.m_stats[index] = value;
+            }
+            const std::uint32_t removed = reader.U32();
+            for (std::uint32_t i = 0; i < removed && !reader.Failed(); ++i)
+            {
+                const std::uint32_t slot = reader.U32();
+                if (slot >= state.m_pickups.size()) return false;
+                state.m_pickups[slot] = PickUpState();
+            }
+            const std::uint32_t spawned = reader.U32();
+            for (std::uint32_t i = 0; i < spawned && !reader.Failed(); ++i)
+            {
+                const std::uint32_t slot = reader.U32();
+                PickUpState pickup;
+                pickup.m_cell = reader.U32();
+                pickup.m_type = reader.U8();
+                pickup.m_visible = 1;
+                if (slot >= state.m_pickups.size()) return false;
+                state.m_pickups[slot] = pickup;
+            }
+        } else
+        {
+            return false;
+        }
+
+        state.m_tick = tick;
+        state.m_flags = flags;
+        return !reader.Failed();
+    }
+
+    inline void encode_error(std::vector<std::uint8_t>& buffer, const std::string& reason)
+    {
+        FrameWriter writer(buffer);
+        writer.Begin(eMessageType::e_Error);
+        writer.Bytes(reason.data(), reason.size());
+        writer.End();
+    }
+
+    inline std::string decode_error(const Frame& frame)
+    {
+        return std::string(reinterpret_cast<const char*>(frame.m_payload), frame.m_size);
+    }
+}
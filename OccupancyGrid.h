@@ -0,0 +1,95 @@
+/**
+ * @file OccupancyGrid.h
+ * @brief Сетка занятости: какие сущности стоят в каждой клетке уровня.
+ *
+ * Сетка перестраивается каждый тик за O(количество сущностей): клетки хранят начало списка
+ * сущностей и номер тика, в котором список был записан, поэтому очищать массив клеток не нужно.
+ * Столкновения проверяются поиском в клетке вместо перебора всех пар сущностей.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "np.h"
+
+/**
+ * @class OccupancyGrid
+ * @brief Списки сущностей по клеткам, перестраиваемые каждый тик.
+ */
+class OccupancyGrid {
+public:
+    /**
+     * @brief Записывает позиции сущностей.
+     * @param metrics Размеры уровня.
+     * @param entities Сущности с методом GetPosition(); в сетку попадает их индекс.
+     * @param include Фильтр: include(entity) == false - сущность не учитывается.
+     */
+    template<typename Entities, typename Include>
+    void Rebuild(const GridMetrics &metrics, const Entities &entities, Include &&include) {
+        const std::size_t cells = static_cast<std::size_t>(metrics.GetColumns()) * metrics.GetRows();
+        if (m_head.size() != cells) {
+            m_head.assign(cells, -1);
+            m_stamp.assign(cells, 0);
+            m_generation = 0;
+        }
+        m_metrics = metrics;
+        ++m_generation;
+        m_next.assign(entities.size(), -1);
+
+        for (std::size_t i = 0; i < entities.size(); ++i) {
+            if (!include(entities[i])) continue;
+
+            const std::size_t cell = GetCell(entities[i].GetPosition());
+            if (m_stamp[cell] != m_generation) {
+                m_stamp[cell] = m_generation;
+                m_head[cell] = -1;
+            }
+            m_next[i] = m_head[cell];
+            m_head[cell] = static_cast<int>(i);
+        }
+    }
+
+    template<typename Entities>
+    void Rebuild(const GridMetrics &metrics, const Entities &entities) {
+        Rebuild(metrics, entities, [](const auto &) { return true; });
+    }
+
+    /**
+     * @brief Индекс клетки по позиции в пикселях.
+     */
+    std::size_t GetCell(const sf::Vector2i position) const {
+        return static_cast<std::size_t>(m_metrics.ToRow(position.y)) * m_metrics.GetColumns() +
+               m_metrics.ToColumn(position.x);
+    }
+
+    /**
+     * @brief Стоит ли в клетке хотя бы одна сущность, кроме except.
+     */
+    bool IsOccupied(const std::size_t cell, const int except = -1) const {
+        for (int i = GetHead(cell); i >= 0; i = m_next[i]) {
+            if (i != except) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Вызывает fn(index) для каждой сущности в клетке.
+     */
+    template<typename Function>
+    void ForEachAt(const std::size_t cell, Function &&fn) const {
+        for (int i = GetHead(cell); i >= 0; i = m_next[i]) fn(i);
+    }
+
+private:
+    GridMetrics m_metrics;
+    std::vector<int> m_head; ///< Первая сущность клетки, если m_stamp совпадает с m_generation.
+    std::vector<std::uint32_t> m_stamp; ///< Тик, в котором записан m_head клетки.
+    std::vector<int> m_next; ///< Следующая сущность в той же клетке.
+    std::uint32_t m_generation = 0;
+
+    int GetHead(const std::size_t cell) const {
+        return m_stamp[cell] == m_generation ? m_head[cell] : -1;
+    }
+};
@@ -8,7 +8,9 @@
 #pragma once
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Graphics/CircleShape.hpp>
+#include "Canvas.h"
 #include "Pacman.h"
+#include "StateHash.h"
 #include "np.h"
 
 /**
@@ -39,6 +41,7 @@ public:
      */
     PickUp():
             m_position(),
+            m_cellSize(cnp::k_gridCellSize),
             m_visible(false),
             m_type(ePickUpType::e_Coin)
     {
@@ -54,31 +57,24 @@ public:
      */
     void Render(sf::RenderWindow& window) const {
         sf::CircleShape circle;
-        switch (m_type)
-        {
-            case ePickUpType::e_Coin:
-                circle.setFillColor({ 255, 255, 71 });
-                circle.setRadius(5);
-                break;
-            case ePickUpType::e_PowerUp:
-                circle.setFillColor({ 255, 255, 255 });
-                circle.setRadius(10);
-                break;
-            case ePickUpType::e_Cherry: break;
-            default:;
-        }
+        circle.setFillColor(GetColour());
+        circle.setRadius(GetRadius());
 
         circle.setOrigin(circle.getGlobalBounds().width / 2, circle.getGlobalBounds().height / 2);
 
-        circle.setPosition(
-                {
-                        static_cast<float>(m_position.x) + static_cast<float>(cnp::k_gridCellSize) / 2.f,
-                        static_cast<float>(m_position.y) + static_cast<float>(cnp::k_gridCellSize) / 2.f
-                }
-        );
+        circle.setPosition(GetCentre());
         window.draw(circle);
     }
 
+    /**
+     * @brief Отрисовка подборки в программный буфер кадра.
+     *
+     * @param canvas Буфер кадра (Canvas).
+     */
+    void Render(Canvas& canvas) const {
+        canvas.FillCircle(GetCentre(), GetRadius(), GetColour());
+    }
+
     /**
      * @brief Инициализация подборки.
      *
@@ -86,11 +82,37 @@ public:
      *
      * @param position Новая позиция подборки (sf::Vector2i).
      * @param type Новый тип подборки (ePickUpType).
+     * @param cellSize Размер клетки уровня в пикселях.
      */
-    void Initialise(sf::Vector2i position, ePickUpType type){
+    void Initialise(sf::Vector2i position, ePickUpType type, int cellSize){
+        if (m_visible) ToggleHash();
         m_position = position;
+        m_cellSize = cellSize;
         m_type = type;
         m_visible = true;
+        ToggleHash();
+    }
+
+    /**
+     * @brief Подключает подборку к хэшу состояния игры: видимая подборка входит в него позицией и типом.
+     *
+     * @param hash Хэш состояния игры.
+     * @param slot Номер подборки в игре.
+     */
+    void TrackState(StateHash& hash, const std::uint32_t slot){
+        if (m_visible) ToggleHash();
+        m_hash = &hash;
+        m_slot = slot;
+        if (m_visible) ToggleHash();
+    }
+
+    /**
+     * @brief Добавляет ключи видимой подборки в хэш (повторный вызов их убирает).
+     */
+    void AddToHash(StateHash& hash, const std::uint32_t slot) const {
+        if (!m_visible) return;
+        hash.Toggle(eHashField::e_PickUp, slot, zobrist::pack(m_position));
+        hash.Toggle(eHashField::e_PickUpType, slot, static_cast<std::uint64_t>(m_type));
     }
 
     /**
@@ -140,6 +162,7 @@ public:
                 default:;
             }
 
+            ToggleHash();
             m_visible = false;
         }
     }
@@ -154,8 +177,78 @@ public:
         return m_position;
     }
 
+    /**
+     * @brief Позиция, тип и видимость подборки для снимка игры.
+     */
+    struct Snapshot
+    {
+        sf::Vector2i m_position;
+        bool m_visible = false;
+        ePickUpType m_type = ePickUpType::e_Coin;
+    };
+
+    Snapshot Save() const {
+        return { m_position, m_visible, m_type };
+    }
+
+    /**
+     * @brief Возвращает подборку из снимка. Хэш не меняется: он восстанавливается вместе с EntityStore.
+     */
+    void Restore(const Snapshot& snapshot){
+        m_position = snapshot.m_position;
+        m_visible = snapshot.m_visible;
+        m_type = snapshot.m_type;
+    }
+
 private:
     sf::Vector2i m_position; /**< Текущая позиция подборки. */
+    int m_cellSize; /**< Размер клетки уровня в пикселях. */
     bool m_visible; /**< Видимость подборки (видна или нет). */
     ePickUpType m_type; /**< Тип подборки. */
+    StateHash* m_hash = nullptr; /**< Хэш состояния игры (nullptr - подборка не отслеживается). */
+    std::uint32_t m_slot = 0; /**< Номер подборки в хэше. */
+
+    void ToggleHash(){
+        if (m_hash) AddToHash(*m_hash, m_slot);
+    }
+
+    /**
+     * @brief Цвет подборки в зависимости от ее типа.
+     */
+    sf::Color GetColour() const {
+        switch (m_type)
+        {
+            case ePickUpType::e_Coin:
+                return { 255, 255, 71 };
+            case ePickUpType::e_PowerUp:
+                return { 255, 255, 255 };
+            default:
+                return sf::Color::White;
+        }
+    }
+
+    /**
+     * @brief Радиус подборки в зависимости от ее типа.
+     */
+    float GetRadius() const {
+        switch (m_type)
+        {
+            case ePickUpType::e_Coin:
+                return static_cast<float>(m_cellSize) / 5.f;
+            case ePickUpType::e_PowerUp:
+                return static_cast<float>(m_cellSize) * 2.f / 5.f;
+            default:
+                return 0.f;
+        }
+    }
+
+    /**
+     * @brief Центр клетки, в которой находится подборка.
+     */
+    sf::Vector2f GetCentre() const {
+        return {
+                static_cast<float>(m_position.x) + static_cast<float>(m_cellSize) / 2.f,
+                static_cast<float>(m_position.y) + static_cast<float>(m_cellSize) / 2.f
+        };
+    }
 };
@@ -0,0 +1,349 @@
+/**
+ * @file PacManBot.h
+ * @brief Программные игроки за Пакмана для безоконных прогонов и бенчмарков.
+ *
+ * Бот каждый тик выбирает направление Пакмана через тот же SetDirection, что и клавиатура.
+ * Случайные решения берутся из собственного генератора бота, поэтому бот с заданным зерном
+ * в детерминированной игре (Game::SetSeed, Game::SetFixedTickSeconds) повторяет партию.
+ *
+ * - e_RandomWalk: на развилках и в тупиках выбирает случайный открытый проход;
+ * - e_GreedyCoin: идет к ближайшей по лабиринту монете;
+ * - e_GhostAvoiding: идет к ближайшей монете в обход клеток у призраков, а когда призрак рядом - убегает.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Game.h"
+#include "np.h"
+
+/**
+ * @enum eBotType
+ * @brief Стратегии ботов.
+ */
+enum class eBotType : std::uint8_t {
+    e_RandomWalk,
+    e_GreedyCoin,
+    e_GhostAvoiding
+};
+
+inline const char *to_string(const eBotType type) {
+    switch (type) {
+        case eBotType::e_RandomWalk:
+            return "random-walk";
+        case eBotType::e_GreedyCoin:
+            return "greedy-coin";
+        case eBotType::e_GhostAvoiding:
+            return "ghost-avoiding";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief Разбирает имя стратегии (как его печатает to_string).
+ * @return false, если имя неизвестно.
+ */
+inline bool parse_bot_type(const std::string &name, eBotType &type) {
+    for (const eBotType candidate: {eBotType::e_RandomWalk, eBotType::e_GreedyCoin, eBotType::e_GhostAvoiding}) {
+        if (name == to_string(candidate)) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @class PacManBot
+ * @brief Управляет одним Пакманом игры.
+ */
+class PacManBot {
+public:
+    /**
+     * @param type Стратегия.
+     * @param seed Зерно случайных решений бота.
+     */
+    PacManBot(const eBotType type, const std::uint64_t seed) :
+            m_type(type),
+            m_random(seed) {
+    }
+
+    eBotType GetType() const {
+        return m_type;
+    }
+
+    /**
+     * @brief Выбирает направление Пакмана с номером pacManIndex на этот тик.
+     */
+    void Steer(Game &game, const std::size_t pacManIndex) {
+        PacMan &pacMan = game.GetPacMan(pacManIndex);
+        if (!pacMan.IsAlive()) return;
+
+        Apply(pacMan, Choose(game, pacManIndex));
+    }
+
+    /**
+     * @brief Задает Пакману направление, в том числе обратное текущему.
+     */
+    static void Apply(PacMan &pacMan, const eDirection direction) {
+        // SetDirection не разворачивает на ходу: бот останавливается и разворачивается в том же тике
+        if (direction == Reverse(pacMan.GetDirection())) {
+            pacMan.SetDirection(eDirection::e_None);
+        }
+        pacMan.SetDirection(direction);
+    }
+
+    static eDirection Reverse(const eDirection direction) {
+        switch (direction) {
+            case eDirection::e_Up:
+                return eDirection::e_Down;
+            case eDirection::e_Down:
+                return eDirection::e_Up;
+            case eDirection::e_Left:
+                return eDirection::e_Right;
+            case eDirection::e_Right:
+                return eDirection::e_Left;
+            default:
+                return eDirection::e_None;
+        }
+    }
+
+    /**
+     * @brief Направление, которое выбрал бы Steer, без изменения игры (например, ввод игрока для RollbackGame).
+     * @return e_None, если Пакман выбыл.
+     */
+    eDirection Choose(Game &game, const std::size_t pacManIndex) {
+        PacMan &pacMan = game.GetPacMan(pacManIndex);
+        if (!pacMan.IsAlive()) return eDirection::e_None;
+
+        const Manager &level = game.GetLevel();
+        const GridMetrics &metrics = level.GetGridMetrics();
+        const int start = ToCell(metrics, pacMan.GetPosition());
+        Prepare(level);
+
+        eDirection direction = eDirection::e_None;
+        switch (m_type) {
+            case eBotType::e_RandomWalk:
+                direction = ChooseRandomWalk(start, pacMan.GetDirection());
+                break;
+            case eBotType::e_GreedyCoin:
+                MarkCoins(game);
+                direction = ChooseTowardsCoin(start, -1);
+                break;
+            case eBotType::e_GhostAvoiding:
+                MarkCoins(game);
+                if (pacMan.GetPacManState() == ePacManState::e_PowerUp) {
+                    // Усиленному Пакману призраки не опасны
+                    direction = ChooseTowardsCoin(start, -1);
+                    break;
+                }
+                MarkDanger(game);
+                if (m_danger[start] <= k_fleeDistance) {
+                    direction = ChooseAwayFromGhosts(start, pacMan.GetDirection());
+                } else {
+                    direction = ChooseTowardsCoin(start, k_avoidDistance);
+                }
+                break;
+            default:;
+        }
+        if (direction == eDirection::e_None) {
+            // Монет не видно или путь закрыт призраками: бродить
+            direction = ChooseRandomWalk(start, pacMan.GetDirection());
+        }
+        return direction;
+    }
+
+private:
+    static constexpr int k_unreached = 1 << 30;
+    static constexpr int k_dangerRadius = 8; ///< Глубина поиска от призраков, в клетках.
+    static constexpr int k_fleeDistance = 3; ///< Ближе этого Пакман убегает от призрака.
+    static constexpr int k_avoidDistance = 2; ///< Клетки ближе этого к призраку путь к монете обходит.
+
+    /**
+     * @brief Смещения по направлениям e_Up, e_Down, e_Left, e_Right.
+     */
+    static constexpr std::array<eDirection, 4> k_directions = {
+            eDirection::e_Up, eDirection::e_Down, eDirection::e_Left, eDirection::e_Right
+    };
+
+    eBotType m_type;
+    hnp::SplitMix64 m_random;
+
+    const Manager *m_level = nullptr; ///< Уровень, для которого заполнен m_open.
+    int m_columns = 0;
+    int m_rows = 0;
+    std::vector<std::uint8_t> m_open; ///< Проходимость клеток уровня.
+    std::vector<std::uint8_t> m_coin; ///< Видимые монеты и усиления на этом тике.
+    std::vector<int> m_danger; ///< Шагов до ближайшего опасного призрака (не дальше k_dangerRadius).
+    std::vector<int> m_firstStep; ///< Направление первого шага пути к клетке (номер в k_directions).
+    std::vector<std::uint32_t> m_stamp; ///< Поиск, посетивший клетку; массивы не очищаются между поисками.
+    std::vector<int> m_queue;
+    std::uint32_t m_search = 0;
+
+    static int ToCell(const GridMetrics &metrics, const sf::Vector2i position) {
+        return metrics.ToRow(position.y) * metrics.GetColumns() + metrics.ToColumn(position.x);
+    }
+
+    /**
+     * @brief Соседняя проходимая клетка в направлении k_directions[index] или -1.
+     */
+    int Neighbour(const int cell, const int index) const {
+        const int column = cell % m_columns;
+        const int row = cell / m_columns;
+        int neighbour = -1;
+        switch (index) {
+            case 0:
+                neighbour = row > 0 ? cell - m_columns : -1;
+                break;
+            case 1:
+                neighbour = row + 1 < m_rows ? cell + m_columns : -1;
+                break;
+            case 2:
+                neighbour = column > 0 ? cell - 1 : -1;
+                break;
+            case 3:
+                neighbour = column + 1 < m_columns ? cell + 1 : -1;
+                break;
+            default:;
+        }
+        return neighbour >= 0 && m_open[neighbour] ? neighbour : -1;
+    }
+
+    /**
+     * @brief Запоминает проходимость клеток уровня при первом вызове и при смене уровня.
+     */
+    void Prepare(const Manager &level) {
+        if (m_level == &level) return;
+
+        const GridMetrics &metrics = level.GetGridMetrics();
+        m_level = &level;
+        m_columns = metrics.GetColumns();
+        m_rows = metrics.GetRows();
+        const std::size_t cells = static_cast<std::size_t>(m_columns) * m_rows;
+        m_open.assign(cells, 0);
+        for (const auto &row: level.GetLevelData()) {
+            for (const Tile &tile: row) {
+                m_open[ToCell(metrics, tile.m_position)] = tile.m_type != eTileType::e_Wall;
+            }
+        }
+        m_coin.assign(cells, 0);
+        m_danger.assign(cells, k_unreached);
+        m_firstStep.assign(cells, -1);
+        m_stamp.assign(cells, 0);
+        m_queue.reserve(cells);
+        m_search = 0;
+    }
+
+    std::uint32_t NextSearch() {
+        if (++m_search == 0) {
+            std::fill(m_stamp.begin(), m_stamp.end(), 0u);
+            m_search = 1;
+        }
+        return m_search;
+    }
+
+    void MarkCoins(const Game &game) {
+        std::memset(m_coin.data(), 0, m_coin.size());
+        const GridMetrics &metrics = game.GetGridMetrics();
+        for (const PickUp &pickup: game.GetPickUps()) {
+            if (pickup.Visible()) m_coin[ToCell(metrics, pickup.GetPosition())] = 1;
+        }
+    }
+
+    /**
+     * @brief Поиск в ширину от всех опасных призраков сразу до глубины k_dangerRadius.
+     */
+    void MarkDanger(const Game &game) {
+        std::fill(m_danger.begin(), m_danger.end(), k_unreached);
+        m_queue.clear();
+        const GridMetrics &metrics = game.GetGridMetrics();
+        for (const Ghost &ghost: game.GetGhosts()) {
+            if (ghost.GetGhostState() == eGhostState::e_Frightened) continue;
+            const int cell = ToCell(metrics, ghost.GetPosition());
+            if (m_danger[cell] == 0) continue;
+            m_danger[cell] = 0;
+            m_queue.push_back(cell);
+        }
+
+        for (std::size_t head = 0; head < m_queue.size(); ++head) {
+            const int cell = m_queue[head];
+            if (m_danger[cell] >= k_dangerRadius) continue;
+            for (int index = 0; index < 4; ++index) {
+                const int neighbour = Neighbour(cell, index);
+                if (neighbour < 0 || m_danger[neighbour] != k_unreached) continue;
+                m_danger[neighbour] = m_danger[cell] + 1;
+                m_queue.push_back(neighbour);
+            }
+        }
+    }
+
+    /**
+     * @brief Первый шаг кратчайшего пути к ближайшей монете.
+     * @param avoid Клетки не дальше avoid от призрака закрыты; -1 - призраки не учитываются.
+     */
+    eDirection ChooseTowardsCoin(const int start, const int avoid) {
+        const std::uint32_t search = NextSearch();
+        m_queue.clear();
+        m_queue.push_back(start);
+        m_stamp[start] = search;
+        m_firstStep[start] = -1;
+
+        for (std::size_t head = 0; head < m_queue.size(); ++head) {
+            const int cell = m_queue[head];
+            if (cell != start && m_coin[cell]) return k_directions[m_firstStep[cell]];
+
+            for (int index = 0; index < 4; ++index) {
+                const int neighbour = Neighbour(cell, index);
+                if (neighbour < 0 || m_stamp[neighbour] == search) continue;
+                if (avoid >= 0 && m_danger[neighbour] <= avoid) continue;
+                m_stamp[neighbour] = search;
+                m_firstStep[neighbour] = cell == start ? index : m_firstStep[cell];
+                m_queue.push_back(neighbour);
+            }
+        }
+        return eDirection::e_None;
+    }
+
+    /**
+     * @brief Соседняя клетка, дальше всего от призраков; при равенстве - без разворота.
+     */
+    eDirection ChooseAwayFromGhosts(const int start, const eDirection current) const {
+        eDirection best = eDirection::e_None;
+        int bestDanger = -1;
+        for (int index = 0; index < 4; ++index) {
+            const int neighbour = Neighbour(start, index);
+            if (neighbour < 0) continue;
+            const int danger = m_danger[neighbour];
+            const bool reverse = k_directions[index] == Reverse(current);
+            if (danger > bestDanger || (danger == bestDanger && best == Reverse(current) && !reverse)) {
+                best = k_directions[index];
+                bestDanger = danger;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief Продолжает движение по коридору; на развилке или в стене выбирает случайный проход.
+     */
+    eDirection ChooseRandomWalk(const int start, const eDirection current) {
+        std::array<eDirection, 4> choices{};
+        int count = 0;
+        bool canContinue = false;
+        for (int index = 0; index < 4; ++index) {
+            if (Neighbour(start, index) < 0 || k_directions[index] == Reverse(current)) continue;
+            choices[count++] = k_directions[index];
+            canContinue |= k_directions[index] == current;
+        }
+
+        if (count == 0) return Reverse(current);
+        if (canContinue && count == 1) return current;
+        return choices[m_random.NextInt(count)];
+    }
+};
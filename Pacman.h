@@ -8,14 +8,16 @@
 
 #pragma once
 
+#include "Canvas.h"
 #include "Entity.h"
+#include "Profiler.h"
 #include "np.h"
 
 /**
  * @enum ePacManState
  * @brief Состояния Пакмана.
  */
-enum class ePacManState {
+enum class ePacManState : std::uint8_t {
     e_Normal, /**< Нормальное состояние. */
     e_PowerUp /**< Состояние усиления. */
 };
@@ -29,22 +31,27 @@ enum class ePacManState {
 class PacMan final : public Entity {
 public:
     /**
-     * @brief Конструктор по умолчанию.
+     * @brief Конструктор.
      *
-     * Инициализирует объект класса PacMan с начальными значениями.
+     * Создает компоненты Пакмана в хранилище с начальными значениями.
+     *
+     * @param store Хранилище сущностей игры.
      */
-    PacMan() :
+    explicit PacMan(EntityStore &store) :
             Entity(
-                    cnp::k_pacManSpawnPosition,
-                    cnp::k_gridCellSize,
+                    store,
+                    store.GetGridMetrics().GetPacManSpawnPosition(),
+                    store.GetGridMetrics().GetCellSize(),
                     eDirection::e_None,
                     sf::Color::Yellow
             ),
             m_points(0),
             m_lives(3),
-            m_isAlive(true),
-            m_state(ePacManState::e_Normal),
-            m_powerUpTimer(0.f) {
+            m_isAlive(true) {
+        StateHash &hash = m_store->GetHash();
+        hash.Toggle(eHashField::e_Points, m_id, zobrist::pack(m_points));
+        hash.Toggle(eHashField::e_Lives, m_id, zobrist::pack(m_lives));
+        hash.Toggle(eHashField::e_Alive, m_id, m_isAlive);
     }
 
     /**
@@ -55,17 +62,17 @@ public:
      * @param tiles Вектор векторов объектов класса Tile, представляющий собой игровое поле.
      */
     void Update(const std::vector<std::vector<Tile>> &tiles) {
+        PACMAN_PROFILE_SCOPE("PacMan::Update");
         CheckForBlockades(tiles);
         Move();
-        if (m_state == ePacManState::e_PowerUp) {
-            m_powerUpTimer += static_cast<float>(m_clock.getElapsedTime().asSeconds());
+        if (GetPacManState() == ePacManState::e_PowerUp) {
+            SetTimer(Timer() + m_store->GetTickSeconds());
 
-            if (m_powerUpTimer >= cnp::k_pacManPowerUpTime) {
-                m_state = ePacManState::e_Normal;
-                m_powerUpTimer = 0.f;
+            if (Timer() >= cnp::k_pacManPowerUpTime) {
+                SetPacManState(ePacManState::e_Normal);
+                SetTimer(0.f);
             }
         }
-        m_clock.restart();
     }
 
     /**
@@ -76,21 +83,19 @@ public:
      * @param window Объект класса sf::RenderWindow, представляющий собой окно для отрисовки.
      */
     void Render(sf::RenderWindow &window) {
-        if (m_state == ePacManState::e_PowerUp) {
-            // Interpolate between pacman's colour and the power-up
-            // Colour based on the time
-            const float normalisedTimer = m_powerUpTimer / static_cast<float>(cnp::k_pacManPowerUpTime);
-
-            const sf::Uint32 lerpedColour = hnp::interpolate(m_colour.toInteger(), sf::Color::White.toInteger(),
-                                                             normalisedTimer);
-
-            m_shape.setFillColor(sf::Color(lerpedColour));
-        } else {
-            m_shape.setFillColor(sf::Color::Yellow);
-        }
+        sf::RectangleShape &shape = m_store->GetShape();
+        shape.setFillColor(GetRenderColour());
+        shape.setPosition(static_cast<sf::Vector2f>(Position()));
+        window.draw(shape);
+    }
 
-        m_shape.setPosition(static_cast<sf::Vector2f>(m_position));
-        window.draw(m_shape);
+    /**
+     * @brief Отрисовка Пакмана в программный буфер кадра.
+     *
+     * @param canvas Буфер кадра (Canvas).
+     */
+    void Render(Canvas &canvas) const {
+        canvas.FillRect(Position(), {m_gridMetrics.GetCellSize(), m_gridMetrics.GetCellSize()}, GetRenderColour());
     }
 
     /**
@@ -100,8 +105,8 @@ public:
      *
      * @return Текущее состояние Пакмана (ePacManState).
      */
-    const ePacManState &GetPacManState() const {
-        return m_state;
+    ePacManState GetPacManState() const {
+        return static_cast<ePacManState>(m_store->State(m_id));
     }
 
     /**
@@ -110,8 +115,8 @@ public:
      * Устанавливает состояние Пакмана в режим усиления и обнуляет таймер усиления.
      */
     void PowerUp() {
-        m_state = ePacManState::e_PowerUp;
-        m_powerUpTimer = 0.f;
+        SetPacManState(ePacManState::e_PowerUp);
+        SetTimer(0.f);
     }
 
     /**
@@ -122,7 +127,7 @@ public:
      * @param amount Количество очков для добавления.
      */
     void AddPoints(int amount) {
-        m_points += amount;
+        SetPoints(m_points + amount);
     }
 
     /**
@@ -154,8 +159,8 @@ public:
      */
     void Reset() {
         {
-            m_position = cnp::k_pacManSpawnPosition;
-            m_isAlive = true;
+            SetPosition(m_gridMetrics.GetPacManSpawnPosition());
+            SetAlive(true);
         }
     }
 
@@ -179,22 +184,102 @@ public:
      */
     void SetIsAlive(bool alive) {
         if (!alive) {
-            m_lives -= 1;
-            m_points -= 500;
-            if (m_points < 0) m_points = 0;
+            SetLives(m_lives - 1);
+            SetPoints(m_points < 500 ? 0 : m_points - 500);
         }
-        m_isAlive = alive;
+        SetAlive(alive);
     }
     void AddLives(int n) {
-        m_lives += n;
+        SetLives(m_lives + n);
+    }
+
+    /**
+     * @brief Тип призрака (GhostPolicyInfo::m_id), поймавшего Пакмана последним; -1 - Пакман не пойман.
+     */
+    int GetCaughtBy() const {
+        return m_caughtBy;
+    }
+
+    /**
+     * @brief Пакман пойман призраком типа ghostType: теряет жизнь (см. SetIsAlive).
+     */
+    void Catch(const int ghostType) {
+        m_caughtBy = ghostType;
+        SetIsAlive(false);
+    }
+
+    /**
+     * @brief Счет и жизни Пакмана для снимка игры; позиция, направление и таймер лежат в EntityStore.
+     */
+    struct Snapshot {
+        int m_points = 0;
+        int m_lives = 0;
+        bool m_isAlive = false;
+        int m_caughtBy = -1;
+    };
+
+    Snapshot Save() const {
+        return {m_points, m_lives, m_isAlive, m_caughtBy};
+    }
+
+    /**
+     * @brief Возвращает счет и жизни из снимка. Хэш не меняется: он восстанавливается вместе с EntityStore.
+     */
+    void Restore(const Snapshot &snapshot) {
+        m_points = snapshot.m_points;
+        m_lives = snapshot.m_lives;
+        m_isAlive = snapshot.m_isAlive;
+        m_caughtBy = snapshot.m_caughtBy;
     }
 
 private:
     int m_points; /**< Текущий счет Пакмана. */
     int m_lives; /**< Количество оставшихся жизней Пакмана. */
     bool m_isAlive; /**< Состояние жизни Пакмана (жив или мертв). */
-    ePacManState m_state; /**< Текущее состояние Пакмана. */
-    float m_powerUpTimer; /**< Таймер усиления. */
+    int m_caughtBy = -1; /**< Тип призрака, поймавшего Пакмана последним. */
+
+    /**
+     * @brief Записывает состояние Пакмана в хранилище.
+     */
+    void SetPacManState(const ePacManState state) {
+        m_store->SetState(m_id, static_cast<std::uint8_t>(state));
+    }
+
+    // Счет, жизни и участие в игре меняются вместе с их ключами в хэше состояния
+
+    void SetPoints(const int points) {
+        m_store->GetHash().Change(eHashField::e_Points, m_id, zobrist::pack(m_points), zobrist::pack(points));
+        m_points = points;
+    }
+
+    void SetLives(const int lives) {
+        m_store->GetHash().Change(eHashField::e_Lives, m_id, zobrist::pack(m_lives), zobrist::pack(lives));
+        m_lives = lives;
+    }
+
+    void SetAlive(const bool alive) {
+        m_store->GetHash().Change(eHashField::e_Alive, m_id, m_isAlive, alive);
+        m_isAlive = alive;
+    }
+
+    /**
+     * @brief Цвет Пакмана с учетом состояния усиления.
+     *
+     * @return Цвет для отрисовки (sf::Color).
+     */
+    sf::Color GetRenderColour() const {
+        if (GetPacManState() == ePacManState::e_PowerUp) {
+            // Interpolate between pacman's colour and the power-up
+            // Colour based on the time
+            const float normalisedTimer = Timer() / static_cast<float>(cnp::k_pacManPowerUpTime);
+
+            const sf::Uint32 lerpedColour = hnp::interpolate(Colour().toInteger(), sf::Color::White.toInteger(),
+                                                             normalisedTimer);
+
+            return sf::Color(lerpedColour);
+        }
+        return sf::Color::Yellow;
+    }
 
     /**
      * @brief Движение Пакмана.
@@ -202,28 +287,30 @@ private:
      * Осуществляет движение Пакмана в зависимости от текущего направления движения и наличия препятствий.
      */
     void Move() {
-        if (!hnp::is_in_vector(m_limitedDirections, m_currentDirection)) {
-            switch (m_currentDirection) {
+        if (!IsBlocked(Direction())) {
+            sf::Vector2i position = Position();
+            switch (Direction()) {
                 case eDirection::e_Up:
-                    m_position.y -= m_speed;
+                    position.y -= Speed();
                     break;
                 case eDirection::e_Down:
-                    m_position.y += m_speed;
+                    position.y += Speed();
                     break;
                 case eDirection::e_Left:
-                    m_position.x -= m_speed;
+                    position.x -= Speed();
                     break;
                 case eDirection::e_Right:
-                    m_position.x += m_speed;
+                    position.x += Speed();
                     break;
                 case eDirection::e_None:
                     break;
                 default:
-                    std::cout << "Unknown Movement direction" << std::endl;
+                    std::cerr << "Unknown Movement direction" << std::endl;
                     break;
             }
+            SetPosition(position);
             WrapAround();
         }
-        m_limitedDirections.clear();
+        m_store->Blocked(m_id) = 0;
     }
 };
@@ -0,0 +1,393 @@
+/**
+ * @file PathService.h
+ * @brief Асинхронный поиск путей призраков в пуле рабочих потоков.
+ *
+ * Призраки отправляют запросы (начало, цель) и продолжают идти по старому пути, а рабочие потоки
+ * ищут пути по неизменяемому уровню. Результаты выдаются только на границе тиков (Deliver),
+ * поэтому состояние игры меняется в тех же точках, что и при синхронном поиске.
+ *
+ * Новый запрос того же призрака отменяет старый: отмененный запрос пропускается рабочим потоком,
+ * а его уже готовый результат отбрасывается при выдаче. Запросы разных призраков к одной цели
+ * объединяются: один обратный поиск в ширину от цели строит пути для всех начальных клеток.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "NavigationData.h"
+#include "Tile.h"
+#include "Tracer.h"
+
+/**
+ * @struct PathServiceStats
+ * @brief Счетчики и задержки сервиса поиска путей.
+ */
+struct PathServiceStats {
+    std::uint64_t m_submitted = 0; /**< Принято запросов. */
+    std::uint64_t m_delivered = 0; /**< Выдано результатов. */
+    std::uint64_t m_cancelled = 0; /**< Запросов, отмененных до выдачи. */
+    std::uint64_t m_deduplicated = 0; /**< Запросов, присоединенных к поиску к той же цели. */
+    std::size_t m_queueDepth = 0; /**< Запросов в очереди, поиск которых еще не начат. */
+    std::chrono::microseconds m_latencyP50{0}; /**< Медиана задержки от запроса до готового пути. */
+    std::chrono::microseconds m_latencyP99{0}; /**< 99-й процентиль задержки. */
+    std::chrono::microseconds m_latencyMax{0}; /**< Максимальная задержка. */
+};
+
+/**
+ * @class PathService
+ * @brief Пул потоков, выполняющий запросы путей к клеткам уровня.
+ */
+class PathService {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param grid Уровень. Должен жить дольше сервиса и не изменяться.
+     * @param threads Количество рабочих потоков (не меньше одного).
+     */
+    PathService(const std::vector<std::vector<Tile>> &grid, const unsigned threads) :
+            m_columns(grid.empty() ? 0 : static_cast<int>(grid[0].size())),
+            m_rows(static_cast<int>(grid.size())) {
+        m_walkable.reserve(static_cast<std::size_t>(m_columns) * m_rows);
+        for (const auto &row: grid) {
+            for (const auto &tile: row) m_walkable.push_back(tile.m_type != eTileType::e_Wall);
+        }
+
+        const unsigned count = std::max(1u, threads);
+        m_workers.reserve(count);
+        for (unsigned i = 0; i < count; ++i) m_workers.emplace_back(&PathService::WorkerLoop, this);
+    }
+
+    PathService(const PathService &) = delete;
+    PathService &operator=(const PathService &) = delete;
+
+    ~PathService() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_workAvailable.notify_all();
+        for (auto &worker: m_workers) worker.join();
+    }
+
+    /**
+     * @brief Резервирует номер заказчика (например, призрака).
+     */
+    int Register() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requesters.emplace_back();
+        // На каждого заказчика - место в очереди и буфер участников поиска
+        m_batches.reserve(m_requesters.size());
+        m_spareMembers.emplace_back();
+        m_spareMembers.back().reserve(k_membersPerBatch);
+        m_spareMembers.reserve(m_requesters.size());
+        return static_cast<int>(m_requesters.size()) - 1;
+    }
+
+    int GetColumns() const {
+        return m_columns;
+    }
+
+    /**
+     * @brief Ставит запрос пути в очередь, отменяя предыдущий запрос того же заказчика.
+     * @param requester Номер заказчика из Register.
+     * @param start Клетка начала (столбец, строка).
+     * @param goal Клетка цели (столбец, строка).
+     */
+    void Submit(const int requester, const sf::Vector2i start, const sf::Vector2i goal) {
+        const Member member{requester, 0, ToIndex(start), Clock::now()};
+        const std::uint32_t goalIndex = ToIndex(goal);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Requester &state = m_requesters[requester];
+            if (state.m_outstanding) ++m_stats.m_cancelled;
+            state.m_outstanding = true;
+            ++m_stats.m_submitted;
+            ++m_queuedRequests;
+
+            Member queued = member;
+            queued.m_generation = ++state.m_generation;
+
+            // Поиск к той же цели, еще не взятый потоком, обслужит и этот запрос
+            const auto batch = std::find_if(m_batches.begin(), m_batches.end(),
+                                            [goalIndex](const Batch &b) { return b.m_goal == goalIndex; });
+            if (batch != m_batches.end()) {
+                batch->m_members.push_back(queued);
+                ++m_stats.m_deduplicated;
+                return;
+            }
+
+            // Буферы участников переиспользуются, чтобы запрос не выделял память в игровом потоке
+            std::vector<Member> members;
+            if (!m_spareMembers.empty()) {
+                members = std::move(m_spareMembers.back());
+                m_spareMembers.pop_back();
+            }
+            members.push_back(queued);
+            m_batches.push_back({goalIndex, std::move(members)});
+            ++m_inFlight;
+        }
+        m_workAvailable.notify_one();
+    }
+
+    /**
+     * @brief Отменяет незавершенный запрос заказчика.
+     */
+    void Cancel(const int requester) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Requester &state = m_requesters[requester];
+        if (!state.m_outstanding) return;
+        state.m_outstanding = false;
+        ++state.m_generation;
+        ++m_stats.m_cancelled;
+    }
+
+    /**
+     * @brief Ждать ли на границе тика запросы предыдущего тика (по умолчанию - да).
+     *
+     * С ожиданием результат не зависит от скорости потоков: путь, запрошенный на тике N,
+     * всегда выдается на тике N + 1. Без ожидания незавершенные пути выдаются на следующих тиках.
+     */
+    void SetWaitAtBoundary(const bool wait) {
+        m_waitAtBoundary = wait;
+    }
+
+    /**
+     * @brief Выдает готовые результаты. Вызывается на границе тиков из игрового потока.
+     * @param handler Вызывается как handler(requester, cells) для каждого актуального результата;
+     *                cells - индексы клеток от начала до цели (пусто, если цель недостижима).
+     */
+    template<typename Handler>
+    void Deliver(Handler &&handler) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_waitAtBoundary) m_idle.wait(lock, [this] { return m_inFlight == 0; });
+            m_delivering.swap(m_results);
+
+            for (auto &result: m_delivering) {
+                Requester &state = m_requesters[result.m_requester];
+                if (result.m_generation != state.m_generation || !state.m_outstanding) {
+                    result.m_requester = -1;
+                    continue;
+                }
+                state.m_outstanding = false;
+                ++m_stats.m_delivered;
+                RecordLatency(result.m_completed - result.m_submitted);
+            }
+            PACMAN_TRACE_COUNTER("Path queue", static_cast<std::int64_t>(m_queuedRequests));
+        }
+
+        for (const auto &result: m_delivering) {
+            if (result.m_requester >= 0) handler(result.m_requester, result.m_cells);
+        }
+        m_delivering.clear();
+    }
+
+    /**
+     * @brief Дожидается завершения всех поисков, уже взятых в работу или стоящих в очереди.
+     */
+    void Wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_inFlight == 0; });
+    }
+
+    /**
+     * @brief Запросы, еще не взятые потоками; дешевле GetStats для опроса каждый тик.
+     */
+    std::size_t GetQueueDepth() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queuedRequests;
+    }
+
+    PathServiceStats GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        PathServiceStats stats = m_stats;
+        stats.m_queueDepth = m_queuedRequests;
+
+        std::vector<std::int64_t> latencies(m_latencies.begin(), m_latencies.begin() + m_latencyCount);
+        if (!latencies.empty()) {
+            std::sort(latencies.begin(), latencies.end());
+            stats.m_latencyP50 = std::chrono::microseconds(latencies[latencies.size() / 2]);
+            stats.m_latencyP99 = std::chrono::microseconds(latencies[latencies.size() * 99 / 100]);
+            stats.m_latencyMax = std::chrono::microseconds(latencies.back());
+        }
+        return stats;
+    }
+
+private:
+    static constexpr std::size_t k_latencySamples = 1024; ///< Окно задержек для процентилей.
+    static constexpr std::size_t k_membersPerBatch = 16; ///< Начальная емкость буфера участников поиска.
+    static constexpr std::uint32_t k_noParent = UINT32_MAX;
+
+    /**
+     * @brief Запрос одного заказчика внутри поиска.
+     */
+    struct Member {
+        int m_requester;
+        std::uint64_t m_generation;
+        std::uint32_t m_start;
+        Clock::time_point m_submitted;
+    };
+
+    /**
+     * @brief Поиск от одной цели, обслуживающий все запросы к ней.
+     */
+    struct Batch {
+        std::uint32_t m_goal;
+        std::vector<Member> m_members;
+    };
+
+    struct Result {
+        int m_requester;
+        std::uint64_t m_generation;
+        std::vector<std::uint32_t> m_cells;
+        Clock::time_point m_submitted;
+        Clock::time_point m_completed;
+    };
+
+    struct Requester {
+        std::uint64_t m_generation = 0; ///< Номер последнего запроса.
+        bool m_outstanding = false; ///< Последний запрос еще не выдан и не отменен.
+    };
+
+    /**
+     * @brief Рабочие массивы поиска, свои у каждого потока.
+     */
+    struct Scratch {
+        std::vector<std::uint32_t> m_parent; ///< Следующая клетка на пути к цели.
+        std::vector<std::uint32_t> m_visited; ///< Номер поиска, посетившего клетку.
+        std::vector<std::uint32_t> m_start; ///< Номер поиска, для которого клетка - начало запроса.
+        std::vector<std::uint32_t> m_frontier;
+        std::uint32_t m_search = 0;
+    };
+
+    const int m_columns;
+    const int m_rows;
+    std::vector<char> m_walkable; ///< Клетка не является стеной.
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_idle;
+    std::vector<Batch> m_batches; ///< Поиски, еще не взятые потоками, в порядке поступления.
+    std::vector<std::vector<Member>> m_spareMembers; ///< Освободившиеся буферы участников поиска.
+    std::vector<Result> m_results; ///< Готовые результаты до следующей выдачи.
+    std::vector<Result> m_delivering;
+    std::vector<Requester> m_requesters;
+    std::size_t m_inFlight = 0; ///< Поисков в очереди и в работе.
+    std::size_t m_queuedRequests = 0;
+    bool m_stopping = false;
+    bool m_waitAtBoundary = true;
+
+    PathServiceStats m_stats;
+    std::vector<std::int64_t> m_latencies = std::vector<std::int64_t>(k_latencySamples); ///< Кольцо последних задержек.
+    std::size_t m_latencyCount = 0;
+    std::size_t m_latencyNext = 0;
+
+    std::vector<std::thread> m_workers;
+
+    std::uint32_t ToIndex(const sf::Vector2i cell) const {
+        return static_cast<std::uint32_t>(cell.y) * m_columns + static_cast<std::uint32_t>(cell.x);
+    }
+
+    void RecordLatency(const Clock::duration latency) {
+        m_latencies[m_latencyNext] = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        m_latencyNext = (m_latencyNext + 1) % k_latencySamples;
+        m_latencyCount = std::min(m_latencyCount + 1, k_latencySamples);
+    }
+
+    void WorkerLoop() {
+        Scratch scratch;
+        scratch.m_parent.resize(m_walkable.size());
+        scratch.m_visited.assign(m_walkable.size(), 0);
+        scratch.m_start.assign(m_walkable.size(), 0);
+        scratch.m_frontier.resize(m_walkable.size());
+        std::vector<Result> results;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_workAvailable.wait(lock, [this] { return m_stopping || !m_batches.empty(); });
+            if (m_stopping) return;
+
+            Batch batch = std::move(m_batches.front());
+            m_batches.erase(m_batches.begin());
+            m_queuedRequests -= batch.m_members.size();
+
+            // Отмененные запросы не ищем
+            batch.m_members.erase(std::remove_if(batch.m_members.begin(), batch.m_members.end(),
+                                                 [this](const Member &member) {
+                                                     return member.m_generation !=
+                                                            m_requesters[member.m_requester].m_generation;
+                                                 }),
+                                  batch.m_members.end());
+
+            lock.unlock();
+            if (!batch.m_members.empty()) Search(scratch, batch, results);
+            lock.lock();
+
+            for (auto &result: results) m_results.push_back(std::move(result));
+            results.clear();
+            batch.m_members.clear();
+            m_spareMembers.push_back(std::move(batch.m_members));
+            --m_inFlight;
+            if (m_inFlight == 0) m_idle.notify_all();
+        }
+    }
+
+    /**
+     * @brief Поиск в ширину от цели (nav::search_from_goal), пока не найдены все начальные клетки запросов.
+     *
+     * Все переходы стоят одинаково, поэтому пути кратчайшие, как и у A* призрака.
+     */
+    void Search(Scratch &scratch, const Batch &batch, std::vector<Result> &results) const {
+        trace::Span span("Path search");
+        span.SetArg("requests", static_cast<std::int64_t>(batch.m_members.size()));
+
+        const std::uint32_t stamp = ++scratch.m_search;
+        auto found = [&](const Member &member) { return scratch.m_visited[member.m_start] == stamp; };
+        auto walkable = [this](const std::size_t cell) { return m_walkable[cell] != 0; };
+
+        // Разные начальные клетки, еще не достигнутые поиском
+        std::size_t unresolved = 0;
+        for (const auto &member: batch.m_members) {
+            if (scratch.m_start[member.m_start] == stamp) continue;
+            scratch.m_start[member.m_start] = stamp;
+            ++unresolved;
+        }
+
+        std::size_t head = 0;
+        if (walkable(batch.m_goal)) {
+            scratch.m_visited[batch.m_goal] = stamp;
+            if (scratch.m_start[batch.m_goal] == stamp) --unresolved;
+            scratch.m_parent[batch.m_goal] = k_noParent;
+            head = nav::search_from_goal(
+                    batch.m_goal, m_columns, scratch.m_frontier.data(),
+                    [&](const std::uint32_t cell) { return nav::exit_mask(cell, m_columns, m_rows, walkable); },
+                    [&](const std::uint32_t neighbour, const std::uint32_t cell, eDirection) {
+                        if (scratch.m_visited[neighbour] == stamp) return false;
+                        scratch.m_visited[neighbour] = stamp;
+                        scratch.m_parent[neighbour] = cell;
+                        if (scratch.m_start[neighbour] == stamp) --unresolved;
+                        return true;
+                    },
+                    [&](std::size_t) { return unresolved != 0; });
+        }
+        span.SetArg("nodes", static_cast<std::int64_t>(head));
+
+        const Clock::time_point completed = Clock::now();
+        for (const auto &member: batch.m_members) {
+            results.push_back({member.m_requester, member.m_generation, {}, member.m_submitted, completed});
+            if (!found(member)) continue;
+
+            for (std::uint32_t cell = member.m_start; cell != k_noParent; cell = scratch.m_parent[cell]) {
+                results.back().m_cells.push_back(cell);
+            }
+        }
+    }
+};
@@ -0,0 +1,229 @@
+/**
+ * @file Profiler.h
+ * @brief Встроенный профилировщик областей кода.
+ *
+ * Области размечаются макросами PACMAN_PROFILE_SCOPE. Каждый поток пишет замеры в собственные
+ * кольцевые буферы фиксированного размера, а чтение (оверлей) агрегирует их по всем потокам.
+ * Без определения PACMAN_ENABLE_PROFILER (релизные сборки) макросы раскрываются в пустоту.
+ */
+
+#pragma once
+
+#if defined(PACMAN_ENABLE_PROFILER)
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace prof
+{
+    constexpr int k_maxRegions = 64; ///< Максимальное количество размеченных областей.
+    constexpr std::size_t k_ringSize = 512; ///< Количество последних замеров, хранимых на поток и область.
+    constexpr int k_histogramBuckets = 16; ///< Корзины гистограммы: [2^(k+10), 2^(k+11)) наносекунд.
+
+    /**
+     * @brief Агрегированная статистика области по всем потокам.
+     */
+    struct RegionStats
+    {
+        const char* m_name = nullptr; ///< Имя области.
+        std::size_t m_samples = 0; ///< Количество учтенных замеров.
+        std::uint32_t m_p50 = 0; ///< Медиана, нс.
+        std::uint32_t m_p99 = 0; ///< 99-й перцентиль, нс.
+        std::array<std::uint32_t, k_histogramBuckets> m_histogram{}; ///< Логарифмическая гистограмма.
+    };
+
+    /**
+     * @brief Реестр областей и буферов замеров всех потоков.
+     */
+    class Profiler
+    {
+    public:
+        static Profiler& Instance()
+        {
+            static Profiler profiler;
+            return profiler;
+        }
+
+        /**
+         * @brief Возвращает идентификатор области, регистрируя ее при первом обращении.
+         *
+         * Поиск идет без блокировки: сначала по указателю на строку, затем по содержимому.
+         *
+         * @param name Имя области (строка со статическим временем жизни).
+         * @return Идентификатор области или -1, если реестр переполнен.
+         */
+        int FindOrRegister(const char* name)
+        {
+            const int count = m_regionCount.load(std::memory_order_acquire);
+            for (int i = 0; i < count; ++i)
+            {
+                const char* registered = m_regionNames[i].load(std::memory_order_relaxed);
+                if (registered == name || std::strcmp(registered, name) == 0) return i;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const int lockedCount = m_regionCount.load(std::memory_order_relaxed);
+            for (int i = count; i < lockedCount; ++i)
+            {
+                if (std::strcmp(m_regionNames[i].load(std::memory_order_relaxed), name) == 0) return i;
+            }
+            if (lockedCount == k_maxRegions) return -1;
+
+            m_regionNames[lockedCount].store(name, std::memory_order_relaxed);
+            m_regionCount.store(lockedCount + 1, std::memory_order_release);
+            return lockedCount;
+        }
+
+        /**
+         * @brief Записывает замер в кольцевой буфер текущего потока.
+         * @param region Идентификатор области.
+         * @param nanoseconds Длительность, нс.
+         */
+        void Record(const int region, const std::uint32_t nanoseconds)
+        {
+            if (region < 0) return;
+
+            thread_local ThreadBuffer* buffer = RegisterThread();
+            Ring& ring = buffer->m_rings[region];
+            const std::uint32_t index = ring.m_written.load(std::memory_order_relaxed);
+            ring.m_samples[index % k_ringSize].store(nanoseconds, std::memory_order_relaxed);
+            ring.m_written.store(index + 1, std::memory_order_release);
+        }
+
+        int GetRegionCount() const
+        {
+            return m_regionCount.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Собирает статистику области по последним замерам всех потоков.
+         * @param region Идентификатор области.
+         * @param scratch Временный буфер (переиспользуется между вызовами).
+         */
+        RegionStats GetStats(const int region, std::vector<std::uint32_t>& scratch)
+        {
+            RegionStats stats;
+            stats.m_name = m_regionNames[region].load(std::memory_order_relaxed);
+
+            scratch.clear();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (const auto& buffer : m_threads)
+                {
+                    const Ring& ring = buffer->m_rings[region];
+                    const std::uint32_t written = ring.m_written.load(std::memory_order_acquire);
+                    const std::uint32_t available = written < k_ringSize ? written : k_ringSize;
+                    for (std::uint32_t i = 0; i < available; ++i)
+                    {
+                        scratch.push_back(ring.m_samples[i].load(std::memory_order_relaxed));
+                    }
+                }
+            }
+
+            stats.m_samples = scratch.size();
+            if (scratch.empty()) return stats;
+
+            for (const auto sample : scratch)
+            {
+                int bucket = 0;
+                for (std::uint32_t value = sample >> 10; value > 1 && bucket < k_histogramBuckets - 1; value >>= 1)
+                {
+                    ++bucket;
+                }
+                ++stats.m_histogram[bucket];
+            }
+
+            auto percentile = [&scratch](const std::size_t permille) {
+                const auto nth = scratch.begin() + static_cast<std::ptrdiff_t>((scratch.size() - 1) * permille / 1000);
+                std::nth_element(scratch.begin(), nth, scratch.end());
+                return *nth;
+            };
+            stats.m_p50 = percentile(500);
+            stats.m_p99 = percentile(990);
+            return stats;
+        }
+
+    private:
+        struct Ring
+        {
+            std::array<std::atomic<std::uint32_t>, k_ringSize> m_samples{};
+            std::atomic<std::uint32_t> m_written{0};
+        };
+
+        struct ThreadBuffer
+        {
+            std::array<Ring, k_maxRegions> m_rings{};
+        };
+
+        std::array<std::atomic<const char*>, k_maxRegions> m_regionNames{};
+        std::atomic<int> m_regionCount{0};
+
+        std::mutex m_mutex;
+        // Буферы живут до конца процесса, чтобы чтение было безопасным и после завершения потока
+        std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+
+        Profiler() = default;
+
+        ThreadBuffer* RegisterThread()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_threads.emplace_back(std::make_unique<ThreadBuffer>());
+            return m_threads.back().get();
+        }
+    };
+
+    /**
+     * @brief Замеряет время жизни объекта и записывает его в профилировщик.
+     */
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(const int region) :
+                m_region(region),
+                m_start(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~ScopedTimer()
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - m_start;
+            const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            Profiler::Instance().Record(m_region,
+                                        nanoseconds > UINT32_MAX ? UINT32_MAX : static_cast<std::uint32_t>(nanoseconds));
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        int m_region;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
+
+#define PACMAN_PROFILE_CONCAT_IMPL(a, b) a##b
+#define PACMAN_PROFILE_CONCAT(a, b) PACMAN_PROFILE_CONCAT_IMPL(a, b)
+
+/// Замеряет область до конца текущего блока. name должен быть строковым литералом.
+#define PACMAN_PROFILE_SCOPE(name) \
+    static const int PACMAN_PROFILE_CONCAT(profileRegion_, __LINE__) = \
+            prof::Profiler::Instance().FindOrRegister(name); \
+    const prof::ScopedTimer PACMAN_PROFILE_CONCAT(profileTimer_, __LINE__)(PACMAN_PROFILE_CONCAT(profileRegion_, __LINE__))
+
+/// Замеряет область, имя которой выбирается во время выполнения (например, по типу призрака).
+#define PACMAN_PROFILE_SCOPE_DYNAMIC(name) \
+    const prof::ScopedTimer PACMAN_PROFILE_CONCAT(profileTimer_, __LINE__)(prof::Profiler::Instance().FindOrRegister(name))
+
+#else
+
+#define PACMAN_PROFILE_SCOPE(name) ((void)0)
+#define PACMAN_PROFILE_SCOPE_DYNAMIC(name) ((void)0)
+
+#endif
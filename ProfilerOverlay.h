@@ -0,0 +1,137 @@
+/**
+ * @file ProfilerOverlay.h
+ * @brief Определение класса ProfilerOverlay.
+ *
+ * Оверлей поверх игры показывает p50/p99 и гистограмму задержек каждой области профилировщика,
+ * а также частоту кадров. В сборках без PACMAN_ENABLE_PROFILER класс пустой.
+ */
+
+#pragma once
+
+#include <SFML/Graphics/RenderWindow.hpp>
+
+#include "Profiler.h"
+#include "np.h"
+
+#if defined(PACMAN_ENABLE_PROFILER)
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/Text.hpp>
+#include <SFML/System/Clock.hpp>
+
+/**
+ * @class ProfilerOverlay
+ * @brief Отрисовка статистики профилировщика в окне.
+ */
+class ProfilerOverlay
+{
+public:
+    ProfilerOverlay()
+    {
+        m_font.loadFromFile(cnp::font_path());
+    }
+
+    /**
+     * @brief Включает или выключает отображение оверлея.
+     */
+    void Toggle()
+    {
+        m_visible = !m_visible;
+    }
+
+    /**
+     * @brief Отмечает конец кадра для подсчета FPS.
+     */
+    void FrameFinished()
+    {
+        ++m_frames;
+        if (m_fpsClock.getElapsedTime().asSeconds() >= 1.f)
+        {
+            m_fps = m_frames;
+            m_frames = 0;
+            m_fpsClock.restart();
+        }
+    }
+
+    void Render(sf::RenderWindow& window)
+    {
+        if (!m_visible) return;
+
+        auto& profiler = prof::Profiler::Instance();
+        const int regionCount = profiler.GetRegionCount();
+
+        sf::RectangleShape background({ 800.f, static_cast<float>((regionCount + 2) * k_lineHeight) });
+        background.setFillColor({ 0, 0, 0, 180 });
+        window.draw(background);
+
+        char line[128];
+        std::snprintf(line, sizeof(line), "FPS: %u", m_fps);
+        DrawLine(window, line, 0);
+
+        for (int region = 0; region < regionCount; ++region)
+        {
+            const prof::RegionStats stats = profiler.GetStats(region, m_scratch);
+            std::snprintf(line, sizeof(line), "%-28s p50 %8.1fus  p99 %8.1fus",
+                          stats.m_name, stats.m_p50 / 1000.0, stats.m_p99 / 1000.0);
+            DrawLine(window, line, region + 1);
+            DrawHistogram(window, stats, region + 1);
+        }
+    }
+
+private:
+    static constexpr int k_lineHeight = 16;
+    static constexpr float k_histogramLeft = 560.f;
+    static constexpr float k_barWidth = 14.f;
+
+    sf::Font m_font;
+    sf::Text m_text;
+    sf::RectangleShape m_bar;
+    std::vector<std::uint32_t> m_scratch;
+    bool m_visible = true;
+
+    sf::Clock m_fpsClock;
+    unsigned m_frames = 0;
+    unsigned m_fps = 0;
+
+    void DrawLine(sf::RenderWindow& window, const std::string& string, const int line)
+    {
+        m_text.setFont(m_font);
+        m_text.setCharacterSize(k_lineHeight - 4);
+        m_text.setFillColor(sf::Color::White);
+        m_text.setString(string);
+        m_text.setPosition({ 4.f, static_cast<float>(line * k_lineHeight) });
+        window.draw(m_text);
+    }
+
+    void DrawHistogram(sf::RenderWindow& window, const prof::RegionStats& stats, const int line)
+    {
+        std::uint32_t tallest = 1;
+        for (const auto count : stats.m_histogram) tallest = count > tallest ? count : tallest;
+
+        const float baseline = static_cast<float>((line + 1) * k_lineHeight - 2);
+        for (int bucket = 0; bucket < prof::k_histogramBuckets; ++bucket)
+        {
+            const float height = static_cast<float>(k_lineHeight - 4) * stats.m_histogram[bucket] / tallest;
+            m_bar.setSize({ k_barWidth - 2.f, height });
+            m_bar.setPosition({ k_histogramLeft + bucket * k_barWidth, baseline - height });
+            m_bar.setFillColor({ 255, 255, 71 });
+            window.draw(m_bar);
+        }
+    }
+};
+
+#else
+
+class ProfilerOverlay
+{
+public:
+    void Toggle() {}
+    void FrameFinished() {}
+    void Render(sf::RenderWindow&) {}
+};
+
+#endif
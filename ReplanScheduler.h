@@ -0,0 +1,150 @@
+/**
+ * @file ReplanScheduler.h
+ * @brief Планировщик обновления путей призраков с бюджетом на тик.
+ *
+ * Призраки обновляют пути раз в cnp::k_ghostReplanInterval тиков, но со сдвигом фазы,
+ * чтобы обновления разных призраков приходились на разные тики. За один тик поиск A*
+ * раскрывает не больше заданного числа узлов и (или) работает не дольше заданного времени;
+ * незавершенный поиск продолжается на следующем тике, а призрак тем временем идет по старому пути.
+ * Незавершенные поиски обслуживаются по кругу, поэтому длинный поиск не задерживает остальных.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Profiler.h"
+#include "Tracer.h"
+#include "np.h"
+
+/**
+ * @struct ReplanBudget
+ * @brief Ограничения на поиск путей за один тик (0 - без ограничения).
+ */
+struct ReplanBudget {
+    int m_nodes = cnp::k_replanNodeBudget; /**< Узлов A*, раскрываемых за тик. */
+    std::chrono::microseconds m_time{0}; /**< Время поиска за тик. */
+};
+
+/**
+ * @class ReplanScheduler
+ * @brief Распределяет обновления путей призраков по тикам.
+ */
+class ReplanScheduler {
+public:
+    explicit ReplanScheduler(const int replanInterval = cnp::k_ghostReplanInterval, const ReplanBudget budget = {}) :
+            m_interval(std::max(1, replanInterval)),
+            m_budget(budget) {
+    }
+
+    void SetBudget(const ReplanBudget budget) {
+        m_budget = budget;
+    }
+
+    /**
+     * @brief Включает сдвиг фаз. Без него все призраки обновляют пути на одном тике.
+     */
+    void SetStaggered(const bool staggered) {
+        m_staggered = staggered;
+    }
+
+    /**
+     * @brief Ставит в очередь призраков, которым пора обновить путь, и обслуживает очередь в пределах бюджета.
+     * @param ghosts Призраки (объекты с методами Replan, IsReplanning, NeedsPath и IsWaitingAtHome).
+     */
+    template<typename Ghosts>
+    void Tick(Ghosts &ghosts) {
+        PACMAN_PROFILE_SCOPE("Ghost replans");
+        PACMAN_TRACE_SCOPE("Ghost replans");
+
+        const std::size_t count = ghosts.size();
+        if (m_queued.size() != count) {
+            // Каждый призрак стоит в очереди не больше одного раза: кольца на count мест хватает
+            m_queued.assign(count, false);
+            m_queue.assign(count, 0);
+            m_queueHead = 0;
+            m_queueSize = 0;
+        }
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (m_queued[i] || ghosts[i].IsWaitingAtHome()) continue;
+
+            const std::uint64_t phase = m_staggered ? i * m_interval / count : 0;
+            if ((m_tick + phase) % m_interval == 0 || ghosts[i].NeedsPath()) {
+                PushBack(i);
+                m_queued[i] = true;
+            }
+        }
+        ++m_tick;
+
+        const auto start = std::chrono::steady_clock::now();
+        auto timeLeft = [&] {
+            return m_budget.m_time.count() == 0 || std::chrono::steady_clock::now() - start < m_budget.m_time;
+        };
+
+        m_lastTickNodes = 0;
+        while (m_queueSize > 0 && timeLeft()) {
+            const int nodesLeft = m_budget.m_nodes > 0 ? m_budget.m_nodes - m_lastTickNodes
+                                                       : std::numeric_limits<int>::max();
+            if (nodesLeft <= 0) break;
+
+            const std::size_t ghost = PopFront();
+            // С ограничением по времени поиск идет небольшими порциями между проверками часов
+            const int slice = m_budget.m_time.count() > 0 ? std::min(nodesLeft, k_timeSliceNodes) : nodesLeft;
+            m_lastTickNodes += ghosts[ghost].Replan(slice);
+
+            if (ghosts[ghost].IsReplanning()) {
+                // Незавершенный поиск уходит в конец очереди
+                PushBack(ghost);
+            } else {
+                m_queued[ghost] = false;
+            }
+        }
+
+        PACMAN_TRACE_COUNTER("Replan queue", static_cast<std::int64_t>(m_queueSize));
+        PACMAN_TRACE_COUNTER("Replan nodes", m_lastTickNodes);
+    }
+
+    /**
+     * @brief Количество узлов A*, раскрытых на последнем тике.
+     */
+    int GetLastTickNodes() const {
+        return m_lastTickNodes;
+    }
+
+    /**
+     * @brief Количество призраков, ждущих обновления пути.
+     */
+    std::size_t GetPendingCount() const {
+        return m_queueSize;
+    }
+
+private:
+    static constexpr int k_timeSliceNodes = 64; ///< Порция узлов между проверками времени.
+
+    int m_interval; ///< Период обновления пути одного призрака, в тиках.
+    ReplanBudget m_budget;
+    bool m_staggered = true;
+    std::uint64_t m_tick = 0;
+    std::vector<std::size_t> m_queue; ///< Кольцо индексов призраков в порядке обслуживания.
+    std::size_t m_queueHead = 0;
+    std::size_t m_queueSize = 0;
+    std::vector<bool> m_queued;
+    int m_lastTickNodes = 0;
+
+    void PushBack(const std::size_t ghost) {
+        m_queue[(m_queueHead + m_queueSize) % m_queue.size()] = ghost;
+        ++m_queueSize;
+    }
+
+    std::size_t PopFront() {
+        const std::size_t ghost = m_queue[m_queueHead];
+        m_queueHead = (m_queueHead + 1) % m_queue.size();
+        --m_queueSize;
+        return ghost;
+    }
+};
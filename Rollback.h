@@ -0,0 +1,327 @@
+/**
+ * @file Rollback.h
+ * @brief Откат и повторная симуляция тиков: сетевая игра без ожидания ввода удаленных игроков.
+ *
+ * RollbackGame продвигает игру каждый тик, не дожидаясь ввода удаленных игроков: недостающий ввод
+ * предсказывается повтором последнего известного направления игрока. Перед каждым тиком игра сохраняется
+ * в кольцо снимков (Game::Snapshot). Когда опоздавший ввод расходится с предсказанным, игра возвращается
+ * к снимку тика этого ввода и заново симулирует тики до текущего - в том же кадре, не глубже окна отката.
+ *
+ * Ввод игрока на тик - нажатое направление (e_None - ничего не нажато). Он применяется через
+ * PacMan::SetDirection, как клавиатура в Game::Input.
+ *
+ * LatencyTransport доставляет ввод локально с задержкой и разбросом в тиках: откат проверяется без сети.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Game.h"
+#include "Metrics.h"
+#include "np.h"
+
+/**
+ * @brief Ввод одного игрока на один тик.
+ */
+struct TickInput
+{
+    std::uint32_t m_tick = 0;
+    std::uint8_t m_player = 0; ///< Номер Пакмана.
+    eDirection m_direction = eDirection::e_None;
+};
+
+/**
+ * @brief Счетчики отката одной игры.
+ */
+struct RollbackStats
+{
+    std::uint64_t m_ticks = 0; ///< Тиков продвинуто (без повторных).
+    std::uint64_t m_rollbacks = 0; ///< Откатов к более раннему тику.
+    std::uint64_t m_resimulatedTicks = 0; ///< Тиков симулировано повторно.
+    std::uint32_t m_maxRollbackTicks = 0; ///< Самый глубокий откат.
+    std::uint64_t m_lateInputs = 0; ///< Ввод старше окна отката: игры участников разошлись.
+};
+
+/**
+ * @class RollbackGame
+ * @brief Игра с предсказанием ввода и откатом на окно из нескольких тиков.
+ */
+class RollbackGame
+{
+public:
+    static constexpr int k_defaultWindow = 8; ///< Тиков, которые можно переиграть за один кадр.
+    static constexpr std::uint32_t k_inputHistory = 64; ///< Тиков ввода в кольце: окно отката и ввод наперед.
+
+    /**
+     * @brief Переводит игру в режим отката: поиск путей синхронный и без бюджета, навигация собрана.
+     *
+     * Зерно и фиксированный шаг тика (Game::SetSeed, Game::SetFixedTickSeconds) у всех участников
+     * должны совпадать, а игра - еще не начата.
+     * @param game Игра; живет дольше RollbackGame.
+     * @param window Глубина отката в тиках (1..k_inputHistory / 2).
+     */
+    explicit RollbackGame(Game& game, const int window = k_defaultWindow):
+            m_game(game),
+            m_window(static_cast<std::uint32_t>(std::clamp(window, 1, static_cast<int>(k_inputHistory / 2)))),
+            m_players(game.GetPacManCount()),
+            m_snapshots(m_window),
+            m_frameTicks(k_inputHistory, std::numeric_limits<std::uint32_t>::max()),
+            m_inputs(k_inputHistory * m_players, eDirection::e_None),
+            m_used(k_inputHistory * m_players, eDirection::e_None),
+            m_confirmed(k_inputHistory * m_players, 0),
+            m_settled(m_players, eDirection::e_None)
+    {
+        // Поиск, растянутый на несколько тиков, или путь из потока не попали бы в снимок
+        m_game.SetPathThreads(0);
+        m_game.GetReplanScheduler().SetBudget({ 0, {} });
+        m_game.WaitForNavigation();
+    }
+
+    RollbackGame(const RollbackGame&) = delete;
+    RollbackGame& operator=(const RollbackGame&) = delete;
+
+    Game& GetGame(){
+        return m_game;
+    }
+
+    /**
+     * @brief Номер следующего тика симуляции (количество продвинутых тиков).
+     */
+    std::uint32_t GetTick() const {
+        return m_tick;
+    }
+
+    /**
+     * @brief Тики до этого номера симулированы с настоящим вводом всех игроков и больше не изменятся.
+     */
+    std::uint32_t GetConfirmedTick() const {
+        return m_confirmedTick;
+    }
+
+    const RollbackStats& GetStats() const {
+        return m_stats;
+    }
+
+    /**
+     * @brief Принимает ввод игрока: свой на текущий тик или удаленный, в том числе на уже симулированный тик.
+     *
+     * Расхождение с предсказанием исправляется откатом в следующем Advance или Resimulate.
+     * @return false, если тик уже вышел из окна отката (или слишком далеко впереди) и ввод отброшен.
+     */
+    bool AddInput(const TickInput& input){
+        if (input.m_player >= m_players) return false;
+        if (input.m_tick < GetWindowStart() || input.m_tick >= GetWindowStart() + k_inputHistory)
+        {
+            ++m_stats.m_lateInputs;
+            return false;
+        }
+
+        const std::size_t slot = Touch(input.m_tick) * m_players + input.m_player;
+        m_inputs[slot] = input.m_direction;
+        m_confirmed[slot] = 1;
+        return true;
+    }
+
+    /**
+     * @brief Симулирует следующий тик; сначала переигрывает тики, ввод которых разошелся с предсказанием.
+     */
+    void Advance(){
+        Resimulate();
+        Simulate(m_tick);
+        ++m_tick;
+        ++m_stats.m_ticks;
+
+        // Тик, вышедший из окна, больше не переигрывается: его ввод продолжает предсказание
+        if (m_tick > m_window)
+        {
+            const std::size_t slot = static_cast<std::size_t>((m_tick - m_window - 1) % k_inputHistory) * m_players;
+            std::copy(m_used.begin() + slot, m_used.begin() + slot + m_players, m_settled.begin());
+        }
+    }
+
+    /**
+     * @brief Переигрывает с самого раннего тика окна, ввод которого изменился с прошлой симуляции.
+     *
+     * Advance вызывает его сам; отдельно нужен, чтобы применить последний ввод, не начиная новый тик.
+     * @return Количество переигранных тиков (0 - предсказание подтвердилось).
+     */
+    std::uint32_t Resimulate(){
+        std::uint32_t from = m_tick;
+        for (std::uint32_t tick = GetWindowStart(); tick < m_tick && from == m_tick; ++tick)
+        {
+            const std::size_t slot = static_cast<std::size_t>(tick % k_inputHistory) * m_players;
+            for (std::size_t player = 0; player < m_players; ++player)
+            {
+                if (Resolve(player, tick) != m_used[slot + player])
+                {
+                    from = tick;
+                    break;
+                }
+            }
+        }
+        // Ввод тиков до m_confirmedTick уже весь получен, и они симулированы с ним
+        while (m_confirmedTick < m_tick && IsConfirmed(m_confirmedTick))
+        {
+            ++m_confirmedTick;
+        }
+        if (from == m_tick) return 0;
+
+        m_game.Restore(m_snapshots[from % m_window]);
+        for (std::uint32_t tick = from; tick < m_tick; ++tick)
+        {
+            Simulate(tick);
+        }
+
+        const std::uint32_t depth = m_tick - from;
+        ++m_stats.m_rollbacks;
+        m_stats.m_resimulatedTicks += depth;
+        m_stats.m_maxRollbackTicks = std::max(m_stats.m_maxRollbackTicks, depth);
+        metrics::GameMetrics& gameMetrics = metrics::GameMetrics::Instance();
+        gameMetrics.m_rollbacks.Add();
+        gameMetrics.m_rollbackTicks.Observe(depth);
+        return depth;
+    }
+
+private:
+    Game& m_game;
+    std::uint32_t m_window; ///< Глубина отката, в тиках.
+    std::size_t m_players;
+    std::uint32_t m_tick = 0;
+    std::uint32_t m_confirmedTick = 0;
+    RollbackStats m_stats;
+
+    // Снимок игры перед тиком t лежит в m_snapshots[t % m_window]
+    std::vector<Game::Snapshot> m_snapshots;
+
+    // Кольцо ввода: тик t занимает строку t % k_inputHistory, по столбцу на игрока
+    std::vector<std::uint32_t> m_frameTicks; ///< Тик, которому принадлежит строка.
+    std::vector<eDirection> m_inputs; ///< Полученный ввод.
+    std::vector<eDirection> m_used; ///< Ввод, с которым тик симулирован в последний раз.
+    std::vector<std::uint8_t> m_confirmed; ///< Ввод получен.
+    std::vector<eDirection> m_settled; ///< Ввод последнего тика, вышедшего из окна отката.
+
+    std::uint32_t GetWindowStart() const {
+        return m_tick > m_window ? m_tick - m_window : 0;
+    }
+
+    /**
+     * @brief Строка кольца ввода для тика; строка прошлого тика очищается.
+     */
+    std::size_t Touch(const std::uint32_t tick){
+        const std::size_t row = tick % k_inputHistory;
+        if (m_frameTicks[row] != tick)
+        {
+            m_frameTicks[row] = tick;
+            std::fill(m_confirmed.begin() + row * m_players, m_confirmed.begin() + (row + 1) * m_players,
+                      std::uint8_t{ 0 });
+        }
+        return row;
+    }
+
+    bool IsConfirmed(const std::uint32_t tick) const {
+        const std::size_t row = tick % k_inputHistory;
+        if (m_frameTicks[row] != tick) return false;
+        return std::all_of(m_confirmed.begin() + row * m_players, m_confirmed.begin() + (row + 1) * m_players,
+                           [](const std::uint8_t confirmed) { return confirmed != 0; });
+    }
+
+    /**
+     * @brief Ввод игрока на тик окна: полученный или предсказанный повтором последнего известного.
+     */
+    eDirection Resolve(const std::size_t player, const std::uint32_t tick) const {
+        for (std::uint32_t known = tick + 1; known-- > GetWindowStart();)
+        {
+            const std::size_t row = known % k_inputHistory;
+            if (m_frameTicks[row] == known && m_confirmed[row * m_players + player])
+            {
+                return m_inputs[row * m_players + player];
+            }
+        }
+        return m_settled[player];
+    }
+
+    void Simulate(const std::uint32_t tick){
+        m_game.Save(m_snapshots[tick % m_window]);
+
+        const std::size_t slot = Touch(tick) * m_players;
+        for (std::size_t player = 0; player < m_players; ++player)
+        {
+            const eDirection direction = Resolve(player, tick);
+            m_used[slot + player] = direction;
+            if (direction != eDirection::e_None) m_game.GetPacMan(player).SetDirection(direction);
+        }
+        m_game.Update();
+    }
+};
+
+/**
+ * @class LatencyTransport
+ * @brief Доставка ввода в одну сторону с задержкой и разбросом, измеренными в тиках.
+ *
+ * Время - номер тика отправителя; с разбросом сообщения приходят не по порядку.
+ */
+class LatencyTransport
+{
+public:
+    /**
+     * @param latencyTicks Задержка доставки.
+     * @param jitterTicks Дополнительная случайная задержка 0..jitterTicks.
+     * @param seed Зерно разброса.
+     */
+    LatencyTransport(const int latencyTicks, const int jitterTicks, const std::uint64_t seed):
+            m_latency(static_cast<std::uint32_t>(std::max(0, latencyTicks))),
+            m_jitter(std::max(0, jitterTicks)),
+            m_random(seed)
+    {
+        m_inFlight.reserve(k_initialCapacity);
+    }
+
+    void Send(const TickInput& input, const std::uint32_t now){
+        const std::uint32_t jitter = m_jitter > 0 ? static_cast<std::uint32_t>(m_random.NextInt(m_jitter + 1)) : 0;
+        m_inFlight.push_back({ now + m_latency + jitter, input });
+    }
+
+    /**
+     * @brief Передает получателю сообщения, срок доставки которых наступил к тику now.
+     */
+    template<typename Receive>
+    void Deliver(const std::uint32_t now, Receive&& receive){
+        std::size_t kept = 0;
+        for (const Message& message : m_inFlight)
+        {
+            if (message.m_due <= now) receive(message.m_input);
+            else m_inFlight[kept++] = message;
+        }
+        m_inFlight.resize(kept);
+    }
+
+    /**
+     * @brief Доставляет все сообщения в пути.
+     */
+    template<typename Receive>
+    void Flush(Receive&& receive){
+        Deliver(std::numeric_limits<std::uint32_t>::max(), receive);
+    }
+
+    std::size_t GetInFlight() const {
+        return m_inFlight.size();
+    }
+
+private:
+    static constexpr std::size_t k_initialCapacity = 64;
+
+    struct Message
+    {
+        std::uint32_t m_due;
+        TickInput m_input;
+    };
+
+    std::uint32_t m_latency;
+    int m_jitter;
+    hnp::SplitMix64 m_random;
+    std::vector<Message> m_inFlight;
+};
@@ -0,0 +1,164 @@
+/**
+ * @file StateHash.h
+ * @brief Хэш Зобриста состояния игры.
+ *
+ * Каждый признак состояния (позиция сущности, ее направление, состояние, таймер, очки и жизни
+ * Пакмана, видимые предметы) вносит в хэш свой 64-битный ключ через XOR. Изменение признака
+ * обновляет хэш за O(1): ключ старого значения вычитается, ключ нового добавляется тем же XOR.
+ * Равные состояния дают равные хэши независимо от пути к ним, поэтому хэш годится для таблиц
+ * транспозиций ботов и для сравнения двух сборок тик за тиком.
+ *
+ * Ключи не хранятся в таблицах: ключ (признак, номер, значение) получается перемешиванием SplitMix64,
+ * одинаковым на всех платформах. Таблица клеток на каждую сущность заняла бы мегабайты на больших уровнях.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <SFML/System/Vector2.hpp>
+
+/**
+ * @enum eHashField
+ * @brief Признаки состояния, входящие в хэш.
+ */
+enum class eHashField : std::uint8_t {
+    e_Position,   ///< Позиция сущности (в пикселях, сущности стоят в клетках).
+    e_Direction,  ///< Направление движения сущности.
+    e_State,      ///< ePacManState или eGhostState.
+    e_Timer,      ///< Таймер усиления или ожидания дома.
+    e_Points,     ///< Очки Пакмана.
+    e_Lives,      ///< Жизни Пакмана.
+    e_Alive,      ///< Пакман в игре.
+    e_PickUp,     ///< Позиция видимого предмета.
+    e_PickUpType  ///< Тип видимого предмета.
+};
+
+namespace zobrist {
+    /**
+     * @brief Ключ признака field объекта slot со значением value.
+     */
+    inline std::uint64_t key(const eHashField field, const std::uint32_t slot, const std::uint64_t value) {
+        std::uint64_t z = value * 0x9E3779B97F4A7C15ull ^
+                          ((static_cast<std::uint64_t>(slot) << 8 | static_cast<std::uint8_t>(field)) + 1) *
+                          0xC2B2AE3D27D4EB4Full;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    inline std::uint64_t pack(const sf::Vector2i position) {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(position.x)) << 32 |
+               static_cast<std::uint32_t>(position.y);
+    }
+
+    /**
+     * @brief Таймеры хэшируются побитово: с фиксированным шагом тика они точно повторяются.
+     */
+    inline std::uint64_t pack(const float value) {
+        std::uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline std::uint64_t pack(const int value) {
+        return static_cast<std::uint32_t>(value);
+    }
+}
+
+/**
+ * @class StateHash
+ * @brief Инкрементально обновляемый хэш одной игры.
+ */
+class StateHash {
+public:
+    std::uint64_t GetValue() const {
+        return m_value;
+    }
+
+    /**
+     * @brief Добавляет признак в хэш или убирает его (XOR обратим).
+     */
+    void Toggle(const eHashField field, const std::uint32_t slot, const std::uint64_t value) {
+        m_value ^= zobrist::key(field, slot, value);
+    }
+
+    /**
+     * @brief Заменяет значение признака.
+     */
+    void Change(const eHashField field, const std::uint32_t slot, const std::uint64_t from, const std::uint64_t to) {
+        if (from != to) m_value ^= zobrist::key(field, slot, from) ^ zobrist::key(field, slot, to);
+    }
+
+private:
+    std::uint64_t m_value = 0;
+};
+
+/**
+ * @class HashTrace
+ * @brief Файл хэшей состояния по тикам: строка "<тик> <хэш>" на тик.
+ *
+ * Трассы двух сборок, запущенных с одним зерном и фиксированным шагом, сравниваются
+ * функцией Diff, которая находит первый тик, где состояния разошлись.
+ */
+class HashTrace {
+public:
+    bool Open(const std::string &path) {
+        m_file.open(path);
+        return static_cast<bool>(m_file);
+    }
+
+    bool IsOpen() const {
+        return m_file.is_open();
+    }
+
+    void Record(const long tick, const std::uint64_t hash) {
+        char line[48];
+        const int length = std::snprintf(line, sizeof(line), "%ld %016llx\n", tick,
+                                         static_cast<unsigned long long>(hash));
+        m_file.write(line, length);
+    }
+
+    /**
+     * @brief Сравнивает две трассы.
+     * @param report Первый разошедшийся тик или причина, по которой трассы не сравнить.
+     * @return true, если трассы совпадают.
+     */
+    static bool Diff(const std::string &pathA, const std::string &pathB, std::string &report) {
+        std::ifstream a(pathA);
+        std::ifstream b(pathB);
+        if (!a || !b) {
+            report = "Cannot open " + (a ? pathB : pathA);
+            return false;
+        }
+
+        std::string lineA;
+        std::string lineB;
+        long compared = 0;
+        while (true) {
+            const bool hasA = static_cast<bool>(std::getline(a, lineA));
+            const bool hasB = static_cast<bool>(std::getline(b, lineB));
+            if (!hasA && !hasB) break;
+            if (hasA != hasB) {
+                report = "Traces match for " + std::to_string(compared) + " ticks, then " +
+                         (hasA ? pathB : pathA) + " ends";
+                return false;
+            }
+            if (lineA != lineB) {
+                report = "First divergent tick: " + lineA.substr(0, lineA.find(' ')) +
+                         " (" + lineA + " vs " + lineB + ")";
+                return false;
+            }
+            ++compared;
+        }
+        report = "Traces match for " + std::to_string(compared) + " ticks";
+        return true;
+    }
+
+private:
+    std::ofstream m_file;
+};
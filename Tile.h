@@ -16,7 +16,7 @@
  * @enum eTileType
  * @brief Типы плиток.
  */
-enum class eTileType {
+enum class eTileType : signed char {
     e_Path = -1, /**< Путь. */
     e_Wall = 0, /**< Стена. */
     e_Coin = 1, /**< Монетка. */
@@ -41,8 +41,7 @@ struct Tile {
      * @param canCollide Возможность столкновения с плиткой (bool).
      */
     Tile(eTileType type, sf::Vector2i position, bool canCollide)
-            : m_type(type), m_position(position), m_canCollide(canCollide),
-              m_cameFromNode(nullptr), m_fCost(0), m_gCost(0), m_hCost(0) {
+            : m_type(type), m_position(position), m_canCollide(canCollide) {
     }
 
     /**
@@ -57,21 +56,7 @@ struct Tile {
         return m_type == tile.m_type && m_position == tile.m_position;
     }
 
-    /**
-     * @brief Вычисление значения F-стоимости.
-     *
-     * Вычисляет значение F-стоимости как сумму значений G-стоимости и H-стоимости.
-     */
-    void CalculateFCost() {
-        m_fCost = m_gCost + m_hCost;
-    }
-
     eTileType m_type; /**< Тип плитки. */
     sf::Vector2i m_position; /**< Позиция плитки. */
     bool m_canCollide; /**< Возможность столкновения с плиткой. */
-
-    Tile *m_cameFromNode; /**< Указатель на предыдущую плитку в пути. */
-    int m_fCost; /**< Значение F-стоимости. */
-    int m_gCost; /**< Значение G-стоимости. */
-    int m_hCost; /**< Значение H-стоимости. */
 };
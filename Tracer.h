@@ -0,0 +1,330 @@
+/**
+ * @file Tracer.h
+ * @brief Трассировщик интервалов и счетчиков в формате Chrome trace events.
+ *
+ * Каждый поток пишет события в собственный кольцевой буфер фиксированного размера без блокировок.
+ * Фоновый поток периодически забирает события из всех буферов и дописывает их в JSON-файл,
+ * который открывается в Perfetto (ui.perfetto.dev) или chrome://tracing.
+ * Трассировка включается и выключается во время выполнения; в выключенном состоянии
+ * каждая точка трассировки стоит одну атомарную загрузку.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace trace
+{
+    /**
+     * @brief Событие трассировки. Имена должны быть строковыми литералами.
+     */
+    struct Event
+    {
+        const char* m_name = nullptr; ///< Имя интервала или счетчика.
+        char m_phase = 'X'; ///< 'X' - завершенный интервал, 'C' - счетчик.
+        std::int64_t m_timestamp = 0; ///< Начало, мкс от запуска трассировщика.
+        std::int64_t m_duration = 0; ///< Длительность интервала, мкс.
+        std::array<const char*, 2> m_argNames{}; ///< Имена аргументов (nullptr - аргумента нет).
+        std::array<std::int64_t, 2> m_argValues{}; ///< Значения аргументов.
+    };
+
+    /**
+     * @class Tracer
+     * @brief Реестр потоковых буферов и поток записи в файл.
+     */
+    class Tracer
+    {
+    public:
+        static constexpr std::size_t k_threadBufferSize = 1 << 14; ///< Событий в буфере одного потока.
+
+        static Tracer& Instance()
+        {
+            static Tracer tracer;
+            return tracer;
+        }
+
+        ~Tracer()
+        {
+            Stop();
+        }
+
+        /**
+         * @brief Открывает файл трассы и запускает фоновую запись. Запись событий при этом включается.
+         * @param path Путь к JSON-файлу.
+         * @return false, если файл не удалось открыть.
+         */
+        bool Start(const std::string& path)
+        {
+            Stop();
+
+            m_file = std::fopen(path.c_str(), "wb");
+            if (!m_file)
+            {
+                std::cerr << "Couldn't Open the File: " + path + "\nTracing disabled" << std::endl;
+                return false;
+            }
+            std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", m_file);
+            m_firstEvent = true;
+
+            m_flushing = true;
+            m_flusher = std::thread(&Tracer::FlushLoop, this);
+            SetEnabled(true);
+            return true;
+        }
+
+        /**
+         * @brief Останавливает запись, сбрасывает оставшиеся события и закрывает файл.
+         */
+        void Stop()
+        {
+            if (!m_file) return;
+
+            SetEnabled(false);
+            m_flushing = false;
+            m_wakeUp.notify_one();
+            m_flusher.join();
+
+            std::fputs("\n]}\n", m_file);
+            std::fclose(m_file);
+            m_file = nullptr;
+
+            if (m_droppedEvents)
+            {
+                std::cerr << "Tracer: " << m_droppedEvents << " events dropped (buffers full)" << std::endl;
+            }
+        }
+
+        /**
+         * @brief Включает или выключает запись событий (файл при этом остается открытым).
+         */
+        void SetEnabled(const bool enabled)
+        {
+            m_enabled.store(enabled && m_file, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Открыт ли файл трассы (между Start и Stop).
+         */
+        bool IsOpen() const
+        {
+            return m_file != nullptr;
+        }
+
+        bool IsEnabled() const
+        {
+            return m_enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Текущее время трассировки в микросекундах.
+         */
+        std::int64_t Now() const
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - m_epoch).count();
+        }
+
+        /**
+         * @brief Добавляет событие в буфер текущего потока. При переполнении событие отбрасывается.
+         */
+        void Emit(const Event& event)
+        {
+            thread_local ThreadBuffer* buffer = RegisterThread();
+            if (!buffer->Push(event)) ++m_droppedEvents;
+        }
+
+        /**
+         * @brief Записывает значение счетчика.
+         * @param name Имя счетчика (строковый литерал).
+         * @param value Значение.
+         */
+        void Counter(const char* name, const std::int64_t value)
+        {
+            if (!IsEnabled()) return;
+
+            Event event;
+            event.m_name = name;
+            event.m_phase = 'C';
+            event.m_timestamp = Now();
+            event.m_argNames[0] = "value";
+            event.m_argValues[0] = value;
+            Emit(event);
+        }
+
+    private:
+        /**
+         * @brief Кольцевой буфер событий потока (один производитель, один потребитель).
+         */
+        class ThreadBuffer
+        {
+        public:
+            explicit ThreadBuffer(const int threadId) : m_threadId(threadId), m_events(k_threadBufferSize) {}
+
+            bool Push(const Event& event)
+            {
+                const std::size_t head = m_head.load(std::memory_order_relaxed);
+                if (head - m_tail.load(std::memory_order_acquire) == k_threadBufferSize) return false;
+                m_events[head % k_threadBufferSize] = event;
+                m_head.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            template<typename Consumer>
+            void Drain(Consumer&& consumer)
+            {
+                const std::size_t head = m_head.load(std::memory_order_acquire);
+                std::size_t tail = m_tail.load(std::memory_order_relaxed);
+                for (; tail != head; ++tail) consumer(m_events[tail % k_threadBufferSize], m_threadId);
+                m_tail.store(tail, std::memory_order_release);
+            }
+
+        private:
+            int m_threadId;
+            std::vector<Event> m_events;
+            std::atomic<std::size_t> m_head{0};
+            std::atomic<std::size_t> m_tail{0};
+        };
+
+        std::atomic<bool> m_enabled{false};
+        std::atomic<std::uint64_t> m_droppedEvents{0};
+        const std::chrono::steady_clock::time_point m_epoch = std::chrono::steady_clock::now();
+
+        std::mutex m_threadsMutex;
+        // Буферы живут до конца процесса: поток может завершиться раньше, чем его события будут записаны
+        std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+
+        std::FILE* m_file = nullptr;
+        bool m_firstEvent = true;
+        std::atomic<bool> m_flushing{false};
+        std::mutex m_wakeUpMutex;
+        std::condition_variable m_wakeUp;
+        std::thread m_flusher;
+
+        Tracer() = default;
+
+        ThreadBuffer* RegisterThread()
+        {
+            std::lock_guard<std::mutex> lock(m_threadsMutex);
+            m_threads.emplace_back(std::make_unique<ThreadBuffer>(static_cast<int>(m_threads.size()) + 1));
+            return m_threads.back().get();
+        }
+
+        void FlushLoop()
+        {
+            while (m_flushing)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_wakeUpMutex);
+                    m_wakeUp.wait_for(lock, std::chrono::milliseconds(50));
+                }
+                Flush();
+            }
+            Flush();
+            std::fflush(m_file);
+        }
+
+        void Flush()
+        {
+            std::lock_guard<std::mutex> lock(m_threadsMutex);
+            for (auto& buffer : m_threads)
+            {
+                buffer->Drain([this](const Event& event, const int threadId) { Write(event, threadId); });
+            }
+        }
+
+        void Write(const Event& event, const int threadId)
+        {
+            std::fprintf(m_file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%lld",
+                         m_firstEvent ? "" : ",\n", event.m_name, event.m_phase, threadId,
+                         static_cast<long long>(event.m_timestamp));
+            m_firstEvent = false;
+
+            if (event.m_phase == 'X') std::fprintf(m_file, ",\"dur\":%lld", static_cast<long long>(event.m_duration));
+
+            if (event.m_argNames[0])
+            {
+                std::fprintf(m_file, ",\"args\":{\"%s\":%lld", event.m_argNames[0],
+                             static_cast<long long>(event.m_argValues[0]));
+                if (event.m_argNames[1])
+                {
+                    std::fprintf(m_file, ",\"%s\":%lld", event.m_argNames[1],
+                                 static_cast<long long>(event.m_argValues[1]));
+                }
+                std::fputc('}', m_file);
+            }
+            std::fputc('}', m_file);
+        }
+    };
+
+    /**
+     * @class Span
+     * @brief Интервал трассировки от конструктора до деструктора.
+     *
+     * Если трассировка выключена в момент создания, деструктор ничего не делает.
+     */
+    class Span
+    {
+    public:
+        explicit Span(const char* name)
+        {
+            if (Tracer::Instance().IsEnabled())
+            {
+                m_event.m_name = name;
+                m_event.m_timestamp = Tracer::Instance().Now();
+            }
+        }
+
+        ~Span()
+        {
+            if (m_event.m_name)
+            {
+                m_event.m_duration = Tracer::Instance().Now() - m_event.m_timestamp;
+                Tracer::Instance().Emit(m_event);
+            }
+        }
+
+        /**
+         * @brief Добавляет к интервалу числовой аргумент (не более двух).
+         * @param name Имя аргумента (строковый литерал).
+         * @param value Значение.
+         */
+        void SetArg(const char* name, const std::int64_t value)
+        {
+            for (std::size_t i = 0; i < m_event.m_argNames.size(); ++i)
+            {
+                if (!m_event.m_argNames[i] || m_event.m_argNames[i] == name)
+                {
+                    m_event.m_argNames[i] = name;
+                    m_event.m_argValues[i] = value;
+                    return;
+                }
+            }
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        Event m_event;
+    };
+}
+
+#define PACMAN_TRACE_CONCAT_IMPL(a, b) a##b
+#define PACMAN_TRACE_CONCAT(a, b) PACMAN_TRACE_CONCAT_IMPL(a, b)
+
+/// Трассирует текущий блок как интервал с именем name (строковый литерал).
+#define PACMAN_TRACE_SCOPE(name) const trace::Span PACMAN_TRACE_CONCAT(traceSpan_, __LINE__)(name)
+
+/// Записывает значение счетчика name (строковый литерал).
+#define PACMAN_TRACE_COUNTER(name, value) trace::Tracer::Instance().Counter(name, value)
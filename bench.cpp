@@ -0,0 +1,1482 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "EmbeddedLevel.h"
+#include "Game.h"
+#include "LevelLoader.h"
+#include "Manager.h"
+#include "MatchLog.h"
+#include "MazeGenerator.h"
+#include "MctsAgent.h"
+#include "NavigationData.h"
+#include "PacManBot.h"
+#include "Rollback.h"
+
+namespace
+{
+    // Allocations made by the calling thread; path workers build their results off the game thread
+    thread_local std::uint64_t t_allocations = 0;
+}
+
+// The replacements stay out of line. Otherwise GCC inlines malloc into some call sites and free into others,
+// matches them against the operator new/delete left on the other side and reports -Wmismatched-new-delete
+#if defined(_MSC_VER)
+#define PACMAN_BENCH_NOINLINE __declspec(noinline)
+#else
+#define PACMAN_BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+PACMAN_BENCH_NOINLINE void* operator new(const std::size_t size)
+{
+    ++t_allocations;
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+PACMAN_BENCH_NOINLINE void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+PACMAN_BENCH_NOINLINE void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    /**
+     * @brief Runs the operation repeatedly and returns the mean wall time per call in nanoseconds.
+     */
+    template<typename Operation>
+    double MeasureNanoseconds(const int iterations, Operation&& operation)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) operation();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    }
+
+    /**
+     * @brief One reported measurement. Counters that were not measured are negative.
+     */
+    struct BenchResult
+    {
+        std::string m_name;
+        double m_nanoseconds = 0.0;
+        double m_nodes = -1.0; ///< Search nodes expanded per operation.
+        double m_allocations = -1.0; ///< Heap allocations of the calling thread per operation.
+        double m_cacheMisses = -1.0; ///< Hardware cache misses per operation.
+        std::string m_note;
+    };
+
+    // Everything reported in this run, for --json
+    std::vector<BenchResult>& Results()
+    {
+        static std::vector<BenchResult> results;
+        return results;
+    }
+
+    void Report(const std::string& name, const double nanoseconds, const std::string& note = "")
+    {
+        std::printf("%-44s %14.0f ns/op  %s\n", name.c_str(), nanoseconds, note.c_str());
+        Results().push_back({ name, nanoseconds, -1.0, -1.0, -1.0, note });
+    }
+
+    /**
+     * @brief Hardware cache misses of the calling thread from Linux perf events.
+     *
+     * Unavailable on other systems, in containers without perf access and under perf_event_paranoid > 2.
+     */
+    class CacheMissCounter
+    {
+    public:
+        CacheMissCounter()
+        {
+#ifdef __linux__
+            perf_event_attr attributes{};
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof(attributes);
+            attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            m_descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+        }
+
+        ~CacheMissCounter()
+        {
+#ifdef __linux__
+            if (m_descriptor >= 0) close(m_descriptor);
+#endif
+        }
+
+        CacheMissCounter(const CacheMissCounter&) = delete;
+        CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+        void Start()
+        {
+#ifdef __linux__
+            if (m_descriptor < 0) return;
+            ioctl(m_descriptor, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_descriptor, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        /**
+         * @return Misses since Start, or -1 if the counter is unavailable.
+         */
+        std::int64_t Stop()
+        {
+#ifdef __linux__
+            if (m_descriptor < 0) return -1;
+            ioctl(m_descriptor, PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t misses = 0;
+            if (read(m_descriptor, &misses, sizeof(misses)) != static_cast<ssize_t>(sizeof(misses))) return -1;
+            return static_cast<std::int64_t>(misses);
+#else
+            return -1;
+#endif
+        }
+
+    private:
+        int m_descriptor = -1;
+    };
+
+    /**
+     * @brief Measures time, allocations and cache misses per call of the operation.
+     *
+     * An operation that returns a number reports the search nodes it expanded.
+     */
+    template<typename Operation>
+    BenchResult MeasureOperation(const std::string& name, const int iterations, Operation&& operation)
+    {
+        static CacheMissCounter cacheMisses;
+        constexpr bool k_countsNodes = !std::is_void_v<decltype(operation())>;
+
+        double nodes = 0.0;
+        cacheMisses.Start();
+        const std::uint64_t allocations = t_allocations;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            if constexpr (k_countsNodes) nodes += static_cast<double>(operation());
+            else operation();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const std::uint64_t allocated = t_allocations - allocations;
+        const std::int64_t misses = cacheMisses.Stop();
+
+        BenchResult result;
+        result.m_name = name;
+        result.m_nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+        result.m_nodes = k_countsNodes ? nodes / iterations : -1.0;
+        result.m_allocations = static_cast<double>(allocated) / iterations;
+        result.m_cacheMisses = misses >= 0 ? static_cast<double>(misses) / iterations : -1.0;
+        return result;
+    }
+
+    void ReportOperation(const BenchResult& result)
+    {
+        char note[128];
+        int length = 0;
+        if (result.m_nodes >= 0.0)
+        {
+            length += std::snprintf(note + length, sizeof(note) - length, "%.1f nodes, ", result.m_nodes);
+        }
+        length += std::snprintf(note + length, sizeof(note) - length, "%.2f allocs, ", result.m_allocations);
+        if (result.m_cacheMisses >= 0.0)
+        {
+            std::snprintf(note + length, sizeof(note) - length, "%.1f cache misses", result.m_cacheMisses);
+        } else
+        {
+            std::snprintf(note + length, sizeof(note) - length, "cache misses n/a");
+        }
+
+        std::printf("%-44s %14.0f ns/op  %s\n", result.m_name.c_str(), result.m_nanoseconds, note);
+        Results().push_back(result);
+    }
+
+    std::string EscapeJson(const std::string& text)
+    {
+        std::string escaped;
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    /**
+     * @brief Writes every reported result as a JSON array (unmeasured counters are null).
+     */
+    bool WriteJson(const std::string& path)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "Cannot write " << path << std::endl;
+            return false;
+        }
+
+        auto number = [](const double value) {
+            return value < 0.0 ? std::string("null") : std::to_string(value);
+        };
+        file << "[\n";
+        for (std::size_t i = 0; i < Results().size(); ++i)
+        {
+            const BenchResult& result = Results()[i];
+            file << "  {\"name\": \"" << EscapeJson(result.m_name) << "\""
+                 << ", \"ns_per_op\": " << number(result.m_nanoseconds)
+                 << ", \"nodes_per_op\": " << number(result.m_nodes)
+                 << ", \"allocs_per_op\": " << number(result.m_allocations)
+                 << ", \"cache_misses_per_op\": " << number(result.m_cacheMisses)
+                 << ", \"note\": \"" << EscapeJson(result.m_note) << "\"}"
+                 << (i + 1 < Results().size() ? ",\n" : "\n");
+        }
+        file << "]\n";
+        return true;
+    }
+
+    /**
+     * @brief One entry of the generated benchmark corpus.
+     */
+    struct CorpusLevel
+    {
+        const char* m_name;
+        MazeParameters m_parameters;
+    };
+
+    MazeParameters MakeParameters(const int size, const float loopDensity, const std::uint64_t seed = 42)
+    {
+        MazeParameters parameters;
+        parameters.m_columns = size;
+        parameters.m_rows = size;
+        parameters.m_loopDensity = loopDensity;
+        parameters.m_seed = seed;
+        parameters.m_tunnels = std::max(1, size / 32);
+        return parameters;
+    }
+
+    std::string DescribeLevel(const MazeParameters& parameters)
+    {
+        return std::to_string(parameters.m_columns) + "x" + std::to_string(parameters.m_rows);
+    }
+
+    // The loader Manager::LoadLevel used before: getline, a stringstream per line and atoi per cell
+    std::size_t LoadLevelGetline(const std::string& filename)
+    {
+        std::ifstream file(filename);
+        std::size_t cells = 0;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::stringstream iss(line);
+            std::string val;
+            while (std::getline(iss, val, ','))
+            {
+                cells += atoi(val.c_str()) != 0;
+            }
+        }
+        return cells;
+    }
+
+    void BenchmarkLevelFile(const std::string& name, const std::string& csvPath, const std::string& binaryPath,
+                            const int iterations)
+    {
+        LevelGrid grid;
+        std::string error;
+        std::size_t sink = 0;
+
+        Report(name + " getline+stringstream", MeasureNanoseconds(iterations, [&] {
+            sink += LoadLevelGetline(csvPath);
+        }));
+        Report(name + " mmap csv", MeasureNanoseconds(iterations, [&] {
+            if (!lvl::load_level_csv(csvPath, grid, error)) std::cout << error << std::endl;
+            sink += grid.m_cells.size();
+        }));
+        Report(name + " binary", MeasureNanoseconds(iterations, [&] {
+            if (!lvl::load_level_binary(binaryPath, grid, error)) std::cout << error << std::endl;
+            sink += grid.m_cells.size();
+        }));
+
+        if (sink == 0) std::cout << "nothing loaded" << std::endl;
+    }
+
+    /**
+     * @brief Loading the shipped level from CSV, the binary format and the embedded copy.
+     * @return false if the embedded navigation data no longer matches the runtime build of the level.
+     */
+    bool BenchmarkShippedLevel(const std::string& levelPath)
+    {
+        const std::string binaryPath = (std::filesystem::temp_directory_path() / "pacman_bench_shipped.pml").string();
+
+        LevelGrid grid;
+        std::string error;
+        if (!lvl::load_level_csv(levelPath, grid, error) || !lvl::save_level_binary(binaryPath, grid))
+        {
+            std::cout << "Skipping the shipped level: " << error << std::endl;
+            return true;
+        }
+
+        BenchmarkLevelFile("load Level.csv", levelPath, binaryPath, 2000);
+
+        Manager manager;
+        Report("Manager::LoadLevel Level.csv", MeasureNanoseconds(2000, [&] { manager.LoadLevel(levelPath); }));
+
+#if defined(PACMAN_EMBED_DEFAULT_LEVEL)
+        // The compiler parsed the embedded level; loading it only lays out the tiles
+        Report("Manager::LoadEmbeddedLevel", MeasureNanoseconds(2000, [&] {
+            manager.LoadEmbeddedLevel(lvl::embedded::k_defaultLevel);
+        }), "no file I/O, parsing or navigation build");
+
+        // Its navigation image must be the one the runtime builder writes to Level.csv.nav; a stale
+        // EmbeddedLevel.h or DefaultLevel.inc fails the run
+        bool embeddedCurrent = true;
+        const auto& embedded = lvl::embedded::k_defaultLevel;
+        const std::vector<char> built = nav::build_navigation(grid, std::atomic<bool>{ false });
+        if (levelPath == cnp::default_level_path() && (built.size() != embedded.m_navigation.k_size ||
+                                                     std::memcmp(built.data(), embedded.m_navigation.Data(), built.size()) != 0))
+        {
+            std::printf("The embedded navigation data differs from the runtime build of %s\n", levelPath.c_str());
+            embeddedCurrent = false;
+        }
+#else
+        const bool embeddedCurrent = true;
+#endif
+
+        // The first game loads the level and font into the registry, later ones share them
+        Report("Game construction, cold registry", MeasureNanoseconds(1, [&] { Game game(levelPath); }));
+        Report("Game construction, shared assets", MeasureNanoseconds(2000, [&] { Game game(levelPath); }));
+
+        std::filesystem::remove(binaryPath);
+        return embeddedCurrent;
+    }
+
+    void BenchmarkGeneratedLevel(const MazeParameters& parameters)
+    {
+        const auto directory = std::filesystem::temp_directory_path();
+        const std::string csvPath = (directory / "pacman_bench_level.csv").string();
+        const std::string binaryPath = (directory / "pacman_bench_level.pml").string();
+
+        const LevelGrid grid = lvl::generate_maze(parameters);
+        lvl::save_level_csv(csvPath, grid);
+        lvl::save_level_binary(binaryPath, grid);
+
+        BenchmarkLevelFile("load " + DescribeLevel(parameters), csvPath, binaryPath,
+                           parameters.m_columns >= 2048 ? 3 : 20);
+
+        std::filesystem::remove(csvPath);
+        std::filesystem::remove(binaryPath);
+    }
+
+    // Cold start rebuilds the tables, warm start maps the sidecar written by the cold one
+    void BenchmarkNavigation(const MazeParameters& parameters)
+    {
+        const std::string sidecarPath = (std::filesystem::temp_directory_path() / "pacman_bench_level.nav").string();
+        const LevelGrid grid = lvl::generate_maze(parameters);
+        const int iterations = parameters.m_columns >= 2048 ? 2 : 10;
+
+        NavigationStore store;
+        const double buildNanoseconds = MeasureNanoseconds(iterations, [&] {
+            std::filesystem::remove(sidecarPath);
+            store.Open(grid, sidecarPath);
+            store.Wait();
+        });
+        Report("navigation " + DescribeLevel(parameters) + " build", buildNanoseconds,
+               std::to_string(std::filesystem::file_size(sidecarPath) >> 10) + " KiB sidecar");
+
+        std::size_t mapped = 0;
+        Report("navigation " + DescribeLevel(parameters) + " map sidecar", MeasureNanoseconds(iterations, [&] {
+            store.Open(grid, sidecarPath);
+            mapped += store.IsMapped() && store.Get();
+        }), "includes hashing the level");
+        if (mapped != static_cast<std::size_t>(iterations)) std::cout << "sidecar was rebuilt" << std::endl;
+
+        store.Close();
+        std::filesystem::remove(sidecarPath);
+    }
+
+    void BenchmarkMazeGeneration(MazeParameters parameters)
+    {
+        const int iterations = parameters.m_columns >= 2048 ? 3 : 20;
+        std::size_t sink = 0;
+
+        parameters.m_threads = 1;
+        Report("generate " + DescribeLevel(parameters) + " 1 thread", MeasureNanoseconds(iterations, [&] {
+            sink += lvl::generate_maze(parameters).m_cells.size();
+        }));
+
+        parameters.m_threads = 0;
+        Report("generate " + DescribeLevel(parameters) + " all threads", MeasureNanoseconds(iterations, [&] {
+            sink += lvl::generate_maze(parameters).m_cells.size();
+        }), std::to_string(std::max(1u, std::thread::hardware_concurrency())) + " threads");
+
+        if (sink == 0) std::cout << "nothing generated" << std::endl;
+    }
+
+    // Per-tick latency percentiles: replan spikes show up in p99 and max, not in the mean
+    void BenchmarkTickLatency(const std::string& name, const MazeParameters& parameters, const ReplanBudget budget,
+                              const bool staggered, const unsigned pathThreads = 0)
+    {
+        Game game(lvl::generate_maze(parameters));
+        game.WaitForNavigation();
+        game.GetReplanScheduler().SetBudget(budget);
+        game.GetReplanScheduler().SetStaggered(staggered);
+        game.SetPathThreads(pathThreads);
+
+        std::vector<double> latencies(parameters.m_columns >= 128 ? 100 : 400);
+        for (auto& latency : latencies)
+        {
+            latency = MeasureNanoseconds(1, [&] { game.Update(); });
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        char note[192];
+        int length = std::snprintf(note, sizeof(note), "p99 %.0f ns, max %.0f ns",
+                                   latencies[latencies.size() * 99 / 100], latencies.back());
+        if (const PathService* service = game.GetPathService())
+        {
+            const PathServiceStats stats = service->GetStats();
+            std::snprintf(note + length, sizeof(note) - length,
+                          "; %llu requests, %llu merged, %llu cancelled, request p50 %lld us, p99 %lld us",
+                          static_cast<unsigned long long>(stats.m_submitted),
+                          static_cast<unsigned long long>(stats.m_deduplicated),
+                          static_cast<unsigned long long>(stats.m_cancelled),
+                          static_cast<long long>(stats.m_latencyP50.count()),
+                          static_cast<long long>(stats.m_latencyP99.count()));
+        }
+        Report(name + " " + DescribeLevel(parameters) + " tick p50", latencies[latencies.size() / 2], note);
+    }
+
+    // Horde variants: tick cost per ghost should fall as the shared chase paths are reused
+    void BenchmarkHorde(const MazeParameters& parameters, const int ghosts, const int pacMen)
+    {
+        GameConfig config;
+        config.m_ghosts = ghosts;
+        config.m_pacMen = pacMen;
+        config.m_ghostSeparation = true;
+
+        Game game(lvl::generate_maze(parameters), config);
+        game.WaitForNavigation();
+        game.GetReplanScheduler().SetBudget({ 0, {} });
+
+        const double tick = MeasureNanoseconds(200, [&] { game.Update(); });
+        char note[64];
+        std::snprintf(note, sizeof(note), "%.0f ns per ghost", tick / ghosts);
+        Report("horde " + DescribeLevel(parameters) + " " + std::to_string(ghosts) + " ghosts, " +
+               std::to_string(pacMen) + " pac-men Game::Update", tick, note);
+    }
+
+    /**
+     * @brief Counts heap allocations of the game thread over steady-state ticks.
+     *
+     * Pac-Men random-walk, so games end quickly; finished games are replaced and only ticks after each
+     * game's warm-up are counted.
+     * @return true if no counted tick allocated.
+     */
+    bool CheckTickAllocations(const std::string& name, const MazeParameters& parameters, const GameConfig& config,
+                              const unsigned pathThreads = 0)
+    {
+        const LevelGrid grid = lvl::generate_maze(parameters);
+        std::unique_ptr<Game> game;
+        int warmUp = 0;
+        int games = 0;
+        std::uint32_t steering = 1;
+
+        const int ticks = 2000;
+        int allocatingTicks = 0;
+        std::uint64_t allocations = 0;
+        for (int tick = 0; tick < ticks;)
+        {
+            if (!game || game->IsGameOver())
+            {
+                game = std::make_unique<Game>(grid, config);
+                game->WaitForNavigation();
+                game->SetPathThreads(pathThreads);
+                // Buffers grow to their working size and every ghost plans its first path
+                warmUp = 20;
+                ++games;
+            }
+
+            steering = steering * 1664525u + 1013904223u;
+            if ((steering >> 24) < 32)
+            {
+                for (std::size_t i = 0; i < game->GetPacManCount(); ++i)
+                {
+                    game->GetPacMan(i).SetDirection(static_cast<eDirection>(1 + (steering >> 8) % 4));
+                }
+            }
+
+            const std::uint64_t tickStart = t_allocations;
+            game->Update();
+            if (warmUp > 0)
+            {
+                --warmUp;
+                continue;
+            }
+            allocations += t_allocations - tickStart;
+            allocatingTicks += t_allocations != tickStart;
+            ++tick;
+        }
+
+        std::printf("%-44s %14llu allocs     in %d of %d ticks, %d games %s\n",
+                    ("allocations " + DescribeLevel(parameters) + " " + name).c_str(),
+                    static_cast<unsigned long long>(allocations), allocatingTicks, ticks, games,
+                    allocations == 0 ? "" : "FAILED");
+        return allocations == 0;
+    }
+
+    bool CheckAllocations()
+    {
+        GameConfig horde;
+        horde.m_pacMen = 2;
+        horde.m_ghosts = 64;
+        horde.m_ghostSeparation = true;
+
+        bool passed = true;
+        for (const int size : { 32, 64 })
+        {
+            passed &= CheckTickAllocations("Game::Update", MakeParameters(size, 0.3f), {});
+            passed &= CheckTickAllocations("Game::Update, 2 path threads", MakeParameters(size, 0.3f), {}, 2);
+        }
+        passed &= CheckTickAllocations("Game::Update, horde", MakeParameters(64, 0.3f), horde);
+
+        GameConfig dangerMap;
+        dangerMap.m_dangerMap = true;
+        passed &= CheckTickAllocations("Game::Update, danger map", MakeParameters(32, 0.3f), dangerMap);
+        return passed;
+    }
+
+    /**
+     * @brief Per-tick cost of the danger and attraction fields, from the sources of a game in play.
+     */
+    void BenchmarkDangerMap(const MazeParameters& parameters)
+    {
+        const LevelGrid grid = lvl::generate_maze(parameters);
+        GameConfig config;
+        config.m_dangerMap = true;
+        Game game(grid, config);
+        game.SetSeed(1);
+        game.WaitForNavigation();
+        for (int tick = 0; tick < 20; ++tick)
+        {
+            game.Update();
+        }
+
+        const int iterations = parameters.m_columns >= 128 ? 2000 : 20000;
+        BenchResult result = MeasureOperation("danger map " + DescribeLevel(parameters) + " Game::UpdateDangerMap",
+                                              iterations, [&] { game.UpdateDangerMap(); });
+        result.m_note = std::string(DangerMap::k_kernel) + " kernel, " +
+                        std::to_string(2 * DangerMap::k_ghostRadius + DangerMap::k_attractionRadius) + " passes at most";
+        ReportOperation(result);
+    }
+
+    // A tick covers entity movement, pickup collisions and ghost replanning; a frame is the software render
+    void BenchmarkGame(const CorpusLevel& level)
+    {
+        const LevelGrid grid = lvl::generate_maze(level.m_parameters);
+        Game game(grid);
+        game.WaitForNavigation();
+
+        const std::string name = std::string(level.m_name) + " " + DescribeLevel(level.m_parameters);
+        const int ticks = level.m_parameters.m_columns >= 128 ? 20 : 200;
+        Report(name + " Game::Update", MeasureNanoseconds(ticks, [&] { game.Update(); }));
+
+        Canvas canvas(game.GetGridMetrics().GetWidth(), game.GetGridMetrics().GetHeight());
+        Report(name + " Game::Render(Canvas)", MeasureNanoseconds(20, [&] {
+            canvas.Clear();
+            game.Render(canvas);
+        }));
+        // FrameCapture::Capture: the tick thread records the frame, the writer thread rasterises it
+        Report(name + " Game::Render(Canvas) recorded", MeasureNanoseconds(20, [&] {
+            canvas.BeginRecording();
+            canvas.Clear();
+            game.Render(canvas);
+        }));
+        Report(name + " Canvas::Replay", MeasureNanoseconds(20, [&] { canvas.Replay(); }));
+    }
+
+    constexpr float k_botTickSeconds = 0.2f; // main.cpp ticks the game every 200 ms
+    constexpr int k_maxEpisodeTicks = 20000; // Bots that can neither win nor die end here
+
+    /**
+     * @brief Episodes played by one thread of the throughput benchmark.
+     */
+    struct EpisodeTotals
+    {
+        std::uint64_t m_ticks = 0;
+        int m_episodes = 0;
+        int m_capped = 0; ///< Episodes stopped at k_maxEpisodeTicks.
+        int m_wins = 0; ///< Episodes that ended with the coins collected.
+        std::int64_t m_score = 0; ///< Sum of final scores: equal for equal seeds on any thread count.
+        std::vector<std::uint32_t> m_tickNanoseconds; ///< Game::Update latency of every tick.
+    };
+
+    // A fresh seeded game with fixed-step timers on the shared level, played to the end by bots
+    void PlayEpisode(const std::shared_ptr<const Manager>& level, const eBotType type, const std::uint64_t seed,
+                     EpisodeTotals& totals, matchlog::MatchLogWriter* results)
+    {
+        Game game(level);
+        game.SetSeed(seed);
+        game.SetFixedTickSeconds(k_botTickSeconds);
+
+        std::vector<PacManBot> bots;
+        for (std::size_t i = 0; i < game.GetPacManCount(); ++i)
+        {
+            bots.emplace_back(type, seed * 31 + i);
+        }
+
+        int tick = 0;
+        for (; tick < k_maxEpisodeTicks && !game.IsGameOver(); ++tick)
+        {
+            for (std::size_t i = 0; i < bots.size(); ++i)
+            {
+                bots[i].Steer(game, i);
+            }
+            const auto start = std::chrono::steady_clock::now();
+            game.Update();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            totals.m_tickNanoseconds.push_back(static_cast<std::uint32_t>(
+                    std::min<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                                           std::numeric_limits<std::uint32_t>::max())));
+        }
+
+        totals.m_ticks += static_cast<std::uint64_t>(tick);
+        totals.m_episodes += 1;
+        totals.m_capped += tick == k_maxEpisodeTicks;
+        // The game ends won when the coins run out while some Pac-Man still has lives
+        bool anyLivesLeft = false;
+        for (std::size_t i = 0; i < game.GetPacManCount(); ++i)
+        {
+            totals.m_score += game.GetPacMan(i).GetPoints();
+            anyLivesLeft |= game.GetPacMan(i).GetLivesRemaining() > 0;
+        }
+        totals.m_wins += game.IsGameOver() && anyLivesLeft;
+        if (!results) return;
+
+        const eMatchOutcome outcome = !game.IsGameOver() ? eMatchOutcome::e_Unfinished
+                                                         : anyLivesLeft ? eMatchOutcome::e_Win : eMatchOutcome::e_Loss;
+        for (std::size_t i = 0; i < game.GetPacManCount(); ++i)
+        {
+            PacMan& pacMan = game.GetPacMan(i);
+            MatchResult result;
+            result.m_seed = seed;
+            result.m_score = pacMan.GetPoints();
+            result.m_ticks = static_cast<std::uint32_t>(tick);
+            result.m_lives = static_cast<std::int16_t>(pacMan.GetLivesRemaining());
+            result.m_bot = static_cast<std::uint8_t>(type);
+            result.m_outcome = outcome;
+            result.m_caughtBy = static_cast<std::int8_t>(pacMan.GetCaughtBy());
+            result.m_pacMan = static_cast<std::uint8_t>(i);
+            results->Push(result);
+        }
+    }
+
+    /**
+     * @brief Plays the episodes on the given number of threads and reports throughput and tick latency.
+     *
+     * Episode i always uses seed i, whichever thread plays it, so the score sum must not depend on threads.
+     * @param results Match log for the result of every Pac-Man, or nullptr.
+     * @return Sum of the final scores.
+     */
+    std::int64_t BenchmarkEpisodes(const std::shared_ptr<const Manager>& level, const eBotType type,
+                                   const int episodes, const unsigned threads,
+                                   matchlog::MatchLogWriter* results = nullptr)
+    {
+        std::vector<EpisodeTotals> totals(threads);
+        std::atomic<int> nextEpisode{ 0 };
+        auto worker = [&](EpisodeTotals& mine) {
+            for (int episode = nextEpisode++; episode < episodes; episode = nextEpisode++)
+            {
+                PlayEpisode(level, type, static_cast<std::uint64_t>(episode) + 1, mine, results);
+            }
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::thread> pool;
+            for (unsigned i = 1; i < threads; ++i)
+            {
+                pool.emplace_back(worker, std::ref(totals[i]));
+            }
+            worker(totals[0]);
+            for (auto& thread : pool) thread.join();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        EpisodeTotals all;
+        for (auto& mine : totals)
+        {
+            all.m_ticks += mine.m_ticks;
+            all.m_episodes += mine.m_episodes;
+            all.m_capped += mine.m_capped;
+            all.m_wins += mine.m_wins;
+            all.m_score += mine.m_score;
+            all.m_tickNanoseconds.insert(all.m_tickNanoseconds.end(), mine.m_tickNanoseconds.begin(),
+                                         mine.m_tickNanoseconds.end());
+        }
+        if (all.m_tickNanoseconds.empty()) return all.m_score;
+
+        auto percentile = [&all](const std::size_t perMille) {
+            auto& latencies = all.m_tickNanoseconds;
+            const auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(latencies.size() * perMille / 1000);
+            std::nth_element(latencies.begin(), nth, latencies.end());
+            return static_cast<double>(*nth);
+        };
+        const double p50 = percentile(500);
+        const double p99 = percentile(990);
+        const double p999 = percentile(999);
+
+        char note[256];
+        std::snprintf(note, sizeof(note),
+                      "%.0f ticks/s, %.1f episodes/s, tick p50 %.0f ns, p99 %.0f ns, p999 %.0f ns; "
+                      "%d episodes, %.0f ticks/episode, %d capped, score sum %lld",
+                      static_cast<double>(all.m_ticks) / seconds, all.m_episodes / seconds, p50, p99, p999,
+                      all.m_episodes, static_cast<double>(all.m_ticks) / all.m_episodes, all.m_capped,
+                      static_cast<long long>(all.m_score));
+        Report(std::string("throughput ") + to_string(type) + ", " + std::to_string(threads) +
+               (threads == 1 ? " thread" : " threads"), seconds * 1e9 / static_cast<double>(all.m_ticks), note);
+        return all.m_score;
+    }
+
+    /**
+     * @brief Complete headless games on the shipped level, driven by each bot on one core and on all cores.
+     * @param results Match log for the games of the last run of each bot, or nullptr.
+     * @return false if a game played differently on more threads.
+     */
+    bool BenchmarkThroughput(const std::string& levelPath, const int episodes,
+                             matchlog::MatchLogWriter* results = nullptr)
+    {
+        const std::shared_ptr<const Manager> level = AssetRegistry::Instance().GetLevel(levelPath);
+        if (!level) return false;
+        level->GetNavigation().Wait();
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+        bool deterministic = true;
+        for (const eBotType type : { eBotType::e_RandomWalk, eBotType::e_GreedyCoin, eBotType::e_GhostAvoiding })
+        {
+            const std::int64_t score = BenchmarkEpisodes(level, type, episodes, 1, cores > 1 ? nullptr : results);
+            if (cores > 1 && BenchmarkEpisodes(level, type, episodes, cores, results) != score)
+            {
+                deterministic = false;
+                std::printf("throughput %s: the score sum differs between 1 and %u threads\n", to_string(type), cores);
+            }
+        }
+        return deterministic;
+    }
+
+    /**
+     * @brief Every core pushes synthetic match results into a log in the temp directory.
+     *
+     * Push must stay a few nanoseconds while the writer keeps up; the log is read back and checked.
+     * @return false if a result went missing or a block failed its checksum.
+     */
+    bool BenchmarkMatchLog(const int results)
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "pacman_bench_results.pmr").string();
+        std::filesystem::remove(path);
+        const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+        matchlog::MatchLogWriter writer;
+        std::string error;
+        if (!writer.Open(path, error))
+        {
+            std::printf("match log: %s\n", error.c_str());
+            return false;
+        }
+
+        std::atomic<int> next{ 0 };
+        auto producer = [&] {
+            MatchResult result;
+            for (int i = next++; i < results; i = next++)
+            {
+                result.m_seed = static_cast<std::uint64_t>(i);
+                result.m_score = (i * 7919) % 20000;
+                result.m_ticks = 500 + static_cast<std::uint32_t>(i % 1500);
+                result.m_bot = static_cast<std::uint8_t>(i % 3);
+                result.m_outcome = static_cast<eMatchOutcome>(i % 3);
+                writer.Push(result);
+            }
+        };
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::thread> pool;
+            for (unsigned i = 1; i < threads; ++i)
+            {
+                pool.emplace_back(producer);
+            }
+            producer();
+            for (auto& thread : pool) thread.join();
+        }
+        const double pushSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const bool written = writer.Close();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const matchlog::WriterStats stats = writer.GetStats();
+
+        matchlog::MatchLogReader reader;
+        std::uint64_t read = 0;
+        bool intact = written && reader.Open(path, error);
+        MatchBlockHeader block;
+        std::vector<MatchResult> records;
+        while (intact && reader.NextBlock(block))
+        {
+            intact = reader.ReadRecords(records);
+            read += records.size();
+        }
+        intact &= read == static_cast<std::uint64_t>(results);
+        std::filesystem::remove(path);
+
+        char note[256];
+        std::snprintf(note, sizeof(note), "%u threads, %.1f MB/s, %llu blocks, %llu fsyncs, %llu stalled pushes; %s",
+                      threads, static_cast<double>(stats.m_bytes) / seconds / 1e6,
+                      static_cast<unsigned long long>(stats.m_blocks), static_cast<unsigned long long>(stats.m_syncs),
+                      static_cast<unsigned long long>(stats.m_stalls), intact ? "read back" : "RESULTS LOST");
+        Report("match log " + std::to_string(results) + " results, Push", pushSeconds * 1e9 * threads / results, note);
+        return intact;
+    }
+
+    constexpr std::uint64_t k_rollbackSeed = 7;
+    constexpr std::uint32_t k_rollbackFrames = 3000;
+    constexpr std::uint32_t k_rollbackWarmUpFrames = 2 * RollbackGame::k_defaultWindow; // Snapshots reach their size
+
+    /**
+     * @brief One side of a cooperative game: a bot steers its own Pac-Man and predicts the other one.
+     */
+    struct RollbackPeer
+    {
+        RollbackPeer(const std::shared_ptr<const Manager>& level, const GameConfig& config, const std::uint8_t player,
+                     const int latencyTicks, const int jitterTicks):
+                m_game(level, config),
+                m_rollback(m_game),
+                m_bot(eBotType::e_GhostAvoiding, k_rollbackSeed * 31 + player),
+                m_outbox(latencyTicks, jitterTicks, k_rollbackSeed + player),
+                m_player(player)
+        {
+            m_game.SetSeed(k_rollbackSeed);
+            m_game.SetFixedTickSeconds(k_botTickSeconds);
+        }
+
+        Game m_game;
+        RollbackGame m_rollback;
+        PacManBot m_bot;
+        LatencyTransport m_outbox; ///< Inputs on their way to the other peer.
+        std::uint8_t m_player;
+    };
+
+    /**
+     * @brief Two peers play one co-op game over a simulated link and never wait for each other's input.
+     *
+     * Once the link is drained, both peers and a replay of the true inputs without rollbacks must reach
+     * the same state hash. Mean time is one Advance, re-simulation included.
+     * @return false if the peers diverged.
+     */
+    bool BenchmarkRollback(const std::shared_ptr<const Manager>& level, const int latencyTicks, const int jitterTicks)
+    {
+        GameConfig config;
+        config.m_pacMen = 2;
+        std::unique_ptr<RollbackPeer> peers[2] = {
+                std::make_unique<RollbackPeer>(level, config, 0, latencyTicks, jitterTicks),
+                std::make_unique<RollbackPeer>(level, config, 1, latencyTicks, jitterTicks)
+        };
+
+        std::vector<TickInput> inputs; // What the players actually pressed, two per tick
+        inputs.reserve(2 * k_rollbackFrames);
+        std::vector<std::uint32_t> advanceNanoseconds;
+        advanceNanoseconds.reserve(2 * k_rollbackFrames);
+        std::uint64_t allocations = 0;
+
+        std::uint32_t frame = 0;
+        for (; frame < k_rollbackFrames && !(peers[0]->m_game.IsGameOver() && peers[1]->m_game.IsGameOver()); ++frame)
+        {
+            for (auto& peer : peers)
+            {
+                const TickInput input{ frame, peer->m_player, peer->m_bot.Choose(peer->m_game, peer->m_player) };
+                peer->m_rollback.AddInput(input);
+                peer->m_outbox.Send(input, frame);
+                inputs.push_back(input);
+            }
+            for (std::size_t i = 0; i < 2; ++i)
+            {
+                peers[1 - i]->m_outbox.Deliver(frame, [&](const TickInput& input) { peers[i]->m_rollback.AddInput(input); });
+            }
+            for (auto& peer : peers)
+            {
+                const std::uint64_t advanceAllocations = t_allocations;
+                const auto start = std::chrono::steady_clock::now();
+                peer->m_rollback.Advance();
+                const auto elapsed = std::chrono::steady_clock::now() - start;
+                advanceNanoseconds.push_back(static_cast<std::uint32_t>(
+                        std::min<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                                               std::numeric_limits<std::uint32_t>::max())));
+                if (frame >= k_rollbackWarmUpFrames) allocations += t_allocations - advanceAllocations;
+            }
+        }
+
+        // With every input delivered the last predictions are corrected without starting a new tick
+        for (std::size_t i = 0; i < 2; ++i)
+        {
+            peers[1 - i]->m_outbox.Flush([&](const TickInput& input) { peers[i]->m_rollback.AddInput(input); });
+            peers[i]->m_rollback.Resimulate();
+        }
+
+        Game replayGame(level, config);
+        RollbackGame replay(replayGame);
+        replayGame.SetSeed(k_rollbackSeed);
+        replayGame.SetFixedTickSeconds(k_botTickSeconds);
+        for (std::uint32_t tick = 0; tick < frame; ++tick)
+        {
+            replay.AddInput(inputs[2 * tick]);
+            replay.AddInput(inputs[2 * tick + 1]);
+            replay.Advance();
+        }
+
+        const std::uint64_t hash = replayGame.GetStateHash();
+        bool consistent = replay.GetStats().m_rollbacks == 0;
+        for (auto& peer : peers)
+        {
+            consistent &= peer->m_game.GetStateHash() == hash && peer->m_game.ComputeStateHash() == hash &&
+                          peer->m_rollback.GetConfirmedTick() == frame;
+        }
+
+        const RollbackStats& stats = peers[0]->m_rollback.GetStats();
+        std::uint64_t resimulated = 0;
+        std::uint64_t rollbacks = 0;
+        std::uint64_t late = 0;
+        std::uint32_t deepest = 0;
+        for (auto& peer : peers)
+        {
+            resimulated += peer->m_rollback.GetStats().m_resimulatedTicks;
+            rollbacks += peer->m_rollback.GetStats().m_rollbacks;
+            late += peer->m_rollback.GetStats().m_lateInputs;
+            deepest = std::max(deepest, peer->m_rollback.GetStats().m_maxRollbackTicks);
+        }
+
+        const double mean = std::accumulate(advanceNanoseconds.begin(), advanceNanoseconds.end(), 0.0) /
+                            static_cast<double>(advanceNanoseconds.size());
+        const auto p99 = advanceNanoseconds.begin() + static_cast<std::ptrdiff_t>(advanceNanoseconds.size() * 99 / 100);
+        std::nth_element(advanceNanoseconds.begin(), p99, advanceNanoseconds.end());
+        const std::uint32_t slowest = *std::max_element(advanceNanoseconds.begin(), advanceNanoseconds.end());
+
+        char note[256];
+        std::snprintf(note, sizeof(note),
+                      "p99 %u ns, max %u ns; %llu ticks, %.1f rollbacks and %.2f re-simulated ticks per 100 frames, "
+                      "deepest %u, %llu late, %llu allocs; %s",
+                      *p99, slowest, static_cast<unsigned long long>(stats.m_ticks),
+                      100.0 * static_cast<double>(rollbacks) / static_cast<double>(advanceNanoseconds.size()),
+                      100.0 * static_cast<double>(resimulated) / static_cast<double>(advanceNanoseconds.size()),
+                      deepest, static_cast<unsigned long long>(late), static_cast<unsigned long long>(allocations),
+                      consistent ? "peers agree" : "PEERS DIVERGED");
+        Report("rollback, latency " + std::to_string(latencyTicks) + "+" + std::to_string(jitterTicks) + " ticks",
+               mean, note);
+        return consistent;
+    }
+
+    /**
+     * @brief Rollback over links from instant to one that fills the whole rollback window.
+     * @return false if the peers of any link diverged.
+     */
+    bool BenchmarkRollbackSuite(const std::string& levelPath)
+    {
+        const std::shared_ptr<const Manager> level = AssetRegistry::Instance().GetLevel(levelPath);
+        if (!level) return false;
+        bool consistent = true;
+        for (const auto& link : { std::make_pair(0, 0), std::make_pair(2, 1), std::make_pair(4, 2), std::make_pair(6, 2) })
+        {
+            consistent &= BenchmarkRollback(level, link.first, link.second);
+        }
+        return consistent;
+    }
+
+    constexpr int k_mctsEpisodes = 3;
+    constexpr int k_mctsMaxTicks = 3000; // A won game takes about 1000 ticks, each searched for the whole budget
+
+    /**
+     * @brief The tree search agent plays seeded games at one time budget per move.
+     *
+     * Mean time is one move, search included; the score is compared with the ghost-avoiding bot on the same seeds.
+     */
+    void BenchmarkMcts(const std::shared_ptr<const Manager>& level, const std::chrono::microseconds budget,
+                       const std::int64_t baseline, const int baselineWins)
+    {
+        MctsOptions options;
+        options.m_budget = budget;
+        std::int64_t score = 0;
+        int wins = 0;
+        std::uint64_t ticks = 0;
+        MctsStats stats;
+        for (int episode = 0; episode < k_mctsEpisodes; ++episode)
+        {
+            const std::uint64_t seed = static_cast<std::uint64_t>(episode) + 1;
+            Game game(level);
+            game.SetSeed(seed);
+            game.SetFixedTickSeconds(k_botTickSeconds);
+
+            // Every Pac-Man of a co-op level gets its own agent; the agents search in turn
+            std::vector<std::unique_ptr<MctsAgent>> agents;
+            for (std::size_t i = 0; i < game.GetPacManCount(); ++i)
+            {
+                agents.push_back(std::make_unique<MctsAgent>(game, i, options, seed * 31 + i));
+            }
+            int tick = 0;
+            for (; tick < k_mctsMaxTicks && !game.IsGameOver(); ++tick)
+            {
+                for (auto& agent : agents)
+                {
+                    agent->Steer(game);
+                }
+                game.Update();
+            }
+
+            ticks += static_cast<std::uint64_t>(tick);
+            bool anyLivesLeft = false;
+            for (std::size_t i = 0; i < game.GetPacManCount(); ++i)
+            {
+                score += game.GetPacMan(i).GetPoints();
+                anyLivesLeft |= game.GetPacMan(i).GetLivesRemaining() > 0;
+            }
+            wins += game.IsGameOver() && anyLivesLeft;
+            for (const auto& agent : agents)
+            {
+                const MctsStats& agentStats = agent->GetStats();
+                stats.m_moves += agentStats.m_moves;
+                stats.m_rollouts += agentStats.m_rollouts;
+                stats.m_simulatedTicks += agentStats.m_simulatedTicks;
+                stats.m_searchSeconds += agentStats.m_searchSeconds;
+                stats.m_maxDepth = std::max(stats.m_maxDepth, agentStats.m_maxDepth);
+            }
+        }
+
+        const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        const double moves = static_cast<double>(std::max<std::uint64_t>(1, stats.m_moves));
+        const double searchSeconds = std::max(stats.m_searchSeconds, 1e-9);
+        char note[256];
+        std::snprintf(note, sizeof(note),
+                      "%u threads, %.0f rollouts/s, %.0f simulated ticks/s, %.0f rollouts/move, deepest %u; "
+                      "score mean %.0f (ghost-avoiding %.0f), %d/%d won (ghost-avoiding %d), %.0f ticks/game",
+                      threads, static_cast<double>(stats.m_rollouts) / searchSeconds,
+                      static_cast<double>(stats.m_simulatedTicks) / searchSeconds,
+                      static_cast<double>(stats.m_rollouts) / moves, stats.m_maxDepth,
+                      static_cast<double>(score) / k_mctsEpisodes, static_cast<double>(baseline) / k_mctsEpisodes,
+                      wins, k_mctsEpisodes, baselineWins, static_cast<double>(ticks) / k_mctsEpisodes);
+        Report("mcts " + std::to_string(budget.count()) + " us/move", searchSeconds * 1e9 / moves, note);
+    }
+
+    /**
+     * @brief Score of the tree search agent against its time budget per move.
+     */
+    void BenchmarkMctsSuite(const std::string& levelPath)
+    {
+        const std::shared_ptr<const Manager> level = AssetRegistry::Instance().GetLevel(levelPath);
+        if (!level) return;
+        level->GetNavigation().Wait();
+
+        EpisodeTotals baseline;
+        for (int episode = 0; episode < k_mctsEpisodes; ++episode)
+        {
+            PlayEpisode(level, eBotType::e_GhostAvoiding, static_cast<std::uint64_t>(episode) + 1, baseline, nullptr);
+        }
+
+        for (const int milliseconds : { 1, 3, 10 })
+        {
+            BenchmarkMcts(level, std::chrono::milliseconds(milliseconds), baseline.m_score, baseline.m_wins);
+        }
+    }
+}
+
+/**
+ * @brief An entity whose wall check is called directly by the benchmark.
+ */
+class BlockadeProbe final : public Entity
+{
+public:
+    explicit BlockadeProbe(EntityStore& store):
+            Entity(store, {}, store.GetGridMetrics().GetCellSize(), eDirection::e_None, sf::Color::White)
+    {
+    }
+
+    void Check(const std::vector<std::vector<Tile>>& tiles, const sf::Vector2i position)
+    {
+        SetPosition(position);
+        CheckForBlockades(tiles);
+        m_store->Blocked(m_id) = 0;
+    }
+};
+
+/**
+ * @brief Pathfinding microbenchmarks. Ghost befriends it to time the neighbour lookup of its A* directly.
+ */
+struct PathfindingBenchmark
+{
+    /**
+     * @brief Start and goal positions of one search, in pixels.
+     */
+    struct SearchPair
+    {
+        sf::Vector2i m_start;
+        sf::Vector2i m_goal;
+    };
+
+    static void Run(const std::string& name, const Manager& level)
+    {
+        const GridMetrics& metrics = level.GetGridMetrics();
+        const auto& tiles = level.GetLevelData();
+        const int cells = metrics.GetColumns() * metrics.GetRows();
+        // A* rescans its lists, so on large levels the goal is a fixed number of steps away
+        const int distance = metrics.GetColumns() > 64 ? 64 : 0;
+        const std::vector<SearchPair> pairs = MakeSearchPairs(level, 64, distance);
+        if (pairs.empty())
+        {
+            std::cout << "Skipping " << name << ": no open cells" << std::endl;
+            return;
+        }
+        const int searches = std::clamp(4000000 / cells, 10, 500);
+
+        EntityStore store(metrics);
+        PacMan pacMan(store);
+        Ghost ghost(*GhostRegistry::Instance().Find(BlinkyPolicy::k_name), 0, tiles, store, level.GetNavigation(), pacMan);
+
+        std::size_t next = 0;
+        ReportOperation(MeasureOperation(name + " Ghost A*", searches, [&] {
+            const SearchPair& pair = pairs[next++ % pairs.size()];
+            ghost.SetPosition(pair.m_start);
+            ghost.PathFindToChaseTarget(pair.m_goal);
+            return ghost.Replan(std::numeric_limits<int>::max());
+        }));
+
+        std::size_t node = 0;
+        std::size_t neighbours = 0;
+        ReportOperation(MeasureOperation(name + " Ghost::GetNeighbourNodes", 1000000, [&] {
+            neighbours += ghost.GetNeighbourNodes(metrics, &ghost.m_nodes[node++ % ghost.m_nodes.size()]).m_count;
+        }));
+
+        {
+            PathService service(tiles, 1);
+            const int requester = service.Register();
+            std::size_t length = 0;
+            ReportOperation(MeasureOperation(name + " PathService round trip", searches, [&] {
+                const SearchPair& pair = pairs[next++ % pairs.size()];
+                service.Submit(requester, ToCell(metrics, pair.m_start), ToCell(metrics, pair.m_goal));
+                service.Wait();
+                service.Deliver([&](int, const std::vector<std::uint32_t>& path) { length += path.size(); });
+            }));
+            if (length == 0) std::cout << "no paths found" << std::endl;
+        }
+
+        {
+            // One cached field, so every goal rebuilds it
+            FlowFieldCache flowFields(tiles, 1);
+            ReportOperation(MeasureOperation(name + " FlowFieldCache build", std::clamp(searches / 4, 5, 100), [&] {
+                const sf::Vector2i goal = ToCell(metrics, pairs[next++ % pairs.size()].m_goal);
+                flowFields.Get(static_cast<std::uint32_t>(goal.y * metrics.GetColumns() + goal.x));
+            }));
+        }
+
+        std::vector<sf::Vector2i> interior;
+        for (std::size_t row = 1; row + 1 < tiles.size(); ++row)
+        {
+            for (std::size_t column = 1; column + 1 < tiles[row].size(); ++column)
+            {
+                if (tiles[row][column].m_type != eTileType::e_Wall) interior.push_back(tiles[row][column].m_position);
+            }
+        }
+        BlockadeProbe probe(store);
+        std::size_t position = 0;
+        ReportOperation(MeasureOperation(name + " Entity::CheckForBlockades", 1000000, [&] {
+            probe.Check(tiles, interior[position++ % interior.size()]);
+        }));
+
+        if (neighbours == 0) std::cout << "no neighbours visited" << std::endl;
+    }
+
+    static sf::Vector2i ToCell(const GridMetrics& metrics, const sf::Vector2i position)
+    {
+        return { metrics.ToColumn(position.x), metrics.ToRow(position.y) };
+    }
+
+    /**
+     * @brief Deterministic random pairs of open cells.
+     * @param distance Steps along the maze from start to goal (0 - goal anywhere on the level).
+     */
+    static std::vector<SearchPair> MakeSearchPairs(const Manager& level, const int count, const int distance)
+    {
+        const auto& tiles = level.GetLevelData();
+        const int columns = level.GetGridMetrics().GetColumns();
+        const int rows = level.GetGridMetrics().GetRows();
+        std::uint64_t state = 42;
+        auto random = [&state](const int bound) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            return static_cast<int>((state >> 33) % static_cast<std::uint64_t>(bound));
+        };
+        auto pickOpen = [&]() -> const Tile* {
+            for (int attempt = 0; attempt < 1024; ++attempt)
+            {
+                const Tile& tile = tiles[random(rows)][random(columns)];
+                if (tile.m_type != eTileType::e_Wall) return &tile;
+            }
+            return nullptr;
+        };
+
+        // Breadth-first search from the start: the last cell reached within the distance is the goal
+        std::vector<int> visited(static_cast<std::size_t>(columns) * rows, -1);
+        std::vector<int> frontier;
+        auto walk = [&](const Tile& start, const int search) -> const Tile* {
+            const int startCell = level.GetGridMetrics().ToRow(start.m_position.y) * columns +
+                                  level.GetGridMetrics().ToColumn(start.m_position.x);
+            frontier.assign(1, startCell);
+            visited[startCell] = search;
+            std::size_t depthEnd = frontier.size();
+            int depth = 0;
+            for (std::size_t head = 0; head < frontier.size() && depth < distance; ++head)
+            {
+                const int column = frontier[head] % columns;
+                const int row = frontier[head] / columns;
+                auto open = [&](const int c, const int r) {
+                    if (c < 0 || c >= columns || r < 0 || r >= rows) return;
+                    const int cell = r * columns + c;
+                    if (visited[cell] == search || tiles[r][c].m_type == eTileType::e_Wall) return;
+                    visited[cell] = search;
+                    frontier.push_back(cell);
+                };
+                open(column - 1, row);
+                open(column + 1, row);
+                open(column, row - 1);
+                open(column, row + 1);
+                if (head + 1 == depthEnd)
+                {
+                    ++depth;
+                    depthEnd = frontier.size();
+                }
+            }
+            return &tiles[frontier.back() / columns][frontier.back() % columns];
+        };
+
+        std::vector<SearchPair> pairs;
+        while (static_cast<int>(pairs.size()) < count)
+        {
+            const Tile* start = pickOpen();
+            if (!start) break;
+            const Tile* goal = distance > 0 ? walk(*start, static_cast<int>(pairs.size())) : pickOpen();
+            if (goal) pairs.push_back({ start->m_position, goal->m_position });
+        }
+        return pairs;
+    }
+};
+
+namespace
+{
+    void BenchmarkLoadLevel(const std::string& name, const std::string& csvPath, const int cells)
+    {
+        // The first load writes the navigation sidecar, timed loads map it
+        Manager manager;
+        manager.LoadLevel(csvPath);
+        manager.GetNavigation().Wait();
+        ReportOperation(MeasureOperation(name + " Manager::LoadLevel", std::clamp(2000000 / cells, 3, 200), [&] {
+            manager.LoadLevel(csvPath);
+        }));
+        manager.GetNavigation().Wait();
+    }
+
+    // The pathfinding suite over the shipped level and generated mazes from 32x32 to 1024x1024
+    void BenchmarkPathfindingSuite(const std::string& levelPath)
+    {
+        Manager shipped;
+        if (shipped.LoadLevel(levelPath))
+        {
+            shipped.GetNavigation().Wait();
+            BenchmarkLoadLevel("pathfinding Level.csv", levelPath,
+                               shipped.GetGridMetrics().GetColumns() * shipped.GetGridMetrics().GetRows());
+            PathfindingBenchmark::Run("pathfinding Level.csv", shipped);
+        } else
+        {
+            std::cout << "Skipping the shipped level in the pathfinding suite: couldn't open " << levelPath << std::endl;
+        }
+
+        for (const int size : { 32, 64, 128, 256, 512, 1024 })
+        {
+            const MazeParameters parameters = MakeParameters(size, 0.3f);
+            const std::string name = "pathfinding " + DescribeLevel(parameters);
+            const std::string csvPath = (std::filesystem::temp_directory_path() /
+                                         ("pacman_bench_pathfinding_" + DescribeLevel(parameters) + ".csv")).string();
+            lvl::save_level_csv(csvPath, lvl::generate_maze(parameters));
+
+            BenchmarkLoadLevel(name, csvPath, size * size);
+
+            Manager level;
+            level.LoadLevel(csvPath);
+            level.GetNavigation().Wait();
+            PathfindingBenchmark::Run(name, level);
+
+            std::filesystem::remove(csvPath);
+            std::filesystem::remove(csvPath + ".nav");
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string levelPath = cnp::default_level_path();
+    std::string jsonPath;
+    std::string resultsPath;
+    bool checkOnly = false;
+    bool pathfindingOnly = false;
+    bool throughputOnly = false;
+    bool rollbackOnly = false;
+    bool mctsOnly = false;
+    int episodes = 200;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--check-allocations") checkOnly = true;
+        else if (argument == "--pathfinding") pathfindingOnly = true;
+        else if (argument == "--throughput") throughputOnly = true;
+        else if (argument == "--rollback") rollbackOnly = true;
+        else if (argument == "--mcts") mctsOnly = true;
+        else if (argument == "--episodes" && i + 1 < argc) episodes = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--json" && i + 1 < argc) jsonPath = argv[++i];
+        else if (argument == "--results" && i + 1 < argc) resultsPath = argv[++i];
+        else levelPath = argument;
+    }
+
+    // The steady-state tick must not touch the heap; --check-allocations runs only this check
+    const bool allocationFree = CheckAllocations();
+    if (checkOnly)
+    {
+        return allocationFree ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (pathfindingOnly)
+    {
+        BenchmarkPathfindingSuite(levelPath);
+        if (!jsonPath.empty() && !WriteJson(jsonPath)) return EXIT_FAILURE;
+        return allocationFree ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Tournament runs keep every episode result in a match log (see pacman_results)
+    matchlog::MatchLogWriter results;
+    if (!resultsPath.empty())
+    {
+        std::string error;
+        if (!results.Open(resultsPath, error))
+        {
+            std::cout << "Couldn't open the match log: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    matchlog::MatchLogWriter* const resultLog = results.IsOpen() ? &results : nullptr;
+
+    if (throughputOnly)
+    {
+        const bool deterministic = BenchmarkThroughput(levelPath, episodes, resultLog) && results.Close();
+        if (!jsonPath.empty() && !WriteJson(jsonPath)) return EXIT_FAILURE;
+        return allocationFree && deterministic ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (rollbackOnly)
+    {
+        const bool consistent = BenchmarkRollbackSuite(levelPath);
+        if (!jsonPath.empty() && !WriteJson(jsonPath)) return EXIT_FAILURE;
+        return allocationFree && consistent ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (mctsOnly)
+    {
+        BenchmarkMctsSuite(levelPath);
+        if (!jsonPath.empty() && !WriteJson(jsonPath)) return EXIT_FAILURE;
+        return allocationFree ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    const bool embeddedCurrent = BenchmarkShippedLevel(levelPath);
+
+    for (const int size : { 1024, 4096 })
+    {
+        BenchmarkMazeGeneration(MakeParameters(size, 0.3f));
+    }
+    for (const int size : { 256, 1024, 4096 })
+    {
+        BenchmarkGeneratedLevel(MakeParameters(size, 0.3f));
+    }
+    for (const int size : { 256, 1024, 4096 })
+    {
+        BenchmarkNavigation(MakeParameters(size, 0.3f));
+    }
+
+    // Sparse mazes make long detours for A*, dense ones make wide open frontiers
+    const CorpusLevel k_gameCorpus[] = {
+            { "tree", MakeParameters(32, 0.f) },
+            { "loops", MakeParameters(32, 0.3f) },
+            { "tree", MakeParameters(64, 0.f) },
+            { "loops", MakeParameters(64, 0.3f) },
+            { "open", MakeParameters(64, 1.f) },
+            { "loops", MakeParameters(128, 0.3f) },
+            { "loops", MakeParameters(256, 0.3f) },
+    };
+    for (const auto& level : k_gameCorpus)
+    {
+        BenchmarkGame(level);
+    }
+
+    // Bots and ghost targeting read the fields every tick, so they must stay a few microseconds
+    for (const int size : { 32, 64, 128 })
+    {
+        BenchmarkDangerMap(MakeParameters(size, 0.3f));
+    }
+
+    for (const int ghosts : { 4, 16, 64, 256 })
+    {
+        BenchmarkHorde(MakeParameters(64, 0.3f), ghosts, 1);
+    }
+    BenchmarkHorde(MakeParameters(64, 0.3f), 256, 4);
+
+    for (const int size : { 64, 128 })
+    {
+        const MazeParameters parameters = MakeParameters(size, 0.3f);
+        BenchmarkTickLatency("lockstep, unbudgeted", parameters, { 0, {} }, false);
+        BenchmarkTickLatency("staggered, unbudgeted", parameters, { 0, {} }, true);
+        BenchmarkTickLatency("staggered, 1024 nodes/tick", parameters, {}, true);
+        BenchmarkTickLatency("staggered, 200 us/tick", parameters, { 0, std::chrono::microseconds(200) }, true);
+        BenchmarkTickLatency("lockstep, 2 path threads", parameters, { 0, {} }, false, 2);
+        BenchmarkTickLatency("staggered, 2 path threads", parameters, { 0, {} }, true, 2);
+    }
+
+    BenchmarkPathfindingSuite(levelPath);
+
+    // Complete games per second is the number capacity is planned against
+    const bool deterministic = BenchmarkThroughput(levelPath, episodes, resultLog) && results.Close();
+    const bool logged = BenchmarkMatchLog(1000000);
+
+    // Networked co-op re-simulates up to a window of ticks per frame
+    const bool consistent = BenchmarkRollbackSuite(levelPath);
+
+    // The built-in opponent: how much a longer search per move buys
+    BenchmarkMctsSuite(levelPath);
+
+    if (!jsonPath.empty() && !WriteJson(jsonPath)) return EXIT_FAILURE;
+    return allocationFree && embeddedCurrent && deterministic && logged && consistent ? EXIT_SUCCESS : EXIT_FAILURE;
+}
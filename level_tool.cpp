@@ -0,0 +1,133 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "LevelLoader.h"
+#include "MazeGenerator.h"
+#include "NavigationData.h"
+
+namespace
+{
+    int PrintUsage()
+    {
+        std::cout << "Usage:\n"
+                     "  pacman_level_tool compile <level.csv> <level.pml>   compile a CSV level to the binary format\n"
+                     "  pacman_level_tool info <level>                      print the dimensions of a level\n"
+                     "  pacman_level_tool nav <level> [<sidecar>]           build the navigation sidecar (<level>.nav)\n"
+                     "  pacman_level_tool generate <columns> <rows> <level> [options]\n"
+                     "                                                      generate a maze (CSV, or binary for .pml)\n"
+                     "    --seed <n>         generation seed (default 1)\n"
+                     "    --loops <0..1>     share of corridors kept beyond the spanning tree (default 0.3)\n"
+                     "    --tunnels <n>      rows with wrap-around tunnels (default 1)\n"
+                     "    --coins <0..1>     share of walkable cells with coins (default 0.9)\n"
+                     "    --power-ups <0..1> share of walkable cells with power-ups (default 0.01)\n"
+                     "    --threads <n>      generation threads (default: all cores)\n";
+        return EXIT_FAILURE;
+    }
+
+    bool Load(const std::string& filename, LevelGrid& grid)
+    {
+        std::string error;
+        if (!lvl::load_level(filename, grid, error))
+        {
+            std::cout << "Couldn't load the level: " + filename + " (" + error + ")" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    int Compile(const std::string& input, const std::string& output)
+    {
+        LevelGrid grid;
+        if (!Load(input, grid)) return EXIT_FAILURE;
+
+        if (!lvl::save_level_binary(output, grid))
+        {
+            std::cout << "Couldn't write " << output << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << input << " -> " << output << " (" << grid.m_columns << "x" << grid.m_rows << ")" << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    int Info(const std::string& input)
+    {
+        LevelGrid grid;
+        if (!Load(input, grid)) return EXIT_FAILURE;
+
+        int counts[5] = {};
+        for (const auto cell : grid.m_cells) ++counts[static_cast<int>(cell) + 1];
+
+        std::cout << input << ": " << grid.m_columns << "x" << grid.m_rows
+                  << ", paths " << counts[0] << ", walls " << counts[1] << ", coins " << counts[2]
+                  << ", power-ups " << counts[3] << ", wrap-arounds " << counts[4] << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    int BuildNavigation(const std::string& input, const std::string& output)
+    {
+        LevelGrid grid;
+        if (!Load(input, grid)) return EXIT_FAILURE;
+
+        const std::atomic<bool> cancel{false};
+        const std::vector<char> image = nav::build_navigation(grid, cancel);
+        if (!nav::save_navigation(output, image))
+        {
+            std::cout << "Couldn't write " << output << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << input << " -> " << output << " (" << image.size() << " bytes, level hash "
+                  << std::hex << nav::hash_level(grid) << std::dec << ")" << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    int Generate(const std::vector<std::string>& arguments)
+    {
+        MazeParameters parameters;
+        parameters.m_columns = std::atoi(arguments[0].c_str());
+        parameters.m_rows = std::atoi(arguments[1].c_str());
+        const std::string& output = arguments[2];
+
+        for (std::size_t i = 3; i + 1 < arguments.size(); i += 2)
+        {
+            const std::string& option = arguments[i];
+            const char* value = arguments[i + 1].c_str();
+            if (option == "--seed") parameters.m_seed = std::strtoull(value, nullptr, 10);
+            else if (option == "--loops") parameters.m_loopDensity = std::strtof(value, nullptr);
+            else if (option == "--tunnels") parameters.m_tunnels = std::atoi(value);
+            else if (option == "--coins") parameters.m_coinDensity = std::strtof(value, nullptr);
+            else if (option == "--power-ups") parameters.m_powerUpDensity = std::strtof(value, nullptr);
+            else if (option == "--threads") parameters.m_threads = static_cast<unsigned>(std::atoi(value));
+            else return PrintUsage();
+        }
+        if (arguments.size() % 2 == 0) return PrintUsage();
+
+        const LevelGrid grid = lvl::generate_maze(parameters);
+        const bool saved = lvl::is_binary_level(output) ? lvl::save_level_binary(output, grid)
+                                                        : lvl::save_level_csv(output, grid);
+        if (!saved)
+        {
+            std::cout << "Couldn't write " << output << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << output << " (" << grid.m_columns << "x" << grid.m_rows << ", seed " << parameters.m_seed << ")"
+                  << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) return PrintUsage();
+
+    const std::string command = argv[1];
+    if (command == "compile" && argc == 4) return Compile(argv[2], argv[3]);
+    if (command == "info" && argc == 3) return Info(argv[2]);
+    if (command == "nav" && (argc == 3 || argc == 4))
+    {
+        return BuildNavigation(argv[2], argc == 4 ? argv[3] : nav::sidecar_path(argv[2]));
+    }
+    if (command == "generate" && argc >= 5) return Generate(std::vector<std::string>(argv + 2, argv + argc));
+    return PrintUsage();
+}
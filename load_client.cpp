@@ -0,0 +1,507 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "NetProtocol.h"
+#include "np.h"
+
+namespace
+{
+    int PrintUsage()
+    {
+        std::cout << "Usage: pacman_load_client [options]\n"
+                     "  --connect <address:port>  server TCP address (default 127.0.0.1:7777)\n"
+                     "  --unix <path>             connect over a Unix socket instead\n"
+                     "  --clients <n>             players, each in a session of its own (default 100)\n"
+                     "  --spectators <n>          extra connections watching every player's session (default 0)\n"
+                     "  --ramp <n>                players connected per second, 0 = all at once (default 500)\n"
+                     "  --seconds <n>             test length (default 30)\n"
+                     "  --report <seconds>        report interval (default 5)\n"
+                     "  --seed <n>                seed of the random inputs (default 1)\n";
+        return EXIT_FAILURE;
+    }
+
+#ifdef __linux__
+    using Clock = std::chrono::steady_clock;
+
+    struct LoadOptions
+    {
+        std::string m_address = "127.0.0.1";
+        int m_port = 7777;
+        std::string m_unixPath;
+        int m_clients = 100;
+        int m_spectators = 0;
+        int m_ramp = 500;
+        int m_seconds = 30;
+        int m_reportSeconds = 5;
+        std::uint64_t m_seed = 1;
+    };
+
+    /**
+     * @brief One socket of the test: a player or a spectator of the player's session.
+     */
+    struct Client
+    {
+        int m_fd = -1;
+        int m_group = 0;
+        bool m_player = true;
+        bool m_connected = false;
+        bool m_welcomed = false;
+        std::vector<std::uint8_t> m_input;
+        std::vector<std::uint8_t> m_output;
+        Clock::time_point m_lastState;
+        std::uint32_t m_lastTick = 0;
+        net::StreamState m_state; ///< Rebuilt from the keyframe and the deltas.
+    };
+
+    /**
+     * @brief A player and its spectators; the group starts a new game when the old one ends.
+     */
+    struct Group
+    {
+        std::vector<int> m_clients; ///< m_clients[0] is the player.
+        std::uint32_t m_session = net::k_newSession;
+    };
+
+    struct Totals
+    {
+        std::uint64_t m_states = 0;
+        std::uint64_t m_bytes = 0;
+        std::uint64_t m_inputs = 0;
+        std::uint64_t m_games = 0;
+        std::uint64_t m_skippedTicks = 0;
+        std::uint64_t m_keyframes = 0;
+        std::uint64_t m_desyncs = 0;
+        std::uint64_t m_errors = 0;
+        std::vector<std::uint32_t> m_gapsMicroseconds; ///< Time between two states of one connection.
+    };
+
+    class LoadTest
+    {
+    public:
+        explicit LoadTest(const LoadOptions& options):
+                m_options(options),
+                m_random(options.m_seed)
+        {
+        }
+
+        int Run()
+        {
+            m_epoll = epoll_create1(EPOLL_CLOEXEC);
+            if (m_epoll < 0) return EXIT_FAILURE;
+
+            const int perGroup = 1 + m_options.m_spectators;
+            m_clients.resize(static_cast<std::size_t>(m_options.m_clients * perGroup));
+            m_groups.resize(static_cast<std::size_t>(m_options.m_clients));
+            for (int group = 0; group < m_options.m_clients; ++group)
+            {
+                for (int i = 0; i < perGroup; ++i)
+                {
+                    const int index = group * perGroup + i;
+                    m_clients[index].m_group = group;
+                    m_clients[index].m_player = i == 0;
+                    m_groups[group].m_clients.push_back(index);
+                }
+            }
+
+            const auto start = Clock::now();
+            const auto end = start + std::chrono::seconds(m_options.m_seconds);
+            auto nextReport = start + std::chrono::seconds(m_options.m_reportSeconds);
+            auto lastReport = start;
+            int started = 0;
+            std::array<epoll_event, 256> events{};
+            while (Clock::now() < end)
+            {
+                // Players join at the ramp rate so that the server is not measured on a connection storm
+                const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                const int due = m_options.m_ramp > 0
+                                ? std::min(m_options.m_clients, static_cast<int>(elapsed * m_options.m_ramp) + 1)
+                                : m_options.m_clients;
+                for (; started < due; ++started)
+                {
+                    StartGroup(started);
+                }
+
+                const int count = epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), 10);
+                for (int i = 0; i < count; ++i)
+                {
+                    const int index = static_cast<int>(events[i].data.u32);
+                    Client& client = m_clients[index];
+                    if (client.m_fd < 0) continue;
+                    if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    {
+                        Fail(index);
+                        continue;
+                    }
+                    if (events[i].events & EPOLLOUT) Flush(index);
+                    if ((events[i].events & EPOLLIN) && client.m_fd >= 0) Receive(index);
+                }
+                RestartFinished();
+
+                if (Clock::now() >= nextReport)
+                {
+                    Report(std::chrono::duration<double>(Clock::now() - lastReport).count(), false);
+                    lastReport = Clock::now();
+                    nextReport += std::chrono::seconds(m_options.m_reportSeconds);
+                }
+            }
+            Report(std::chrono::duration<double>(Clock::now() - lastReport).count(), true);
+
+            for (Client& client : m_clients)
+            {
+                if (client.m_fd >= 0) close(client.m_fd);
+            }
+            close(m_epoll);
+            return m_connectedEver > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+    private:
+        LoadOptions m_options;
+        hnp::SplitMix64 m_random;
+        int m_epoll = -1;
+        std::vector<Client> m_clients;
+        std::vector<Group> m_groups;
+        std::vector<int> m_finished; ///< Groups whose game ended this iteration.
+        Totals m_totals;
+        std::uint64_t m_connectedEver = 0;
+        std::vector<std::uint8_t> m_frame;
+
+        int Connect() const
+        {
+            int fd = -1;
+            if (!m_options.m_unixPath.empty())
+            {
+                sockaddr_un address{};
+                address.sun_family = AF_UNIX;
+                m_options.m_unixPath.copy(address.sun_path, sizeof(address.sun_path) - 1);
+                fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 &&
+                    errno != EINPROGRESS && errno != EAGAIN)
+                {
+                    close(fd);
+                    return -1;
+                }
+                return fd;
+            }
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(static_cast<std::uint16_t>(m_options.m_port));
+            if (inet_pton(AF_INET, m_options.m_address.c_str(), &address.sin_addr) != 1) return -1;
+            fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) return -1;
+            const int noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 && errno != EINPROGRESS)
+            {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        void Open(const int index, const net::JoinRequest& join)
+        {
+            Client& client = m_clients[index];
+            client.m_fd = Connect();
+            if (client.m_fd < 0)
+            {
+                ++m_totals.m_errors;
+                return;
+            }
+            client.m_connected = false;
+            client.m_welcomed = false;
+            client.m_lastTick = 0;
+            client.m_state = net::StreamState();
+            client.m_input.clear();
+            client.m_output.clear();
+            net::encode_join(client.m_output, join);
+
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLOUT;
+            event.data.u32 = static_cast<std::uint32_t>(index);
+            epoll_ctl(m_epoll, EPOLL_CTL_ADD, client.m_fd, &event);
+        }
+
+        void StartGroup(const int group)
+        {
+            m_groups[group].m_session = net::k_newSession;
+            Open(m_groups[group].m_clients[0], { net::k_newSession, net::eRole::e_Player });
+        }
+
+        void CloseClient(const int index)
+        {
+            Client& client = m_clients[index];
+            if (client.m_fd < 0) return;
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, client.m_fd, nullptr);
+            close(client.m_fd);
+            client.m_fd = -1;
+        }
+
+        /**
+         * @brief A broken connection ends its group's game; the group starts again.
+         */
+        void Fail(const int index)
+        {
+            ++m_totals.m_errors;
+            CloseClient(index);
+            m_finished.push_back(m_clients[index].m_group);
+        }
+
+        void RestartFinished()
+        {
+            std::sort(m_finished.begin(), m_finished.end());
+            m_finished.erase(std::unique(m_finished.begin(), m_finished.end()), m_finished.end());
+            for (const int group : m_finished)
+            {
+                for (const int index : m_groups[group].m_clients)
+                {
+                    CloseClient(index);
+                }
+                StartGroup(group);
+            }
+            m_finished.clear();
+        }
+
+        void Flush(const int index)
+        {
+            Client& client = m_clients[index];
+            if (!client.m_connected)
+            {
+                int error = 0;
+                socklen_t size = sizeof(error);
+                if (getsockopt(client.m_fd, SOL_SOCKET, SO_ERROR, &error, &size) != 0 || error != 0)
+                {
+                    Fail(index);
+                    return;
+                }
+                client.m_connected = true;
+                ++m_connectedEver;
+            }
+
+            while (!client.m_output.empty())
+            {
+                const ssize_t sent = send(client.m_fd, client.m_output.data(), client.m_output.size(), MSG_NOSIGNAL);
+                if (sent < 0)
+                {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    Fail(index);
+                    return;
+                }
+                client.m_output.erase(client.m_output.begin(), client.m_output.begin() + sent);
+            }
+
+            epoll_event event{};
+            event.events = EPOLLIN | (client.m_output.empty() ? 0u : EPOLLOUT);
+            event.data.u32 = static_cast<std::uint32_t>(index);
+            epoll_ctl(m_epoll, EPOLL_CTL_MOD, client.m_fd, &event);
+        }
+
+        void Receive(const int index)
+        {
+            Client& client = m_clients[index];
+            std::array<std::uint8_t, 16384> chunk{};
+            const ssize_t received = recv(client.m_fd, chunk.data(), chunk.size(), 0);
+            if (received <= 0)
+            {
+                if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) Fail(index);
+                return;
+            }
+            m_totals.m_bytes += static_cast<std::uint64_t>(received);
+            client.m_input.insert(client.m_input.end(), chunk.begin(), chunk.begin() + received);
+
+            std::size_t offset = 0;
+            net::Frame frame;
+            std::size_t next = 0;
+            bool malformed = false;
+            while (net::next_frame(client.m_input, offset, frame, next, malformed))
+            {
+                offset = next;
+                if (!HandleFrame(index, frame)) return;
+            }
+            if (malformed)
+            {
+                Fail(index);
+                return;
+            }
+            client.m_input.erase(client.m_input.begin(), client.m_input.begin() + static_cast<std::ptrdiff_t>(offset));
+        }
+
+        /**
+         * @return false if the connection was closed.
+         */
+        bool HandleFrame(const int index, const net::Frame& frame)
+        {
+            Client& client = m_clients[index];
+            Group& group = m_groups[client.m_group];
+            switch (frame.m_type)
+            {
+                case net::eMessageType::e_Welcome:
+                {
+                    net::Welcome welcome;
+                    if (!net::decode_welcome(frame, welcome)) break;
+                    client.m_welcomed = true;
+                    client.m_lastState = Clock::now();
+                    if (client.m_player)
+                    {
+                        // Spectators follow the session the server created for the player
+                        group.m_session = welcome.m_session;
+                        for (std::size_t i = 1; i < group.m_clients.size(); ++i)
+                        {
+                            Open(group.m_clients[i], { welcome.m_session, net::eRole::e_Spectator });
+                        }
+                    }
+                    break;
+                }
+                case net::eMessageType::e_Keyframe:
+                case net::eMessageType::e_Delta:
+                {
+                    // A delta that does not continue the client's state means the stream is broken
+                    if (!net::apply_state(frame, client.m_state))
+                    {
+                        ++m_totals.m_desyncs;
+                        Fail(index);
+                        return false;
+                    }
+                    const std::uint32_t tick = client.m_state.m_tick;
+                    const std::uint8_t flags = client.m_state.m_flags;
+                    m_totals.m_keyframes += frame.m_type == net::eMessageType::e_Keyframe;
+
+                    const auto now = Clock::now();
+                    if (client.m_lastTick != 0 && tick > client.m_lastTick + 1) m_totals.m_skippedTicks += tick - client.m_lastTick - 1;
+                    if (client.m_lastTick != 0)
+                    {
+                        m_totals.m_gapsMicroseconds.push_back(static_cast<std::uint32_t>(
+                                std::chrono::duration_cast<std::chrono::microseconds>(now - client.m_lastState).count()));
+                    }
+                    client.m_lastState = now;
+                    client.m_lastTick = tick;
+                    ++m_totals.m_states;
+
+                    if (flags & net::k_stateGameOver)
+                    {
+                        if (client.m_player)
+                        {
+                            ++m_totals.m_games;
+                            m_finished.push_back(client.m_group);
+                        }
+                        break;
+                    }
+
+                    // A player turns at about every fourth tick, like someone steering through a maze
+                    if (client.m_player && m_random.NextInt(4) == 0)
+                    {
+                        m_frame.clear();
+                        net::encode_input(m_frame, static_cast<std::uint8_t>(1 + m_random.NextInt(4)));
+                        client.m_output.insert(client.m_output.end(), m_frame.begin(), m_frame.end());
+                        ++m_totals.m_inputs;
+                        Flush(index);
+                        if (client.m_fd < 0) return false;
+                    }
+                    break;
+                }
+                case net::eMessageType::e_Error:
+                    std::cerr << "Server error: " << net::decode_error(frame) << std::endl;
+                    Fail(index);
+                    return false;
+                default:;
+            }
+            return true;
+        }
+
+        void Report(const double seconds, const bool final)
+        {
+            int connected = 0;
+            for (const Client& client : m_clients)
+            {
+                connected += client.m_fd >= 0 && client.m_welcomed;
+            }
+
+            auto& gaps = m_totals.m_gapsMicroseconds;
+            auto percentile = [&gaps](const std::size_t perMille) {
+                if (gaps.empty()) return 0.0;
+                const auto nth = gaps.begin() + static_cast<std::ptrdiff_t>(std::min(gaps.size() - 1, gaps.size() * perMille / 1000));
+                std::nth_element(gaps.begin(), nth, gaps.end());
+                return *nth / 1000.0;
+            };
+
+            char line[384];
+            std::snprintf(line, sizeof(line),
+                          "%s%d connections, %.0f states/s, %.2f MB/s received, %.0f inputs/s, %llu games finished, "
+                          "state gap p50 %.1f ms p99 %.1f ms max %.1f ms, %llu keyframes, %llu skipped ticks, %llu desyncs, %llu errors",
+                          final ? "final: " : "", connected,
+                          seconds > 0.0 ? static_cast<double>(m_totals.m_states) / seconds : 0.0,
+                          seconds > 0.0 ? static_cast<double>(m_totals.m_bytes) / seconds / (1024.0 * 1024.0) : 0.0,
+                          seconds > 0.0 ? static_cast<double>(m_totals.m_inputs) / seconds : 0.0,
+                          static_cast<unsigned long long>(m_totals.m_games),
+                          percentile(500), percentile(990), percentile(1000),
+                          static_cast<unsigned long long>(m_totals.m_keyframes),
+                          static_cast<unsigned long long>(m_totals.m_skippedTicks),
+                          static_cast<unsigned long long>(m_totals.m_desyncs),
+                          static_cast<unsigned long long>(m_totals.m_errors));
+            std::cout << line << std::endl;
+            m_totals = Totals();
+        }
+    };
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef __linux__
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (argument == "--connect" && hasValue)
+        {
+            const std::string target = argv[++i];
+            const std::size_t colon = target.rfind(':');
+            if (colon == std::string::npos) return PrintUsage();
+            options.m_address = target.substr(0, colon);
+            options.m_port = std::atoi(target.c_str() + colon + 1);
+        }
+        else if (argument == "--unix" && hasValue) options.m_unixPath = argv[++i];
+        else if (argument == "--clients" && hasValue) options.m_clients = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--spectators" && hasValue) options.m_spectators = std::max(0, std::atoi(argv[++i]));
+        else if (argument == "--ramp" && hasValue) options.m_ramp = std::max(0, std::atoi(argv[++i]));
+        else if (argument == "--seconds" && hasValue) options.m_seconds = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--report" && hasValue) options.m_reportSeconds = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--seed" && hasValue) options.m_seed = std::strtoull(argv[++i], nullptr, 10);
+        else return PrintUsage();
+    }
+
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    return LoadTest(options).Run();
+#else
+    (void)argc;
+    (void)argv;
+    std::cout << "pacman_load_client needs epoll (Linux)" << std::endl;
+    return EXIT_FAILURE;
+#endif
+}
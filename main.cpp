@@ -1,44 +1,249 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <string>
 #include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
 
+#include "FrameCapture.h"
 #include "Game.h"
+#include "Metrics.h"
+#include "Profiler.h"
+#include "ProfilerOverlay.h"
+#include "StateHash.h"
+#include "Tracer.h"
 
-class FPS
+/**
+ * @brief Параметры запуска из командной строки.
+ */
+struct LaunchOptions
 {
-public:
-    FPS() : m_frame(0), m_fps(0) {}
+    bool m_headless = false;
+    std::string m_capturePath;
+    eCaptureFormat m_captureFormat = eCaptureFormat::e_RawVideo;
+    long m_ticks = -1;
+    std::string m_tracePath;
+    std::string m_levelPath = cnp::default_level_path();
+    unsigned m_pathThreads = 2; // 0 keeps ghost pathfinding on the game thread
+    std::string m_configPath; // empty: <level>.cfg when present
+    bool m_seeded = false; // a seed also fixes the tick step, so runs repeat tick for tick
+    std::uint64_t m_seed = 0;
+    std::string m_hashTracePath;
+    std::string m_hashDiffA;
+    std::string m_hashDiffB;
+    std::string m_metricsSharedMemory; // segment name, e.g. /pacman-metrics
+    int m_metricsPort = 0; // 0: no text endpoint
+    std::string m_metricsRead;
+};
+
+constexpr float k_tickSeconds = 0.2f; // One game tick of the window loop
+
+LaunchOptions ParseLaunchOptions(int argc, char* argv[])
+{
+    LaunchOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--headless") options.m_headless = true;
+        else if (arg == "--capture" && hasValue) options.m_capturePath = argv[++i];
+        else if (arg == "--format" && hasValue)
+        {
+            const std::string format = argv[++i];
+            options.m_captureFormat = format == "png" ? eCaptureFormat::e_PngSequence : eCaptureFormat::e_RawVideo;
+        }
+        else if (arg == "--ticks" && hasValue) options.m_ticks = std::atol(argv[++i]);
+        else if (arg == "--trace" && hasValue) options.m_tracePath = argv[++i];
+        else if (arg == "--level" && hasValue) options.m_levelPath = argv[++i];
+        else if (arg == "--config" && hasValue) options.m_configPath = argv[++i];
+        else if (arg == "--seed" && hasValue)
+        {
+            options.m_seeded = true;
+            options.m_seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--hash-trace" && hasValue) options.m_hashTracePath = argv[++i];
+        else if (arg == "--hash-diff" && i + 2 < argc)
+        {
+            options.m_hashDiffA = argv[++i];
+            options.m_hashDiffB = argv[++i];
+        }
+        else if (arg == "--metrics-shm" && hasValue) options.m_metricsSharedMemory = argv[++i];
+        else if (arg == "--metrics-port" && hasValue) options.m_metricsPort = std::atoi(argv[++i]);
+        else if (arg == "--metrics-read" && hasValue) options.m_metricsRead = argv[++i];
+        else if (arg == "--path-threads" && hasValue)
+            options.m_pathThreads = static_cast<unsigned>(std::max(0l, std::atol(argv[++i])));
+        else
+        {
+            std::cout << "Usage: pacman [--headless] [--capture <path|->] [--format raw|png] [--ticks <n>] [--trace <file.json>]"
+                      << " [--level <level.csv|level.pml>] [--path-threads <n>] [--config <file.cfg>]"
+                      << " [--seed <n>] [--hash-trace <file>] [--hash-diff <trace> <trace>]"
+                      << " [--metrics-shm <name>] [--metrics-port <port>] [--metrics-read <name>]"
+                      << std::endl;
+        }
+    }
+    return options;
+}
+
+GameConfig LoadConfig(const LaunchOptions& options)
+{
+    if (options.m_configPath.empty()) return lvl::load_level_config(options.m_levelPath);
 
-    [[nodiscard]] unsigned int GetFPS() const { return m_fps; }
+    GameConfig config;
+    std::string error;
+    if (!lvl::load_config(options.m_configPath, config, error))
+    {
+        std::cerr << "Couldn't load the config: " << error << std::endl;
+    }
+    return config;
+}
+
+void ApplySeed(const LaunchOptions& options, Game& game)
+{
+    if (!options.m_seeded) return;
+    game.SetSeed(options.m_seed);
+    game.SetFixedTickSeconds(k_tickSeconds);
+}
+
+/**
+ * @brief Записывает хэш состояния после каждого тика и сверяет инкрементальный хэш с пересчитанным.
+ */
+class StateHashRecorder
+{
+public:
+    explicit StateHashRecorder(const std::string& path)
+    {
+        if (!path.empty() && !m_trace.Open(path)) std::cerr << "Cannot write the hash trace " << path << std::endl;
+    }
 
-    void Update()
+    void Record(const Game& game)
     {
-        if (m_clock.getElapsedTime().asSeconds() >= 1.f)
+        if (!m_trace.IsOpen()) return;
+        const std::uint64_t hash = game.GetStateHash();
+        if (!m_mismatchReported && hash != game.ComputeStateHash())
         {
-            m_fps = m_frame;
-            m_frame = 0;
-            m_clock.restart();
+            std::cerr << "Tick " << m_tick << ": the incremental state hash differs from a full recompute" << std::endl;
+            m_mismatchReported = true;
         }
+        m_trace.Record(m_tick++, hash);
+    }
 
-        ++m_frame;
+private:
+    HashTrace m_trace;
+    long m_tick = 0;
+    bool m_mismatchReported = false;
+};
+
+/**
+ * @brief Экспорт показателей на время работы игры.
+ */
+class MetricsExport
+{
+public:
+    explicit MetricsExport(const LaunchOptions& options)
+    {
+        if (!options.m_metricsSharedMemory.empty())
+        {
+            m_sharedMemory.Start(options.m_metricsSharedMemory, std::chrono::seconds(1));
+        }
+        if (options.m_metricsPort > 0)
+        {
+            m_endpoint.Start(options.m_metricsPort);
+        }
     }
+
 private:
-    unsigned int m_frame;
-    unsigned int m_fps;
-    sf::Clock m_clock;
+    metrics::SharedMemoryExporter m_sharedMemory;
+    metrics::TextEndpoint m_endpoint;
 };
 
+// Without a display there is no keyboard and no frame pacing: tick as fast as possible
+int RunHeadless(const LaunchOptions& options)
+{
+    Game game(options.m_levelPath, LoadConfig(options));
+    game.SetPathThreads(options.m_pathThreads);
+    ApplySeed(options, game);
+    const GridMetrics& gridMetrics = game.GetGridMetrics();
+    StateHashRecorder hashes(options.m_hashTracePath);
+
+    std::unique_ptr<FrameCapture> capture;
+    if (!options.m_capturePath.empty())
+    {
+        capture = std::make_unique<FrameCapture>(options.m_capturePath, options.m_captureFormat,
+                                                 gridMetrics.GetWidth(), gridMetrics.GetHeight());
+    }
+
+    const long ticks = options.m_ticks < 0 ? 1000 : options.m_ticks;
+    for (long tick = 0; tick < ticks; ++tick)
+    {
+        game.Update();
+        hashes.Record(game);
+        if (capture) capture->Capture(game);
+    }
+    return EXIT_SUCCESS;
+}
 
-int main()
+int main(int argc, char* argv[])
 {
-    sf::RenderWindow window(sf::VideoMode(800, 800), "SFML Pac-Man");
+    const LaunchOptions options = ParseLaunchOptions(argc, argv);
+    if (!options.m_hashDiffA.empty())
+    {
+        std::string report;
+        const bool same = HashTrace::Diff(options.m_hashDiffA, options.m_hashDiffB, report);
+        std::cout << report << std::endl;
+        return same ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (!options.m_metricsRead.empty())
+    {
+        std::vector<metrics::MetricValue> values;
+        std::string error;
+        if (!metrics::read_shared_memory(options.m_metricsRead, values, error))
+        {
+            std::cerr << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << metrics::format_text(values);
+        return EXIT_SUCCESS;
+    }
+
+    // Exporters run until main returns
+    MetricsExport metricsExport(options);
 
-    FPS fps;
+    if (!options.m_tracePath.empty())
+    {
+        trace::Tracer::Instance().Start(options.m_tracePath);
+    }
+
+    if (options.m_headless)
+    {
+        const int result = RunHeadless(options);
+        trace::Tracer::Instance().Stop();
+        return result;
+    }
 
-    Game game;
+    Game game(options.m_levelPath, LoadConfig(options));
+    game.SetPathThreads(options.m_pathThreads);
+    ApplySeed(options, game);
+    const GridMetrics& gridMetrics = game.GetGridMetrics();
+    StateHashRecorder hashes(options.m_hashTracePath);
+
+    sf::RenderWindow window(sf::VideoMode(gridMetrics.GetWidth(), gridMetrics.GetHeight()), "SFML Pac-Man");
+
+    ProfilerOverlay overlay;
+
+    std::unique_ptr<FrameCapture> capture;
+    if (!options.m_capturePath.empty())
+    {
+        capture = std::make_unique<FrameCapture>(options.m_capturePath, options.m_captureFormat,
+                                                 gridMetrics.GetWidth(), gridMetrics.GetHeight());
+    }
 
     sf::Clock clock;
+    sf::Clock frameClock;
+    const metrics::Histogram& frameMicroseconds = metrics::GameMetrics::Instance().m_frameMicroseconds;
 
     // Start the game loop
     while (window.isOpen())
@@ -50,26 +255,47 @@ int main()
             // Close window: exit
             if (event.type == sf::Event::Closed)
                 window.close();
-        }
 
-        game.Input();
+            // F1 toggles the profiler overlay
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F1)
+                overlay.Toggle();
 
-        fps.Update();
-        std::ostringstream ss;
-        ss << fps.GetFPS();
+            // F2 starts tracing, then pauses and resumes it
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F2)
+            {
+                auto& tracer = trace::Tracer::Instance();
+                if (!tracer.IsOpen()) tracer.Start("pacman_trace.json");
+                else tracer.SetEnabled(!tracer.IsEnabled());
+            }
+        }
 
-        window.setTitle("SFML Pac-Man   FPS: " + ss.str());
+        {
+            PACMAN_PROFILE_SCOPE("Input");
+            game.Input();
+        }
 
-        // Game tick every 100 ms
-        while (clock.getElapsedTime() >= sf::milliseconds(200))
+        // Game tick every k_tickSeconds
+        while (clock.getElapsedTime() >= sf::seconds(k_tickSeconds))
         {
             game.Update();
+            hashes.Record(game);
+            if (capture) capture->Capture(game);
             clock.restart();
         }
 
-        window.clear();
-        game.Render(window);
-        window.display();
+        {
+            PACMAN_PROFILE_SCOPE("Frame");
+            window.clear();
+            game.Render(window);
+            overlay.Render(window);
+
+            PACMAN_TRACE_SCOPE("Frame submit");
+            window.display();
+        }
+        overlay.FrameFinished();
+        frameMicroseconds.Observe(static_cast<std::uint64_t>(frameClock.restart().asMicroseconds()));
     }
+
+    trace::Tracer::Instance().Stop();
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -1,36 +1,107 @@
 #pragma once
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
 #include <vector>
 #include <string>
+#if defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
 #include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/System/Vector2.hpp>
 
 namespace cnp
 {
-    const int k_screenSize = 800;
-    const int k_gridSize = 32;
-    const int k_gridCellSize = k_screenSize / k_gridSize;
+    const int k_screenSize = 800; ///< Наибольший размер окна; клетки больших уровней уменьшаются под него.
+    const int k_gridSize = 32; ///< Размер стандартного уровня в клетках.
+    const int k_gridCellSize = k_screenSize / k_gridSize; ///< Размер клетки стандартного уровня и масштаб HUD.
     const int k_gridMovementCost = 10;
     const int k_ghostHomeTime = 7;
     const int k_pacManPowerUpTime = 5;
+    const int k_ghostReplanInterval = 10; ///< Период обновления пути призрака, в тиках.
+    const int k_replanNodeBudget = 1024; ///< Узлов A*, раскрываемых за тик всеми призраками.
+    const int k_classicGhostCount = 4; ///< Blinky, Pinky, Inky и Clyde.
 
-    const sf::Vector2i k_pacManSpawnPosition = { 375, 375 };
+    // Каталог данных рядом с программой, относительно каталога программы: копия data/ или установка
+    // (cmake --install кладет данные в PACMAN_INSTALL_DATA_DIR относительно каталога программ)
+#ifndef PACMAN_INSTALL_DATA_DIR
+#define PACMAN_INSTALL_DATA_DIR "../share/pacman/"
+#endif
+    // Запасной каталог для разработки: CMake задает каталог data/ исходников
+#ifndef PACMAN_DATA_DIR
+#define PACMAN_DATA_DIR "../data/"
+#endif
 
-    const sf::Vector2i k_cornerPositions[]
-            {
-                    {cnp::k_gridCellSize,      2 * cnp::k_gridCellSize },
-                    {30 * cnp::k_gridCellSize, 2 * cnp::k_gridCellSize },
-                    {30 * cnp::k_gridCellSize, 29 * cnp::k_gridCellSize },
-                    {cnp::k_gridCellSize,      29 * cnp::k_gridCellSize }
-            };
+    /**
+     * @brief Путь к исполняемому файлу программы или пустой путь, если система его не сообщает.
+     */
+    inline std::filesystem::path executable_path()
+    {
+        std::error_code error;
+#if defined(_WIN32)
+        char* path = nullptr;
+        if (_get_pgmptr(&path) == 0 && path && *path) return path;
+        return {};
+#elif defined(__APPLE__)
+        char path[4096];
+        std::uint32_t size = sizeof(path);
+        if (_NSGetExecutablePath(path, &size) != 0) return {};
+        return std::filesystem::weakly_canonical(path, error);
+#else
+        std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", error);
+        return error ? std::filesystem::path() : path;
+#endif
+    }
 
-    const sf::Vector2i k_homePositions[]
+    /**
+     * @brief Каталог данных (со слешем в конце), выбирается один раз за процесс.
+     *
+     * Первый из каталогов, где есть Font.ttf: data/ рядом с программой, каталог установки
+     * относительно программы, каталог data/ исходников (PACMAN_DATA_DIR). Так программа, скопированная
+     * вместе с data/ или установленная через cmake --install, не зависит от дерева исходников.
+     */
+    inline const std::string& data_dir()
+    {
+        static const std::string directory = [] {
+            const std::filesystem::path executable = executable_path();
+            if (!executable.empty())
             {
-                    { 350, 375 },
-                    { 375, 375 },
-                    { 400, 375 },
-                    { 425, 375 }
-            };
+                const std::filesystem::path programDirectory = executable.parent_path();
+                for (const auto& candidate : { programDirectory / "data", programDirectory / PACMAN_INSTALL_DATA_DIR })
+                {
+                    std::error_code error;
+                    if (std::filesystem::is_regular_file(candidate / "Font.ttf", error))
+                    {
+                        return (candidate.lexically_normal() / "").generic_string();
+                    }
+                }
+            }
+            return std::string(PACMAN_DATA_DIR);
+        }();
+        return directory;
+    }
+
+    /**
+     * @brief Уровень по умолчанию.
+     */
+    inline const std::string& default_level_path()
+    {
+        static const std::string path = data_dir() + "Level.csv";
+        return path;
+    }
+
+    /**
+     * @brief Шрифт HUD и оверлея.
+     */
+    inline const std::string& font_path()
+    {
+        static const std::string path = data_dir() + "Font.ttf";
+        return path;
+    }
+
 }
 
 
@@ -80,11 +151,88 @@ namespace hnp
         return min + (rand() % (max - min + 1));
     }
 
-    constexpr int world_coord_to_array_index(const int worldCoord)
+    /**
+     * @brief Генератор SplitMix64: быстрый, детерминированный на всех платформах.
+     */
+    class SplitMix64
+    {
+    public:
+        explicit SplitMix64(const std::uint64_t seed) : m_state(seed) {}
+
+        std::uint64_t Next()
+        {
+            std::uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        /**
+         * @brief Равномерное число в [0, 1).
+         */
+        float NextFloat()
+        {
+            return static_cast<float>(Next() >> 40) / static_cast<float>(1ull << 24);
+        }
+
+        /**
+         * @brief Равномерное целое в [0, bound).
+         */
+        int NextInt(const int bound)
+        {
+            return static_cast<int>(Next() % static_cast<std::uint64_t>(bound));
+        }
+
+    private:
+        std::uint64_t m_state;
+    };
+
+    /**
+     * @brief Клетка уровня: столбец и строка.
+     */
+    struct GridCell
+    {
+        int m_column;
+        int m_row;
+    };
+
+    /**
+     * @brief Угол для разбегания и патрулирования призраков (0..3 по часовой стрелке от левого верхнего).
+     *
+     * Первая строка отведена под HUD, за ней идет стена, поэтому верхние углы находятся во второй строке.
+     */
+    constexpr GridCell corner_cell(const int index, const int columns, const int rows)
+    {
+        switch (index & 3)
+        {
+            case 0: return { 1, 2 };
+            case 1: return { columns - 2, 2 };
+            case 2: return { columns - 2, rows - 3 };
+            default: return { 1, rows - 3 };
+        }
+    }
+
+    /**
+     * @brief Клетка появления Пакмана (центр уровня).
+     */
+    constexpr GridCell pacman_spawn_cell(const int columns, const int rows)
+    {
+        return { columns / 2 - 1, rows / 2 - 1 };
+    }
+
+    /**
+     * @brief Домашняя клетка призрака: четыре клетки в ряд вокруг точки появления Пакмана.
+     */
+    constexpr GridCell home_cell(const int index, const int columns, const int rows)
     {
-        const int index = worldCoord / cnp::k_gridCellSize;
+        return { columns / 2 - 2 + (index & 3), rows / 2 - 1 };
+    }
+
+    constexpr int world_coord_to_array_index(const int worldCoord, const int cellSize, const int cellCount)
+    {
+        const int index = worldCoord / cellSize;
         if (index < 0) return 0;
-        if (index > cnp::k_gridSize - 1) return cnp::k_gridSize - 1;
+        if (index > cellCount - 1) return cellCount - 1;
         return index;
     }
 
@@ -103,3 +251,142 @@ namespace hnp
     }
 
 }
+
+
+/**
+ * @brief Размеры сетки, известные во время компиляции.
+ *
+ * Быстрый путь для стандартного уровня: деление на размер клетки и границы сетки
+ * становятся константами. Интерфейс совпадает с GridMetrics, поэтому горячие циклы
+ * (поиск пути, проверка препятствий) пишутся шаблоном над типом сетки.
+ */
+template<int Columns, int Rows>
+struct tStaticGrid
+{
+    static constexpr int k_columns = Columns;
+    static constexpr int k_rows = Rows;
+    static constexpr int k_cellSize = cnp::k_screenSize / (Columns > Rows ? Columns : Rows);
+
+    static constexpr int GetColumns() { return k_columns; }
+    static constexpr int GetRows() { return k_rows; }
+    static constexpr int GetCellSize() { return k_cellSize; }
+    static constexpr int GetWidth() { return k_columns * k_cellSize; }
+    static constexpr int GetHeight() { return k_rows * k_cellSize; }
+
+    static constexpr int ToColumn(const int x) { return hnp::world_coord_to_array_index(x, k_cellSize, k_columns); }
+    static constexpr int ToRow(const int y) { return hnp::world_coord_to_array_index(y, k_cellSize, k_rows); }
+};
+
+using DefaultGrid = tStaticGrid<cnp::k_gridSize, cnp::k_gridSize>;
+
+/**
+ * @brief Размеры загруженного уровня: количество клеток и размер клетки в пикселях.
+ *
+ * Для уровня 32x32 методы Dispatch передают в шаблонный код DefaultGrid с константами,
+ * для остальных размеров - сам объект GridMetrics.
+ */
+class GridMetrics
+{
+public:
+    /**
+     * @brief Метрики стандартного уровня 32x32.
+     */
+    GridMetrics() : GridMetrics(cnp::k_gridSize, cnp::k_gridSize) {}
+
+    /**
+     * @brief Метрики уровня заданного размера. Клетка уменьшается так, чтобы уровень поместился в k_screenSize.
+     * @param columns Количество столбцов.
+     * @param rows Количество строк.
+     */
+    GridMetrics(const int columns, const int rows) :
+            m_columns(columns),
+            m_rows(rows),
+            m_cellSize(cnp::k_screenSize / (columns > rows ? columns : rows) > 0
+                       ? cnp::k_screenSize / (columns > rows ? columns : rows) : 1)
+    {
+    }
+
+    int GetColumns() const { return m_columns; }
+    int GetRows() const { return m_rows; }
+    int GetCellSize() const { return m_cellSize; }
+    int GetWidth() const { return m_columns * m_cellSize; }
+    int GetHeight() const { return m_rows * m_cellSize; }
+
+    int ToColumn(const int x) const { return hnp::world_coord_to_array_index(x, m_cellSize, m_columns); }
+    int ToRow(const int y) const { return hnp::world_coord_to_array_index(y, m_cellSize, m_rows); }
+
+    /**
+     * @brief Совпадает ли уровень со стандартным 32x32 (доступен быстрый путь DefaultGrid).
+     */
+    bool IsDefault() const
+    {
+        return m_columns == DefaultGrid::k_columns && m_rows == DefaultGrid::k_rows &&
+               m_cellSize == DefaultGrid::k_cellSize;
+    }
+
+    /**
+     * @brief Вызывает visitor с DefaultGrid для уровня 32x32 или с *this для остальных.
+     */
+    template<typename Visitor>
+    decltype(auto) Dispatch(Visitor&& visitor) const
+    {
+        if (IsDefault()) return visitor(DefaultGrid());
+        return visitor(*this);
+    }
+
+    /**
+     * @brief Позиция в пикселях по индексам клетки.
+     */
+    sf::Vector2i CellToWorld(const int column, const int row) const
+    {
+        return { column * m_cellSize, row * m_cellSize };
+    }
+
+    sf::Vector2i CellToWorld(const hnp::GridCell cell) const
+    {
+        return CellToWorld(cell.m_column, cell.m_row);
+    }
+
+    /**
+     * @brief Угол для разбегания и патрулирования призраков (см. hnp::corner_cell).
+     */
+    sf::Vector2i GetCornerPosition(const int index) const
+    {
+        return CellToWorld(hnp::corner_cell(index, m_columns, m_rows));
+    }
+
+    /**
+     * @brief Клетка появления Пакмана (центр уровня).
+     */
+    sf::Vector2i GetPacManSpawnPosition() const
+    {
+        return CellToWorld(hnp::pacman_spawn_cell(m_columns, m_rows));
+    }
+
+    /**
+     * @brief Домашняя клетка призрака (см. hnp::home_cell).
+     */
+    sf::Vector2i GetHomePosition(const int index) const
+    {
+        return CellToWorld(hnp::home_cell(index, m_columns, m_rows));
+    }
+
+    /**
+     * @brief Случайная позиция внутри стен уровня (без HUD и внешних стен).
+     * @param random Генератор игры: одно зерно воспроизводит всю партию.
+     */
+    sf::Vector2i GetRandomInteriorPosition(hnp::SplitMix64& random) const
+    {
+        const int width = GetWidth() - 3 * m_cellSize;
+        const int height = GetHeight() - 5 * m_cellSize;
+        return {
+                m_cellSize + random.NextInt(width + 1),
+                2 * m_cellSize + random.NextInt(height + 1)
+        };
+    }
+
+private:
+    int m_columns;
+    int m_rows;
+    int m_cellSize;
+};
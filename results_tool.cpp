@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "GhostPolicy.h"
+#include "MatchLog.h"
+#include "PacManBot.h"
+
+namespace
+{
+    int PrintUsage()
+    {
+        std::cout << "Usage:\n"
+                     "  pacman_results summary <log>          totals from the block headers, without reading results\n"
+                     "  pacman_results query <log> [options]  win rate and score distribution per bot\n"
+                     "    --bot <name>       only this bot: random-walk, greedy-coin or ghost-avoiding\n"
+                     "    --bucket <n>       score histogram bucket width (default 1000)\n";
+        return EXIT_FAILURE;
+    }
+
+    bool OpenLog(const std::string& path, matchlog::MatchLogReader& reader)
+    {
+        std::string error;
+        if (!reader.Open(path, error))
+        {
+            std::cout << "Couldn't open the match log: " << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    double Percent(const std::uint64_t part, const std::uint64_t whole)
+    {
+        return whole > 0 ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+    }
+
+    // Every block header summarises its results, so the totals never touch the results themselves
+    int Summary(const std::string& path)
+    {
+        matchlog::MatchLogReader reader;
+        if (!OpenLog(path, reader)) return EXIT_FAILURE;
+
+        std::uint64_t blocks = 0;
+        std::uint64_t results = 0;
+        std::uint64_t wins = 0;
+        std::uint64_t losses = 0;
+        std::uint64_t ticks = 0;
+        std::int64_t scoreSum = 0;
+        std::int32_t scoreMin = 0;
+        std::int32_t scoreMax = 0;
+        MatchBlockHeader block;
+        while (reader.NextBlock(block))
+        {
+            scoreMin = blocks == 0 ? block.m_scoreMin : std::min(scoreMin, block.m_scoreMin);
+            scoreMax = blocks == 0 ? block.m_scoreMax : std::max(scoreMax, block.m_scoreMax);
+            ++blocks;
+            results += block.m_count;
+            wins += block.m_wins;
+            losses += block.m_losses;
+            ticks += block.m_tickSum;
+            scoreSum += block.m_scoreSum;
+        }
+        if (results == 0)
+        {
+            std::cout << path << ": no results" << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::printf("%s: %llu results in %llu blocks\n", path.c_str(), static_cast<unsigned long long>(results),
+                    static_cast<unsigned long long>(blocks));
+        std::printf("  win rate %.2f%%, losses %.2f%%, unfinished %.2f%%\n", Percent(wins, results),
+                    Percent(losses, results), Percent(results - wins - losses, results));
+        std::printf("  score mean %.1f, min %d, max %d; %.0f ticks per game\n",
+                    static_cast<double>(scoreSum) / static_cast<double>(results), scoreMin, scoreMax,
+                    static_cast<double>(ticks) / static_cast<double>(results));
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * @brief Results of one bot collected by a query.
+     */
+    struct BotResults
+    {
+        std::uint64_t m_wins = 0;
+        std::uint64_t m_losses = 0;
+        std::vector<std::int32_t> m_scores;
+        std::vector<std::uint64_t> m_caughtBy; ///< Results whose last life was taken by each ghost type.
+    };
+
+    std::int32_t Percentile(std::vector<std::int32_t>& scores, const std::size_t perMille)
+    {
+        const auto nth = scores.begin() + static_cast<std::ptrdiff_t>((scores.size() - 1) * perMille / 1000);
+        std::nth_element(scores.begin(), nth, scores.end());
+        return *nth;
+    }
+
+    void PrintBot(const char* name, BotResults& bot, const int bucket)
+    {
+        const std::uint64_t count = bot.m_scores.size();
+        std::int64_t sum = 0;
+        for (const std::int32_t score : bot.m_scores) sum += score;
+
+        std::printf("%s: %llu results, win rate %.2f%%, losses %.2f%%\n", name, static_cast<unsigned long long>(count),
+                    Percent(bot.m_wins, count), Percent(bot.m_losses, count));
+        std::printf("  score mean %.1f, p50 %d, p90 %d, p99 %d\n",
+                    static_cast<double>(sum) / static_cast<double>(count), Percentile(bot.m_scores, 500),
+                    Percentile(bot.m_scores, 900), Percentile(bot.m_scores, 990));
+
+        std::printf("  last life taken by:");
+        for (std::size_t type = 0; type < bot.m_caughtBy.size(); ++type)
+        {
+            if (bot.m_caughtBy[type] == 0) continue;
+            const GhostPolicyInfo* policy = GhostRegistry::Instance().Get(static_cast<int>(type));
+            std::printf(" %s %llu", policy ? policy->m_name.c_str() : "unknown",
+                        static_cast<unsigned long long>(bot.m_caughtBy[type]));
+        }
+        std::printf("\n");
+
+        // The sorted scores make the histogram one pass
+        std::sort(bot.m_scores.begin(), bot.m_scores.end());
+        constexpr int k_barWidth = 50;
+        std::vector<std::pair<std::int32_t, std::uint64_t>> buckets;
+        std::uint64_t largest = 0;
+        for (const std::int32_t score : bot.m_scores)
+        {
+            const std::int32_t low = score >= 0 ? score / bucket * bucket : -((-score + bucket - 1) / bucket * bucket);
+            if (buckets.empty() || buckets.back().first != low) buckets.emplace_back(low, 0);
+            largest = std::max(largest, ++buckets.back().second);
+        }
+        for (const auto& entry : buckets)
+        {
+            const int bar = static_cast<int>(entry.second * k_barWidth / largest);
+            std::printf("  %8d..%-8d %8llu %s\n", entry.first, entry.first + bucket - 1,
+                        static_cast<unsigned long long>(entry.second), std::string(static_cast<std::size_t>(bar), '#').c_str());
+        }
+    }
+
+    int Query(const std::string& path, const std::vector<std::string>& options)
+    {
+        int bucket = 1000;
+        int onlyBot = -1;
+        for (std::size_t i = 0; i < options.size(); i += 2)
+        {
+            if (i + 1 >= options.size()) return PrintUsage();
+            const std::string& option = options[i];
+            if (option == "--bucket") bucket = std::max(1, std::atoi(options[i + 1].c_str()));
+            else if (option == "--bot")
+            {
+                eBotType type;
+                if (!parse_bot_type(options[i + 1], type))
+                {
+                    std::cout << "Unknown bot: " << options[i + 1] << std::endl;
+                    return EXIT_FAILURE;
+                }
+                onlyBot = static_cast<int>(type);
+            } else return PrintUsage();
+        }
+
+        matchlog::MatchLogReader reader;
+        if (!OpenLog(path, reader)) return EXIT_FAILURE;
+
+        // The bot mask of a block header lets a query for one bot skip the blocks without its results
+        std::vector<BotResults> bots(32);
+        std::uint64_t scanned = 0;
+        std::uint64_t skipped = 0;
+        std::uint64_t corrupted = 0;
+        MatchBlockHeader block;
+        std::vector<MatchResult> records;
+        while (reader.NextBlock(block))
+        {
+            if (onlyBot >= 0 && !(block.m_botMask & (1u << onlyBot)))
+            {
+                ++skipped;
+                continue;
+            }
+            if (!reader.ReadRecords(records))
+            {
+                ++corrupted;
+                continue;
+            }
+            ++scanned;
+            for (const MatchResult& record : records)
+            {
+                if (onlyBot >= 0 && record.m_bot != onlyBot) continue;
+                BotResults& bot = bots[record.m_bot & 31];
+                bot.m_wins += record.m_outcome == eMatchOutcome::e_Win;
+                bot.m_losses += record.m_outcome == eMatchOutcome::e_Loss;
+                bot.m_scores.push_back(record.m_score);
+                if (record.m_caughtBy >= 0)
+                {
+                    if (bot.m_caughtBy.size() <= static_cast<std::size_t>(record.m_caughtBy))
+                    {
+                        bot.m_caughtBy.resize(static_cast<std::size_t>(record.m_caughtBy) + 1);
+                    }
+                    ++bot.m_caughtBy[record.m_caughtBy];
+                }
+            }
+        }
+
+        std::printf("%s: %llu blocks scanned, %llu skipped by the index, %llu failed the checksum\n", path.c_str(),
+                    static_cast<unsigned long long>(scanned), static_cast<unsigned long long>(skipped),
+                    static_cast<unsigned long long>(corrupted));
+        for (std::size_t type = 0; type < bots.size(); ++type)
+        {
+            if (bots[type].m_scores.empty()) continue;
+            PrintBot(to_string(static_cast<eBotType>(type)), bots[type], bucket);
+        }
+        return corrupted == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) return PrintUsage();
+
+    const std::string command = argv[1];
+    if (command == "summary" && argc == 3) return Summary(argv[2]);
+    if (command == "query") return Query(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    return PrintUsage();
+}
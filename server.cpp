@@ -0,0 +1,124 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include "AssetRegistry.h"
+#include "GameConfig.h"
+#include "GameServer.h"
+#include "LevelLoader.h"
+#include "Metrics.h"
+
+namespace
+{
+    int PrintUsage()
+    {
+        std::cout << "Usage: pacman_server [options]\n"
+                     "  --bind <address>     TCP address to listen on (default 127.0.0.1)\n"
+                     "  --port <n>           TCP port, 0 disables TCP (default 7777)\n"
+                     "  --unix <path>        also listen on a Unix socket\n"
+                     "  --workers <n>        event loops, 0 = one per core (default 0)\n"
+                     "  --tick-ms <n>        game tick length (default 200)\n"
+                     "  --level <level>      level shared by all sessions (default data/Level.csv)\n"
+                     "  --config <file.cfg>  Pac-Men (player seats per session) and ghosts\n"
+                     "  --report <seconds>   load report interval (default 5)\n"
+                     "  --seconds <n>        stop after n seconds (default: run until interrupted)\n"
+                     "  --metrics-port <n>   serve the metrics registry as text on 127.0.0.1\n";
+        return EXIT_FAILURE;
+    }
+
+#ifdef PACMAN_SERVER_EPOLL
+    server::GameServer* g_server = nullptr;
+
+    void RequestStop(int)
+    {
+        if (g_server) g_server->RequestStop();
+    }
+
+    // Every client holds a socket: thousands of sessions need more than the default 1024 descriptors
+    void RaiseDescriptorLimit()
+    {
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == limit.rlim_max) return;
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef PACMAN_SERVER_EPOLL
+    std::string address = "127.0.0.1";
+    int port = 7777;
+    std::string unixPath;
+    unsigned workers = 0;
+    int tickMilliseconds = 200;
+    std::string levelPath = cnp::default_level_path();
+    std::string configPath;
+    int reportSeconds = 5;
+    int seconds = 0;
+    int metricsPort = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (argument == "--bind" && hasValue) address = argv[++i];
+        else if (argument == "--port" && hasValue) port = std::atoi(argv[++i]);
+        else if (argument == "--unix" && hasValue) unixPath = argv[++i];
+        else if (argument == "--workers" && hasValue) workers = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        else if (argument == "--tick-ms" && hasValue) tickMilliseconds = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--level" && hasValue) levelPath = argv[++i];
+        else if (argument == "--config" && hasValue) configPath = argv[++i];
+        else if (argument == "--report" && hasValue) reportSeconds = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--seconds" && hasValue) seconds = std::max(0, std::atoi(argv[++i]));
+        else if (argument == "--metrics-port" && hasValue) metricsPort = std::atoi(argv[++i]);
+        else return PrintUsage();
+    }
+
+    GameConfig config = lvl::load_level_config(levelPath);
+    std::string error;
+    if (!configPath.empty() && !lvl::load_config(configPath, config, error))
+    {
+        std::cout << "Couldn't load the config: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::shared_ptr<const Manager> level = AssetRegistry::Instance().GetLevel(levelPath);
+    if (!level) return EXIT_FAILURE;
+
+    RaiseDescriptorLimit();
+    server::GameServer gameServer(level, config, std::chrono::milliseconds(tickMilliseconds), workers);
+    if (port > 0 && !gameServer.ListenTcp(address, port)) return EXIT_FAILURE;
+    if (!unixPath.empty() && !gameServer.ListenUnix(unixPath)) return EXIT_FAILURE;
+    if (port <= 0 && unixPath.empty()) return PrintUsage();
+
+    metrics::TextEndpoint metricsEndpoint;
+    if (metricsPort > 0) metricsEndpoint.Start(metricsPort);
+
+    g_server = &gameServer;
+    std::signal(SIGINT, RequestStop);
+    std::signal(SIGTERM, RequestStop);
+
+    std::cout << "Serving " << levelPath;
+    if (port > 0) std::cout << " on " << address << ":" << port;
+    if (!unixPath.empty()) std::cout << " and " << unixPath;
+    std::cout << ", " << tickMilliseconds << " ms ticks" << std::endl;
+
+    const bool served = gameServer.Run(std::cout, std::chrono::seconds(reportSeconds), std::chrono::seconds(seconds));
+
+    g_server = nullptr;
+    return served ? EXIT_SUCCESS : EXIT_FAILURE;
+#else
+    (void)argc;
+    (void)argv;
+    std::cout << "pacman_server needs epoll (Linux)" << std::endl;
+    return EXIT_FAILURE;
+#endif
+}